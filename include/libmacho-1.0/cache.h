@@ -0,0 +1,163 @@
+/**
+ * libmacho-1.0 - cache.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_CACHE_H_
+#define MACHO_CACHE_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/map.h>
+
+#define MACHO_CACHE_MAGIC "dyld_v1"
+
+struct macho_t_64;
+
+typedef struct macho_cache_header_t_64 {
+	char		magic[16];		/* e.g. "dyld_v1   arm64e" */
+	uint32_t	mappingOffset;		/* file offset to first dyld_cache_mapping_info */
+	uint32_t	mappingCount;		/* number of dyld_cache_mapping_info entries */
+	uint32_t	imagesOffsetOld;	/* file offset to first dyld_cache_image_info (pre iOS 16) */
+	uint32_t	imagesCountOld;		/* number of dyld_cache_image_info entries (pre iOS 16) */
+	uint64_t	dyldBaseAddress;	/* base address of dyld when cache was built */
+	uint64_t	codeSignatureOffset;	/* file offset of code signature blob */
+	uint64_t	codeSignatureSize;	/* size of code signature blob */
+	uint64_t	slideInfoOffsetUnused;
+	uint64_t	slideInfoSizeUnused;
+	uint64_t	localSymbolsOffset;	/* file offset of where local symbols are stored */
+	uint64_t	localSymbolsSize;	/* size of local symbols information */
+	uint8_t		uuid[16];		/* unique value for each shared cache file */
+	uint64_t	cacheType;
+	uint32_t	branchPoolsOffset;
+	uint32_t	branchPoolsCount;
+	uint64_t	dyldInCacheMH;
+	uint64_t	dyldInCacheEntry;
+	uint64_t	imagesTextOffset;
+	uint64_t	imagesTextCount;
+	uint64_t	patchInfoAddr;
+	uint64_t	patchInfoSize;
+	uint64_t	otherImageGroupAddrUnused;
+	uint64_t	otherImageGroupSizeUnused;
+	uint64_t	progClosuresAddr;
+	uint64_t	progClosuresSize;
+	uint64_t	progClosuresTrieAddr;
+	uint64_t	progClosuresTrieSize;
+	uint32_t	platform;
+	uint32_t	formatVersion;		/* bitfield: version, simulator, locally built... */
+	uint64_t	sharedRegionStart;	/* base load address of cache if not slid */
+	uint64_t	sharedRegionSize;
+	uint64_t	maxSlide;
+	uint64_t	dylibsImageArrayAddr;
+	uint64_t	dylibsImageArraySize;
+	uint64_t	dylibsTrieAddr;
+	uint64_t	dylibsTrieSize;
+	uint64_t	otherImageArrayAddr;
+	uint64_t	otherImageArraySize;
+	uint64_t	otherTrieAddr;
+	uint64_t	otherTrieSize;
+	uint32_t	mappingWithSlideOffset;
+	uint32_t	mappingWithSlideCount;
+	uint64_t	dylibsPBLStateArrayAddrUnused;
+	uint64_t	dylibsPBLSetAddr;
+	uint64_t	programsPBLSetPoolAddr;
+	uint64_t	programsPBLSetPoolSize;
+	uint64_t	programTrieAddr;
+	uint32_t	programTrieSize;
+	uint32_t	osVersion;
+	uint32_t	altPlatform;
+	uint32_t	altOsVersion;
+	uint64_t	swiftOptsOffset;
+	uint64_t	swiftOptsSize;
+	uint32_t	subCacheArrayOffset;	/* file offset to first dyld_subcache_entry */
+	uint32_t	subCacheArrayCount;	/* number of sub-cache files */
+	uint8_t		symbolFileUUID[16];
+	uint64_t	rosettaReadOnlyAddr;
+	uint64_t	rosettaReadOnlySize;
+	uint64_t	rosettaReadWriteAddr;
+	uint64_t	rosettaReadWriteSize;
+	uint32_t	imagesOffset;		/* file offset to first dyld_cache_image_info */
+	uint32_t	imagesCount;		/* number of dyld_cache_image_info entries */
+	uint32_t	cacheSubType;
+	uint32_t	padding;
+} macho_cache_header_t_64;
+
+typedef struct macho_cache_mapping_info_t_64 {
+	uint64_t	address;
+	uint64_t	size;
+	uint64_t	fileOffset;
+	uint32_t	maxProt;
+	uint32_t	initProt;
+} macho_cache_mapping_info_t_64;
+
+typedef struct macho_cache_image_info_t_64 {
+	uint64_t	address;
+	uint64_t	modTime;
+	uint64_t	inode;
+	uint32_t	pathFileOffset;
+	uint32_t	pad;
+} macho_cache_image_info_t_64;
+
+typedef struct macho_cache_subcache_entry_t_64 {
+	uint8_t		uuid[16];
+	uint64_t	cacheVMOffset;
+	char		fileSuffix[32];		/* only present in v2 entries */
+} macho_cache_subcache_entry_t_64;
+
+typedef struct macho_cache_file_t_64 {
+	char* path;
+	uint64_t address;		/* first VM address covered by this file */
+	uint64_t mapping_count;
+	macho_map_t_64* map;		/* NULL until the file is first touched */
+	macho_cache_mapping_info_t_64* mappings;
+} macho_cache_file_t_64;
+
+typedef struct macho_cache_image_t_64 {
+	uint64_t address;
+	const char* path;
+	struct macho_t_64* macho;	/* NULL until the image is first opened */
+} macho_cache_image_t_64;
+
+typedef struct macho_cache_t_64 {
+	uint64_t file_count;
+	uint64_t image_count;
+	macho_cache_header_t_64* header;
+	macho_cache_file_t_64** files;
+	macho_cache_image_t_64* images;
+} macho_cache_t_64;
+
+/*
+ * dyld Shared Cache Functions
+ */
+macho_cache_t_64* macho_cache_create_64();
+macho_cache_t_64* macho_cache_open_64(const char* path);
+unsigned char* macho_cache_translate_64(macho_cache_t_64* cache, uint64_t address, uint64_t* available);
+macho_cache_image_t_64* macho_cache_find_image_64(macho_cache_t_64* cache, const char* path);
+struct macho_t_64* macho_cache_image_load_64(macho_cache_t_64* cache, macho_cache_image_t_64* image);
+void macho_cache_debug_64(macho_cache_t_64* cache);
+void macho_cache_free_64(macho_cache_t_64* cache);
+
+/*
+ * dyld Shared Cache File Functions
+ */
+macho_cache_file_t_64* macho_cache_file_create_64();
+int macho_cache_file_load_64(macho_cache_file_t_64* file);
+void macho_cache_file_debug_64(macho_cache_file_t_64* file);
+void macho_cache_file_free_64(macho_cache_file_t_64* file);
+
+#endif /* MACHO_CACHE_H_ */
@@ -0,0 +1,65 @@
+/**
+ * libmacho-1.0 - callgraph.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_CALLGRAPH_H_
+#define MACHO_CALLGRAPH_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+
+#define MACHO_CALLGRAPH_NONE   UINT64_MAX // no node at the address
+#define MACHO_CALLGRAPH_IMPORT 0x1        // node is a stub for an imported symbol
+
+typedef struct macho_callgraph_node_t_64 {
+	uint64_t address;	/* function start or stub */
+	const char* name;	/* NULL if no symbol names the function */
+	uint32_t flags;		/* MACHO_CALLGRAPH_* */
+	uint32_t reserved;
+} macho_callgraph_node_t_64;
+
+/*
+ * Direct calls in compressed sparse row form. Functions come first in
+ *   address order, followed by one node per stub. The calls made by node i
+ *   are callees[offsets[i]] up to callees[offsets[i + 1]], in the order
+ *   they appear in the code, and sites holds the address of each call.
+ */
+typedef struct macho_callgraph_t_64 {
+	uint64_t node_count;
+	uint64_t function_count;	/* nodes before the first stub */
+	macho_callgraph_node_t_64* nodes;
+	uint64_t edge_count;
+	uint64_t* offsets;	/* node_count + 1 entries */
+	uint64_t* callees;	/* node index of each call target */
+	uint64_t* sites;
+	uint64_t unresolved;	/* calls into no function start or stub */
+	struct macho_t_64* macho;
+} macho_callgraph_t_64;
+
+/*
+ * Mach-O Call Graph Functions
+ */
+macho_callgraph_t_64* macho_callgraph_create_64();
+macho_callgraph_t_64* macho_callgraph_load_64(struct macho_t_64* macho);
+uint64_t macho_callgraph_find_64(macho_callgraph_t_64* graph, uint64_t address);
+void macho_callgraph_debug_64(macho_callgraph_t_64* graph);
+void macho_callgraph_free_64(macho_callgraph_t_64* graph);
+
+#endif /* MACHO_CALLGRAPH_H_ */
@@ -23,6 +23,7 @@
 #define MACHO_COMMAND_H_
 
 #include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
 
 #define	MACHO_CMD_SEGMENT          0x1  // segment of this file to be mapped
 #define	MACHO_CMD_SYMTAB           0x2  // link-edit stab symbol table info
@@ -47,21 +48,62 @@
 #define	MACHO_CMD_SUB_LIBRARY      0x15 // sub library
 #define	MACHO_CMD_TWOLEVEL_HINTS   0x16 // two-level namespace lookup hints
 #define	MACHO_CMD_PREBIND_CKSUM    0x17 // prebind checksum
+
+#define MACHO_CMD_REQ_DYLD         0x80000000 // dyld must understand the command
+
+#define	MACHO_CMD_LOAD_WEAK_DYLIB  (0x18 | MACHO_CMD_REQ_DYLD) // load a dylib that may be missing
+#define	MACHO_CMD_SEGMENT_64       0x19 // 64-bit segment of this file to be mapped
+#define	MACHO_CMD_ROUTINES_64      0x1A // 64-bit image routines
+#define	MACHO_CMD_UUID             0x1B // the uuid
+#define	MACHO_CMD_RPATH            (0x1C | MACHO_CMD_REQ_DYLD) // runpath additions
+#define	MACHO_CMD_CODE_SIGNATURE   0x1D // local of code signature
+#define	MACHO_CMD_SEGMENT_SPLIT_INFO 0x1E // local of info to split segments
+#define	MACHO_CMD_REEXPORT_DYLIB   (0x1F | MACHO_CMD_REQ_DYLD) // load and re-export dylib
+#define	MACHO_CMD_LAZY_LOAD_DYLIB  0x20 // delay load of dylib until first use
+#define	MACHO_CMD_ENCRYPTION_INFO  0x21 // encrypted segment information
+#define	MACHO_CMD_DYLD_INFO        0x22 // compressed dyld information
+#define	MACHO_CMD_DYLD_INFO_ONLY   (0x22 | MACHO_CMD_REQ_DYLD) // compressed dyld information only
+#define	MACHO_CMD_LOAD_UPWARD_DYLIB (0x23 | MACHO_CMD_REQ_DYLD) // load upward dylib
+#define	MACHO_CMD_VERSION_MIN_MACOSX 0x24 // build for MacOSX min OS version
+#define	MACHO_CMD_VERSION_MIN_IPHONEOS 0x25 // build for iPhoneOS min OS version
+#define	MACHO_CMD_FUNCTION_STARTS  0x26 // compressed table of function start addresses
+#define	MACHO_CMD_DYLD_ENVIRONMENT 0x27 // string for dyld to treat like environment variable
+#define	MACHO_CMD_MAIN             (0x28 | MACHO_CMD_REQ_DYLD) // replacement for LC_UNIXTHREAD
+#define	MACHO_CMD_DATA_IN_CODE     0x29 // table of non-instructions in __text
+#define	MACHO_CMD_SOURCE_VERSION   0x2A // source version used to build binary
+#define	MACHO_CMD_DYLIB_CODE_SIGN_DRS 0x2B // code signing DRs copied from linked dylibs
+#define	MACHO_CMD_ENCRYPTION_INFO_64 0x2C // 64-bit encrypted segment information
+#define	MACHO_CMD_LINKER_OPTION    0x2D // linker options in MH_OBJECT files
+#define	MACHO_CMD_LINKER_OPTIMIZATION_HINT 0x2E // optimization hints in MH_OBJECT files
+#define	MACHO_CMD_VERSION_MIN_TVOS 0x2F // build for AppleTV min OS version
+#define	MACHO_CMD_VERSION_MIN_WATCHOS 0x30 // build for Watch min OS version
+#define	MACHO_CMD_NOTE             0x31 // arbitrary data included within a Mach-O file
+#define	MACHO_CMD_BUILD_VERSION    0x32 // build for platform min OS version
+#define	MACHO_CMD_DYLD_EXPORTS_TRIE (0x33 | MACHO_CMD_REQ_DYLD) // used with linkedit_data_command, payload is trie
+#define	MACHO_CMD_DYLD_CHAINED_FIXUPS (0x34 | MACHO_CMD_REQ_DYLD) // used with linkedit_data_command
+#define	MACHO_CMD_FILESET_ENTRY    (0x35 | MACHO_CMD_REQ_DYLD) // used with fileset_entry_command
 //////macho_command_info_t_64
 ///macho_command_t_64_64
 
-typedef struct macho_command_info_t_64 {
-	uint64_t cmd;
-	uint64_t cmdsize;
+typedef struct MACHO_PACKED macho_command_info_t_64 {
+	uint32_t cmd;
+	uint32_t cmdsize;
 } macho_command_info_t_64;
 
+typedef struct MACHO_PACKED macho_linkedit_data_cmd_t_64 {
+	uint32_t cmd;		/* LC_CODE_SIGNATURE, LC_FUNCTION_STARTS, ... */
+	uint32_t cmdsize;	/* sizeof(struct macho_linkedit_data_cmd_t_64) */
+	uint32_t dataoff;	/* file offset of data in __LINKEDIT segment */
+	uint32_t datasize;	/* file size of data in __LINKEDIT segment */
+} macho_linkedit_data_cmd_t_64;
+
 typedef struct macho_command_t_64 {
 	uint64_t cmd;
 	uint64_t size;
 	uint64_t index;
 	uint64_t offset;
 	unsigned char* data;
-	macho_command_info_t_64* info;
+	macho_command_info_t_64* info;	/* view into the image data */
 } macho_command_t_64;
 
 /*
@@ -75,9 +117,9 @@ void macho_command_free_64(macho_command_t_64* command);
 /*
  * Mach-O Command Info Functions
  */
-macho_command_info_t_64* macho_command_info_create_64();
-macho_command_info_t_64* macho_command_info_load_64(unsigned char* data, uint64_t offset);
+static inline macho_command_info_t_64* macho_command_info_view_64(unsigned char* data, uint64_t offset) {
+	return (macho_command_info_t_64*) &data[offset];
+}
 void macho_command_info_debug_64(macho_command_info_t_64* info);
-void macho_command_info_free_64(macho_command_info_t_64* info);
 
 #endif /* MACHO_COMMAND_H_ */
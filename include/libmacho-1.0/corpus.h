@@ -0,0 +1,104 @@
+/**
+ * libmacho-1.0 - corpus.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_CORPUS_H_
+#define MACHO_CORPUS_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+
+#define MACHO_CORPUS_MAGIC "corpus02"
+
+#define MACHO_CORPUS_EXPORT 1 // external symbol defined by the binary
+#define MACHO_CORPUS_IMPORT 2 // external symbol the binary leaves undefined
+
+struct macho_map_t_64;
+
+/*
+ * The index file is laid out as the header, the postings, the symbols
+ *   sorted by name, the Bloom filters, the binaries and a string pool, so
+ *   an opened index is used straight from the mapping.
+ */
+typedef struct MACHO_PACKED macho_corpus_header_t_64 {
+	char magic[8];
+	uint64_t binary_count;
+	uint64_t symbol_count;
+	uint64_t posting_count;
+	uint64_t postings_offset;
+	uint64_t symbols_offset;
+	uint64_t blooms_offset;
+	uint64_t blooms_size;
+	uint64_t binaries_offset;
+	uint64_t strings_offset;
+	uint64_t strings_size;
+} macho_corpus_header_t_64;
+
+typedef struct MACHO_PACKED macho_corpus_posting_t_64 {
+	uint32_t binary;	/* binary ID, the index into the binaries */
+	uint32_t kind;		/* MACHO_CORPUS_EXPORT or MACHO_CORPUS_IMPORT */
+	uint64_t address;	/* n_value, zero for imports */
+} macho_corpus_posting_t_64;
+
+typedef struct MACHO_PACKED macho_corpus_symbol_t_64 {
+	uint64_t name;		/* offset into the string pool */
+	uint64_t posting;	/* first posting, ordered by binary */
+	uint64_t count;
+} macho_corpus_symbol_t_64;
+
+typedef struct MACHO_PACKED macho_corpus_binary_t_64 {
+	uint64_t path;		/* offset into the string pool */
+	uint64_t bloom;		/* offset into the Bloom filters */
+	uint32_t bloom_bits;	/* a power of two, zero without symbols */
+	uint32_t symbol_count;
+	uint64_t inode;		/* file identity when indexed, checked by updates */
+	uint64_t mtime;
+	uint64_t size;
+	uint8_t uuid[16];	/* LC_UUID, zero without one */
+} macho_corpus_binary_t_64;
+
+typedef struct macho_corpus_t_64 {
+	struct macho_map_t_64* map;
+	macho_corpus_header_t_64* header;	/* views into the mapping */
+	macho_corpus_posting_t_64* postings;
+	macho_corpus_symbol_t_64* symbols;
+	unsigned char* blooms;
+	macho_corpus_binary_t_64* binaries;
+	const char* strings;
+} macho_corpus_t_64;
+
+/*
+ * Mach-O Corpus Index Functions
+ */
+int macho_corpus_build_64(const char* directory, const char* output);
+int macho_corpus_update_64(const char* directory, const char* output);
+int macho_corpus_watch_64(const char* directory, const char* output, volatile int* stop);
+macho_corpus_t_64* macho_corpus_create_64();
+macho_corpus_t_64* macho_corpus_open_64(const char* path);
+const macho_corpus_posting_t_64* macho_corpus_lookup_64(macho_corpus_t_64* corpus, const char* name,
+		uint64_t* count);
+const macho_corpus_posting_t_64* macho_corpus_lookup_binary_64(macho_corpus_t_64* corpus, uint64_t binary,
+		const char* name, uint64_t* count);
+int macho_corpus_may_contain_64(macho_corpus_t_64* corpus, uint64_t binary, const char* name);
+uint64_t macho_corpus_binary_find_64(macho_corpus_t_64* corpus, const char* path);
+const char* macho_corpus_binary_path_64(macho_corpus_t_64* corpus, uint64_t binary);
+void macho_corpus_debug_64(macho_corpus_t_64* corpus);
+void macho_corpus_free_64(macho_corpus_t_64* corpus);
+
+#endif /* MACHO_CORPUS_H_ */
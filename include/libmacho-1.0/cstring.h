@@ -0,0 +1,69 @@
+/**
+ * libmacho-1.0 - cstring.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_CSTRING_H_
+#define MACHO_CSTRING_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+
+#define MACHO_CSTRING_EXACT     0 // string equals the pattern
+#define MACHO_CSTRING_PREFIX    1 // string starts with the pattern
+#define MACHO_CSTRING_SUBSTRING 2 // string contains the pattern
+
+typedef struct macho_cstring_entry_t_64 {
+	const char* string;	/* in the mapped image data */
+	uint64_t offset;	/* file offset of the first byte */
+	uint64_t address;	/* virtual address of the first byte */
+	uint64_t size;		/* length without the terminator */
+} macho_cstring_entry_t_64;
+
+/*
+ * Covers __cstring, __objc_methname, __oslogstring and every other section
+ *   typed as C string literals.
+ */
+typedef struct macho_cstring_index_t_64 {
+	uint64_t count;
+	macho_cstring_entry_t_64* entries;	/* sorted by file offset */
+	uint64_t* sorted;	/* entry numbers sorted by string */
+	uint64_t bucket_count;	/* a power of two */
+	uint64_t* buckets;	/* entry number plus one by content hash, zero if empty */
+	struct macho_t_64* macho;
+} macho_cstring_index_t_64;
+
+typedef struct macho_cstring_result_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t* matches;	/* entry numbers */
+} macho_cstring_result_t_64;
+
+/*
+ * Mach-O C String Index Functions
+ */
+macho_cstring_index_t_64* macho_cstring_index_create_64();
+macho_cstring_index_t_64* macho_cstring_index_load_64(struct macho_t_64* macho);
+macho_cstring_entry_t_64* macho_cstring_at_64(macho_cstring_index_t_64* index, uint64_t offset);
+macho_cstring_result_t_64* macho_find_cstrings_64(macho_cstring_index_t_64* index, const char* pattern, int mode);
+void macho_cstring_result_free_64(macho_cstring_result_t_64* result);
+void macho_cstring_index_debug_64(macho_cstring_index_t_64* index);
+void macho_cstring_index_free_64(macho_cstring_index_t_64* index);
+
+#endif /* MACHO_CSTRING_H_ */
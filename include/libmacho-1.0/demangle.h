@@ -0,0 +1,58 @@
+/**
+ * libmacho-1.0 - demangle.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_DEMANGLE_H_
+#define MACHO_DEMANGLE_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/symtab.h>
+
+struct macho_arena_t_64;
+
+/*
+ * Demangled names are memoized by string table offset, so aliases that
+ *   share a string are only demangled once. The names live in arenas
+ *   owned by the demangler and stay valid until it is freed.
+ */
+typedef struct macho_demangler_t_64 {
+	macho_symtab_t_64* symtab;
+	uint64_t count;			/* memoized entries */
+	uint64_t capacity;		/* hash slots, a power of two */
+	uint64_t* keys;			/* strx + 1, zero marks an empty slot */
+	const char** names;		/* NULL when the name is not mangled */
+	uint64_t arena_count;
+	struct macho_arena_t_64* arenas;	/* one per chunk of a range */
+	struct macho_arena_t_64* single;	/* names looked up one at a time */
+	struct macho_arena_t_64* scratch;	/* parser memory of single lookups */
+} macho_demangler_t_64;
+
+/*
+ * Mach-O Demangler Functions
+ */
+macho_demangler_t_64* macho_demangler_create_64(macho_symtab_t_64* symtab);
+const char* macho_demangle_64(macho_demangler_t_64* demangler, uint64_t index);
+int macho_demangle_range_64(macho_demangler_t_64* demangler, uint64_t start, uint64_t count,
+		const char** results);
+void macho_demangler_free_64(macho_demangler_t_64* demangler);
+
+// Itanium C++ or Swift symbol, returns a malloc'd string or NULL
+char* macho_demangle_string_64(const char* name);
+
+#endif /* MACHO_DEMANGLE_H_ */
@@ -0,0 +1,63 @@
+/**
+ * libmacho-1.0 - diff.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_DIFF_H_
+#define MACHO_DIFF_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#define MACHO_DIFF_SEGMENT  0x1
+#define MACHO_DIFF_SECTION  0x2
+#define MACHO_DIFF_SYMBOL   0x3
+
+#define MACHO_DIFF_ADDED    0x1 // only present in the new image
+#define MACHO_DIFF_REMOVED  0x2 // only present in the old image
+#define MACHO_DIFF_RESIZED  0x3 // present in both, size changed
+#define MACHO_DIFF_CHANGED  0x4 // present in both, same size, contents differ
+
+struct macho_t_64;
+
+typedef struct macho_diff_entry_t_64 {
+	uint32_t kind;		/* MACHO_DIFF_SEGMENT, _SECTION or _SYMBOL */
+	uint32_t change;	/* MACHO_DIFF_ADDED, _REMOVED, _RESIZED or _CHANGED */
+	char* name;		/* "__TEXT", "__TEXT,__text" or the symbol name */
+	uint64_t old_size;
+	uint64_t new_size;
+} macho_diff_entry_t_64;
+
+typedef struct macho_diff_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t identical;	/* sections skipped because their hashes matched */
+	int64_t size_delta;	/* file size difference, new - old */
+	macho_diff_entry_t_64* entries;
+} macho_diff_t_64;
+
+/*
+ * Mach-O Diff Functions
+ */
+macho_diff_t_64* macho_diff_create_64();
+macho_diff_t_64* macho_diff_load_64(struct macho_t_64* old_macho, struct macho_t_64* new_macho);
+void macho_diff_count_64(macho_diff_t_64* diff, uint32_t kind, uint32_t change, uint64_t* count, int64_t* delta);
+void macho_diff_debug_64(macho_diff_t_64* diff);
+void macho_diff_free_64(macho_diff_t_64* diff);
+
+#endif /* MACHO_DIFF_H_ */
@@ -0,0 +1,69 @@
+/**
+ * libmacho-1.0 - fat.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_FAT_H_
+#define MACHO_FAT_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/map.h>
+
+#define MACHO_FAT_MAGIC    0xCAFEBABE // fat_arch entries, 32-bit offsets
+#define MACHO_FAT_MAGIC_64 0xCAFEBABF // fat_arch_64 entries, 64-bit offsets
+
+#define MACHO_CPU_ARCH_ABI64    0x01000000
+#define MACHO_CPU_ARCH_ABI64_32 0x02000000
+#define MACHO_CPU_TYPE_X86      7
+#define MACHO_CPU_TYPE_X86_64   (MACHO_CPU_TYPE_X86 | MACHO_CPU_ARCH_ABI64)
+#define MACHO_CPU_TYPE_ARM      12
+#define MACHO_CPU_TYPE_ARM64    (MACHO_CPU_TYPE_ARM | MACHO_CPU_ARCH_ABI64)
+#define MACHO_CPU_TYPE_ARM64_32 (MACHO_CPU_TYPE_ARM | MACHO_CPU_ARCH_ABI64_32)
+#define MACHO_CPU_SUBTYPE_MASK  0xFF000000
+
+/* host order copy of a fat_arch or fat_arch_64 entry */
+typedef struct macho_fat_arch_t_64 {
+	uint32_t cputype;
+	uint32_t cpusubtype;
+	uint64_t offset;
+	uint64_t size;
+	uint32_t align;
+} macho_fat_arch_t_64;
+
+typedef struct macho_fat_t_64 {
+	uint32_t magic;
+	uint32_t count;
+	macho_map_t_64* map;
+	macho_fat_arch_t_64* archs;
+} macho_fat_t_64;
+
+/*
+ * Mach-O Universal Binary Functions
+ */
+macho_fat_t_64* macho_fat_create_64();
+macho_fat_t_64* macho_fat_open_64(const char* path);
+macho_fat_t_64* macho_fat_load_64(macho_map_t_64* map);
+int macho_fat_find_arch_64(macho_fat_t_64* fat, const char* name);
+const char* macho_fat_arch_name_64(uint32_t cputype, uint32_t cpusubtype);
+int macho_fat_extract_64(macho_fat_t_64* fat, uint32_t index, const char* path);
+int macho_fat_extract_all_64(macho_fat_t_64* fat, const char* directory);
+void macho_fat_debug_64(macho_fat_t_64* fat);
+void macho_fat_free_64(macho_fat_t_64* fat);
+
+#endif /* MACHO_FAT_H_ */
@@ -0,0 +1,54 @@
+/**
+ * libmacho-1.0 - find.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_FIND_H_
+#define MACHO_FIND_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/query.h>
+
+struct macho_t_64;
+
+#define MACHO_FIND_PREFIX 0 // name starts with the pattern
+#define MACHO_FIND_GLOB   1 // fnmatch(3) pattern over the whole name
+#define MACHO_FIND_REGEX  2 // POSIX extended regular expression
+
+typedef struct macho_name_entry_t_64 {
+	const char* name;	/* name in the mapped string table */
+	uint64_t symtab;	/* index into the symtab array */
+	uint64_t index;		/* symbol index within that symtab */
+} macho_name_entry_t_64;
+
+typedef struct macho_name_index_t_64 {
+	uint64_t count;
+	macho_name_entry_t_64* entries;	/* sorted by name */
+	struct macho_t_64* macho;
+} macho_name_index_t_64;
+
+/*
+ * Mach-O Symbol Name Index Functions
+ */
+macho_name_index_t_64* macho_name_index_create_64();
+macho_name_index_t_64* macho_name_index_load_64(struct macho_t_64* macho);
+macho_query_result_t_64* macho_find_symbols_64(macho_name_index_t_64* index, const char* pattern, int mode);
+void macho_name_index_debug_64(macho_name_index_t_64* index);
+void macho_name_index_free_64(macho_name_index_t_64* index);
+
+#endif /* MACHO_FIND_H_ */
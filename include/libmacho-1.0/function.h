@@ -0,0 +1,49 @@
+/**
+ * libmacho-1.0 - function.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_FUNCTION_H_
+#define MACHO_FUNCTION_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+
+#define MACHO_FUNCTION_NONE UINT64_MAX // address precedes every function
+
+/*
+ * Function start addresses, from LC_FUNCTION_STARTS when the image has one
+ *   and from the symbols defined in code sections otherwise.
+ */
+typedef struct macho_functions_t_64 {
+	uint64_t count;
+	uint64_t* starts;	/* sorted, without duplicates */
+	struct macho_t_64* macho;
+} macho_functions_t_64;
+
+/*
+ * Mach-O Function Start Functions
+ */
+macho_functions_t_64* macho_functions_create_64();
+macho_functions_t_64* macho_functions_load_64(struct macho_t_64* macho);
+uint64_t macho_functions_find_64(macho_functions_t_64* functions, uint64_t address);
+void macho_functions_debug_64(macho_functions_t_64* functions);
+void macho_functions_free_64(macho_functions_t_64* functions);
+
+#endif /* MACHO_FUNCTION_H_ */
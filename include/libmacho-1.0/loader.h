@@ -0,0 +1,47 @@
+/**
+ * libmacho-1.0 - loader.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_LOADER_H_
+#define MACHO_LOADER_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#define MACHO_LOADER_DEPTH   0x40 // default files in flight, read or waiting to be parsed
+
+#define MACHO_LOADER_THREADS 0 // blocking preads on a pool of I/O threads
+#define MACHO_LOADER_URING   1 // io_uring, Linux only
+
+struct macho_t_64;
+
+/*
+ * Called on a parse thread for every path holding a 64-bit Mach-O, in
+ *   completion order; the image and its data are freed once it returns.
+ *   Anything but zero stops the run.
+ */
+typedef int (*macho_loader_func_t_64)(uint64_t index, struct macho_t_64* macho, void* userdata);
+
+/*
+ * Mach-O Bulk Loader Functions
+ */
+int macho_loader_backend_64();
+int macho_loader_run_64(const char* const* paths, uint64_t count, uint32_t depth,
+		macho_loader_func_t_64 func, void* userdata);
+
+#endif /* MACHO_LOADER_H_ */
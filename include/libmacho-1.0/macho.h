@@ -24,6 +24,7 @@
 #include <libcrippy-1.0/debug.h>
 #include <libcrippy-1.0/libcrippy.h>
 
+#include "libmacho-1.0/view.h"
 #include "libmacho-1.0/symtab.h"
 #include "libmacho-1.0/segment.h"
 #include "libmacho-1.0/section.h"
@@ -33,28 +34,35 @@
 #define MACHO_MAGIC_64  0xFEEDFACF
 #define MACHO_MAGIC_FAT 0xCAFEBABE
 
-typedef struct macho_header_t_64 {
-	uint64_t magic;
-	uint64_t cputype;
-	uint64_t cpusubtype;
-	uint64_t filetype;
-	uint64_t ncmds;
-	uint64_t sizeofcmds;
-	uint64_t flags;
+typedef struct MACHO_PACKED macho_header_t_64 {
+	uint32_t magic;
+	uint32_t cputype;
+	uint32_t cpusubtype;
+	uint32_t filetype;
+	uint32_t ncmds;
+	uint32_t sizeofcmds;
+	uint32_t flags;
+	uint32_t reserved;
 } macho_header_t_64;
 
 typedef struct macho_t_64 {
-	uint16_t* data;
+	unsigned char* data;
 	uint64_t size;
 	uint64_t offset;
 	uint64_t command_count;
 	uint64_t segment_count;
 	uint64_t symtab_count;
-	macho_header_t_64* header;
+	uint64_t swapped;	/* data is a private byte-swapped copy, owned */
+	macho_header_t_64* header;	/* view into the image data */
 	macho_symtab_t_64** symtabs;
 	macho_command_t_64** commands;
 	macho_segment_t_64** segments;
 } macho_t_64;
+
+typedef struct macho_symbol_cursor_t_64 {
+	uint64_t symtab;	/* symtab to resume in, zero to start */
+	uint64_t index;		/* symbol to resume at within that symtab */
+} macho_symbol_cursor_t_64;
 //
 /*
  * Mach-O Functions
@@ -68,7 +76,10 @@ void macho_free_64(macho_t_64* macho);
 uint64_t macho_lookup_64(macho_t_64* macho, const char* sym);
 macho_segment_t_64* macho_get_segment_64(macho_t_64* macho, const char* segment);
 macho_section_t_64* macho_get_section_64(macho_t_64* macho, const char* segment, const char* section);
+uint64_t macho_offset_to_address_64(macho_t_64* macho, uint64_t offset);
 void macho_list_symbols_64(macho_t_64* macho, void (*print_func)(const char*, uint64_t, void*), void* userdata);
+uint64_t macho_symbols_next_64(macho_t_64* macho, macho_symbol_cursor_t_64* cursor,
+		const macho_symbol_filter_t_64* filter, macho_symbol_record_t_64* records, uint64_t max);
 
 
 int macho_handle_command_64(macho_t_64* macho, macho_command_t_64* command);
@@ -76,10 +87,8 @@ int macho_handle_command_64(macho_t_64* macho, macho_command_t_64* command);
 /*
  * Mach-O Header Functions
  */
-macho_header_t_64* macho_header_create_64();
 macho_header_t_64* macho_header_load_64(macho_t_64* macho);
 void macho_header_debug_64(macho_t_64* macho);
-void macho_header_free_64(macho_header_t_64* header);
 //macho_command_t_64_64
 /*
  * Mach-O Commands Functions
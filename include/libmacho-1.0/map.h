@@ -0,0 +1,58 @@
+/**
+ * libmacho-1.0 - map.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_MAP_H_
+#define MACHO_MAP_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#define MACHO_MAP_NORMAL	0	/* no expectation, the kernel default */
+#define MACHO_MAP_SEQUENTIAL	1	/* scanned front to back, read ahead */
+#define MACHO_MAP_RANDOM	2	/* probed by index lookups, no read ahead */
+#define MACHO_MAP_WILLNEED	3	/* about to be touched, start reading now */
+
+#define MACHO_MAP_HUGE_PAGE	0x200000
+
+typedef struct macho_map_t_64 {
+	int fd;
+	int huge;	/* anonymous copy backed by transparent huge pages */
+	char* path;
+	uint64_t size;
+	unsigned char* data;
+} macho_map_t_64;
+
+typedef struct macho_map_faults_t_64 {
+	uint64_t minor;	/* served without touching the disk */
+	uint64_t major;	/* had to wait for a read */
+} macho_map_faults_t_64;
+
+/*
+ * Mach-O File Mapping Functions
+ */
+macho_map_t_64* macho_map_create_64();
+macho_map_t_64* macho_map_open_64(const char* path);
+macho_map_t_64* macho_map_open_huge_64(const char* path);
+int macho_map_advise_64(macho_map_t_64* map, uint64_t offset, uint64_t size, int advice);
+void macho_map_faults_64(macho_map_faults_t_64* faults);
+void macho_map_debug_64(macho_map_t_64* map);
+void macho_map_free_64(macho_map_t_64* map);
+
+#endif /* MACHO_MAP_H_ */
@@ -0,0 +1,143 @@
+/**
+ * libmacho-1.0 - objc.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_OBJC_H_
+#define MACHO_OBJC_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+
+struct macho_t_64;
+struct macho_vm_t_64;
+
+#define MACHO_OBJC_RO_META              0x1        // class_ro_t of a metaclass
+#define MACHO_OBJC_DATA_MASK            0x7FFFFFFFFFF8ULL // class_ro_t address in the data field
+#define MACHO_OBJC_METHOD_LIST_RELATIVE 0x80000000 // entries are 32 bit relative offsets
+#define MACHO_OBJC_METHOD_LIST_ENTSIZE  0xFFFC     // mask for the entry size
+
+typedef struct MACHO_PACKED macho_objc_class_info_t_64 {
+	uint64_t isa;		/* metaclass */
+	uint64_t superclass;
+	uint64_t cache;
+	uint64_t vtable;
+	uint64_t data;		/* class_ro_t, low bits are Swift flags */
+} macho_objc_class_info_t_64;
+
+typedef struct MACHO_PACKED macho_objc_class_ro_t_64 {
+	uint32_t flags;		/* MACHO_OBJC_RO_* */
+	uint32_t instance_start;
+	uint32_t instance_size;
+	uint32_t reserved;
+	uint64_t ivar_layout;
+	uint64_t name;
+	uint64_t base_methods;
+	uint64_t base_protocols;
+	uint64_t ivars;
+	uint64_t weak_ivar_layout;
+	uint64_t base_properties;
+} macho_objc_class_ro_t_64;
+
+typedef struct MACHO_PACKED macho_objc_category_info_t_64 {
+	uint64_t name;
+	uint64_t cls;
+	uint64_t instance_methods;
+	uint64_t class_methods;
+	uint64_t protocols;
+	uint64_t instance_properties;
+} macho_objc_category_info_t_64;
+
+typedef struct MACHO_PACKED macho_objc_method_list_t_64 {
+	uint32_t entsize_and_flags;
+	uint32_t count;
+} macho_objc_method_list_t_64;
+
+typedef struct MACHO_PACKED macho_objc_method_info_t_64 {
+	uint64_t name;		/* selector string */
+	uint64_t types;
+	uint64_t imp;
+} macho_objc_method_info_t_64;
+
+typedef struct MACHO_PACKED macho_objc_relative_method_t_64 {
+	int32_t name;		/* to a selector reference, from this field */
+	int32_t types;		/* to the type string, from this field */
+	int32_t imp;		/* to the implementation, from this field */
+} macho_objc_relative_method_t_64;
+
+typedef struct macho_objc_method_t_64 {
+	const char* name;	/* in the mapped image data */
+	const char* types;	/* in the mapped image data */
+	uint64_t imp;		/* zero if the entry has none */
+} macho_objc_method_t_64;
+
+typedef struct macho_objc_methods_t_64 {
+	uint64_t list;		/* address of the method list, zero if none */
+	int loaded;		/* list decoded into methods */
+	uint64_t count;
+	macho_objc_method_t_64* methods;
+} macho_objc_methods_t_64;
+
+typedef struct macho_objc_class_t_64 {
+	uint64_t address;
+	const char* name;	/* in the mapped image data */
+	const char* superclass;	/* NULL for a root class or an unresolved bind */
+	uint32_t flags;		/* of the class_ro_t */
+	uint32_t instance_size;
+	macho_objc_methods_t_64 instance_methods;
+	macho_objc_methods_t_64 class_methods;	/* from the metaclass */
+} macho_objc_class_t_64;
+
+typedef struct macho_objc_category_t_64 {
+	uint64_t address;
+	const char* name;
+	const char* cls;	/* extended class, NULL if unresolved */
+	macho_objc_methods_t_64 instance_methods;
+	macho_objc_methods_t_64 class_methods;
+} macho_objc_category_t_64;
+
+/*
+ * Classes and categories are found on load, method lists are only decoded
+ *   by macho_objc_methods_64 and selector references by
+ *   macho_objc_selector_64. Every string stays in the image data.
+ */
+typedef struct macho_objc_t_64 {
+	uint64_t class_count;
+	macho_objc_class_t_64* classes;	/* in __objc_classlist order */
+	uint64_t category_count;
+	macho_objc_category_t_64* categories;
+	uint64_t protocol_count;
+	const char** protocols;
+	uint64_t selref_count;
+	uint64_t selrefs;	/* address of __objc_selrefs */
+	struct macho_vm_t_64* vm;
+	struct macho_t_64* macho;
+} macho_objc_t_64;
+
+/*
+ * Mach-O Objective-C Metadata Functions
+ */
+macho_objc_t_64* macho_objc_create_64();
+macho_objc_t_64* macho_objc_load_64(struct macho_t_64* macho);
+macho_objc_class_t_64* macho_objc_find_class_64(macho_objc_t_64* objc, const char* name);
+macho_objc_methods_t_64* macho_objc_methods_64(macho_objc_t_64* objc, macho_objc_methods_t_64* methods);
+const char* macho_objc_selector_64(macho_objc_t_64* objc, uint64_t index);
+void macho_objc_debug_64(macho_objc_t_64* objc);
+void macho_objc_free_64(macho_objc_t_64* objc);
+
+#endif /* MACHO_OBJC_H_ */
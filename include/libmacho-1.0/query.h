@@ -0,0 +1,69 @@
+/**
+ * libmacho-1.0 - query.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_QUERY_H_
+#define MACHO_QUERY_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/symtab.h>
+
+struct macho_t_64;
+
+#define MACHO_QUERY_TYPE    0x01 // (n_type & type_mask) == type_value
+#define MACHO_QUERY_SECT    0x02 // n_sect == sect
+#define MACHO_QUERY_ORDINAL 0x04 // library ordinal in n_desc == ordinal
+#define MACHO_QUERY_VALUE   0x08 // value_min <= n_value < value_max
+#define MACHO_QUERY_PREFIX  0x10 // name starts with prefix
+
+#define MACHO_LIBRARY_ORDINAL(desc) (((desc) >> 8) & 0xFF)
+
+typedef struct macho_query_t_64 {
+	uint32_t fields;	/* MACHO_QUERY_* predicates to apply, all must hold */
+	uint8_t type_mask;
+	uint8_t type_value;
+	uint8_t sect;
+	uint8_t ordinal;
+	uint64_t value_min;
+	uint64_t value_max;
+	const char* prefix;
+} macho_query_t_64;
+
+typedef struct macho_query_match_t_64 {
+	uint64_t symtab;	/* index into the symtab array that was searched */
+	uint64_t index;		/* symbol index within that symtab */
+} macho_query_match_t_64;
+
+typedef struct macho_query_result_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	macho_query_match_t_64* matches;	/* in symtab then symbol order */
+} macho_query_result_t_64;
+
+/*
+ * Mach-O Symbol Query Functions
+ */
+macho_query_result_t_64* macho_query_symtabs_64(macho_symtab_t_64** symtabs, uint64_t count,
+		const macho_query_t_64* query);
+macho_query_result_t_64* macho_query_symbols_64(struct macho_t_64* macho, const macho_query_t_64* query);
+const char* macho_query_backend_64();
+int macho_query_result_add_64(macho_query_result_t_64* result, uint64_t symtab, uint64_t index);
+void macho_query_result_free_64(macho_query_result_t_64* result);
+
+#endif /* MACHO_QUERY_H_ */
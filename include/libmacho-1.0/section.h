@@ -22,40 +22,65 @@
 #define MACHO_SECTION_H_
 
 #include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
 
-typedef struct macho_section_info_t_64 {
+struct macho_t_64;
+
+#define MACHO_SECTION_TYPE                     0xFF       // mask for the section type
+#define MACHO_SECTION_ATTRIBUTES               0xFFFFFF00 // mask for the section attributes
+#define MACHO_SECTION_REGULAR                  0x0  // regular section
+#define MACHO_SECTION_ZEROFILL                 0x1  // zero fill on demand section
+#define MACHO_SECTION_CSTRING_LITERALS         0x2  // section with only literal C strings
+#define MACHO_SECTION_NON_LAZY_SYMBOL_POINTERS 0x6  // section with only non-lazy symbol pointers
+#define MACHO_SECTION_LAZY_SYMBOL_POINTERS     0x7  // section with only lazy symbol pointers
+#define MACHO_SECTION_SYMBOL_STUBS             0x8  // section with only symbol stubs
+#define MACHO_SECTION_GB_ZEROFILL              0xC  // zero fill on demand section (>4GB)
+#define MACHO_SECTION_THREAD_LOCAL_ZEROFILL    0x12 // thread local zerofill section
+#define MACHO_SECTION_ATTR_PURE_INSTRUCTIONS   0x80000000 // section contains only true machine instructions
+#define MACHO_SECTION_ATTR_SOME_INSTRUCTIONS   0x400      // section contains some machine instructions
+#define MACHO_SECTION_ORDINAL_MAX              255        // symbols name their section in one byte, 0 is none
+
+typedef struct MACHO_PACKED macho_section_info_t_64 {
 	char		sectname[16];	/* name of this section */
 	char		segname[16];	/* segment this section goes in */
 	uint64_t	addr;		/* memory address of this section */
 	uint64_t	size;		/* size in bytes of this section */
-	uint64_t	offset;		/* file offset of this section */
-	uint64_t	align;		/* section alignment (power of 2) */
-	uint64_t	reloff;		/* file offset of relocation entries */
-	uint64_t	nreloc;		/* number of relocation entries */
-	uint64_t	flags;		/* flags (section type and attributes)*/
-	uint64_t	reserved1;	/* reserved (for offset or index) */
-	uint64_t	reserved2;	/* reserved (for count or sizeof) */
+	uint32_t	offset;		/* file offset of this section */
+	uint32_t	align;		/* section alignment (power of 2) */
+	uint32_t	reloff;		/* file offset of relocation entries */
+	uint32_t	nreloc;		/* number of relocation entries */
+	uint32_t	flags;		/* flags (section type and attributes)*/
+	uint32_t	reserved1;	/* reserved (for offset or index) */
+	uint32_t	reserved2;	/* reserved (for count or sizeof) */
+	uint32_t	reserved3;	/* reserved */
 } macho_section_info_t_64;
 
 typedef struct macho_section_t_64 {
 	char* name;
-	macho_section_info_t_64* info;
+	unsigned char* data;	/* contents, NULL for zerofill or out of bounds */
+	macho_section_info_t_64* info;	/* view into the image data */
 } macho_section_t_64;
 
 /*
- * Mach-O Segment Functions
+ * Mach-O Section Functions
  */
 macho_section_t_64* macho_section_create_64();
 macho_section_t_64* macho_section_load_64(unsigned char* data, uint64_t offset);
 void macho_section_debug_64(macho_section_t_64* section);
 void macho_section_free_64(macho_section_t_64* section);
+void macho_section_ends_64(struct macho_t_64* macho, uint64_t ends[MACHO_SECTION_ORDINAL_MAX + 1]);
 
 /*
- * Mach-O Segment Info Functions
+ * Mach-O Section Info Functions
  */
-macho_section_info_t_64* macho_section_info_create_64();
-macho_section_info_t_64* macho_section_info_load_64(unsigned char* data, uint64_t offset);
+static inline macho_section_info_t_64* macho_section_info_view_64(unsigned char* data, uint64_t offset) {
+	return (macho_section_info_t_64*) &data[offset];
+}
+static inline int macho_section_info_zerofill_64(macho_section_info_t_64* info) {
+	uint32_t type = info->flags & MACHO_SECTION_TYPE;
+	return type == MACHO_SECTION_ZEROFILL || type == MACHO_SECTION_GB_ZEROFILL
+			|| type == MACHO_SECTION_THREAD_LOCAL_ZEROFILL;
+}
 void macho_section_info_debug_64(macho_section_info_t_64* info);
-void macho_section_info_free_64(macho_section_info_t_64* info);
 
 #endif /* MACHO_SECTION_H_ */
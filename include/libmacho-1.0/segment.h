@@ -21,32 +21,33 @@
 #ifndef MACHO_SEGMENT_H_
 #define MACHO_SEGMENT_H_
 
+#include <libmacho-1.0/view.h>
 #include <libmacho-1.0/section.h>
-#include <libcrippy-1.0/libcrippy.h>//
+#include <libcrippy-1.0/libcrippy.h>
 
-typedef struct macho_segment_cmd_t_64 {
-	uint64_t cmd;
-	uint64_t cmdsize;
+typedef struct MACHO_PACKED macho_segment_cmd_t_64 {
+	uint32_t cmd;		/* MACHO_CMD_SEGMENT_64 */
+	uint32_t cmdsize;	/* includes the section headers that follow */
 	char segname[16];
 	uint64_t vmaddr;
 	uint64_t vmsize;
 	uint64_t fileoff;
 	uint64_t filesize;
-	uint64_t maxprot;
-	uint64_t initprot;
-	uint64_t nsects;
-	uint64_t flags;
+	uint32_t maxprot;
+	uint32_t initprot;
+	uint32_t nsects;
+	uint32_t flags;
 } macho_segment_cmd_t_64;
 
 typedef struct macho_segment_t_64 {
 	char* name;
-	uint64_t size;
+	uint64_t size;		/* bytes reachable through data, at most filesize */
 	uint64_t offset;
 	uint64_t address;
-	unsigned char* data;
+	unsigned char* data;	/* translated through the mappings for cache images */
 	uint64_t section_count;
 	macho_section_t_64** sections;
-	macho_segment_cmd_t_64* command;
+	macho_segment_cmd_t_64* command;	/* view into the image data */
 } macho_segment_t_64;
 
 /*
@@ -59,11 +60,11 @@ void macho_segment_debug_64(macho_segment_t_64* segment);
 void macho_segment_free_64(macho_segment_t_64* segment);
 
 /*
- * Mach-O Segment Info Functions
+ * Mach-O Segment Command Functions
  */
-macho_segment_cmd_t_64* macho_segment_cmd_create_64();
-macho_segment_cmd_t_64* macho_segment_cmd_load_64(unsigned char* data, uint64_t offset);
+static inline macho_segment_cmd_t_64* macho_segment_cmd_view_64(unsigned char* data, uint64_t offset) {
+	return (macho_segment_cmd_t_64*) &data[offset];
+}
 void macho_segment_cmd_debug_64(macho_segment_cmd_t_64* cmd);
-void macho_segment_cmd_free_64(macho_segment_cmd_t_64* cmd);
 
 #endif /* MACHO_SEGMENT_H_ */
@@ -0,0 +1,142 @@
+/**
+ * libmacho-1.0 - server.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_SERVER_H_
+#define MACHO_SERVER_H_
+
+#include <pthread.h>
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+
+#define MACHO_SERVER_MAGIC 0x3151534D // "MSQ1", every message starts with it
+
+#define MACHO_SERVER_LOOKUP      1 // payload: symbol name, records: macho_server_symbol_t_64
+#define MACHO_SERVER_SYMBOLICATE 2 // payload: uint64_t addresses, records: macho_server_frame_t_64
+#define MACHO_SERVER_SECTION     3 // payload: segment and section, each terminated, record: macho_server_section_t_64
+#define MACHO_SERVER_SEARCH      4 // payload: substring, records: macho_server_symbol_t_64
+
+#define MACHO_SERVER_OK          0
+#define MACHO_SERVER_BAD_REQUEST 1
+#define MACHO_SERVER_NO_IMAGE    2 // the image could not be mapped or parsed
+#define MACHO_SERVER_NOT_FOUND   3
+#define MACHO_SERVER_FAILED      4
+#define MACHO_SERVER_TRUNCATED   5 // the records are valid but more did not fit
+
+#define MACHO_SERVER_PATH_MAX    0x1000
+#define MACHO_SERVER_PAYLOAD_MAX 0x4000000
+
+struct macho_t_64;
+struct macho_map_t_64;
+struct macho_symbolicator_t_64;
+struct macho_name_index_t_64;
+struct macho_trigram_index_t_64;
+
+/*
+ * Messages are in host byte order, client and server share a machine. A
+ *   request header is followed by the image path and the op payload, a
+ *   response header by its records; names in records follow the fixed
+ *   part and are not terminated.
+ */
+typedef struct MACHO_PACKED macho_server_request_t_64 {
+	uint32_t magic;
+	uint32_t op;		/* MACHO_SERVER_LOOKUP ... MACHO_SERVER_SEARCH */
+	uint32_t path_size;
+	uint32_t payload_size;
+} macho_server_request_t_64;
+
+typedef struct MACHO_PACKED macho_server_response_t_64 {
+	uint32_t magic;
+	uint32_t status;	/* MACHO_SERVER_OK or the reason it failed */
+	uint32_t count;		/* records in the payload */
+	uint32_t payload_size;
+} macho_server_response_t_64;
+
+typedef struct MACHO_PACKED macho_server_symbol_t_64 {
+	uint64_t value;
+	uint8_t type;
+	uint8_t sect;
+	uint16_t desc;
+	uint32_t name_size;
+} macho_server_symbol_t_64;
+
+typedef struct MACHO_PACKED macho_server_frame_t_64 {
+	uint64_t address;	/* start of the resolved symbol */
+	uint64_t offset;	/* distance from the symbol start */
+	uint32_t name_size;	/* zero if the address precedes every symbol */
+} macho_server_frame_t_64;
+
+typedef struct MACHO_PACKED macho_server_section_t_64 {
+	uint64_t addr;
+	uint64_t size;
+	uint32_t offset;
+	uint32_t flags;
+} macho_server_section_t_64;
+
+typedef struct macho_server_image_t_64 {
+	char* path;
+	uint64_t inode;		/* file identity when parsed, a change drops the entry */
+	uint64_t mtime;
+	uint64_t size;
+	uint64_t cost;		/* bytes charged against the cache budget */
+	int references;
+	int cached;		/* still linked in the LRU list */
+	pthread_mutex_t lock;	/* held while an index is built */
+	struct macho_map_t_64* map;
+	struct macho_t_64* macho;
+	struct macho_symbolicator_t_64* symbolicator;	/* built on first use */
+	struct macho_name_index_t_64* names;
+	struct macho_trigram_index_t_64* trigrams;
+	struct macho_server_image_t_64* prev;
+	struct macho_server_image_t_64* next;
+} macho_server_image_t_64;
+
+typedef struct macho_server_t_64 {
+	int fd;
+	char* path;
+	uint64_t limit;		/* cache budget in bytes */
+	int huge;		/* copy images into transparent huge pages */
+	uint64_t used;
+	uint64_t count;
+	int clients;
+	int stopping;
+	pthread_mutex_t lock;	/* guards the cache and the client count */
+	pthread_cond_t idle;
+	macho_server_image_t_64* head;	/* most recently used first */
+	macho_server_image_t_64* tail;
+} macho_server_t_64;
+
+/*
+ * Mach-O Query Server Functions
+ */
+macho_server_t_64* macho_server_create_64();
+macho_server_t_64* macho_server_open_64(const char* path, uint64_t limit);
+int macho_server_run_64(macho_server_t_64* server, volatile int* stop);
+void macho_server_debug_64(macho_server_t_64* server);
+void macho_server_free_64(macho_server_t_64* server);
+
+/*
+ * Mach-O Query Client Functions
+ */
+int macho_server_connect_64(const char* path);
+int macho_server_request_64(int fd, uint32_t op, const char* image, const void* payload, uint32_t size,
+		macho_server_response_t_64* response, unsigned char** records);
+
+#endif /* MACHO_SERVER_H_ */
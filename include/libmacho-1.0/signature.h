@@ -0,0 +1,107 @@
+/**
+ * libmacho-1.0 - signature.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_SIGNATURE_H_
+#define MACHO_SIGNATURE_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#define MACHO_CSMAGIC_EMBEDDED_SIGNATURE  0xFADE0CC0 // embedded form of signature data
+#define MACHO_CSMAGIC_CODEDIRECTORY       0xFADE0C02 // CodeDirectory blob
+
+#define MACHO_CSSLOT_CODEDIRECTORY            0x0    // slot index for CodeDirectory
+#define MACHO_CSSLOT_INFOSLOT                 0x1    // Info.plist, embedded as __TEXT,__info_plist
+#define MACHO_CSSLOT_REQUIREMENTS             0x2    // internal requirements blob
+#define MACHO_CSSLOT_ENTITLEMENTS             0x5    // XML entitlements blob
+#define MACHO_CSSLOT_DER_ENTITLEMENTS         0x7    // DER entitlements blob
+#define MACHO_CSSLOT_ALTERNATE_CODEDIRECTORIES 0x1000 // first alternate CodeDirectory
+#define MACHO_CSSLOT_ALTERNATE_CODEDIRECTORY_MAX 5
+
+#define MACHO_CS_HASHTYPE_SHA1             1
+#define MACHO_CS_HASHTYPE_SHA256           2
+#define MACHO_CS_HASHTYPE_SHA256_TRUNCATED 3
+#define MACHO_CS_HASHTYPE_SHA384           4
+
+#define MACHO_SIGNATURE_VALID            0 // every code page matched its slot
+#define MACHO_SIGNATURE_UNSIGNED         1 // no LC_CODE_SIGNATURE command
+#define MACHO_SIGNATURE_MALFORMED        2 // blobs are truncated or out of bounds
+#define MACHO_SIGNATURE_UNSUPPORTED_HASH 3 // CodeDirectory uses a hash we don't do
+#define MACHO_SIGNATURE_PAGE_MISMATCH    4 // a code page hash didn't match
+#define MACHO_SIGNATURE_SLOT_MISMATCH    5 // a special slot hash didn't match
+
+typedef struct macho_code_directory_t_64 {
+	uint32_t magic;		/* magic number (CSMAGIC_CODEDIRECTORY) */
+	uint32_t length;	/* total length of CodeDirectory blob */
+	uint32_t version;	/* compatibility version */
+	uint32_t flags;		/* setup and mode flags */
+	uint32_t hashOffset;	/* offset of hash slot element at index zero */
+	uint32_t identOffset;	/* offset of identifier string */
+	uint32_t nSpecialSlots;	/* number of special hash slots */
+	uint32_t nCodeSlots;	/* number of ordinary (code) hash slots */
+	uint32_t codeLimit;	/* limit to main image signature range */
+	uint8_t hashSize;	/* size of each hash in bytes */
+	uint8_t hashType;	/* type of hash (cdHashType* constants) */
+	uint8_t platform;	/* platform identifier; zero if not platform binary */
+	uint8_t pageSize;	/* log2(page size in bytes); 0 => infinite */
+	uint32_t spare2;	/* unused (must be zero) */
+	uint64_t codeLimit64;	/* limit to main image signature range, 64 bits (0x20300) */
+} macho_code_directory_t_64;
+
+typedef struct macho_signature_t_64 {
+	uint64_t size;			/* size of the SuperBlob */
+	uint64_t count;			/* number of blobs in the SuperBlob */
+	unsigned char* data;		/* SuperBlob in the image mapping */
+	unsigned char* image;		/* start of the Mach-O the signature covers */
+	uint64_t image_size;
+	unsigned char* hashes;		/* code slot zero of the chosen CodeDirectory */
+	unsigned char* info_plist;	/* __TEXT,__info_plist, hashed into the info slot */
+	uint64_t info_plist_size;
+	const char* identifier;
+	macho_code_directory_t_64* directory;
+} macho_signature_t_64;
+
+typedef struct macho_signature_verdict_t_64 {
+	int status;			/* MACHO_SIGNATURE_* */
+	uint8_t hash_type;
+	uint8_t hash_size;
+	uint32_t page_size;
+	uint64_t page_count;
+	uint64_t code_limit;
+	uint64_t failed_page;		/* lowest mismatching page when status is PAGE_MISMATCH */
+	uint32_t failed_slot;		/* mismatching special slot when status is SLOT_MISMATCH */
+	const char* identifier;
+	const char* backend;		/* hash implementation that did the work */
+} macho_signature_verdict_t_64;
+
+struct macho_t_64;
+
+/*
+ * Mach-O Code Signature Functions
+ */
+macho_signature_t_64* macho_signature_create_64();
+macho_signature_t_64* macho_signature_load_64(struct macho_t_64* macho, int* status);
+int macho_signature_verify_64(macho_signature_t_64* signature, macho_signature_verdict_t_64* verdict);
+int macho_verify_signature_64(struct macho_t_64* macho, macho_signature_verdict_t_64* verdict);
+const char* macho_signature_status_string_64(int status);
+void macho_signature_debug_64(macho_signature_t_64* signature);
+void macho_signature_free_64(macho_signature_t_64* signature);
+
+#endif /* MACHO_SIGNATURE_H_ */
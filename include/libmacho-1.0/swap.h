@@ -0,0 +1,47 @@
+/**
+ * libmacho-1.0 - swap.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_SWAP_H_
+#define MACHO_SWAP_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#define MACHO_CIGAM_32 0xCEFAEDFE // MACHO_MAGIC_32 read with the wrong byte order
+#define MACHO_CIGAM_64 0xCFFAEDFE // MACHO_MAGIC_64 read with the wrong byte order
+
+#define MACHO_NLIST_64_SIZE   16 // sizeof(struct nlist_64) on disk
+#define MACHO_SECTION_64_SIZE 80 // sizeof(struct section_64) on disk
+
+/*
+ * Bulk Byte Swapping Functions
+ */
+void macho_swap32_array_64(void* data, uint64_t count);
+void macho_swap64_array_64(void* data, uint64_t count);
+void macho_swap_nlists_64(void* data, uint64_t count);
+void macho_swap_sections_64(void* data, uint64_t count);
+const char* macho_swap_backend_64();
+
+/*
+ * Byte-swapped Image Functions
+ */
+int macho_is_swapped_64(const unsigned char* data, uint64_t size);
+int macho_swap_image_64(unsigned char* data, uint64_t size);
+
+#endif /* MACHO_SWAP_H_ */
@@ -0,0 +1,162 @@
+/**
+ * libmacho-1.0 - swift.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_SWIFT_H_
+#define MACHO_SWIFT_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+
+struct macho_t_64;
+struct macho_vm_t_64;
+
+#define MACHO_SWIFT_KIND_MODULE    0  // module context
+#define MACHO_SWIFT_KIND_EXTENSION 1  // extension context
+#define MACHO_SWIFT_KIND_ANONYMOUS 2  // anonymous context
+#define MACHO_SWIFT_KIND_PROTOCOL  3  // protocol
+#define MACHO_SWIFT_KIND_OPAQUE    4  // opaque type
+#define MACHO_SWIFT_KIND_CLASS     16 // class
+#define MACHO_SWIFT_KIND_STRUCT    17 // struct
+#define MACHO_SWIFT_KIND_ENUM      18 // enum
+#define MACHO_SWIFT_KIND_MASK      0x1F
+
+#define MACHO_SWIFT_TYPE_DIRECT        0 // relative pointer to a type descriptor
+#define MACHO_SWIFT_TYPE_INDIRECT      1 // relative pointer to a type descriptor pointer
+#define MACHO_SWIFT_TYPE_OBJC_NAME     2 // relative pointer to an Objective-C class name
+#define MACHO_SWIFT_TYPE_OBJC_INDIRECT 3 // relative pointer to an Objective-C class pointer
+
+#define MACHO_SWIFT_CONFORMANCE_TYPE(flags) (((flags) >> 3) & 0x7)
+
+/*
+ * Every reference between these records is a 32 bit offset from the field
+ *   holding it. Where the low bit may be set it marks the target as a
+ *   pointer to the record rather than the record itself.
+ */
+typedef struct MACHO_PACKED macho_swift_context_info_t_64 {
+	uint32_t flags;		/* kind in the low bits */
+	int32_t parent;		/* indirectable */
+	int32_t name;		/* modules, protocols and nominal types only */
+} macho_swift_context_info_t_64;
+
+typedef struct MACHO_PACKED macho_swift_type_info_t_64 {
+	uint32_t flags;
+	int32_t parent;
+	int32_t name;
+	int32_t access_function;
+	int32_t fields;		/* field descriptor, zero if none */
+} macho_swift_type_info_t_64;
+
+typedef struct MACHO_PACKED macho_swift_conformance_info_t_64 {
+	int32_t protocol;	/* indirectable */
+	int32_t type;		/* interpreted by MACHO_SWIFT_CONFORMANCE_TYPE */
+	int32_t witness_table;
+	uint32_t flags;
+} macho_swift_conformance_info_t_64;
+
+typedef struct MACHO_PACKED macho_swift_field_info_t_64 {
+	int32_t type;		/* mangled type name */
+	int32_t superclass;	/* mangled superclass name, zero if none */
+	uint16_t kind;
+	uint16_t record_size;
+	uint32_t count;
+} macho_swift_field_info_t_64;
+
+typedef struct MACHO_PACKED macho_swift_record_info_t_64 {
+	uint32_t flags;
+	int32_t type;		/* mangled type name, zero if none */
+	int32_t name;		/* into __swift5_reflstr */
+} macho_swift_record_info_t_64;
+
+/*
+ * Decoded records are filled in by the caller's storage, every string is in
+ *   the image data. Mangled names can hold symbolic references, a control
+ *   byte followed by a 32 or 64 bit reference, so may not end at the first
+ *   NUL a plain string walk finds.
+ */
+typedef struct macho_swift_type_t_64 {
+	uint64_t address;	/* of the type descriptor */
+	uint32_t kind;		/* MACHO_SWIFT_KIND_* */
+	uint32_t flags;
+	const char* name;
+	const char* parent;	/* name of the enclosing module or type */
+	uint64_t fields;	/* address of the field descriptor, zero if none */
+} macho_swift_type_t_64;
+
+typedef struct macho_swift_conformance_t_64 {
+	uint64_t address;	/* of the conformance descriptor */
+	uint32_t flags;
+	const char* protocol;	/* descriptor name, or the imported symbol */
+	const char* type;	/* descriptor or Objective-C class name, or the imported symbol */
+	uint64_t witness_table;
+} macho_swift_conformance_t_64;
+
+typedef struct macho_swift_field_t_64 {
+	uint64_t address;	/* of the field descriptor */
+	const char* type;	/* mangled */
+	const char* superclass;	/* mangled, NULL if none */
+	uint32_t type_size;	/* bytes before the terminator, references included */
+	uint32_t superclass_size;
+	uint16_t kind;
+	uint16_t record_size;
+	uint32_t count;
+} macho_swift_field_t_64;
+
+typedef struct macho_swift_record_t_64 {
+	uint32_t flags;
+	const char* name;
+	const char* type;	/* mangled, NULL if none */
+	uint32_t type_size;	/* bytes before the terminator, references included */
+} macho_swift_record_t_64;
+
+typedef struct macho_swift_t_64 {
+	uint64_t type_count;
+	uint64_t types;		/* address of __swift5_types */
+	uint64_t conformance_count;
+	uint64_t conformances;	/* address of __swift5_proto */
+	uint64_t fields;	/* address of __swift5_fieldmd */
+	uint64_t fields_size;
+	uint64_t strings;	/* address of __swift5_reflstr */
+	uint64_t strings_size;
+	struct macho_vm_t_64* vm;
+	struct macho_t_64* macho;
+} macho_swift_t_64;
+
+/*
+ * Conformance callback for the parallel walk, called from several threads
+ *   at once: returns 0 to keep going, anything else stops the walk.
+ */
+typedef int (*macho_swift_conformance_func_t_64)(uint64_t index, macho_swift_conformance_t_64* conformance,
+		void* userdata);
+
+/*
+ * Mach-O Swift Reflection Functions
+ */
+macho_swift_t_64* macho_swift_create_64();
+macho_swift_t_64* macho_swift_load_64(struct macho_t_64* macho);
+int macho_swift_type_64(macho_swift_t_64* swift, uint64_t index, macho_swift_type_t_64* type);
+int macho_swift_conformance_64(macho_swift_t_64* swift, uint64_t index, macho_swift_conformance_t_64* conformance);
+int macho_swift_conformances_each_64(macho_swift_t_64* swift, macho_swift_conformance_func_t_64 func, void* userdata);
+int macho_swift_fields_next_64(macho_swift_t_64* swift, uint64_t* cursor, macho_swift_field_t_64* field);
+int macho_swift_record_64(macho_swift_t_64* swift, macho_swift_field_t_64* field, uint32_t index,
+		macho_swift_record_t_64* record);
+void macho_swift_debug_64(macho_swift_t_64* swift);
+void macho_swift_free_64(macho_swift_t_64* swift);
+
+#endif /* MACHO_SWIFT_H_ */
@@ -0,0 +1,56 @@
+/**
+ * libmacho-1.0 - symbolicate.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_SYMBOLICATE_H_
+#define MACHO_SYMBOLICATE_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+
+typedef struct macho_symbolicator_entry_t_64 {
+	uint64_t address;	/* start address of the symbol */
+	uint64_t end;		/* end of the section or segment holding it */
+	const char* name;	/* name in the mapped string table */
+} macho_symbolicator_entry_t_64;
+
+typedef struct macho_symbolicator_t_64 {
+	uint64_t count;
+	macho_symbolicator_entry_t_64* entries;	/* sorted by address */
+	struct macho_t_64* macho;
+} macho_symbolicator_t_64;
+
+typedef struct macho_symbolication_t_64 {
+	const char* name;	/* NULL if no symbol's section covers the address */
+	uint64_t address;	/* start address of the resolved symbol */
+	uint64_t offset;	/* distance from the symbol start */
+} macho_symbolication_t_64;
+
+/*
+ * Mach-O Symbolicator Functions
+ */
+macho_symbolicator_t_64* macho_symbolicator_create_64();
+macho_symbolicator_t_64* macho_symbolicator_load_64(struct macho_t_64* macho);
+int macho_symbolicator_resolve_64(macho_symbolicator_t_64* symbolicator, const uint64_t* addresses,
+		uint64_t count, macho_symbolication_t_64* results);
+void macho_symbolicator_debug_64(macho_symbolicator_t_64* symbolicator);
+void macho_symbolicator_free_64(macho_symbolicator_t_64* symbolicator);
+
+#endif /* MACHO_SYMBOLICATE_H_ */
@@ -22,47 +22,125 @@
 #define MACHO_SYMTAB_H_
 
 #include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
 
-typedef struct macho_symtab_cmd_t_64 {
-	uint64_t cmd;		/* LC_SYMTAB */
-	uint64_t cmdsize;	/* sizeof(struct macho_symtab_cmd_t_64) */
-	uint64_t symoff;	/* symbol table offset */
-	uint64_t nsyms;		/* number of symbol table entries */
-	uint64_t stroff;	/* string table offset */
-	uint64_t strsize;	/* string table size in bytes */
+#define MACHO_N_STAB  0xE0 // if any of these bits set, a symbolic debugging entry
+#define MACHO_N_PEXT  0x10 // private external symbol bit
+#define MACHO_N_TYPE  0x0E // mask for the type bits
+#define MACHO_N_EXT   0x01 // external symbol bit, set for external symbols
+
+#define MACHO_N_UNDF  0x0  // undefined, n_sect == NO_SECT
+#define MACHO_N_ABS   0x2  // absolute, n_sect == NO_SECT
+#define MACHO_N_SECT  0xE  // defined in section number n_sect
+#define MACHO_N_PBUD  0xC  // prebound undefined (defined in a dylib)
+#define MACHO_N_INDR  0xA  // indirect
+
+typedef struct MACHO_PACKED macho_symtab_cmd_t_64 {
+	uint32_t cmd;		/* LC_SYMTAB */
+	uint32_t cmdsize;	/* sizeof(struct macho_symtab_cmd_t_64) */
+	uint32_t symoff;	/* symbol table offset */
+	uint32_t nsyms;		/* number of symbol table entries */
+	uint32_t stroff;	/* string table offset */
+	uint32_t strsize;	/* string table size in bytes */
 } macho_symtab_cmd_t_64;
 
-typedef struct nlist_64 {
+#define MACHO_INDIRECT_SYMBOL_LOCAL 0x80000000 // indirect entry for a non-lazy pointer to a local symbol
+#define MACHO_INDIRECT_SYMBOL_ABS   0x40000000 // indirect entry for an absolute symbol
+
+typedef struct MACHO_PACKED macho_dysymtab_cmd_t_64 {
+	uint32_t cmd;		/* LC_DYSYMTAB */
+	uint32_t cmdsize;	/* sizeof(struct macho_dysymtab_cmd_t_64) */
+	uint32_t ilocalsym;	/* index to local symbols */
+	uint32_t nlocalsym;	/* number of local symbols */
+	uint32_t iextdefsym;	/* index to externally defined symbols */
+	uint32_t nextdefsym;	/* number of externally defined symbols */
+	uint32_t iundefsym;	/* index to undefined symbols */
+	uint32_t nundefsym;	/* number of undefined symbols */
+	uint32_t tocoff;	/* file offset to table of contents */
+	uint32_t ntoc;		/* number of entries in table of contents */
+	uint32_t modtaboff;	/* file offset to module table */
+	uint32_t nmodtab;	/* number of module table entries */
+	uint32_t extrefsymoff;	/* offset to referenced symbol table */
+	uint32_t nextrefsyms;	/* number of referenced symbol table entries */
+	uint32_t indirectsymoff;	/* file offset to the indirect symbol table */
+	uint32_t nindirectsyms;	/* number of indirect symbol table entries */
+	uint32_t extreloff;	/* offset to external relocation entries */
+	uint32_t nextrel;	/* number of external relocation entries */
+	uint32_t locreloff;	/* offset to local relocation entries */
+	uint32_t nlocrel;	/* number of local relocation entries */
+} macho_dysymtab_cmd_t_64;
+
+typedef struct MACHO_PACKED nlist_64 {
 	union {
-		char *n_name; /* resolved symbol name */
-		int64_t n_strx; /* index into the string table */
+		uint32_t n_strx; /* index into the string table */
 	} n_un;
-	uint16_t n_type; /* type flag, see below */
-	uint16_t n_sect; /* section number or NO_SECT */
-	int32_t n_desc; /* see <mach-o/stab.h> */
+	uint8_t n_type; /* type flag, see below */
+	uint8_t n_sect; /* section number or NO_SECT */
+	uint16_t n_desc; /* see <mach-o/stab.h> */
 	uint64_t n_value; /* value of this symbol (or stab offset) */
 } nlist_64;
 
 typedef struct macho_symtab_t_64 {
 	uint64_t nsyms;
-	struct nlist_64* symbols;
-	macho_symtab_cmd_t_64* cmd;
+	struct nlist_64* symbols;	/* view into the image data */
+	unsigned char* strings;		/* view of the string table */
+	macho_symtab_cmd_t_64* cmd;	/* view into the image data */
+
+	/* one column per nlist field, nsyms entries each, in one allocation */
+	uint64_t* values;
+	uint32_t* strx;
+	uint16_t* descs;
+	uint8_t* types;
+	uint8_t* sects;
 } macho_symtab_t_64;
 
+#define MACHO_SYMBOL_FILTER_NAMED   0x1 // skip symbols without a name
+#define MACHO_SYMBOL_FILTER_NONZERO 0x2 // skip symbols whose value is zero
+
+typedef struct macho_symbol_filter_t_64 {
+	uint8_t type_mask;	/* keep if (n_type & type_mask) == type_value */
+	uint8_t type_value;
+	uint8_t sect_mask;	/* keep if (n_sect & sect_mask) == sect_value */
+	uint8_t sect_value;
+	uint32_t flags;		/* MACHO_SYMBOL_FILTER_* */
+} macho_symbol_filter_t_64;
+
+typedef struct macho_symbol_record_t_64 {
+	const char* name;	/* NULL if the name is out of range or unterminated */
+	uint64_t value;
+	uint64_t index;		/* index within its symtab */
+	uint8_t type;
+	uint8_t sect;
+	uint16_t desc;
+} macho_symbol_record_t_64;
+
 /*
  * Mach-O Symtab Functions
  */
 macho_symtab_t_64* macho_symtab_create_64();
-macho_symtab_t_64* macho_symtab_load_64(unsigned char* data, unsigned int offset);
+macho_symtab_t_64* macho_symtab_load_64(unsigned char* data, uint64_t offset);
+int macho_symtab_columns_load_64(macho_symtab_t_64* symtab);
+uint64_t macho_symtab_next_64(macho_symtab_t_64* symtab, uint64_t* index,
+		const macho_symbol_filter_t_64* filter, macho_symbol_record_t_64* records, uint64_t max);
 void macho_symtab_debug_64(macho_symtab_t_64* symtab);
 void macho_symtab_free_64(macho_symtab_t_64* symtab);
 
+// Name of symbol index, or NULL unless it is terminated inside the string table
+static inline const char* macho_symtab_name_64(macho_symtab_t_64* symtab, uint64_t index) {
+	uint32_t strx = symtab->strx ? symtab->strx[index] : symtab->symbols[index].n_un.n_strx;
+	if (symtab->strings == NULL || strx >= symtab->cmd->strsize
+			|| memchr(&symtab->strings[strx], '\0', symtab->cmd->strsize - strx) == NULL) {
+		return NULL;
+	}
+	return (const char*) &symtab->strings[strx];
+}
+
 /*
- * Mach-O Symtab Info Functions
+ * Mach-O Symtab Command Functions
  */
-macho_symtab_cmd_t_64* macho_symtab_cmd_create_64();
-macho_symtab_cmd_t_64* macho_symtab_cmd_load_64(unsigned char* data);
+static inline macho_symtab_cmd_t_64* macho_symtab_cmd_view_64(unsigned char* data, uint64_t offset) {
+	return (macho_symtab_cmd_t_64*) &data[offset];
+}
 void macho_symtab_cmd_debug_64(macho_symtab_cmd_t_64* cmd);
-void macho_symtab_cmd_free_64(macho_symtab_cmd_t_64* cmd);
 
 #endif /* MACHO_SYMTAB_H_ */
@@ -0,0 +1,74 @@
+/**
+ * libmacho-1.0 - trigram.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_TRIGRAM_H_
+#define MACHO_TRIGRAM_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+#include <libmacho-1.0/query.h>
+
+#define MACHO_TRIGRAM_MAGIC "trigram1"
+
+struct macho_t_64;
+struct macho_map_t_64;
+
+/*
+ * Symbols are numbered by ordinal, counting through every symtab in order.
+ *   Each posting list holds the ordinals whose names contain the trigram,
+ *   ascending, as a varint of the first one followed by varint deltas.
+ */
+typedef struct MACHO_PACKED macho_trigram_header_t_64 {
+	char magic[8];
+	uint64_t nsyms;		/* symbol ordinals covered */
+	uint64_t term_count;
+	uint64_t size;		/* bytes of posting lists after the terms */
+	uint64_t checksum;	/* of the string tables the index was built from */
+} macho_trigram_header_t_64;
+
+typedef struct MACHO_PACKED macho_trigram_term_t_64 {
+	uint32_t trigram;	/* three name bytes, the first one highest */
+	uint32_t count;		/* ordinals in the posting list */
+	uint64_t offset;	/* into the posting lists */
+} macho_trigram_term_t_64;
+
+typedef struct macho_trigram_index_t_64 {
+	uint64_t nsyms;
+	uint64_t checksum;
+	uint64_t term_count;
+	macho_trigram_term_t_64* terms;	/* sorted by trigram */
+	uint64_t size;
+	unsigned char* postings;
+	struct macho_map_t_64* map;	/* backing file of an index opened from disk */
+	struct macho_t_64* macho;
+} macho_trigram_index_t_64;
+
+/*
+ * Mach-O Symbol Trigram Index Functions
+ */
+macho_trigram_index_t_64* macho_trigram_index_create_64();
+macho_trigram_index_t_64* macho_trigram_index_load_64(struct macho_t_64* macho);
+macho_trigram_index_t_64* macho_trigram_index_open_64(struct macho_t_64* macho, const char* path);
+int macho_trigram_index_save_64(macho_trigram_index_t_64* index, const char* path);
+macho_query_result_t_64* macho_trigram_search_64(macho_trigram_index_t_64* index, const char* substring);
+void macho_trigram_index_debug_64(macho_trigram_index_t_64* index);
+void macho_trigram_index_free_64(macho_trigram_index_t_64* index);
+
+#endif /* MACHO_TRIGRAM_H_ */
@@ -0,0 +1,59 @@
+/**
+ * libmacho-1.0 - view.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_VIEW_H_
+#define MACHO_VIEW_H_
+
+#include <string.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+// On-disk structures are declared packed so a pointer straight into the
+//   image bytes can be dereferenced whatever its alignment.
+#define MACHO_PACKED __attribute__((packed))
+
+/*
+ * Mach-O View Functions
+ */
+static inline uint16_t macho_read16_64(const void* data) {
+	uint16_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint32_t macho_read32_64(const void* data) {
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint64_t macho_read64_64(const void* data) {
+	uint64_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline void* macho_view_64(unsigned char* data, uint64_t size, uint64_t offset, uint64_t length) {
+	if (data == NULL || offset > size || length > size - offset) {
+		return NULL;
+	}
+	return &data[offset];
+}
+
+#endif /* MACHO_VIEW_H_ */
@@ -0,0 +1,97 @@
+/**
+ * libmacho-1.0 - vm.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_VM_H_
+#define MACHO_VM_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+#include <libmacho-1.0/view.h>
+
+struct macho_t_64;
+
+#define MACHO_CHAINED_PTR_ARM64E            1  // target is an address, authenticated ones an offset
+#define MACHO_CHAINED_PTR_64                2  // target is an address
+#define MACHO_CHAINED_PTR_64_OFFSET         6  // target is an offset from the image base
+#define MACHO_CHAINED_PTR_ARM64E_KERNEL     7  // every target is an offset
+#define MACHO_CHAINED_PTR_ARM64E_USERLAND   9  // every target is an offset
+#define MACHO_CHAINED_PTR_ARM64E_USERLAND24 12 // as above, with 24 bit bind ordinals
+
+#define MACHO_CHAINED_IMPORT          1 // 32 bit entries
+#define MACHO_CHAINED_IMPORT_ADDEND   2 // 32 bit entries with a 32 bit addend
+#define MACHO_CHAINED_IMPORT_ADDEND64 3 // 64 bit entries with a 64 bit addend
+
+typedef struct MACHO_PACKED macho_chained_fixups_header_t_64 {
+	uint32_t fixups_version;
+	uint32_t starts_offset;		/* of the per segment starts, from this header */
+	uint32_t imports_offset;
+	uint32_t symbols_offset;
+	uint32_t imports_count;
+	uint32_t imports_format;	/* MACHO_CHAINED_IMPORT_* */
+	uint32_t symbols_format;	/* zero for uncompressed names */
+} macho_chained_fixups_header_t_64;
+
+typedef struct MACHO_PACKED macho_chained_starts_segment_t_64 {
+	uint32_t size;
+	uint16_t page_size;
+	uint16_t pointer_format;	/* MACHO_CHAINED_PTR_* */
+	uint64_t segment_offset;
+	uint32_t max_valid_pointer;
+	uint16_t page_count;
+} macho_chained_starts_segment_t_64;
+
+typedef struct macho_vm_range_t_64 {
+	uint64_t address;
+	uint64_t size;		/* in memory, may run past the file contents */
+	uint64_t offset;	/* file offset of the first byte */
+	uint64_t filesize;
+	unsigned char* data;	/* the segment's bytes, wherever the image has them */
+} macho_vm_range_t_64;
+
+/*
+ * Resolves addresses to bytes of the mapped image and decodes the pointers
+ *   stored there. Without chained fixups a pointer is stored as the address
+ *   it points to and binds read as zero.
+ */
+typedef struct macho_vm_t_64 {
+	uint64_t base;		/* preferred load address */
+	uint64_t count;
+	macho_vm_range_t_64* ranges;	/* sorted by address */
+	uint16_t pointer_format;	/* zero without chained fixups */
+	uint32_t import_count;
+	uint32_t import_format;
+	unsigned char* imports;	/* view into the image data */
+	const char* symbols;	/* import names, view into the image data */
+	uint64_t symbols_size;
+	struct macho_t_64* macho;
+} macho_vm_t_64;
+
+/*
+ * Mach-O Address Space Functions
+ */
+macho_vm_t_64* macho_vm_create_64();
+macho_vm_t_64* macho_vm_load_64(struct macho_t_64* macho);
+void* macho_vm_view_64(macho_vm_t_64* vm, uint64_t address, uint64_t size);
+const char* macho_vm_string_64(macho_vm_t_64* vm, uint64_t address);
+uint64_t macho_vm_decode_64(macho_vm_t_64* vm, uint64_t raw, const char** bind);
+uint64_t macho_vm_pointer_64(macho_vm_t_64* vm, uint64_t address, const char** bind);
+void macho_vm_debug_64(macho_vm_t_64* vm);
+void macho_vm_free_64(macho_vm_t_64* vm);
+
+#endif /* MACHO_VM_H_ */
@@ -0,0 +1,63 @@
+/**
+ * libmacho-1.0 - writer.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_WRITER_H_
+#define MACHO_WRITER_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+
+typedef struct macho_writer_command_t_64 {
+	uint32_t cmd;
+	uint32_t size;
+	unsigned char* data;	/* private copy, edits go here */
+} macho_writer_command_t_64;
+
+typedef struct macho_writer_t_64 {
+	int source_fd;			/* optional, enables copy_file_range */
+	struct macho_t_64* macho;
+	uint64_t command_count;
+	uint64_t command_capacity;
+	macho_writer_command_t_64* commands;
+	uint64_t header_limit;		/* first byte of segment data after the load commands */
+	uint64_t linkedit_offset;	/* file offset of __LINKEDIT, 0 if there is none */
+	uint64_t linkedit_size;		/* size of __LINKEDIT in the output */
+	unsigned char* linkedit;	/* caller owned __LINKEDIT, NULL to reuse the source */
+} macho_writer_t_64;
+
+/*
+ * Mach-O Writer Functions
+ */
+macho_writer_t_64* macho_writer_create_64();
+macho_writer_t_64* macho_writer_load_64(struct macho_t_64* macho);
+int macho_writer_set_source_fd_64(macho_writer_t_64* writer, int fd);
+int macho_writer_remove_command_64(macho_writer_t_64* writer, uint64_t index);
+int macho_writer_add_command_64(macho_writer_t_64* writer, const unsigned char* data, uint32_t size);
+macho_writer_command_t_64* macho_writer_find_command_64(macho_writer_t_64* writer, uint32_t cmd);
+int macho_writer_set_linkedit_64(macho_writer_t_64* writer, unsigned char* data, uint64_t size);
+int macho_writer_remove_signature_64(macho_writer_t_64* writer);
+int macho_writer_write_64(macho_writer_t_64* writer, int fd);
+int macho_writer_save_64(macho_writer_t_64* writer, const char* path);
+void macho_writer_debug_64(macho_writer_t_64* writer);
+void macho_writer_free_64(macho_writer_t_64* writer);
+
+#endif /* MACHO_WRITER_H_ */
@@ -0,0 +1,62 @@
+/**
+ * libmacho-1.0 - xref.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_XREF_H_
+#define MACHO_XREF_H_
+
+#include <libcrippy-1.0/libcrippy.h>
+
+struct macho_t_64;
+struct macho_vm_t_64;
+
+#define MACHO_XREF_ADDRESS 1 // instruction computes the address
+#define MACHO_XREF_LOAD    2 // instruction loads from or stores to the address
+#define MACHO_XREF_POINTER 3 // pointer stored in a data section
+
+typedef struct macho_xref_t_64 {
+	uint64_t target;	/* address referred to */
+	uint64_t source;	/* address of the instruction or pointer */
+	uint32_t kind;		/* MACHO_XREF_* */
+	uint32_t reserved;
+} macho_xref_t_64;
+
+/*
+ * Built in one pass over the code and data sections, split across the
+ *   worker pool. Code is decoded for the image's architecture, pointers in
+ *   writable segments are decoded through their fixups.
+ */
+typedef struct macho_xref_index_t_64 {
+	uint64_t count;
+	macho_xref_t_64* xrefs;	/* sorted by target, then source */
+	struct macho_vm_t_64* vm;
+	struct macho_t_64* macho;
+} macho_xref_index_t_64;
+
+/*
+ * Mach-O Cross Reference Functions
+ */
+macho_xref_index_t_64* macho_xref_index_create_64();
+macho_xref_index_t_64* macho_xref_index_load_64(struct macho_t_64* macho);
+uint64_t macho_xref_find_64(macho_xref_index_t_64* index, uint64_t start, uint64_t end, uint64_t* first);
+const char* macho_xref_backend_64();
+void macho_xref_index_debug_64(macho_xref_index_t_64* index);
+void macho_xref_index_free_64(macho_xref_index_t_64* index);
+
+#endif /* MACHO_XREF_H_ */
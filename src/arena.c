@@ -0,0 +1,90 @@
+/**
+ * libmacho-1.0 - arena.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define MACHO_ARENA_ALIGN 8
+
+void macho_arena_init_64(macho_arena_t_64* arena, uint64_t block_size) {
+	arena->block_size = block_size ? block_size : 0x10000;
+	arena->head = NULL;
+}
+
+void* macho_arena_alloc_64(macho_arena_t_64* arena, uint64_t size) {
+	uint64_t capacity = 0;
+	macho_arena_block_t_64* block = arena->head;
+
+	size = (size + MACHO_ARENA_ALIGN - 1) & ~((uint64_t) MACHO_ARENA_ALIGN - 1);
+	if (block == NULL || block->size - block->used < size) {
+		// Oversized requests get a block of their own
+		capacity = size > arena->block_size ? size : arena->block_size;
+		block = (macho_arena_block_t_64*) malloc(sizeof(macho_arena_block_t_64) + capacity);
+		if (block == NULL) {
+			return NULL;
+		}
+		block->size = capacity;
+		block->used = 0;
+		block->next = arena->head;
+		arena->head = block;
+	}
+	block->used += size;
+	return &block->data[block->used - size];
+}
+
+char* macho_arena_strndup_64(macho_arena_t_64* arena, const char* string, uint64_t length) {
+	char* copy = (char*) macho_arena_alloc_64(arena, length + 1);
+	if (copy) {
+		memcpy(copy, string, length);
+		copy[length] = '\0';
+	}
+	return copy;
+}
+
+// Keeps the most recent block for reuse and releases the rest
+void macho_arena_reset_64(macho_arena_t_64* arena) {
+	macho_arena_block_t_64* next = NULL;
+	macho_arena_block_t_64* block = arena->head;
+	if (block == NULL) {
+		return;
+	}
+	next = block->next;
+	block->next = NULL;
+	block->used = 0;
+	while (next) {
+		block = next;
+		next = block->next;
+		free(block);
+	}
+}
+
+void macho_arena_free_64(macho_arena_t_64* arena) {
+	macho_arena_block_t_64* next = NULL;
+	macho_arena_block_t_64* block = arena->head;
+	while (block) {
+		next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->head = NULL;
+}
@@ -0,0 +1,51 @@
+/**
+ * libmacho-1.0 - arena.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_ARENA_H_
+#define MACHO_ARENA_H_
+
+#include <stdint.h>
+
+typedef struct macho_arena_block_t_64 {
+	struct macho_arena_block_t_64* next;
+	uint64_t size;
+	uint64_t used;
+	unsigned char data[];
+} macho_arena_block_t_64;
+
+/*
+ * Bump allocator: everything handed out lives until the arena is reset
+ *   or freed, there is no per-allocation free.
+ */
+typedef struct macho_arena_t_64 {
+	uint64_t block_size;
+	macho_arena_block_t_64* head;
+} macho_arena_t_64;
+
+/*
+ * Internal Arena Functions
+ */
+void macho_arena_init_64(macho_arena_t_64* arena, uint64_t block_size);
+void* macho_arena_alloc_64(macho_arena_t_64* arena, uint64_t size);
+char* macho_arena_strndup_64(macho_arena_t_64* arena, const char* string, uint64_t length);
+void macho_arena_reset_64(macho_arena_t_64* arena);
+void macho_arena_free_64(macho_arena_t_64* arena);
+
+#endif /* MACHO_ARENA_H_ */
@@ -0,0 +1,547 @@
+/**
+ * libmacho-1.0 - cache.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define _DEBUG
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/cache.h>
+
+#define MACHO_CACHE_HAS_FIELD(header, field) \
+	((header)->mappingOffset >= offsetof(macho_cache_header_t_64, field) + sizeof((header)->field))
+
+#define MACHO_CACHE_SUBCACHE_V1_SIZE 24
+#define MACHO_CACHE_SUBCACHE_V2_SIZE 56
+
+/*
+ * dyld Shared Cache File Functions
+ */
+macho_cache_file_t_64* macho_cache_file_create_64() {
+	macho_cache_file_t_64* file = (macho_cache_file_t_64*) malloc(sizeof(macho_cache_file_t_64));
+	if (file) {
+		memset(file, '\0', sizeof(macho_cache_file_t_64));
+	}
+	return file;
+}
+
+int macho_cache_file_load_64(macho_cache_file_t_64* file) {
+	uint32_t offset = 0;
+	uint32_t count = 0;
+	unsigned char* data = NULL;
+
+	if (file == NULL) {
+		return -1;
+	}
+	if (file->map) {
+		return 0;
+	}
+
+	debug("Mapping cache file %s\n", file->path);
+	file->map = macho_map_open_64(file->path);
+	if (file->map == NULL) {
+		error("Unable to map cache file %s\n", file->path);
+		return -1;
+	}
+	// Only the few images asked for are ever touched in a cache this size
+	macho_map_advise_64(file->map, 0, 0, MACHO_MAP_RANDOM);
+
+	data = file->map->data;
+	if (file->map->size < offsetof(macho_cache_header_t_64, imagesOffsetOld)
+			|| strncmp((const char*) data, MACHO_CACHE_MAGIC, strlen(MACHO_CACHE_MAGIC)) != 0) {
+		error("%s is not a dyld shared cache\n", file->path);
+		macho_map_free_64(file->map);
+		file->map = NULL;
+		return -1;
+	}
+
+	memcpy(&offset, &data[offsetof(macho_cache_header_t_64, mappingOffset)], sizeof(uint32_t));
+	memcpy(&count, &data[offsetof(macho_cache_header_t_64, mappingCount)], sizeof(uint32_t));
+	if (offset + (uint64_t) count * sizeof(macho_cache_mapping_info_t_64) > file->map->size) {
+		error("Cache mappings of %s are out of bounds\n", file->path);
+		macho_map_free_64(file->map);
+		file->map = NULL;
+		return -1;
+	}
+
+	// The mapping table is naturally aligned in the file, so it's used in place
+	file->mappings = (macho_cache_mapping_info_t_64*) &data[offset];
+	file->mapping_count = count;
+	if (count > 0 && file->address == 0) {
+		file->address = file->mappings[0].address;
+	}
+	return 0;
+}
+
+void macho_cache_file_debug_64(macho_cache_file_t_64* file) {
+	uint64_t i = 0;
+	if (file) {
+		debug("\tCache File:\n");
+		debug("\t\t   path: %s\n", file->path);
+		debug("\t\taddress: 0x%016" PRIx64 "\n", file->address);
+		if (file->map == NULL) {
+			debug("\t\t(not mapped)\n");
+			return;
+		}
+		for (i = 0; i < file->mapping_count; i++) {
+			macho_cache_mapping_info_t_64* mapping = &file->mappings[i];
+			debug("\t\tmapping: 0x%016" PRIx64 "-0x%016" PRIx64 " fileoff=0x%" PRIx64 " prot=%d/%d\n",
+					mapping->address, mapping->address + mapping->size,
+					mapping->fileOffset, mapping->initProt, mapping->maxProt);
+		}
+	}
+}
+
+void macho_cache_file_free_64(macho_cache_file_t_64* file) {
+	if (file) {
+		if (file->map) {
+			macho_map_free_64(file->map);
+			file->map = NULL;
+		}
+		if (file->path) {
+			free(file->path);
+			file->path = NULL;
+		}
+		free(file);
+	}
+}
+
+/*
+ * dyld Shared Cache Functions
+ */
+macho_cache_t_64* macho_cache_create_64() {
+	macho_cache_t_64* cache = (macho_cache_t_64*) malloc(sizeof(macho_cache_t_64));
+	if (cache) {
+		memset(cache, '\0', sizeof(macho_cache_t_64));
+	}
+	return cache;
+}
+
+static int macho_cache_subcaches_load_64(macho_cache_t_64* cache, const char* path) {
+	uint32_t i = 0;
+	uint64_t size = 0;
+	uint64_t entry_size = 0;
+	unsigned char* data = NULL;
+	macho_cache_file_t_64* file = NULL;
+	macho_cache_header_t_64* header = cache->header;
+	macho_cache_subcache_entry_t_64 entry;
+
+	if (!MACHO_CACHE_HAS_FIELD(header, subCacheArrayCount) || header->subCacheArrayCount == 0) {
+		return 0;
+	}
+
+	// v2 entries carry their own file suffix; older caches just number them
+	entry_size = MACHO_CACHE_HAS_FIELD(header, cacheSubType) ?
+			MACHO_CACHE_SUBCACHE_V2_SIZE : MACHO_CACHE_SUBCACHE_V1_SIZE;
+	data = cache->files[0]->map->data;
+	size = cache->files[0]->map->size;
+	if (header->subCacheArrayOffset + header->subCacheArrayCount * entry_size > size) {
+		error("Sub-cache array is out of bounds\n");
+		return -1;
+	}
+
+	for (i = 0; i < header->subCacheArrayCount; i++) {
+		memset(&entry, '\0', sizeof(entry));
+		memcpy(&entry, &data[header->subCacheArrayOffset + i * entry_size], entry_size);
+
+		file = macho_cache_file_create_64();
+		if (file == NULL) {
+			return -1;
+		}
+		file->path = (char*) malloc(strlen(path) + sizeof(entry.fileSuffix) + 1);
+		if (file->path == NULL) {
+			macho_cache_file_free_64(file);
+			return -1;
+		}
+		if (entry_size == MACHO_CACHE_SUBCACHE_V2_SIZE) {
+			entry.fileSuffix[sizeof(entry.fileSuffix) - 1] = '\0';
+			sprintf(file->path, "%s%s", path, entry.fileSuffix);
+		} else {
+			sprintf(file->path, "%s.%u", path, i + 1);
+		}
+		file->address = cache->files[0]->address + entry.cacheVMOffset;
+		cache->files[cache->file_count++] = file;
+	}
+	return 0;
+}
+
+static int macho_cache_images_load_64(macho_cache_t_64* cache) {
+	uint64_t i = 0;
+	uint64_t size = 0;
+	uint32_t offset = 0;
+	uint32_t count = 0;
+	unsigned char* data = NULL;
+	macho_cache_header_t_64* header = cache->header;
+	macho_cache_image_info_t_64 info;
+
+	if (MACHO_CACHE_HAS_FIELD(header, imagesCount)) {
+		offset = header->imagesOffset;
+		count = header->imagesCount;
+	} else {
+		offset = header->imagesOffsetOld;
+		count = header->imagesCountOld;
+	}
+
+	data = cache->files[0]->map->data;
+	size = cache->files[0]->map->size;
+	if (offset + (uint64_t) count * sizeof(macho_cache_image_info_t_64) > size) {
+		error("Cache image table is out of bounds\n");
+		return -1;
+	}
+
+	cache->images = (macho_cache_image_t_64*) malloc((count + 1) * sizeof(macho_cache_image_t_64));
+	if (cache->images == NULL) {
+		error("Unable to allocate cache image table\n");
+		return -1;
+	}
+	memset(cache->images, '\0', (count + 1) * sizeof(macho_cache_image_t_64));
+
+	for (i = 0; i < count; i++) {
+		memcpy(&info, &data[offset + i * sizeof(macho_cache_image_info_t_64)], sizeof(info));
+		cache->images[i].address = info.address;
+		// Paths are only kept when they end inside the mapping
+		if (info.pathFileOffset < size
+				&& memchr(&data[info.pathFileOffset], '\0', size - info.pathFileOffset) != NULL) {
+			cache->images[i].path = (const char*) &data[info.pathFileOffset];
+		}
+	}
+	cache->image_count = count;
+	debug("Found %d images in cache\n", count);
+	return 0;
+}
+
+macho_cache_t_64* macho_cache_open_64(const char* path) {
+	uint64_t length = 0;
+	macho_cache_file_t_64* file = NULL;
+	macho_cache_t_64* cache = NULL;
+
+	if (path == NULL) {
+		return NULL;
+	}
+
+	cache = macho_cache_create_64();
+	if (cache == NULL) {
+		error("Unable to create cache\n");
+		return NULL;
+	}
+
+	file = macho_cache_file_create_64();
+	if (file == NULL) {
+		macho_cache_free_64(cache);
+		return NULL;
+	}
+	file->path = strdup(path);
+	if (macho_cache_file_load_64(file) < 0) {
+		macho_cache_file_free_64(file);
+		macho_cache_free_64(cache);
+		return NULL;
+	}
+
+	// Older headers are shorter; anything past mappingOffset isn't header
+	cache->header = (macho_cache_header_t_64*) malloc(sizeof(macho_cache_header_t_64));
+	if (cache->header == NULL) {
+		macho_cache_file_free_64(file);
+		macho_cache_free_64(cache);
+		return NULL;
+	}
+	memset(cache->header, '\0', sizeof(macho_cache_header_t_64));
+	memcpy(cache->header, file->map->data, offsetof(macho_cache_header_t_64, mappingCount) + sizeof(uint32_t));
+	length = cache->header->mappingOffset;
+	if (length > sizeof(macho_cache_header_t_64)) {
+		length = sizeof(macho_cache_header_t_64);
+	}
+	memcpy(cache->header, file->map->data, length);
+
+	length = 1;
+	if (MACHO_CACHE_HAS_FIELD(cache->header, subCacheArrayCount)) {
+		length += cache->header->subCacheArrayCount;
+	}
+	cache->files = (macho_cache_file_t_64**) malloc((length + 1) * sizeof(macho_cache_file_t_64*));
+	if (cache->files == NULL) {
+		macho_cache_file_free_64(file);
+		macho_cache_free_64(cache);
+		return NULL;
+	}
+	memset(cache->files, '\0', (length + 1) * sizeof(macho_cache_file_t_64*));
+	cache->files[cache->file_count++] = file;
+
+	if (macho_cache_subcaches_load_64(cache, path) < 0
+			|| macho_cache_images_load_64(cache) < 0) {
+		error("Unable to parse dyld shared cache %s\n", path);
+		macho_cache_free_64(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+unsigned char* macho_cache_translate_64(macho_cache_t_64* cache, uint64_t address, uint64_t* available) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t delta = 0;
+	macho_cache_file_t_64* file = NULL;
+	macho_cache_mapping_info_t_64* mapping = NULL;
+
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	// Sub-caches are laid out in ascending VM order, so the last file starting
+	//   at or below the address is the only one that can contain it.
+	for (i = 0; i < cache->file_count; i++) {
+		if (cache->files[i]->address > address) {
+			break;
+		}
+		file = cache->files[i];
+	}
+	if (file == NULL || macho_cache_file_load_64(file) < 0) {
+		return NULL;
+	}
+
+	for (j = 0; j < file->mapping_count; j++) {
+		mapping = &file->mappings[j];
+		if (address >= mapping->address && address < mapping->address + mapping->size) {
+			delta = address - mapping->address;
+			if (mapping->fileOffset + delta >= file->map->size) {
+				return NULL;
+			}
+			if (available) {
+				*available = mapping->size - delta;
+				if (mapping->fileOffset + mapping->size > file->map->size) {
+					*available = file->map->size - (mapping->fileOffset + delta);
+				}
+			}
+			return &file->map->data[mapping->fileOffset + delta];
+		}
+	}
+	return NULL;
+}
+
+macho_cache_image_t_64* macho_cache_find_image_64(macho_cache_t_64* cache, const char* path) {
+	uint64_t i = 0;
+	if (cache && path) {
+		for (i = 0; i < cache->image_count; i++) {
+			if (cache->images[i].path && strcmp(cache->images[i].path, path) == 0) {
+				return &cache->images[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+static macho_symtab_t_64** macho_cache_symtabs_load_64(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t count = 0;
+	uint64_t start = 0;
+	unsigned char* base = NULL;
+	macho_symtab_cmd_t_64* cmd = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_symtab_t_64** symtabs = NULL;
+	macho_segment_t_64* linkedit = NULL;
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd == MACHO_CMD_SYMTAB) {
+			count++;
+		}
+	}
+	macho->symtab_count = count;
+
+	symtabs = macho_symtabs_create_64(count);
+	if (symtabs == NULL) {
+		return NULL;
+	}
+
+	// symoff and stroff are file offsets into whichever cache file holds the
+	//   shared __LINKEDIT, so go through the segment's translated data instead.
+	linkedit = macho_get_segment_64(macho, "__LINKEDIT");
+	if (linkedit == NULL || linkedit->data == NULL) {
+		error("Cache image has no __LINKEDIT\n");
+		macho->symtab_count = 0;
+		return symtabs;
+	}
+	base = linkedit->data;
+	start = linkedit->command->fileoff;
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd != MACHO_CMD_SYMTAB) {
+			continue;
+		}
+		// Both tables have to lie inside the part of __LINKEDIT the cache maps
+		cmd = (macho_symtab_cmd_t_64*) macho_view_64(macho->data, macho->size,
+				macho->commands[i]->offset, sizeof(macho_symtab_cmd_t_64));
+		if (cmd == NULL || macho->commands[i]->size < sizeof(macho_symtab_cmd_t_64)
+				|| cmd->symoff < start || cmd->stroff < start
+				|| macho_view_64(base, linkedit->size, cmd->symoff - start,
+						(uint64_t) cmd->nsyms * sizeof(nlist_64)) == NULL
+				|| macho_view_64(base, linkedit->size, cmd->stroff - start, cmd->strsize) == NULL) {
+			error("Cache image symtab is out of bounds\n");
+			continue;
+		}
+		symtab = macho_symtab_create_64();
+		if (symtab == NULL) {
+			break;
+		}
+		symtab->cmd = cmd;
+		symtab->nsyms = cmd->nsyms;
+		symtab->symbols = (nlist_64*) &base[cmd->symoff - start];
+		symtab->strings = &base[cmd->stroff - start];
+		if (macho_symtab_columns_load_64(symtab) < 0) {
+			macho_symtab_free_64(symtab);
+			break;
+		}
+		symtabs[j++] = symtab;
+	}
+	macho->symtab_count = j;
+	return symtabs;
+}
+
+macho_t_64* macho_cache_image_load_64(macho_cache_t_64* cache, macho_cache_image_t_64* image) {
+	uint64_t i = 0;
+	uint64_t size = 0;
+	unsigned char* data = NULL;
+	uint64_t j = 0;
+	uint64_t available = 0;
+	macho_t_64* macho = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_section_t_64* section = NULL;
+
+	if (cache == NULL || image == NULL) {
+		return NULL;
+	}
+	if (image->macho) {
+		return image->macho;
+	}
+
+	data = macho_cache_translate_64(cache, image->address, &size);
+	if (data == NULL) {
+		error("Unable to locate image at 0x%016" PRIx64 " in cache\n", image->address);
+		return NULL;
+	}
+
+	// The view borrows the cache mapping, it never owns or copies the bytes
+	macho = macho_create_64();
+	if (macho == NULL) {
+		return NULL;
+	}
+	macho->data = data;
+	macho->size = size;
+	macho->offset = 0;
+
+	macho->header = macho_header_load_64(macho);
+	if (macho->header == NULL) {
+		error("Unable to load cache image header\n");
+		macho_free_64(macho);
+		return NULL;
+	}
+	macho->offset += sizeof(macho_header_t_64);
+
+	macho->command_count = macho->header->ncmds;
+	macho->commands = macho_commands_load_64(macho);
+	if (macho->commands == NULL) {
+		error("Unable to parse cache image load commands\n");
+		macho_free_64(macho);
+		return NULL;
+	}
+
+	macho->segments = macho_segments_load_64(macho);
+	if (macho->segments == NULL) {
+		error("Unable to parse cache image segments\n");
+		macho_free_64(macho);
+		return NULL;
+	}
+	// Segment and section file offsets are offsets into whichever cache file
+	//   holds them, not into the image, so every view goes by address instead
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		segment->data = macho_cache_translate_64(cache, segment->address, &available);
+		segment->size = segment->data ? segment->command->filesize : 0;
+		if (segment->size > available) {
+			segment->size = available;
+		}
+		for (j = 0; j < segment->section_count; j++) {
+			section = segment->sections[j];
+			section->data = NULL;
+			if (macho_section_info_zerofill_64(section->info)) {
+				continue;
+			}
+			section->data = macho_cache_translate_64(cache, section->info->addr, &available);
+			if (section->data && available < section->info->size) {
+				section->data = NULL;
+			}
+		}
+	}
+
+	macho->symtabs = macho_cache_symtabs_load_64(macho);
+	image->macho = macho;
+	return macho;
+}
+
+void macho_cache_debug_64(macho_cache_t_64* cache) {
+	uint64_t i = 0;
+	if (cache) {
+		debug("dyld Shared Cache:\n");
+		debug("\t  magic: %.16s\n", cache->header->magic);
+		debug("\t  files: %" PRIu64 "\n", cache->file_count);
+		debug("\t images: %" PRIu64 "\n", cache->image_count);
+		for (i = 0; i < cache->file_count; i++) {
+			macho_cache_file_debug_64(cache->files[i]);
+		}
+		for (i = 0; i < cache->image_count; i++) {
+			debug("\t0x%016" PRIx64 "\t%s\n", cache->images[i].address,
+					cache->images[i].path ? cache->images[i].path : "(no path)");
+		}
+		debug("\n");
+	}
+}
+
+void macho_cache_free_64(macho_cache_t_64* cache) {
+	uint64_t i = 0;
+	if (cache) {
+		if (cache->images) {
+			for (i = 0; i < cache->image_count; i++) {
+				if (cache->images[i].macho) {
+					macho_free_64(cache->images[i].macho);
+					cache->images[i].macho = NULL;
+				}
+			}
+			free(cache->images);
+			cache->images = NULL;
+		}
+		if (cache->files) {
+			for (i = 0; i < cache->file_count; i++) {
+				macho_cache_file_free_64(cache->files[i]);
+			}
+			free(cache->files);
+			cache->files = NULL;
+		}
+		if (cache->header) {
+			free(cache->header);
+			cache->header = NULL;
+		}
+		free(cache);
+	}
+}
@@ -0,0 +1,526 @@
+/**
+ * libmacho-1.0 - callgraph.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/symbolicate.h>
+#include <libmacho-1.0/fat.h>
+#include <libmacho-1.0/function.h>
+#include <libmacho-1.0/callgraph.h>
+
+#include "pool.h"
+#include "x86.h"
+
+#define MACHO_CALLGRAPH_CHUNK 0x40000 // bytes of code decoded by one job, at least
+
+typedef struct macho_callgraph_edge_t_64 {
+	uint64_t caller;
+	uint64_t callee;
+	uint64_t site;
+} macho_callgraph_edge_t_64;
+
+typedef struct macho_callgraph_chunk_t_64 {
+	uint64_t address;	/* of the section */
+	const unsigned char* data;	/* view of the whole section */
+	uint64_t size;
+	uint64_t start;		/* of this chunk within the section */
+	uint64_t end;
+	uint64_t count;
+	uint64_t capacity;
+	macho_callgraph_edge_t_64* edges;	/* in address order */
+	uint64_t unresolved;
+} macho_callgraph_chunk_t_64;
+
+typedef struct macho_callgraph_build_t_64 {
+	uint32_t cputype;
+	macho_callgraph_t_64* graph;
+	macho_functions_t_64* functions;
+	uint64_t chunk_count;
+	uint64_t chunk_capacity;
+	macho_callgraph_chunk_t_64* chunks;
+} macho_callgraph_build_t_64;
+
+static int macho_callgraph_node_compare(const void* a, const void* b) {
+	const macho_callgraph_node_t_64* x = (const macho_callgraph_node_t_64*) a;
+	const macho_callgraph_node_t_64* y = (const macho_callgraph_node_t_64*) b;
+	if (x->address < y->address) return -1;
+	if (x->address > y->address) return 1;
+	return 0;
+}
+
+static int macho_callgraph_is_stubs(macho_section_info_t_64* info) {
+	return (info->flags & MACHO_SECTION_TYPE) == MACHO_SECTION_SYMBOL_STUBS && info->reserved2 != 0;
+}
+
+static int macho_callgraph_is_code(macho_section_info_t_64* info) {
+	return (info->flags & (MACHO_SECTION_ATTR_PURE_INSTRUCTIONS | MACHO_SECTION_ATTR_SOME_INSTRUCTIONS)) != 0
+			&& !macho_callgraph_is_stubs(info);
+}
+
+// Exact node lookup, over the functions and then the stubs, each of which
+//   are sorted by address
+static uint64_t macho_callgraph_lookup(macho_callgraph_t_64* graph, uint64_t low, uint64_t high, uint64_t address) {
+	uint64_t end = high;
+	uint64_t middle = 0;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (graph->nodes[middle].address < address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low < end && graph->nodes[low].address == address ? low : MACHO_CALLGRAPH_NONE;
+}
+
+static int macho_callgraph_add(macho_callgraph_build_t_64* build, macho_callgraph_chunk_t_64* chunk,
+		uint64_t site, uint64_t target) {
+	uint64_t caller = 0;
+	uint64_t callee = 0;
+	uint64_t capacity = 0;
+	macho_callgraph_edge_t_64* edges = NULL;
+
+	caller = macho_functions_find_64(build->functions, site);
+	callee = macho_callgraph_find_64(build->graph, target);
+	if (caller == MACHO_FUNCTION_NONE || callee == MACHO_CALLGRAPH_NONE) {
+		chunk->unresolved++;
+		return 0;
+	}
+	if (chunk->count == chunk->capacity) {
+		capacity = chunk->capacity ? chunk->capacity * 2 : 256;
+		edges = (macho_callgraph_edge_t_64*) realloc(chunk->edges, capacity * sizeof(macho_callgraph_edge_t_64));
+		if (edges == NULL) {
+			return -1;
+		}
+		chunk->edges = edges;
+		chunk->capacity = capacity;
+	}
+	chunk->edges[chunk->count].caller = caller;
+	chunk->edges[chunk->count].callee = callee;
+	chunk->edges[chunk->count].site = site;
+	chunk->count++;
+	return 0;
+}
+
+// BL, the only arm64 branch that links
+static int macho_callgraph_arm64_scan(macho_callgraph_build_t_64* build, macho_callgraph_chunk_t_64* chunk) {
+	uint32_t insn = 0;
+	uint64_t offset = 0;
+	uint64_t pc = 0;
+	int64_t displacement = 0;
+
+	for (offset = chunk->start; offset + sizeof(uint32_t) <= chunk->end; offset += sizeof(uint32_t)) {
+		insn = macho_read32_64(chunk->data + offset);
+		if ((insn & 0xFC000000) != 0x94000000) {
+			continue;
+		}
+		pc = chunk->address + offset;
+		displacement = (int64_t) ((uint64_t) insn << 38) >> 36;
+		if (macho_callgraph_add(build, chunk, pc, pc + (uint64_t) displacement) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// CALL rel32, decoded instruction by instruction from a function start
+static int macho_callgraph_x86_64_scan(macho_callgraph_build_t_64* build, macho_callgraph_chunk_t_64* chunk) {
+	uint64_t offset = 0;
+	uint64_t pc = 0;
+	macho_x86_insn_t_64 insn;
+
+	for (offset = chunk->start; offset < chunk->end; offset += insn.length) {
+		if (macho_x86_decode_64(chunk->data + offset, chunk->size - offset, &insn) < 0) {
+			insn.length = 1;
+			continue;
+		}
+		if ((insn.flags & (MACHO_X86_CALL | MACHO_X86_REL32)) != (MACHO_X86_CALL | MACHO_X86_REL32)) {
+			continue;
+		}
+		pc = chunk->address + offset;
+		if (macho_callgraph_add(build, chunk, pc, pc + insn.length + (uint64_t) insn.displacement) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int macho_callgraph_chunk_job(uint64_t index, void* userdata) {
+	macho_callgraph_build_t_64* build = (macho_callgraph_build_t_64*) userdata;
+	macho_callgraph_chunk_t_64* chunk = &build->chunks[index];
+	if (build->cputype == MACHO_CPU_TYPE_ARM64) {
+		return macho_callgraph_arm64_scan(build, chunk);
+	}
+	return macho_callgraph_x86_64_scan(build, chunk);
+}
+
+// Variable length code is only split at a function start, fixed length
+//   code anywhere
+static uint64_t macho_callgraph_chunk_end(macho_callgraph_build_t_64* build, macho_section_info_t_64* info,
+		uint64_t start) {
+	uint64_t end = 0;
+	uint64_t index = 0;
+
+	if (info->size - start <= MACHO_CALLGRAPH_CHUNK) {
+		return info->size;
+	}
+	end = start + MACHO_CALLGRAPH_CHUNK;
+	if (build->cputype != MACHO_CPU_TYPE_X86_64) {
+		return end;
+	}
+	index = macho_functions_find_64(build->functions, info->addr + end - 1);
+	index = index == MACHO_FUNCTION_NONE ? 0 : index + 1;
+	if (index >= build->functions->count || build->functions->starts[index] >= info->addr + info->size) {
+		return info->size;
+	}
+	return build->functions->starts[index] - info->addr;
+}
+
+static int macho_callgraph_add_section(macho_callgraph_build_t_64* build, macho_section_t_64* section) {
+	uint64_t start = 0;
+	uint64_t end = 0;
+	uint64_t capacity = 0;
+	const unsigned char* data = NULL;
+	macho_callgraph_chunk_t_64* chunks = NULL;
+	macho_callgraph_chunk_t_64* chunk = NULL;
+	macho_section_info_t_64* info = section->info;
+
+	data = section->data;
+	if (data == NULL || info->size == 0) {
+		return 0;
+	}
+	for (start = 0; start < info->size; start = end) {
+		end = macho_callgraph_chunk_end(build, info, start);
+		if (build->chunk_count == build->chunk_capacity) {
+			capacity = build->chunk_capacity ? build->chunk_capacity * 2 : 64;
+			chunks = (macho_callgraph_chunk_t_64*) realloc(build->chunks, capacity * sizeof(macho_callgraph_chunk_t_64));
+			if (chunks == NULL) {
+				return -1;
+			}
+			build->chunks = chunks;
+			build->chunk_capacity = capacity;
+		}
+		chunk = &build->chunks[build->chunk_count++];
+		memset(chunk, '\0', sizeof(macho_callgraph_chunk_t_64));
+		chunk->address = info->addr;
+		chunk->data = data;
+		chunk->size = info->size;
+		chunk->start = start;
+		chunk->end = end;
+	}
+	return 0;
+}
+
+// One node per stub, named after the symbol its indirect symbol table
+//   entry points at
+static int macho_callgraph_load_stubs(macho_callgraph_t_64* graph) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t k = 0;
+	uint64_t count = 0;
+	uint64_t entry = 0;
+	uint32_t symbol = 0;
+	unsigned char* indirect = NULL;
+	macho_t_64* macho = graph->macho;
+	macho_symtab_t_64* symtab = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_dysymtab_cmd_t_64* dysymtab = NULL;
+	macho_callgraph_node_t_64* node = NULL;
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd == MACHO_CMD_DYSYMTAB) {
+			dysymtab = (macho_dysymtab_cmd_t_64*) macho_view_64(macho->data, macho->size, macho->commands[i]->offset,
+					sizeof(macho_dysymtab_cmd_t_64));
+			break;
+		}
+	}
+	if (dysymtab) {
+		indirect = (unsigned char*) macho_view_64(macho->data, macho->size, dysymtab->indirectsymoff,
+				(uint64_t) dysymtab->nindirectsyms * sizeof(uint32_t));
+	}
+	symtab = macho->symtab_count ? macho->symtabs[0] : NULL;
+
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; segment && j < segment->section_count; j++) {
+			info = segment->sections[j]->info;
+			if (info == NULL || !macho_callgraph_is_stubs(info)) {
+				continue;
+			}
+			count = info->size / info->reserved2;
+			for (k = 0; k < count; k++) {
+				node = &graph->nodes[graph->node_count++];
+				node->address = info->addr + k * info->reserved2;
+				node->name = NULL;
+				node->flags = MACHO_CALLGRAPH_IMPORT;
+				entry = (uint64_t) info->reserved1 + k;
+				if (indirect == NULL || entry >= dysymtab->nindirectsyms) {
+					continue;
+				}
+				symbol = macho_read32_64(indirect + entry * sizeof(uint32_t));
+				if (symtab && !(symbol & (MACHO_INDIRECT_SYMBOL_LOCAL | MACHO_INDIRECT_SYMBOL_ABS))
+						&& symbol < symtab->nsyms) {
+					node->name = macho_symtab_name_64(symtab, symbol);
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+static int macho_callgraph_load_nodes(macho_callgraph_build_t_64* build) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t stubs = 0;
+	macho_callgraph_t_64* graph = build->graph;
+	macho_t_64* macho = graph->macho;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_symbolicator_t_64* symbolicator = NULL;
+	macho_symbolication_t_64* names = NULL;
+
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; segment && j < segment->section_count; j++) {
+			info = segment->sections[j]->info;
+			if (info && macho_callgraph_is_stubs(info)) {
+				stubs += info->size / info->reserved2;
+			}
+		}
+	}
+
+	graph->nodes = (macho_callgraph_node_t_64*) calloc(build->functions->count + stubs + 1,
+			sizeof(macho_callgraph_node_t_64));
+	names = (macho_symbolication_t_64*) calloc(build->functions->count + 1, sizeof(macho_symbolication_t_64));
+	if (graph->nodes == NULL || names == NULL) {
+		free(names);
+		return -1;
+	}
+
+	// A function keeps a name only if a symbol starts exactly there
+	symbolicator = macho_symbolicator_load_64(macho);
+	if (symbolicator && macho_symbolicator_resolve_64(symbolicator, build->functions->starts,
+			build->functions->count, names) < 0) {
+		memset(names, '\0', (build->functions->count + 1) * sizeof(macho_symbolication_t_64));
+	}
+	for (i = 0; i < build->functions->count; i++) {
+		graph->nodes[i].address = build->functions->starts[i];
+		graph->nodes[i].name = symbolicator && names[i].name && names[i].offset == 0 ? names[i].name : NULL;
+	}
+	graph->node_count = build->functions->count;
+	graph->function_count = build->functions->count;
+	macho_symbolicator_free_64(symbolicator);
+	free(names);
+
+	macho_callgraph_load_stubs(graph);
+	if (graph->node_count - graph->function_count > 1) {
+		qsort(&graph->nodes[graph->function_count], graph->node_count - graph->function_count,
+				sizeof(macho_callgraph_node_t_64), macho_callgraph_node_compare);
+	}
+	return 0;
+}
+
+// Counting sort of the edges by caller. Chunks are in address order, so
+//   the calls of each function stay in the order they were found.
+static int macho_callgraph_load_edges(macho_callgraph_build_t_64* build) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t slot = 0;
+	uint64_t* cursors = NULL;
+	macho_callgraph_t_64* graph = build->graph;
+	macho_callgraph_chunk_t_64* chunk = NULL;
+
+	for (i = 0; i < build->chunk_count; i++) {
+		graph->edge_count += build->chunks[i].count;
+		graph->unresolved += build->chunks[i].unresolved;
+	}
+	graph->offsets = (uint64_t*) calloc(graph->node_count + 1, sizeof(uint64_t));
+	graph->callees = (uint64_t*) malloc((graph->edge_count + 1) * sizeof(uint64_t));
+	graph->sites = (uint64_t*) malloc((graph->edge_count + 1) * sizeof(uint64_t));
+	cursors = (uint64_t*) malloc((graph->node_count + 1) * sizeof(uint64_t));
+	if (graph->offsets == NULL || graph->callees == NULL || graph->sites == NULL || cursors == NULL) {
+		free(cursors);
+		return -1;
+	}
+
+	for (i = 0; i < build->chunk_count; i++) {
+		chunk = &build->chunks[i];
+		for (j = 0; j < chunk->count; j++) {
+			graph->offsets[chunk->edges[j].caller + 1]++;
+		}
+	}
+	for (i = 0; i < graph->node_count; i++) {
+		graph->offsets[i + 1] += graph->offsets[i];
+	}
+	memcpy(cursors, graph->offsets, (graph->node_count + 1) * sizeof(uint64_t));
+	for (i = 0; i < build->chunk_count; i++) {
+		chunk = &build->chunks[i];
+		for (j = 0; j < chunk->count; j++) {
+			slot = cursors[chunk->edges[j].caller]++;
+			graph->callees[slot] = chunk->edges[j].callee;
+			graph->sites[slot] = chunk->edges[j].site;
+		}
+	}
+	free(cursors);
+	return 0;
+}
+
+/*
+ * Mach-O Call Graph Functions
+ */
+macho_callgraph_t_64* macho_callgraph_create_64() {
+	macho_callgraph_t_64* graph = (macho_callgraph_t_64*) malloc(sizeof(macho_callgraph_t_64));
+	if (graph) {
+		memset(graph, '\0', sizeof(macho_callgraph_t_64));
+	}
+	return graph;
+}
+
+macho_callgraph_t_64* macho_callgraph_load_64(macho_t_64* macho) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t failed = 0;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_callgraph_t_64* graph = NULL;
+	macho_callgraph_build_t_64 build;
+
+	if (macho == NULL || macho->header == NULL) {
+		return NULL;
+	}
+	if (macho->header->cputype != MACHO_CPU_TYPE_ARM64 && macho->header->cputype != MACHO_CPU_TYPE_X86_64) {
+		error("Unable to decode calls for CPU type 0x%x\n", macho->header->cputype);
+		return NULL;
+	}
+
+	graph = macho_callgraph_create_64();
+	if (graph == NULL) {
+		error("Unable to create call graph\n");
+		return NULL;
+	}
+	graph->macho = macho;
+
+	memset(&build, '\0', sizeof(build));
+	build.cputype = macho->header->cputype;
+	build.graph = graph;
+	build.functions = macho_functions_load_64(macho);
+	if (build.functions == NULL || macho_callgraph_load_nodes(&build) < 0) {
+		error("Unable to allocate call graph nodes\n");
+		macho_functions_free_64(build.functions);
+		macho_callgraph_free_64(graph);
+		return NULL;
+	}
+
+	for (i = 0; ret == 0 && i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; ret == 0 && segment && j < segment->section_count; j++) {
+			info = segment->sections[j]->info;
+			if (info && macho_callgraph_is_code(info)) {
+				ret = macho_callgraph_add_section(&build, segment->sections[j]);
+			}
+		}
+	}
+	if (ret == 0 && build.chunk_count
+			&& macho_pool_run_64(build.chunk_count, 1, macho_callgraph_chunk_job, &build, &failed) != 0) {
+		error("Unable to decode calls in chunk %" PRIu64 "\n", failed);
+		ret = -1;
+	}
+	if (ret == 0 && macho_callgraph_load_edges(&build) < 0) {
+		error("Unable to allocate call graph edges\n");
+		ret = -1;
+	}
+
+	for (i = 0; i < build.chunk_count; i++) {
+		free(build.chunks[i].edges);
+	}
+	free(build.chunks);
+	macho_functions_free_64(build.functions);
+	if (ret < 0) {
+		macho_callgraph_free_64(graph);
+		return NULL;
+	}
+	debug("Call graph has %" PRIu64 " functions, %" PRIu64 " stubs and %" PRIu64 " calls, %" PRIu64 " unresolved\n", graph->function_count,
+			graph->node_count - graph->function_count, graph->edge_count, graph->unresolved);
+	return graph;
+}
+
+// Node starting exactly at address
+uint64_t macho_callgraph_find_64(macho_callgraph_t_64* graph, uint64_t address) {
+	uint64_t index = 0;
+	if (graph == NULL) {
+		return MACHO_CALLGRAPH_NONE;
+	}
+	index = macho_callgraph_lookup(graph, 0, graph->function_count, address);
+	if (index == MACHO_CALLGRAPH_NONE) {
+		index = macho_callgraph_lookup(graph, graph->function_count, graph->node_count, address);
+	}
+	return index;
+}
+
+void macho_callgraph_debug_64(macho_callgraph_t_64* graph) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	if (graph) {
+		debug("\tCall Graph:\n");
+		debug("\t\tnodes: 0x%" PRIx64 "\n", graph->node_count);
+		debug("\t\tedges: 0x%" PRIx64 "\n", graph->edge_count);
+		for (i = 0; i < graph->node_count; i++) {
+			debug("\t\t0x%016" PRIx64 "\t%s\n", graph->nodes[i].address, graph->nodes[i].name ? graph->nodes[i].name : "");
+			for (j = graph->offsets[i]; j < graph->offsets[i + 1]; j++) {
+				debug("\t\t\t0x%016" PRIx64 " -> 0x%016" PRIx64 "\n", graph->sites[j], graph->nodes[graph->callees[j]].address);
+			}
+		}
+	}
+}
+
+void macho_callgraph_free_64(macho_callgraph_t_64* graph) {
+	if (graph) {
+		if (graph->nodes) {
+			free(graph->nodes);
+			graph->nodes = NULL;
+		}
+		if (graph->offsets) {
+			free(graph->offsets);
+			graph->offsets = NULL;
+		}
+		if (graph->callees) {
+			free(graph->callees);
+			graph->callees = NULL;
+		}
+		if (graph->sites) {
+			free(graph->sites);
+			graph->sites = NULL;
+		}
+		free(graph);
+	}
+}
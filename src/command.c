@@ -66,21 +66,17 @@ macho_command_t_64* macho_command_create_64() {
 #define	MACHO_CMD_PREBIND_CKSUM    0x17 // prebind checksum
 */
 macho_command_t_64* macho_command_load_64(unsigned char* data, uint64_t offset) {
-	uint64_t size = 0;
 	macho_command_t_64* command = macho_command_create_64();
 	if(command == NULL) {
 		error("Unable to create command\n");
 		return NULL;
 	}
 
-	macho_command_info_t_64* info = macho_command_info_load_64(data, offset); 
-	if (info) {
-		command->info = info;
-		command->cmd = info->cmd;
-		command->size = info->cmdsize;
-		command->data = data;
-		command->offset = offset;
-	}
+	command->info = macho_command_info_view_64(data, offset);
+	command->cmd = command->info->cmd;
+	command->size = command->info->cmdsize;
+	command->data = data;
+	command->offset = offset;
 
 	return command;
 }
@@ -97,10 +93,6 @@ void macho_command_debug_64(macho_command_t_64* command) {
 
 void macho_command_free_64(macho_command_t_64* command) {
 	if(command) {
-		if(command->info) {
-			macho_command_info_free_64(command->info);
-			command->info = NULL;
-		}
 		free(command);
 	}
 }
@@ -108,36 +100,11 @@ void macho_command_free_64(macho_command_t_64* command) {
 /*
  * Mach-O Command Info Functions
  */
-macho_command_info_t_64* macho_command_info_create_64() {
-	macho_command_info_t_64* info = (macho_command_info_t_64*) malloc(sizeof(macho_command_info_t_64));
-	if (info) {
-		debug("Mach-O Command Info Created\n");
-		memset(info, '\0', sizeof(macho_command_info_t_64));
-	}
-	return info;
-}
-
-macho_command_info_t_64* macho_command_info_load_64(unsigned char* data, uint64_t offset) {
-	macho_command_info_t_64* info = (macho_command_info_t_64*)macho_command_info_create_64();
-	if (info) {
-		debug("Mach-O Command Info Loaded\n");
-		memcpy(info, data+offset, sizeof(macho_command_info_t_64));
-		//macho_command_info_debug_64(info);
-	}
-	return info;
-}
-
 void macho_command_info_debug_64(macho_command_info_t_64* info) {
 	if (info) {
 		debug("\tInfo:\n");
-		debug("\t\t    cmd = %d\n", info->cmd);
-		debug("\t\tcmdsize = %d\n", info->cmdsize);
+		debug("\t\t    cmd = 0x%x\n", info->cmd);
+		debug("\t\tcmdsize = %u\n", info->cmdsize);
 		debug("\t\n");
 	}
 }
-
-void macho_command_info_free_64(macho_command_info_t_64* info) {
-	if (info) {
-		free(info);
-	}
-}
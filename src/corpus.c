@@ -0,0 +1,1504 @@
+/**
+ * libmacho-1.0 - corpus.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/view.h>
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/corpus.h>
+#include <libmacho-1.0/loader.h>
+
+#include "arena.h"
+#include "hash.h"
+
+#define MACHO_CORPUS_SHARD_MAX    0x400	// binaries per shard
+#define MACHO_CORPUS_SHARDS_MAX   0x200	// shard runs open at once while merging
+#define MACHO_CORPUS_BLOOM_BITS   10	// filter bits per distinct name
+#define MACHO_CORPUS_BLOOM_HASHES 7
+#define MACHO_CORPUS_SETTLE_MS    1000	// quiet time after the last change before a watch update
+
+typedef struct macho_corpus_file_t_64 {
+	char* path;
+	uint64_t inode;
+	uint64_t mtime;
+	uint64_t size;
+	uint8_t uuid[16];
+	uint64_t previous;	/* binary ID in the previous index, or UINT64_MAX to parse */
+} macho_corpus_file_t_64;
+
+typedef struct macho_corpus_paths_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	macho_corpus_file_t_64* items;
+} macho_corpus_paths_t_64;
+
+typedef struct macho_corpus_record_t_64 {
+	const char* name;
+	uint32_t binary;
+	uint32_t kind;
+	uint64_t address;
+} macho_corpus_record_t_64;
+
+typedef struct macho_corpus_build_t_64 {
+	const char* output;
+	uint64_t shard_size;
+	uint64_t shard_count;
+	uint64_t parse_count;
+	uint64_t* parse;	/* IDs of the binaries to parse, ascending */
+	macho_corpus_paths_t_64* paths;
+	macho_corpus_t_64* previous;
+} macho_corpus_build_t_64;
+
+// Records and Bloom filters of the shard being parsed, filled in by the
+//   loader's parse threads one binary at a time
+typedef struct macho_corpus_shard_t_64 {
+	macho_corpus_build_t_64* build;
+	uint64_t start;		/* first entry of build->parse in the shard */
+	uint64_t count;
+	uint64_t capacity;
+	macho_corpus_record_t_64* records;
+	uint32_t* bits;
+	uint32_t* distinct;
+	unsigned char** blooms;
+	macho_arena_t_64 arena;
+	pthread_mutex_t lock;
+} macho_corpus_shard_t_64;
+
+// Sorted records of one shard, or the postings the previous index keeps,
+//   read back one at a time during the merge
+typedef struct macho_corpus_run_t_64 {
+	FILE* file;
+	macho_corpus_t_64* corpus;
+	const uint64_t* remap;	/* previous binary ID to new, UINT64_MAX if dropped */
+	uint64_t symbol;
+	uint64_t posting;
+	uint64_t remaining;
+	uint64_t capacity;
+	char* name;
+	uint32_t binary;
+	uint32_t kind;
+	uint64_t address;
+} macho_corpus_run_t_64;
+
+static int macho_corpus_record_compare(const void* a, const void* b) {
+	const macho_corpus_record_t_64* x = (const macho_corpus_record_t_64*) a;
+	const macho_corpus_record_t_64* y = (const macho_corpus_record_t_64*) b;
+	int result = strcmp(x->name, y->name);
+	if (result) return result;
+	if (x->binary != y->binary) return x->binary < y->binary ? -1 : 1;
+	if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+	if (x->address != y->address) return x->address < y->address ? -1 : 1;
+	return 0;
+}
+
+static int macho_corpus_path_compare(const void* a, const void* b) {
+	return strcmp(((const macho_corpus_file_t_64*) a)->path, ((const macho_corpus_file_t_64*) b)->path);
+}
+
+static void macho_corpus_bloom_hashes(const char* name, uint64_t* h1, uint64_t* h2) {
+	*h1 = macho_hash_64(name, strlen(name), 0);
+	*h2 = macho_hash_mix_64(*h1) | 1;
+}
+
+static int macho_corpus_run_path(char* path, uint64_t size, const char* output, uint64_t shard) {
+	return snprintf(path, size, "%s.shard%" PRIu64, output, shard) < (int) size ? 0 : -1;
+}
+
+static int macho_corpus_is_macho(const char* path) {
+	int fd = -1;
+	uint32_t magic = 0;
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	if (read(fd, &magic, sizeof(magic)) != sizeof(magic)) {
+		magic = 0;
+	}
+	close(fd);
+	return magic == MACHO_MAGIC_64 || magic == __builtin_bswap32(MACHO_MAGIC_64);
+}
+
+// LC_UUID read straight from the load commands, without loading the image,
+//   to tell a rewritten but identical binary from a rebuilt one
+static int macho_corpus_uuid(const char* path, uint8_t* uuid) {
+	int fd = -1;
+	int swap = 0;
+	uint32_t i = 0;
+	uint32_t cmd = 0;
+	uint32_t ncmds = 0;
+	uint32_t cmdsize = 0;
+	uint32_t offset = 0;
+	uint32_t sizeofcmds = 0;
+	uint32_t header[8];
+	unsigned char* commands = NULL;
+
+	memset(uuid, '\0', 16);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (pread(fd, header, sizeof(header), 0) != sizeof(header)
+			|| (header[0] != MACHO_MAGIC_64 && header[0] != __builtin_bswap32(MACHO_MAGIC_64))) {
+		close(fd);
+		return -1;
+	}
+	swap = header[0] != MACHO_MAGIC_64;
+	ncmds = swap ? __builtin_bswap32(header[4]) : header[4];
+	sizeofcmds = swap ? __builtin_bswap32(header[5]) : header[5];
+	if (sizeofcmds > 0x100000) {
+		close(fd);
+		return -1;
+	}
+	commands = (unsigned char*) malloc(sizeofcmds ? sizeofcmds : 1);
+	if (commands == NULL || pread(fd, commands, sizeofcmds, sizeof(header)) != (ssize_t) sizeofcmds) {
+		free(commands);
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	for (i = 0; i < ncmds && offset + 8 <= sizeofcmds; i++) {
+		memcpy(&cmd, &commands[offset], sizeof(cmd));
+		memcpy(&cmdsize, &commands[offset + 4], sizeof(cmdsize));
+		cmd = swap ? __builtin_bswap32(cmd) : cmd;
+		cmdsize = swap ? __builtin_bswap32(cmdsize) : cmdsize;
+		if (cmdsize < 8 || cmdsize > sizeofcmds - offset) {
+			break;
+		}
+		if (cmd == MACHO_CMD_UUID && cmdsize >= 24) {
+			memcpy(uuid, &commands[offset + 8], 16);
+			free(commands);
+			return 0;
+		}
+		offset += cmdsize;
+	}
+	free(commands);
+	return -1;
+}
+
+static int macho_corpus_paths_add(macho_corpus_paths_t_64* paths, char* path, struct stat* st) {
+	uint64_t capacity = 0;
+	macho_corpus_file_t_64* items = NULL;
+	macho_corpus_file_t_64* file = NULL;
+	if (paths->count == paths->capacity) {
+		capacity = paths->capacity ? paths->capacity * 2 : 0x100;
+		items = (macho_corpus_file_t_64*) realloc(paths->items, capacity * sizeof(macho_corpus_file_t_64));
+		if (items == NULL) {
+			return -1;
+		}
+		paths->items = items;
+		paths->capacity = capacity;
+	}
+	file = &paths->items[paths->count++];
+	memset(file, '\0', sizeof(macho_corpus_file_t_64));
+	file->path = path;
+	file->inode = st->st_ino;
+	file->mtime = st->st_mtime;
+	file->size = st->st_size;
+	file->previous = UINT64_MAX;
+	return 0;
+}
+
+// Every thin 64-bit Mach-O below the directory; symlinks are not followed
+static int macho_corpus_walk(const char* directory, macho_corpus_paths_t_64* paths) {
+	int ret = 0;
+	char* path = NULL;
+	DIR* dir = NULL;
+	struct stat st;
+	struct dirent* entry = NULL;
+
+	dir = opendir(directory);
+	if (dir == NULL) {
+		error("Unable to open directory %s\n", directory);
+		return -1;
+	}
+	while (ret == 0 && (entry = readdir(dir)) != NULL) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+			continue;
+		}
+		path = (char*) malloc(strlen(directory) + strlen(entry->d_name) + 2);
+		if (path == NULL) {
+			ret = -1;
+			break;
+		}
+		sprintf(path, "%s/%s", directory, entry->d_name);
+		if (lstat(path, &st) < 0) {
+			free(path);
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			ret = macho_corpus_walk(path, paths);
+			free(path);
+		} else if (S_ISREG(st.st_mode) && macho_corpus_is_macho(path)) {
+			if (macho_corpus_paths_add(paths, path, &st) < 0) {
+				free(path);
+				ret = -1;
+			}
+		} else {
+			free(path);
+		}
+	}
+	closedir(dir);
+	return ret;
+}
+
+// Bloom filter over the distinct names of one binary's records, which
+//   have to be sorted by name already
+static unsigned char* macho_corpus_bloom(macho_arena_t_64* arena, const macho_corpus_record_t_64* records,
+		uint64_t count, uint32_t* bits, uint32_t* distinct) {
+	uint64_t i = 0;
+	uint64_t k = 0;
+	uint64_t h1 = 0;
+	uint64_t h2 = 0;
+	uint64_t size = 0;
+	unsigned char* bloom = NULL;
+
+	*bits = 0;
+	*distinct = 0;
+	for (i = 0; i < count; i++) {
+		if (i == 0 || strcmp(records[i - 1].name, records[i].name)) {
+			(*distinct)++;
+		}
+	}
+	if (*distinct == 0) {
+		return NULL;
+	}
+	for (size = 64; size < (uint64_t) *distinct * MACHO_CORPUS_BLOOM_BITS; size <<= 1);
+	bloom = (unsigned char*) macho_arena_alloc_64(arena, size / 8);
+	if (bloom == NULL) {
+		return NULL;
+	}
+	memset(bloom, '\0', size / 8);
+	for (i = 0; i < count; i++) {
+		macho_corpus_bloom_hashes(records[i].name, &h1, &h2);
+		for (k = 0; k < MACHO_CORPUS_BLOOM_HASHES; k++) {
+			h1 += h2;
+			bloom[(h1 & (size - 1)) / 8] |= 1 << (h1 & 7);
+		}
+	}
+	*bits = (uint32_t) size;
+	return bloom;
+}
+
+// Exports and imports of one binary, appended to the shard's records and
+//   summarized in its Bloom filter
+static int macho_corpus_shard_binary(uint64_t index, macho_t_64* macho, void* userdata) {
+	int ret = 0;
+	uint64_t j = 0;
+	uint64_t k = 0;
+	uint64_t id = 0;
+	uint64_t first = 0;
+	uint64_t capacity = 0;
+	uint8_t type = 0;
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_corpus_record_t_64* swap = NULL;
+	macho_corpus_record_t_64* record = NULL;
+	macho_corpus_shard_t_64* shard = (macho_corpus_shard_t_64*) userdata;
+
+	id = shard->build->parse[shard->start + index];
+	macho_corpus_uuid(shard->build->paths->items[id].path, shard->build->paths->items[id].uuid);
+
+	pthread_mutex_lock(&shard->lock);
+	first = shard->count;
+	for (j = 0; ret == 0 && j < macho->symtab_count; j++) {
+		symtab = macho->symtabs[j];
+		for (k = 0; k < symtab->nsyms; k++) {
+			type = symtab->types[k];
+			if ((type & MACHO_N_STAB) || !(type & MACHO_N_EXT)) {
+				continue;
+			}
+			name = macho_symtab_name_64(symtab, k);
+			if (name == NULL || name[0] == '\0') {
+				continue;
+			}
+			if (shard->count == shard->capacity) {
+				capacity = shard->capacity ? shard->capacity * 2 : 0x1000;
+				swap = (macho_corpus_record_t_64*) realloc(shard->records, capacity * sizeof(macho_corpus_record_t_64));
+				if (swap == NULL) {
+					ret = -1;
+					break;
+				}
+				shard->records = swap;
+				shard->capacity = capacity;
+			}
+			record = &shard->records[shard->count];
+			record->name = macho_arena_strndup_64(&shard->arena, name, strlen(name));
+			record->binary = (uint32_t) id;
+			record->kind = (type & MACHO_N_TYPE) == MACHO_N_UNDF ? MACHO_CORPUS_IMPORT : MACHO_CORPUS_EXPORT;
+			record->address = symtab->values[k];
+			if (record->name == NULL) {
+				ret = -1;
+				break;
+			}
+			shard->count++;
+		}
+	}
+	if (ret == 0 && shard->count > first) {
+		qsort(&shard->records[first], shard->count - first, sizeof(macho_corpus_record_t_64), macho_corpus_record_compare);
+		shard->blooms[index] = macho_corpus_bloom(&shard->arena, &shard->records[first], shard->count - first,
+				&shard->bits[index], &shard->distinct[index]);
+		if (shard->blooms[index] == NULL) {
+			ret = -1;
+		}
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return ret;
+}
+
+// Exports and imports of the shard's binaries, sorted by name then binary
+//   and written to a run file, followed by each binary's Bloom filter. The
+//   binaries are read through the bulk loader so parsing one overlaps the
+//   reads of the next.
+static int macho_corpus_shard_job(macho_corpus_build_t_64* build, uint64_t index) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint64_t written = 0;
+	uint32_t value = 0;
+	char path[4096];
+	const char** paths = NULL;
+	FILE* run = NULL;
+	macho_corpus_shard_t_64 shard;
+	macho_corpus_record_t_64* previous = NULL;
+
+	memset(&shard, '\0', sizeof(shard));
+	shard.build = build;
+	shard.start = index * build->shard_size;
+	end = shard.start + build->shard_size;
+	if (end > build->parse_count) {
+		end = build->parse_count;
+	}
+	if (macho_corpus_run_path(path, sizeof(path), build->output, index) < 0) {
+		return -1;
+	}
+	run = fopen(path, "wb");
+	if (run == NULL) {
+		error("Unable to create %s\n", path);
+		return -1;
+	}
+	macho_arena_init_64(&shard.arena, 0);
+	pthread_mutex_init(&shard.lock, NULL);
+	shard.bits = (uint32_t*) calloc(end - shard.start, sizeof(uint32_t));
+	shard.distinct = (uint32_t*) calloc(end - shard.start, sizeof(uint32_t));
+	shard.blooms = (unsigned char**) calloc(end - shard.start, sizeof(unsigned char*));
+	paths = (const char**) calloc(end - shard.start, sizeof(char*));
+
+	// The record count is filled in once the run is written
+	if (shard.bits == NULL || shard.distinct == NULL || shard.blooms == NULL || paths == NULL
+			|| fwrite(&written, sizeof(written), 1, run) != 1) {
+		ret = -1;
+	}
+
+	// Files that turn out not to be Mach-Os are skipped by the loader
+	for (i = shard.start; ret == 0 && i < end; i++) {
+		paths[i - shard.start] = build->paths->items[build->parse[i]].path;
+	}
+	if (ret == 0 && macho_loader_run_64(paths, end - shard.start, 0, macho_corpus_shard_binary, &shard) < 0) {
+		ret = -1;
+	}
+
+	if (ret == 0) {
+		qsort(shard.records, shard.count, sizeof(macho_corpus_record_t_64), macho_corpus_record_compare);
+	}
+	for (i = 0; ret == 0 && i < shard.count; i++) {
+		// A name repeated with the same kind in one binary is kept once
+		if (previous && previous->binary == shard.records[i].binary && previous->kind == shard.records[i].kind
+				&& !strcmp(previous->name, shard.records[i].name)) {
+			continue;
+		}
+		previous = &shard.records[i];
+		value = (uint32_t) strlen(shard.records[i].name);
+		if (fwrite(&value, sizeof(value), 1, run) != 1
+				|| fwrite(shard.records[i].name, 1, value, run) != value
+				|| fwrite(&shard.records[i].binary, sizeof(uint32_t), 1, run) != 1
+				|| fwrite(&shard.records[i].kind, sizeof(uint32_t), 1, run) != 1
+				|| fwrite(&shard.records[i].address, sizeof(uint64_t), 1, run) != 1) {
+			ret = -1;
+		}
+		written++;
+	}
+
+	for (i = 0; ret == 0 && i < end - shard.start; i++) {
+		if (fwrite(&shard.bits[i], sizeof(uint32_t), 1, run) != 1 || fwrite(&shard.distinct[i], sizeof(uint32_t), 1, run) != 1
+				|| (shard.bits[i] && fwrite(shard.blooms[i], 1, shard.bits[i] / 8, run) != shard.bits[i] / 8)) {
+			ret = -1;
+		}
+	}
+
+	if (ret == 0 && (fseek(run, 0, SEEK_SET) != 0 || fwrite(&written, sizeof(written), 1, run) != 1)) {
+		ret = -1;
+	}
+	if (fclose(run) != 0) {
+		ret = -1;
+	}
+	free(paths);
+	free(shard.records);
+	free(shard.bits);
+	free(shard.distinct);
+	free(shard.blooms);
+	pthread_mutex_destroy(&shard.lock);
+	macho_arena_free_64(&shard.arena);
+	if (ret < 0) {
+		error("Unable to write corpus shard %s\n", path);
+	}
+	return ret;
+}
+
+static int macho_corpus_run_reserve(macho_corpus_run_t_64* run, uint64_t length) {
+	char* name = NULL;
+	if (length + 1 > run->capacity) {
+		name = (char*) realloc(run->name, length + 1);
+		if (name == NULL) {
+			return -1;
+		}
+		run->name = name;
+		run->capacity = length + 1;
+	}
+	return 0;
+}
+
+// Postings of the previous index in name then binary order, skipping the
+//   binaries that are gone or parsed again
+static int macho_corpus_run_previous(macho_corpus_run_t_64* run) {
+	uint64_t length = 0;
+	macho_corpus_t_64* corpus = run->corpus;
+	macho_corpus_symbol_t_64* symbol = NULL;
+	macho_corpus_posting_t_64* posting = NULL;
+
+	for (; run->symbol < corpus->header->symbol_count; run->symbol++, run->posting = 0) {
+		symbol = &corpus->symbols[run->symbol];
+		if (symbol->name >= corpus->header->strings_size || symbol->posting > corpus->header->posting_count
+				|| symbol->count > corpus->header->posting_count - symbol->posting) {
+			return -1;
+		}
+		while (run->posting < symbol->count) {
+			posting = &corpus->postings[symbol->posting + run->posting++];
+			if (posting->binary >= corpus->header->binary_count || run->remap[posting->binary] == UINT64_MAX) {
+				continue;
+			}
+			length = strlen(&corpus->strings[symbol->name]);
+			if (macho_corpus_run_reserve(run, length) < 0) {
+				return -1;
+			}
+			memcpy(run->name, &corpus->strings[symbol->name], length + 1);
+			run->binary = (uint32_t) run->remap[posting->binary];
+			run->kind = posting->kind;
+			run->address = posting->address;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int macho_corpus_run_next(macho_corpus_run_t_64* run) {
+	uint32_t length = 0;
+	if (run->corpus) {
+		return macho_corpus_run_previous(run);
+	}
+	if (run->remaining == 0) {
+		return 0;
+	}
+	if (fread(&length, sizeof(length), 1, run->file) != 1 || macho_corpus_run_reserve(run, length) < 0) {
+		return -1;
+	}
+	if (fread(run->name, 1, length, run->file) != length
+			|| fread(&run->binary, sizeof(uint32_t), 1, run->file) != 1
+			|| fread(&run->kind, sizeof(uint32_t), 1, run->file) != 1
+			|| fread(&run->address, sizeof(uint64_t), 1, run->file) != 1) {
+		return -1;
+	}
+	run->name[length] = '\0';
+	run->remaining--;
+	return 1;
+}
+
+// Reused and parsed binaries interleave across runs, ties on a name go
+//   to the lower binary so every posting list ends up ordered by binary
+static int macho_corpus_heap_less(macho_corpus_run_t_64* runs, uint64_t a, uint64_t b) {
+	int result = strcmp(runs[a].name, runs[b].name);
+	return result < 0 || (result == 0 && runs[a].binary < runs[b].binary);
+}
+
+static void macho_corpus_heap_down(macho_corpus_run_t_64* runs, uint64_t* heap, uint64_t count, uint64_t i) {
+	uint64_t child = 0;
+	uint64_t top = heap[i];
+	while ((child = i * 2 + 1) < count) {
+		if (child + 1 < count && macho_corpus_heap_less(runs, heap[child + 1], heap[child])) {
+			child++;
+		}
+		if (!macho_corpus_heap_less(runs, heap[child], top)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = top;
+}
+
+static int macho_corpus_pool_add(unsigned char** pool, uint64_t* size, uint64_t* capacity,
+		const char* string, uint64_t* offset) {
+	uint64_t length = strlen(string) + 1;
+	uint64_t grown = 0;
+	unsigned char* data = NULL;
+	if (*size + length > *capacity) {
+		grown = *capacity ? *capacity * 2 : 0x10000;
+		while (grown < *size + length) {
+			grown *= 2;
+		}
+		data = (unsigned char*) realloc(*pool, grown);
+		if (data == NULL) {
+			return -1;
+		}
+		*pool = data;
+		*capacity = grown;
+	}
+	memcpy(&(*pool)[*size], string, length);
+	*offset = *size;
+	*size += length;
+	return 0;
+}
+
+static int macho_corpus_merge(macho_corpus_build_t_64* build, macho_corpus_run_t_64* runs, uint64_t run_count,
+		FILE* output) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t bits = 0;
+	uint64_t heap_count = 0;
+	uint64_t strings_size = 0;
+	uint64_t strings_capacity = 0;
+	uint64_t symbol_capacity = 0;
+	uint64_t offset = 0;
+	uint32_t value = 0;
+	uint64_t* heap = NULL;
+	unsigned char* bloom = NULL;
+	unsigned char* strings = NULL;
+	macho_corpus_file_t_64* file = NULL;
+	macho_corpus_binary_t_64* previous = NULL;
+	macho_corpus_run_t_64* run = NULL;
+	macho_corpus_symbol_t_64* swap = NULL;
+	macho_corpus_symbol_t_64* symbols = NULL;
+	macho_corpus_binary_t_64* binaries = NULL;
+	macho_corpus_posting_t_64 posting;
+	macho_corpus_header_t_64 header;
+
+	memset(&header, '\0', sizeof(header));
+	memcpy(header.magic, MACHO_CORPUS_MAGIC, sizeof(header.magic));
+	header.binary_count = build->paths->count;
+	header.postings_offset = sizeof(header);
+
+	heap = (uint64_t*) malloc((run_count ? run_count : 1) * sizeof(uint64_t));
+	binaries = (macho_corpus_binary_t_64*) calloc(build->paths->count ? build->paths->count : 1,
+			sizeof(macho_corpus_binary_t_64));
+	if (heap == NULL || binaries == NULL || fwrite(&header, sizeof(header), 1, output) != 1) {
+		ret = -1;
+		goto done;
+	}
+
+	for (i = 0; i < run_count; i++) {
+		if (runs[i].file && fread(&runs[i].remaining, sizeof(uint64_t), 1, runs[i].file) != 1) {
+			ret = -1;
+			goto done;
+		}
+		switch (macho_corpus_run_next(&runs[i])) {
+		case 1:
+			heap[heap_count++] = i;
+			break;
+		case 0:
+			break;
+		default:
+			ret = -1;
+			goto done;
+		}
+	}
+	for (i = heap_count; i-- > 0;) {
+		macho_corpus_heap_down(runs, heap, heap_count, i);
+	}
+
+	// Names are interned in sorted order, a symbol ID is its position
+	while (heap_count > 0) {
+		run = &runs[heap[0]];
+		if (header.symbol_count == 0 || strcmp((const char*) &strings[symbols[header.symbol_count - 1].name], run->name)) {
+			if (header.symbol_count == symbol_capacity) {
+				symbol_capacity = symbol_capacity ? symbol_capacity * 2 : 0x1000;
+				swap = (macho_corpus_symbol_t_64*) realloc(symbols, symbol_capacity * sizeof(macho_corpus_symbol_t_64));
+				if (swap == NULL) {
+					ret = -1;
+					goto done;
+				}
+				symbols = swap;
+			}
+			if (macho_corpus_pool_add(&strings, &strings_size, &strings_capacity, run->name, &offset) < 0) {
+				ret = -1;
+				goto done;
+			}
+			symbols[header.symbol_count].name = offset;
+			symbols[header.symbol_count].posting = header.posting_count;
+			symbols[header.symbol_count].count = 0;
+			header.symbol_count++;
+		}
+		posting.binary = run->binary;
+		posting.kind = run->kind;
+		posting.address = run->kind == MACHO_CORPUS_IMPORT ? 0 : run->address;
+		if (fwrite(&posting, sizeof(posting), 1, output) != 1) {
+			ret = -1;
+			goto done;
+		}
+		symbols[header.symbol_count - 1].count++;
+		header.posting_count++;
+
+		switch (macho_corpus_run_next(run)) {
+		case 1:
+			break;
+		case 0:
+			heap[0] = heap[--heap_count];
+			break;
+		default:
+			ret = -1;
+			goto done;
+		}
+		if (heap_count > 0) {
+			macho_corpus_heap_down(runs, heap, heap_count, 0);
+		}
+	}
+
+	header.symbols_offset = header.postings_offset + header.posting_count * sizeof(macho_corpus_posting_t_64);
+	if (header.symbol_count && fwrite(symbols, sizeof(macho_corpus_symbol_t_64), header.symbol_count, output) != header.symbol_count) {
+		ret = -1;
+		goto done;
+	}
+
+	// Reused binaries copy their filter out of the previous index, parsed
+	//   ones find theirs after the last record of their run, in ID order
+	header.blooms_offset = header.symbols_offset + header.symbol_count * sizeof(macho_corpus_symbol_t_64);
+	for (i = 0, j = 0; i < build->paths->count; i++) {
+		file = &build->paths->items[i];
+		binaries[i].bloom = header.blooms_size;
+		if (file->previous != UINT64_MAX) {
+			previous = &build->previous->binaries[file->previous];
+			bits = previous->bloom_bits;
+			binaries[i].bloom_bits = previous->bloom_bits;
+			binaries[i].symbol_count = previous->symbol_count;
+			if (bits && (previous->bloom > build->previous->header->blooms_size
+					|| bits / 8 > build->previous->header->blooms_size - previous->bloom
+					|| fwrite(&build->previous->blooms[previous->bloom], 1, bits / 8, output) != bits / 8)) {
+				ret = -1;
+				goto done;
+			}
+			header.blooms_size += bits / 8;
+			continue;
+		}
+		run = &runs[j++ / build->shard_size];
+		if (fread(&value, sizeof(value), 1, run->file) != 1) {
+			ret = -1;
+			goto done;
+		}
+		binaries[i].bloom_bits = value;
+		if (fread(&value, sizeof(value), 1, run->file) != 1) {
+			ret = -1;
+			goto done;
+		}
+		binaries[i].symbol_count = value;
+		bits = binaries[i].bloom_bits;
+		if (bits == 0) {
+			continue;
+		}
+		bloom = (unsigned char*) malloc(bits / 8);
+		if (bloom == NULL || fread(bloom, 1, bits / 8, run->file) != bits / 8
+				|| fwrite(bloom, 1, bits / 8, output) != bits / 8) {
+			free(bloom);
+			ret = -1;
+			goto done;
+		}
+		free(bloom);
+		header.blooms_size += bits / 8;
+	}
+
+	header.binaries_offset = header.blooms_offset + header.blooms_size;
+	for (i = 0; i < build->paths->count; i++) {
+		file = &build->paths->items[i];
+		if (macho_corpus_pool_add(&strings, &strings_size, &strings_capacity, file->path, &offset) < 0) {
+			ret = -1;
+			goto done;
+		}
+		binaries[i].path = offset;
+		binaries[i].inode = file->inode;
+		binaries[i].mtime = file->mtime;
+		binaries[i].size = file->size;
+		memcpy(binaries[i].uuid, file->uuid, sizeof(binaries[i].uuid));
+	}
+	if (build->paths->count && fwrite(binaries, sizeof(macho_corpus_binary_t_64), build->paths->count, output) != build->paths->count) {
+		ret = -1;
+		goto done;
+	}
+
+	header.strings_offset = header.binaries_offset + build->paths->count * sizeof(macho_corpus_binary_t_64);
+	header.strings_size = strings_size;
+	if ((strings_size && fwrite(strings, 1, strings_size, output) != strings_size)
+			|| fseek(output, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, output) != 1) {
+		ret = -1;
+		goto done;
+	}
+	debug("Corpus index holds %" PRIu64 " names in %" PRIu64 " postings over %" PRIu64 " binaries\n",
+			header.symbol_count, header.posting_count, header.binary_count);
+
+done:
+	free(heap);
+	free(symbols);
+	free(strings);
+	free(binaries);
+	return ret;
+}
+
+// Binaries whose (inode, mtime, size), or failing that whose LC_UUID, match
+//   the previous index keep their postings, the rest are parsed again
+static void macho_corpus_reuse(macho_corpus_t_64* previous, macho_corpus_paths_t_64* paths, uint64_t* remap) {
+	int result = 0;
+	uint64_t i = 0;
+	uint64_t low = 0;
+	uint64_t high = 0;
+	uint64_t found = 0;
+	uint64_t middle = 0;
+	uint64_t probed = 0;
+	uint64_t reused = 0;
+	const char* path = NULL;
+	macho_corpus_file_t_64* file = NULL;
+	macho_corpus_binary_t_64* binary = NULL;
+
+	// Both sides are in path order, binary IDs only ever shift down or up
+	for (i = 0; i < paths->count; i++) {
+		file = &paths->items[i];
+		found = UINT64_MAX;
+		low = 0;
+		high = previous->header->binary_count;
+		while (low < high) {
+			middle = low + (high - low) / 2;
+			path = macho_corpus_binary_path_64(previous, middle);
+			if (path == NULL) {
+				break;
+			}
+			result = strcmp(path, file->path);
+			if (result == 0) {
+				found = middle;
+				break;
+			}
+			if (result < 0) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		if (found == UINT64_MAX) {
+			continue;
+		}
+		binary = &previous->binaries[found];
+		if (binary->inode == file->inode && binary->mtime == file->mtime && binary->size == file->size) {
+			memcpy(file->uuid, binary->uuid, sizeof(file->uuid));
+		} else {
+			probed++;
+			if (macho_corpus_uuid(file->path, file->uuid) < 0
+					|| memcmp(file->uuid, binary->uuid, sizeof(file->uuid)) != 0) {
+				continue;
+			}
+		}
+		file->previous = found;
+		remap[found] = i;
+		reused++;
+	}
+	debug("Reusing %" PRIu64 " of %" PRIu64 " binaries, %" PRIu64 " probed by LC_UUID\n", reused, paths->count, probed);
+}
+
+// Indexes the tree into output, carrying over what it can from the previous
+//   index; the result is written aside and renamed over output when done
+static int macho_corpus_index(const char* directory, const char* output, macho_corpus_t_64* previous) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t run_count = 0;
+	uint64_t* remap = NULL;
+	char path[4096];
+	char temporary[4096];
+	FILE* file = NULL;
+	macho_corpus_paths_t_64 paths;
+	macho_corpus_run_t_64* runs = NULL;
+	macho_corpus_build_t_64 build;
+
+	memset(&paths, '\0', sizeof(paths));
+	memset(&build, '\0', sizeof(build));
+	if (snprintf(temporary, sizeof(temporary), "%s.tmp", output) >= (int) sizeof(temporary)) {
+		return -1;
+	}
+	if (macho_corpus_walk(directory, &paths) < 0) {
+		ret = -1;
+		goto done;
+	}
+	// Binary IDs follow path order so rebuilding an unchanged tree gives the same index
+	qsort(paths.items, paths.count, sizeof(macho_corpus_file_t_64), macho_corpus_path_compare);
+
+	build.output = output;
+	build.paths = &paths;
+	build.previous = previous;
+	build.parse = (uint64_t*) malloc((paths.count ? paths.count : 1) * sizeof(uint64_t));
+	if (build.parse == NULL) {
+		ret = -1;
+		goto done;
+	}
+	if (previous) {
+		remap = (uint64_t*) malloc((previous->header->binary_count ? previous->header->binary_count : 1) * sizeof(uint64_t));
+		if (remap == NULL) {
+			ret = -1;
+			goto done;
+		}
+		for (i = 0; i < previous->header->binary_count; i++) {
+			remap[i] = UINT64_MAX;
+		}
+		macho_corpus_reuse(previous, &paths, remap);
+	}
+	for (i = 0; i < paths.count; i++) {
+		if (paths.items[i].previous == UINT64_MAX) {
+			build.parse[build.parse_count++] = i;
+		}
+	}
+
+	// Shards run one after another, each spreading its reads and parses
+	//   over the loader's threads
+	build.shard_size = MACHO_CORPUS_SHARD_MAX;
+	if ((build.parse_count + build.shard_size - 1) / build.shard_size > MACHO_CORPUS_SHARDS_MAX) {
+		build.shard_size = (build.parse_count + MACHO_CORPUS_SHARDS_MAX - 1) / MACHO_CORPUS_SHARDS_MAX;
+	}
+	build.shard_count = (build.parse_count + build.shard_size - 1) / build.shard_size;
+	debug("Indexing %" PRIu64 " of %" PRIu64 " binaries in %" PRIu64 " shards\n", build.parse_count, paths.count, build.shard_count);
+
+	for (i = 0; i < build.shard_count; i++) {
+		if (macho_corpus_shard_job(&build, i) < 0) {
+			error("Unable to index corpus shard %" PRIu64 "\n", i);
+			ret = -1;
+			goto done;
+		}
+	}
+
+	// The previous index is merged as one more run
+	run_count = build.shard_count + (previous ? 1 : 0);
+	runs = (macho_corpus_run_t_64*) calloc(run_count ? run_count : 1, sizeof(macho_corpus_run_t_64));
+	if (runs == NULL) {
+		ret = -1;
+		goto done;
+	}
+	for (i = 0; i < build.shard_count; i++) {
+		if (macho_corpus_run_path(path, sizeof(path), output, i) < 0
+				|| (runs[i].file = fopen(path, "rb")) == NULL) {
+			error("Unable to open corpus shard %" PRIu64 "\n", i);
+			ret = -1;
+			goto done;
+		}
+	}
+	if (previous) {
+		runs[build.shard_count].corpus = previous;
+		runs[build.shard_count].remap = remap;
+	}
+	file = fopen(temporary, "wb");
+	if (file == NULL) {
+		error("Unable to create %s\n", temporary);
+		ret = -1;
+		goto done;
+	}
+	if (macho_corpus_merge(&build, runs, run_count, file) < 0) {
+		error("Unable to write %s: %s\n", temporary, strerror(errno));
+		ret = -1;
+	}
+	if (fclose(file) != 0) {
+		ret = -1;
+	}
+	// Readers holding the old index keep their mapping across the rename
+	if (ret == 0 && rename(temporary, output) < 0) {
+		error("Unable to replace %s: %s\n", output, strerror(errno));
+		ret = -1;
+	}
+	if (ret < 0) {
+		unlink(temporary);
+	}
+
+done:
+	for (i = 0; i < run_count; i++) {
+		if (runs && runs[i].file) {
+			fclose(runs[i].file);
+		}
+		if (runs) {
+			free(runs[i].name);
+		}
+	}
+	for (i = 0; i < build.shard_count; i++) {
+		if (macho_corpus_run_path(path, sizeof(path), output, i) == 0) {
+			unlink(path);
+		}
+	}
+	free(runs);
+	free(remap);
+	free(build.parse);
+	for (i = 0; i < paths.count; i++) {
+		free(paths.items[i].path);
+	}
+	free(paths.items);
+	return ret;
+}
+
+#ifdef __linux__
+typedef struct macho_corpus_watch_t_64 {
+	int fd;
+	uint64_t count;
+	uint64_t capacity;
+	int* descriptors;	/* inotify watch and the directory it is on */
+	char** directories;
+	const char* directory;
+	const char* output;
+	pthread_t thread;
+	int running;
+	int finished;
+	int result;
+} macho_corpus_watch_t_64;
+
+#define MACHO_CORPUS_WATCH_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO)
+
+static uint64_t macho_corpus_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static const char* macho_corpus_watch_directory(macho_corpus_watch_t_64* watch, int descriptor) {
+	uint64_t i = 0;
+	for (i = 0; i < watch->count; i++) {
+		if (watch->descriptors[i] == descriptor) {
+			return watch->directories[i];
+		}
+	}
+	return NULL;
+}
+
+// Forgets a watch the kernel has dropped, such as on a deleted directory
+static void macho_corpus_watch_remove(macho_corpus_watch_t_64* watch, int descriptor) {
+	uint64_t i = 0;
+	for (i = 0; i < watch->count; i++) {
+		if (watch->descriptors[i] == descriptor) {
+			free(watch->directories[i]);
+			watch->count--;
+			watch->descriptors[i] = watch->descriptors[watch->count];
+			watch->directories[i] = watch->directories[watch->count];
+			return;
+		}
+	}
+}
+
+// Watches the directory and every directory below it
+static int macho_corpus_watch_add(macho_corpus_watch_t_64* watch, const char* directory) {
+	int ret = 0;
+	int descriptor = 0;
+	uint64_t i = 0;
+	uint64_t capacity = 0;
+	int* descriptors = NULL;
+	char** directories = NULL;
+	char* path = NULL;
+	DIR* dir = NULL;
+	struct stat st;
+	struct dirent* entry = NULL;
+
+	descriptor = inotify_add_watch(watch->fd, directory, MACHO_CORPUS_WATCH_EVENTS | IN_ONLYDIR | IN_DONT_FOLLOW);
+	if (descriptor < 0) {
+		error("Unable to watch %s: %s\n", directory, strerror(errno));
+		return -1;
+	}
+	path = strdup(directory);
+	if (path == NULL) {
+		return -1;
+	}
+	// A directory moved back in reuses its old watch
+	for (i = 0; i < watch->count && watch->descriptors[i] != descriptor; i++);
+	if (i < watch->count) {
+		free(watch->directories[i]);
+		watch->directories[i] = path;
+	} else {
+		if (watch->count == watch->capacity) {
+			capacity = watch->capacity ? watch->capacity * 2 : 0x40;
+			descriptors = (int*) realloc(watch->descriptors, capacity * sizeof(int));
+			if (descriptors) {
+				watch->descriptors = descriptors;
+			}
+			directories = (char**) realloc(watch->directories, capacity * sizeof(char*));
+			if (directories) {
+				watch->directories = directories;
+			}
+			if (descriptors == NULL || directories == NULL) {
+				free(path);
+				return -1;
+			}
+			watch->capacity = capacity;
+		}
+		watch->descriptors[watch->count] = descriptor;
+		watch->directories[watch->count] = path;
+		watch->count++;
+	}
+
+	dir = opendir(directory);
+	if (dir == NULL) {
+		return 0;
+	}
+	while (ret == 0 && (entry = readdir(dir)) != NULL) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+			continue;
+		}
+		path = (char*) malloc(strlen(directory) + strlen(entry->d_name) + 2);
+		if (path == NULL) {
+			ret = -1;
+			break;
+		}
+		sprintf(path, "%s/%s", directory, entry->d_name);
+		if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+			ret = macho_corpus_watch_add(watch, path);
+		}
+		free(path);
+	}
+	closedir(dir);
+	return ret;
+}
+
+static void* macho_corpus_watch_update(void* userdata) {
+	macho_corpus_watch_t_64* watch = (macho_corpus_watch_t_64*) userdata;
+	watch->result = macho_corpus_update_64(watch->directory, watch->output);
+	__atomic_store_n(&watch->finished, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+// Drains pending events, returning one if any of them touched the tree
+static int macho_corpus_watch_read(macho_corpus_watch_t_64* watch, const char* ignore) {
+	int changed = 0;
+	ssize_t length = 0;
+	ssize_t offset = 0;
+	char* path = NULL;
+	const char* directory = NULL;
+	uint64_t buffer[0x800];
+	struct inotify_event* event = NULL;
+
+	while ((length = read(watch->fd, buffer, sizeof(buffer))) > 0) {
+		for (offset = 0; offset < length; offset += sizeof(struct inotify_event) + event->len) {
+			event = (struct inotify_event*) ((char*) buffer + offset);
+			if (event->mask & IN_Q_OVERFLOW) {
+				changed = 1;
+				continue;
+			}
+			// The kernel drops the watch of a deleted or unmounted directory
+			//   and reports it with IN_IGNORED
+			if (event->mask & IN_DELETE_SELF) {
+				changed = 1;
+			}
+			if (event->mask & IN_IGNORED) {
+				macho_corpus_watch_remove(watch, event->wd);
+				continue;
+			}
+			// Writing the index and its shard runs must not trigger another update
+			if (event->len == 0 || !strncmp(event->name, ignore, strlen(ignore))) {
+				continue;
+			}
+			changed = 1;
+			directory = macho_corpus_watch_directory(watch, event->wd);
+			if (directory == NULL || !(event->mask & IN_ISDIR) || !(event->mask & (IN_CREATE | IN_MOVED_TO))) {
+				continue;
+			}
+			path = (char*) malloc(strlen(directory) + strlen(event->name) + 2);
+			if (path == NULL) {
+				return -1;
+			}
+			sprintf(path, "%s/%s", directory, event->name);
+			if (macho_corpus_watch_add(watch, path) < 0) {
+				debug("Unable to watch new directory %s\n", path);
+			}
+			free(path);
+		}
+	}
+	if (length < 0 && errno != EAGAIN && errno != EINTR) {
+		return -1;
+	}
+	return changed;
+}
+#endif
+
+/*
+ * Mach-O Corpus Index Functions
+ */
+int macho_corpus_build_64(const char* directory, const char* output) {
+	if (directory == NULL || output == NULL) {
+		return -1;
+	}
+	return macho_corpus_index(directory, output, NULL);
+}
+
+int macho_corpus_update_64(const char* directory, const char* output) {
+	int ret = 0;
+	struct stat st;
+	macho_corpus_t_64* previous = NULL;
+
+	if (directory == NULL || output == NULL) {
+		return -1;
+	}
+	// An index that does not open, such as one in an older format, is rebuilt
+	if (stat(output, &st) == 0) {
+		previous = macho_corpus_open_64(output);
+		if (previous == NULL) {
+			debug("Rebuilding corpus index %s\n", output);
+		}
+	}
+	ret = macho_corpus_index(directory, output, previous);
+	macho_corpus_free_64(previous);
+	return ret;
+}
+
+#ifdef __linux__
+int macho_corpus_watch_64(const char* directory, const char* output, volatile int* stop) {
+	int ret = 0;
+	int dirty = 0;
+	uint64_t i = 0;
+	uint64_t changed = 0;
+	const char* ignore = NULL;
+	struct pollfd poller;
+	macho_corpus_watch_t_64 watch;
+
+	if (directory == NULL || output == NULL || stop == NULL) {
+		return -1;
+	}
+	memset(&watch, '\0', sizeof(watch));
+	watch.directory = directory;
+	watch.output = output;
+	ignore = strrchr(output, '/') ? strrchr(output, '/') + 1 : output;
+	watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch.fd < 0) {
+		error("Unable to start inotify: %s\n", strerror(errno));
+		return -1;
+	}
+	// Watches go in before the first update so nothing written meanwhile is missed
+	if (macho_corpus_watch_add(&watch, directory) < 0 || macho_corpus_update_64(directory, output) < 0) {
+		ret = -1;
+		goto done;
+	}
+
+	while (!*stop) {
+		poller.fd = watch.fd;
+		poller.events = POLLIN;
+		poller.revents = 0;
+		if (poll(&poller, 1, dirty ? 100 : 1000) < 0 && errno != EINTR) {
+			ret = -1;
+			break;
+		}
+		switch (macho_corpus_watch_read(&watch, ignore)) {
+		case 1:
+			dirty = 1;
+			changed = macho_corpus_now();
+			break;
+		case 0:
+			break;
+		default:
+			ret = -1;
+			goto done;
+		}
+		if (watch.running && __atomic_load_n(&watch.finished, __ATOMIC_ACQUIRE)) {
+			pthread_join(watch.thread, NULL);
+			watch.running = 0;
+			if (watch.result < 0) {
+				error("Unable to update corpus index %s\n", output);
+			}
+		}
+		// One update runs at a time off the event loop, once the tree has
+		//   settled; whatever changes during it is picked up by the next
+		if (dirty && !watch.running && macho_corpus_now() - changed >= MACHO_CORPUS_SETTLE_MS) {
+			dirty = 0;
+			watch.finished = 0;
+			if (pthread_create(&watch.thread, NULL, macho_corpus_watch_update, &watch) != 0) {
+				error("Unable to start corpus update\n");
+				ret = -1;
+				break;
+			}
+			watch.running = 1;
+		}
+	}
+
+done:
+	if (watch.running) {
+		pthread_join(watch.thread, NULL);
+	}
+	close(watch.fd);
+	for (i = 0; i < watch.count; i++) {
+		free(watch.directories[i]);
+	}
+	free(watch.directories);
+	free(watch.descriptors);
+	return ret;
+}
+#else
+int macho_corpus_watch_64(const char* directory, const char* output, volatile int* stop) {
+	error("Watching a corpus needs inotify\n");
+	return -1;
+}
+#endif
+
+macho_corpus_t_64* macho_corpus_create_64() {
+	macho_corpus_t_64* corpus = (macho_corpus_t_64*) malloc(sizeof(macho_corpus_t_64));
+	if (corpus) {
+		memset(corpus, '\0', sizeof(macho_corpus_t_64));
+	}
+	return corpus;
+}
+
+static void* macho_corpus_section(macho_map_t_64* map, uint64_t offset, uint64_t count, uint64_t size) {
+	if (count > map->size / size) {
+		return NULL;
+	}
+	return macho_view_64(map->data, map->size, offset, count * size);
+}
+
+macho_corpus_t_64* macho_corpus_open_64(const char* path) {
+	macho_corpus_header_t_64* header = NULL;
+	macho_corpus_t_64* corpus = NULL;
+
+	if (path == NULL) {
+		return NULL;
+	}
+
+	corpus = macho_corpus_create_64();
+	if (corpus == NULL) {
+		error("Unable to create corpus index\n");
+		return NULL;
+	}
+	corpus->map = macho_map_open_64(path);
+	if (corpus->map == NULL) {
+		macho_corpus_free_64(corpus);
+		return NULL;
+	}
+	// Lookups binary search the symbol table and jump to a few postings
+	macho_map_advise_64(corpus->map, 0, 0, MACHO_MAP_RANDOM);
+
+	header = (macho_corpus_header_t_64*) macho_view_64(corpus->map->data, corpus->map->size, 0,
+			sizeof(macho_corpus_header_t_64));
+	if (header == NULL || memcmp(header->magic, MACHO_CORPUS_MAGIC, sizeof(header->magic)) != 0) {
+		error("%s is not a corpus index\n", path);
+		macho_corpus_free_64(corpus);
+		return NULL;
+	}
+	corpus->header = header;
+	corpus->postings = (macho_corpus_posting_t_64*) macho_corpus_section(corpus->map, header->postings_offset,
+			header->posting_count, sizeof(macho_corpus_posting_t_64));
+	corpus->symbols = (macho_corpus_symbol_t_64*) macho_corpus_section(corpus->map, header->symbols_offset,
+			header->symbol_count, sizeof(macho_corpus_symbol_t_64));
+	corpus->blooms = (unsigned char*) macho_view_64(corpus->map->data, corpus->map->size, header->blooms_offset,
+			header->blooms_size);
+	corpus->binaries = (macho_corpus_binary_t_64*) macho_corpus_section(corpus->map, header->binaries_offset,
+			header->binary_count, sizeof(macho_corpus_binary_t_64));
+	corpus->strings = (const char*) macho_view_64(corpus->map->data, corpus->map->size, header->strings_offset,
+			header->strings_size);
+	// Every offset into the pool has to land on a terminated string
+	if (corpus->postings == NULL || corpus->symbols == NULL || corpus->blooms == NULL || corpus->binaries == NULL
+			|| corpus->strings == NULL || (header->strings_size && corpus->strings[header->strings_size - 1] != '\0')) {
+		error("Corpus index %s is truncated\n", path);
+		macho_corpus_free_64(corpus);
+		return NULL;
+	}
+	return corpus;
+}
+
+const macho_corpus_posting_t_64* macho_corpus_lookup_64(macho_corpus_t_64* corpus, const char* name,
+		uint64_t* count) {
+	int result = 0;
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = 0;
+	macho_corpus_symbol_t_64* symbol = NULL;
+
+	if (corpus == NULL || name == NULL || count == NULL) {
+		return NULL;
+	}
+	*count = 0;
+	high = corpus->header->symbol_count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		symbol = &corpus->symbols[middle];
+		if (symbol->name >= corpus->header->strings_size) {
+			return NULL;
+		}
+		result = strcmp(&corpus->strings[symbol->name], name);
+		if (result == 0) {
+			if (symbol->posting > corpus->header->posting_count
+					|| symbol->count > corpus->header->posting_count - symbol->posting) {
+				return NULL;
+			}
+			*count = symbol->count;
+			return &corpus->postings[symbol->posting];
+		}
+		if (result < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return NULL;
+}
+
+// Postings of name in one binary, whose Bloom filter answers most misses
+//   without searching the symbols
+const macho_corpus_posting_t_64* macho_corpus_lookup_binary_64(macho_corpus_t_64* corpus, uint64_t binary,
+		const char* name, uint64_t* count) {
+	uint64_t low = 0;
+	uint64_t high = 0;
+	uint64_t middle = 0;
+	uint64_t total = 0;
+	const macho_corpus_posting_t_64* postings = NULL;
+
+	if (count == NULL) {
+		return NULL;
+	}
+	*count = 0;
+	if (!macho_corpus_may_contain_64(corpus, binary, name)) {
+		return NULL;
+	}
+	postings = macho_corpus_lookup_64(corpus, name, &total);
+	if (postings == NULL) {
+		return NULL;
+	}
+	// A symbol's postings are ordered by binary
+	high = total;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (postings[middle].binary < binary) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	for (high = low; high < total && postings[high].binary == binary; high++);
+	*count = high - low;
+	return *count ? &postings[low] : NULL;
+}
+
+// Zero means the binary certainly has no such export or import, one that
+//   it probably does
+int macho_corpus_may_contain_64(macho_corpus_t_64* corpus, uint64_t binary, const char* name) {
+	uint64_t i = 0;
+	uint64_t h1 = 0;
+	uint64_t h2 = 0;
+	uint64_t bits = 0;
+	const unsigned char* bloom = NULL;
+
+	if (corpus == NULL || name == NULL || binary >= corpus->header->binary_count) {
+		return 0;
+	}
+	bits = corpus->binaries[binary].bloom_bits;
+	if (bits == 0 || (bits & (bits - 1)) || corpus->binaries[binary].bloom > corpus->header->blooms_size
+			|| bits / 8 > corpus->header->blooms_size - corpus->binaries[binary].bloom) {
+		return 0;
+	}
+	bloom = &corpus->blooms[corpus->binaries[binary].bloom];
+	macho_corpus_bloom_hashes(name, &h1, &h2);
+	for (i = 0; i < MACHO_CORPUS_BLOOM_HASHES; i++) {
+		h1 += h2;
+		if (!(bloom[(h1 & (bits - 1)) / 8] & (1 << (h1 & 7)))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Binary ID of an indexed path, or UINT64_MAX
+uint64_t macho_corpus_binary_find_64(macho_corpus_t_64* corpus, const char* path) {
+	int result = 0;
+	uint64_t low = 0;
+	uint64_t high = 0;
+	uint64_t middle = 0;
+	const char* name = NULL;
+
+	if (corpus == NULL || path == NULL) {
+		return UINT64_MAX;
+	}
+	// Binary IDs follow path order
+	high = corpus->header->binary_count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		name = macho_corpus_binary_path_64(corpus, middle);
+		if (name == NULL) {
+			return UINT64_MAX;
+		}
+		result = strcmp(name, path);
+		if (result == 0) {
+			return middle;
+		}
+		if (result < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return UINT64_MAX;
+}
+
+const char* macho_corpus_binary_path_64(macho_corpus_t_64* corpus, uint64_t binary) {
+	if (corpus == NULL || binary >= corpus->header->binary_count
+			|| corpus->binaries[binary].path >= corpus->header->strings_size) {
+		return NULL;
+	}
+	return &corpus->strings[corpus->binaries[binary].path];
+}
+
+void macho_corpus_debug_64(macho_corpus_t_64* corpus) {
+	uint64_t i = 0;
+	if (corpus) {
+		debug("\tCorpus Index:\n");
+		debug("\t\tbinaries: 0x%" PRIx64 "\n", corpus->header->binary_count);
+		debug("\t\tsymbols: 0x%" PRIx64 "\n", corpus->header->symbol_count);
+		debug("\t\tpostings: 0x%" PRIx64 "\n", corpus->header->posting_count);
+		for (i = 0; i < corpus->header->binary_count; i++) {
+			debug("\t\t%" PRIu64 "\t%u\t%s\n", i, corpus->binaries[i].symbol_count, macho_corpus_binary_path_64(corpus, i));
+		}
+	}
+}
+
+void macho_corpus_free_64(macho_corpus_t_64* corpus) {
+	if (corpus) {
+		if (corpus->map) {
+			macho_map_free_64(corpus->map);
+			corpus->map = NULL;
+		}
+		free(corpus);
+	}
+}
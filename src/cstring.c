@@ -0,0 +1,385 @@
+/**
+ * libmacho-1.0 - cstring.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/cstring.h>
+
+#include "hash.h"
+
+// Sections that hold nothing but NUL-terminated strings, whatever type
+//   the linker happened to give them
+static const char* macho_cstring_sections[] = {
+	"__cstring",
+	"__objc_methname",
+	"__objc_classname",
+	"__objc_methtype",
+	"__oslogstring",
+	NULL
+};
+
+static int macho_cstring_offset_compare(const void* a, const void* b) {
+	const macho_cstring_entry_t_64* x = (const macho_cstring_entry_t_64*) a;
+	const macho_cstring_entry_t_64* y = (const macho_cstring_entry_t_64*) b;
+	if (x->offset < y->offset) return -1;
+	if (x->offset > y->offset) return 1;
+	return 0;
+}
+
+static int macho_cstring_string_compare(const void* a, const void* b) {
+	const macho_cstring_entry_t_64* x = *(const macho_cstring_entry_t_64* const*) a;
+	const macho_cstring_entry_t_64* y = *(const macho_cstring_entry_t_64* const*) b;
+	int result = strcmp(x->string, y->string);
+	if (result) return result;
+	return macho_cstring_offset_compare(x, y);
+}
+
+static int macho_cstring_number_compare(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	if (x < y) return -1;
+	if (x > y) return 1;
+	return 0;
+}
+
+static int macho_cstring_section_indexed(macho_section_t_64* section) {
+	int i = 0;
+	macho_section_info_t_64* info = section->info;
+	if (info == NULL || section->data == NULL || info->size == 0) {
+		return 0;
+	}
+	if ((info->flags & MACHO_SECTION_TYPE) == MACHO_SECTION_CSTRING_LITERALS) {
+		return 1;
+	}
+	for (i = 0; macho_cstring_sections[i]; i++) {
+		if (!strncmp(info->sectname, macho_cstring_sections[i], sizeof(info->sectname))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Every string of a section, or with entries NULL only how many there are
+static uint64_t macho_cstring_section_split(macho_section_t_64* section, macho_cstring_entry_t_64* entries) {
+	uint64_t count = 0;
+	macho_section_info_t_64* info = section->info;
+	const unsigned char* start = section->data;
+	const unsigned char* end = start + info->size;
+	const unsigned char* string = start;
+	const unsigned char* terminator = NULL;
+
+	while (string < end) {
+		terminator = (const unsigned char*) memchr(string, '\0', end - string);
+		// A string running off the end of its section is not one
+		if (terminator == NULL) {
+			break;
+		}
+		// Alignment padding shows up as empty strings
+		if (terminator > string) {
+			if (entries) {
+				entries[count].string = (const char*) string;
+				entries[count].offset = info->offset + (string - start);
+				entries[count].address = info->addr + (string - start);
+				entries[count].size = terminator - string;
+			}
+			count++;
+		}
+		string = terminator + 1;
+	}
+	return count;
+}
+
+static int macho_cstring_result_add(macho_cstring_result_t_64* result, uint64_t number) {
+	uint64_t capacity = 0;
+	uint64_t* matches = NULL;
+	if (result->count == result->capacity) {
+		capacity = result->capacity ? result->capacity * 2 : 256;
+		matches = (uint64_t*) realloc(result->matches, capacity * sizeof(uint64_t));
+		if (matches == NULL) {
+			return -1;
+		}
+		result->matches = matches;
+		result->capacity = capacity;
+	}
+	result->matches[result->count++] = number;
+	return 0;
+}
+
+// First sorted entry whose string does not sort below the prefix, or with
+//   upper set, the first one past every string starting with it
+static uint64_t macho_cstring_index_bound(macho_cstring_index_t_64* index, const char* prefix,
+		uint64_t length, int upper) {
+	int result = 0;
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = index->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		result = strncmp(index->entries[index->sorted[middle]].string, prefix, length);
+		if (result < 0 || (upper && result == 0)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+ * Mach-O C String Index Functions
+ */
+macho_cstring_index_t_64* macho_cstring_index_create_64() {
+	macho_cstring_index_t_64* index = (macho_cstring_index_t_64*) malloc(sizeof(macho_cstring_index_t_64));
+	if (index) {
+		memset(index, '\0', sizeof(macho_cstring_index_t_64));
+	}
+	return index;
+}
+
+macho_cstring_index_t_64* macho_cstring_index_load_64(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t slot = 0;
+	uint64_t count = 0;
+	macho_segment_t_64* segment = NULL;
+	macho_section_t_64* section = NULL;
+	macho_cstring_entry_t_64** order = NULL;
+	macho_cstring_index_t_64* index = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	index = macho_cstring_index_create_64();
+	if (index == NULL) {
+		error("Unable to create string index\n");
+		return NULL;
+	}
+	index->macho = macho;
+
+	// Counted first so the entries take a single allocation
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; j < segment->section_count; j++) {
+			section = segment->sections[j];
+			if (macho_cstring_section_indexed(section)) {
+				count += macho_cstring_section_split(section, NULL);
+			}
+		}
+	}
+	if (count == 0) {
+		return index;
+	}
+
+	for (index->bucket_count = 1; index->bucket_count < count * 2; index->bucket_count <<= 1);
+	index->entries = (macho_cstring_entry_t_64*) malloc(count * sizeof(macho_cstring_entry_t_64));
+	index->sorted = (uint64_t*) malloc(count * sizeof(uint64_t));
+	index->buckets = (uint64_t*) calloc(index->bucket_count, sizeof(uint64_t));
+	order = (macho_cstring_entry_t_64**) malloc(count * sizeof(macho_cstring_entry_t_64*));
+	if (index->entries == NULL || index->sorted == NULL || index->buckets == NULL || order == NULL) {
+		error("Unable to allocate string index entries\n");
+		free(order);
+		macho_cstring_index_free_64(index);
+		return NULL;
+	}
+
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; j < segment->section_count; j++) {
+			section = segment->sections[j];
+			if (macho_cstring_section_indexed(section)) {
+				index->count += macho_cstring_section_split(section, &index->entries[index->count]);
+			}
+		}
+	}
+	qsort(index->entries, index->count, sizeof(macho_cstring_entry_t_64), macho_cstring_offset_compare);
+
+	for (i = 0; i < index->count; i++) {
+		order[i] = &index->entries[i];
+	}
+	qsort(order, index->count, sizeof(macho_cstring_entry_t_64*), macho_cstring_string_compare);
+	for (i = 0; i < index->count; i++) {
+		index->sorted[i] = order[i] - index->entries;
+	}
+	free(order);
+
+	// Open addressing at half load, so a probe rarely goes past a slot or two
+	for (i = 0; i < index->count; i++) {
+		slot = macho_hash_64(index->entries[i].string, index->entries[i].size, 0) & (index->bucket_count - 1);
+		while (index->buckets[slot]) {
+			slot = (slot + 1) & (index->bucket_count - 1);
+		}
+		index->buckets[slot] = i + 1;
+	}
+
+	debug("String index loaded %llu strings\n", index->count);
+	return index;
+}
+
+// The string covering a file offset, which is what a raw match inside the
+//   image used to have to walk backwards to find
+macho_cstring_entry_t_64* macho_cstring_at_64(macho_cstring_index_t_64* index, uint64_t offset) {
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = 0;
+	macho_cstring_entry_t_64* entry = NULL;
+
+	if (index == NULL) {
+		return NULL;
+	}
+	high = index->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (index->entries[middle].offset <= offset) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0) {
+		return NULL;
+	}
+	entry = &index->entries[low - 1];
+	return offset <= entry->offset + entry->size ? entry : NULL;
+}
+
+// Exact and substring matches come back in file order, prefix matches in
+//   string order. Exact matches are a hash probe and prefix matches a range
+//   of the sorted strings; only a substring has to look at every string.
+macho_cstring_result_t_64* macho_find_cstrings_64(macho_cstring_index_t_64* index, const char* pattern, int mode) {
+	int failed = 0;
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint64_t slot = 0;
+	uint64_t start = 0;
+	uint64_t length = 0;
+	macho_cstring_entry_t_64* entry = NULL;
+	macho_cstring_result_t_64* result = NULL;
+
+	if (index == NULL || pattern == NULL) {
+		return NULL;
+	}
+	if (mode != MACHO_CSTRING_EXACT && mode != MACHO_CSTRING_PREFIX && mode != MACHO_CSTRING_SUBSTRING) {
+		error("Unknown string find mode %d\n", mode);
+		return NULL;
+	}
+
+	result = (macho_cstring_result_t_64*) malloc(sizeof(macho_cstring_result_t_64));
+	if (result == NULL) {
+		error("Unable to allocate string find result\n");
+		return NULL;
+	}
+	memset(result, '\0', sizeof(macho_cstring_result_t_64));
+	length = strlen(pattern);
+
+	if (mode == MACHO_CSTRING_EXACT && index->count) {
+		slot = macho_hash_64(pattern, length, 0) & (index->bucket_count - 1);
+		for (; index->buckets[slot]; slot = (slot + 1) & (index->bucket_count - 1)) {
+			entry = &index->entries[index->buckets[slot] - 1];
+			if (entry->size != length || memcmp(entry->string, pattern, length) != 0) {
+				continue;
+			}
+			if (macho_cstring_result_add(result, index->buckets[slot] - 1) < 0) {
+				failed = 1;
+				break;
+			}
+		}
+		if (result->count > 1) {
+			qsort(result->matches, result->count, sizeof(uint64_t), macho_cstring_number_compare);
+		}
+	} else if (mode == MACHO_CSTRING_PREFIX) {
+		start = macho_cstring_index_bound(index, pattern, length, 0);
+		end = macho_cstring_index_bound(index, pattern, length, 1);
+		for (i = start; i < end; i++) {
+			if (macho_cstring_result_add(result, index->sorted[i]) < 0) {
+				failed = 1;
+				break;
+			}
+		}
+	} else if (mode == MACHO_CSTRING_SUBSTRING) {
+		for (i = 0; i < index->count; i++) {
+			entry = &index->entries[i];
+			if (entry->size < length || strstr(entry->string, pattern) == NULL) {
+				continue;
+			}
+			if (macho_cstring_result_add(result, i) < 0) {
+				failed = 1;
+				break;
+			}
+		}
+	}
+
+	if (failed) {
+		error("Unable to allocate string find matches\n");
+		macho_cstring_result_free_64(result);
+		return NULL;
+	}
+	debug("String find of %s returned %llu of %llu strings\n", pattern, result->count, index->count);
+	return result;
+}
+
+void macho_cstring_result_free_64(macho_cstring_result_t_64* result) {
+	if (result) {
+		if (result->matches) {
+			free(result->matches);
+			result->matches = NULL;
+		}
+		free(result);
+	}
+}
+
+void macho_cstring_index_debug_64(macho_cstring_index_t_64* index) {
+	uint64_t i = 0;
+	if (index) {
+		debug("\tString Index:\n");
+		debug("\t\tcount: 0x%llx\n", index->count);
+		debug("\t\tbuckets: 0x%llx\n", index->bucket_count);
+		for (i = 0; i < index->count; i++) {
+			debug("\t\t0x%016llx\t0x%08llx\t%s\n", index->entries[i].address, index->entries[i].offset,
+					index->entries[i].string);
+		}
+	}
+}
+
+void macho_cstring_index_free_64(macho_cstring_index_t_64* index) {
+	if (index) {
+		if (index->entries) {
+			free(index->entries);
+			index->entries = NULL;
+		}
+		if (index->sorted) {
+			free(index->sorted);
+			index->sorted = NULL;
+		}
+		if (index->buckets) {
+			free(index->buckets);
+			index->buckets = NULL;
+		}
+		free(index);
+	}
+}
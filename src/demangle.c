@@ -0,0 +1,2178 @@
+/**
+ * libmacho-1.0 - demangle.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/demangle.h>
+
+#include "arena.h"
+#include "hash.h"
+#include "pool.h"
+
+// Names demangled by one worker before it reaches for more
+#define MACHO_DEMANGLE_CHUNK 256
+// Nesting deeper than this is treated as malformed
+#define MACHO_DEMANGLE_MAX_DEPTH 128
+#define MACHO_SWIFT_MAX_WORDS 26
+
+#define MACHO_SWIFT_IDENT  1
+#define MACHO_SWIFT_MODULE 2
+#define MACHO_SWIFT_TYPE   3
+#define MACHO_SWIFT_FUNC   4
+#define MACHO_SWIFT_EMPTY  5	// 'y', an empty list
+#define MACHO_SWIFT_MARKER 6	// '_', follows the first element of a list
+#define MACHO_SWIFT_THROWS 7
+#define MACHO_SWIFT_ENTITY 8
+
+/*
+ * C++ types are kept as the text before and after the declarator, so a
+ *   pointer to a function can be written as "void (*)(int)".
+ */
+typedef struct macho_itanium_type_t_64 {
+	const char* left;
+	const char* right;
+	int paren;	/* 1 for functions, 2 for arrays */
+	int ref;	/* 1 for "&", 2 for "&&", references collapse */
+	int pack;	/* argument pack, left holds the elements comma separated */
+	uint64_t param;	/* template parameter index + 1 of a bare T_ substitution */
+	uint64_t count;
+	struct macho_itanium_type_t_64* elems;
+} macho_itanium_type_t_64;
+
+typedef struct macho_itanium_list_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	macho_itanium_type_t_64* items;
+} macho_itanium_list_t_64;
+
+typedef struct macho_itanium_name_t_64 {
+	const char* text;
+	const char* quals;	/* cv and ref qualifiers of a member function */
+	int template;		/* ends in template arguments */
+	int special;		/* constructor, destructor or conversion, no return type */
+} macho_itanium_name_t_64;
+
+typedef struct macho_swift_node_t_64 {
+	int kind;
+	int throws;
+	const char* text;
+	const char* result;	/* function result type */
+	uint64_t count;		/* tuple elements or function parameters */
+	const char** elems;
+} macho_swift_node_t_64;
+
+typedef struct macho_swift_list_t_64 {
+	uint64_t count;
+	uint64_t capacity;
+	macho_swift_node_t_64* items;
+} macho_swift_list_t_64;
+
+typedef struct macho_demangle_state_t_64 {
+	const char* cur;
+	const char* end;
+	int depth;
+	int oom;			/* an allocation failed, the result is not final */
+	macho_arena_t_64* arena;
+
+	macho_itanium_list_t_64 subs;
+	macho_itanium_list_t_64 params;	/* template arguments T_ refers to */
+	int tag;			/* record the next template arguments as params */
+	int local;			/* encoding scopes a local name, print no result */
+	int64_t pack_index;		/* element of a pack being expanded, or -1 */
+	int64_t pack_count;		/* size of the first pack met in a pattern */
+
+	macho_swift_list_t_64 stack;
+	macho_swift_list_t_64 swift_subs;
+	int word_count;
+	const char* words[MACHO_SWIFT_MAX_WORDS];
+} macho_demangle_state_t_64;
+
+// Standard abbreviations, spelled out the way c++filt prints them
+static const char* macho_itanium_abbrevs[][2] = {
+	{ "a", "std::allocator" },
+	{ "b", "std::basic_string" },
+	{ "s", "std::basic_string<char, std::char_traits<char>, std::allocator<char> >" },
+	{ "i", "std::basic_istream<char, std::char_traits<char> >" },
+	{ "o", "std::basic_ostream<char, std::char_traits<char> >" },
+	{ "d", "std::basic_iostream<char, std::char_traits<char> >" },
+	{ NULL, NULL }
+};
+
+static const char* macho_itanium_builtins[26] = {
+	"signed char", "bool", "char", "double", "long double", "float", "__float128",
+	"unsigned char", "int", "unsigned int", NULL, "long", "unsigned long",
+	"__int128", "unsigned __int128", NULL, NULL, NULL, "short", "unsigned short",
+	NULL, "void", "wchar_t", "long long", "unsigned long long", "..."
+};
+
+static const char* macho_itanium_operators[][2] = {
+	{ "nw", "new" }, { "na", "new[]" }, { "dl", "delete" }, { "da", "delete[]" },
+	{ "ps", "+" }, { "ng", "-" }, { "ad", "&" }, { "de", "*" }, { "co", "~" },
+	{ "pl", "+" }, { "mi", "-" }, { "ml", "*" }, { "dv", "/" }, { "rm", "%" },
+	{ "an", "&" }, { "or", "|" }, { "eo", "^" }, { "aS", "=" }, { "pL", "+=" },
+	{ "mI", "-=" }, { "mL", "*=" }, { "dV", "/=" }, { "rM", "%=" }, { "aN", "&=" },
+	{ "oR", "|=" }, { "eO", "^=" }, { "ls", "<<" }, { "rs", ">>" }, { "lS", "<<=" },
+	{ "rS", ">>=" }, { "eq", "==" }, { "ne", "!=" }, { "lt", "<" }, { "gt", ">" },
+	{ "le", "<=" }, { "ge", ">=" }, { "ss", "<=>" }, { "nt", "!" }, { "aa", "&&" },
+	{ "oo", "||" }, { "pp", "++" }, { "mm", "--" }, { "cm", "," }, { "pm", "->*" },
+	{ "pt", "->" }, { "cl", "()" }, { "ix", "[]" }, { "qu", "?" }, { NULL, NULL }
+};
+
+static const char* macho_swift_standard[][2] = {
+	{ "a", "Array" }, { "b", "Bool" }, { "D", "Dictionary" }, { "d", "Double" },
+	{ "f", "Float" }, { "h", "Set" }, { "i", "Int" }, { "u", "UInt" },
+	{ "q", "Optional" }, { "S", "String" }, { "s", "Substring" }, { "J", "Character" },
+	{ "n", "Range" }, { "N", "ClosedRange" }, { "O", "ObjectIdentifier" },
+	{ "P", "UnsafePointer" }, { "p", "UnsafeMutablePointer" },
+	{ "V", "UnsafeRawPointer" }, { "v", "UnsafeMutableRawPointer" },
+	{ "R", "UnsafeBufferPointer" }, { "r", "UnsafeMutableBufferPointer" },
+	{ "Q", "Equatable" }, { "H", "Hashable" }, { "L", "Comparable" },
+	{ "T", "Sequence" }, { "l", "Collection" }, { "E", "Encodable" }, { "e", "Decodable" },
+	{ NULL, NULL }
+};
+
+// Sentinels for names claimed by the batch in flight, and for names that
+//   ran out of memory and are demangled again on the next lookup
+static const char macho_demangle_pending[] = "";
+static const char macho_demangle_retry[] = "";
+
+/*
+ * Shared Parser Helpers
+ */
+static char macho_demangle_peek(macho_demangle_state_t_64* dm, int ahead) {
+	if (dm->end - dm->cur <= ahead) {
+		return '\0';
+	}
+	return dm->cur[ahead];
+}
+
+static int macho_demangle_consume(macho_demangle_state_t_64* dm, const char* text) {
+	uint64_t length = strlen(text);
+	if ((uint64_t) (dm->end - dm->cur) < length || strncmp(dm->cur, text, length) != 0) {
+		return 0;
+	}
+	dm->cur += length;
+	return 1;
+}
+
+static void* macho_demangle_alloc(macho_demangle_state_t_64* dm, uint64_t size) {
+	void* data = macho_arena_alloc_64(dm->arena, size);
+	if (data == NULL) {
+		dm->oom = 1;
+	}
+	return data;
+}
+
+static char* macho_demangle_strndup(macho_demangle_state_t_64* dm, const char* text, uint64_t length) {
+	char* copy = macho_arena_strndup_64(dm->arena, text, length);
+	if (copy == NULL) {
+		dm->oom = 1;
+	}
+	return copy;
+}
+
+static int macho_demangle_number(macho_demangle_state_t_64* dm, uint64_t* value) {
+	*value = 0;
+	if (dm->cur >= dm->end || *dm->cur < '0' || *dm->cur > '9') {
+		return -1;
+	}
+	while (dm->cur < dm->end && *dm->cur >= '0' && *dm->cur <= '9') {
+		if (*value > 0xFFFFFFFF) {
+			return -1;
+		}
+		*value = *value * 10 + (*dm->cur++ - '0');
+	}
+	return 0;
+}
+
+// Concatenates count strings, NULL parts count as empty
+static const char* macho_demangle_cat(macho_demangle_state_t_64* dm, int count, ...) {
+	int i = 0;
+	va_list args;
+	char* out = NULL;
+	char* next = NULL;
+	uint64_t length = 0;
+	const char* part = NULL;
+
+	va_start(args, count);
+	for (i = 0; i < count; i++) {
+		part = va_arg(args, const char*);
+		if (part) {
+			length += strlen(part);
+		}
+	}
+	va_end(args);
+
+	out = (char*) macho_demangle_alloc(dm, length + 1);
+	if (out == NULL) {
+		return NULL;
+	}
+	next = out;
+	va_start(args, count);
+	for (i = 0; i < count; i++) {
+		part = va_arg(args, const char*);
+		if (part) {
+			length = strlen(part);
+			memcpy(next, part, length);
+			next += length;
+		}
+	}
+	va_end(args);
+	*next = '\0';
+	return out;
+}
+
+static int macho_demangle_grow(macho_demangle_state_t_64* dm, void** items, uint64_t* capacity,
+		uint64_t count, uint64_t size) {
+	void* grown = NULL;
+	if (count < *capacity) {
+		return 0;
+	}
+	grown = macho_demangle_alloc(dm, (*capacity ? *capacity * 2 : 16) * size);
+	if (grown == NULL) {
+		return -1;
+	}
+	if (count) {
+		memcpy(grown, *items, count * size);
+	}
+	*items = grown;
+	*capacity = *capacity ? *capacity * 2 : 16;
+	return 0;
+}
+
+/*
+ * Itanium C++ ABI
+ */
+static int macho_itanium_type(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type);
+static int macho_itanium_name(macho_demangle_state_t_64* dm, macho_itanium_name_t_64* name);
+static const char* macho_itanium_encoding(macho_demangle_state_t_64* dm);
+
+static int macho_itanium_push(macho_demangle_state_t_64* dm, macho_itanium_list_t_64* list,
+		const macho_itanium_type_t_64* type) {
+	if (macho_demangle_grow(dm, (void**) &list->items, &list->capacity, list->count,
+			sizeof(macho_itanium_type_t_64)) < 0) {
+		return -1;
+	}
+	list->items[list->count++] = *type;
+	return 0;
+}
+
+static int macho_itanium_push_text(macho_demangle_state_t_64* dm, const char* text) {
+	macho_itanium_type_t_64 type = { text, "", 0, 0, 0, 0, 0, NULL };
+	return macho_itanium_push(dm, &dm->subs, &type);
+}
+
+static const char* macho_itanium_string(macho_demangle_state_t_64* dm, const macho_itanium_type_t_64* type) {
+	if (type->right[0] == '\0') {
+		return type->left;
+	}
+	return macho_demangle_cat(dm, 2, type->left, type->right);
+}
+
+// Applies a pointer, reference or member pointer to type
+static int macho_itanium_declarator(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type,
+		const char* op) {
+	uint64_t length = strlen(type->left);
+	int ref = strcmp(op, "&") == 0 ? 1 : strcmp(op, "&&") == 0 ? 2 : 0;
+
+	type->pack = 0;
+	if (ref && type->ref) {
+		// A reference to a reference is an lvalue one unless both are rvalues
+		if (ref == 1 && type->ref == 2) {
+			type->left = macho_demangle_strndup(dm, type->left, length - 1);
+			type->ref = 1;
+		}
+		return type->left ? 0 : -1;
+	}
+	type->ref = ref;
+	if (type->paren) {
+		type->left = macho_demangle_cat(dm, 4, type->left,
+				(length && type->left[length - 1] == ' ') ? "" : " ", "(", op);
+		type->right = macho_demangle_cat(dm, 2, ")", type->right);
+		type->paren = 0;
+	} else {
+		type->left = macho_demangle_cat(dm, 3, type->left, (op[0] == '*' || op[0] == '&') ? "" : " ", op);
+	}
+	return (type->left && type->right) ? 0 : -1;
+}
+
+static const char* macho_itanium_source_name(macho_demangle_state_t_64* dm) {
+	uint64_t length = 0;
+	const char* name = NULL;
+	if (macho_demangle_number(dm, &length) < 0 || length == 0 || length > (uint64_t) (dm->end - dm->cur)) {
+		return NULL;
+	}
+	if (length >= 10 && strncmp(dm->cur, "_GLOBAL__N", 10) == 0) {
+		name = "(anonymous namespace)";
+	} else {
+		name = macho_demangle_strndup(dm, dm->cur, length);
+	}
+	dm->cur += length;
+	return name;
+}
+
+// Discriminator numbers: "_" is #1, "<n>_" is #n+2
+static int macho_itanium_seq(macho_demangle_state_t_64* dm, uint64_t* value) {
+	if (macho_demangle_consume(dm, "_")) {
+		*value = 1;
+		return 0;
+	}
+	if (macho_demangle_number(dm, value) < 0 || !macho_demangle_consume(dm, "_")) {
+		return -1;
+	}
+	*value += 2;
+	return 0;
+}
+
+static void macho_itanium_discriminator(macho_demangle_state_t_64* dm) {
+	uint64_t value = 0;
+	if (macho_demangle_consume(dm, "__")) {
+		if (macho_demangle_number(dm, &value) == 0) {
+			macho_demangle_consume(dm, "_");
+		}
+	} else if (macho_demangle_peek(dm, 0) == '_' && macho_demangle_peek(dm, 1) >= '0'
+			&& macho_demangle_peek(dm, 1) <= '9') {
+		dm->cur += 2;
+	}
+}
+
+// Comma separated list, empty parts are what an empty pack expands to
+static const char* macho_itanium_append(macho_demangle_state_t_64* dm, const char* text, const char* part) {
+	if (text == NULL || part == NULL) {
+		return NULL;
+	}
+	if (part[0] == '\0') {
+		return text;
+	}
+	return macho_demangle_cat(dm, 3, text, text[0] ? ", " : "", part);
+}
+
+static int macho_itanium_params_end(macho_demangle_state_t_64* dm) {
+	char c = macho_demangle_peek(dm, 0);
+	char n = macho_demangle_peek(dm, 1);
+	return c == '\0' || c == 'E' || c == '.' || ((c == 'R' || c == 'O') && n == 'E');
+}
+
+// Parameter types up to the end of the list, "v" alone means no parameters
+static const char* macho_itanium_params(macho_demangle_state_t_64* dm) {
+	const char* text = "";
+	macho_itanium_type_t_64 type;
+
+	if (macho_demangle_peek(dm, 0) == 'v') {
+		dm->cur++;
+		if (macho_itanium_params_end(dm)) {
+			return text;
+		}
+		dm->cur--;
+	}
+	while (!macho_itanium_params_end(dm)) {
+		if (macho_itanium_type(dm, &type) < 0) {
+			return NULL;
+		}
+		text = macho_itanium_append(dm, text, macho_itanium_string(dm, &type));
+		if (text == NULL) {
+			return NULL;
+		}
+	}
+	return text;
+}
+
+static const char* macho_itanium_literal(macho_demangle_state_t_64* dm) {
+	int negative = 0;
+	const char* type = NULL;
+	const char* value = NULL;
+	const char* start = NULL;
+	macho_itanium_type_t_64 literal;
+
+	dm->cur++;
+	if (macho_demangle_consume(dm, "_Z") || macho_demangle_consume(dm, "Z")) {
+		value = macho_itanium_encoding(dm);
+		return macho_demangle_consume(dm, "E") ? value : NULL;
+	}
+	if (macho_itanium_type(dm, &literal) < 0) {
+		return NULL;
+	}
+	type = macho_itanium_string(dm, &literal);
+	negative = macho_demangle_consume(dm, "n");
+	start = dm->cur;
+	while (dm->cur < dm->end && *dm->cur != 'E') {
+		dm->cur++;
+	}
+	if (!macho_demangle_consume(dm, "E") || type == NULL) {
+		return NULL;
+	}
+	value = macho_demangle_strndup(dm, start, dm->cur - 1 - start);
+	if (value == NULL) {
+		return NULL;
+	}
+	if (strcmp(type, "bool") == 0) {
+		return strcmp(value, "0") == 0 ? "false" : "true";
+	}
+	value = macho_demangle_cat(dm, 2, negative ? "-" : "", value);
+	if (strcmp(type, "int") == 0) return value;
+	if (strcmp(type, "unsigned int") == 0) return macho_demangle_cat(dm, 2, value, "u");
+	if (strcmp(type, "long") == 0) return macho_demangle_cat(dm, 2, value, "l");
+	if (strcmp(type, "unsigned long") == 0) return macho_demangle_cat(dm, 2, value, "ul");
+	if (strcmp(type, "long long") == 0) return macho_demangle_cat(dm, 2, value, "ll");
+	if (strcmp(type, "unsigned long long") == 0) return macho_demangle_cat(dm, 2, value, "ull");
+	return macho_demangle_cat(dm, 4, "(", type, ")", value);
+}
+
+static int macho_itanium_template_arg(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	uint64_t capacity = 0;
+	const char* text = "";
+	macho_itanium_type_t_64 elem;
+
+	memset(type, '\0', sizeof(macho_itanium_type_t_64));
+	type->right = "";
+	switch (macho_demangle_peek(dm, 0)) {
+	case 'L':
+		type->left = macho_itanium_literal(dm);
+		return type->left ? 0 : -1;
+	case 'J':
+		dm->cur++;
+		while (!macho_demangle_consume(dm, "E")) {
+			if (macho_itanium_template_arg(dm, &elem) < 0 || macho_demangle_grow(dm, (void**) &type->elems,
+					&capacity, type->count, sizeof(macho_itanium_type_t_64)) < 0) {
+				return -1;
+			}
+			type->elems[type->count++] = elem;
+			text = macho_itanium_append(dm, text, macho_itanium_string(dm, &elem));
+			if (text == NULL) {
+				return -1;
+			}
+		}
+		type->left = text;
+		type->pack = 1;
+		return 0;
+	case 'X':
+		// Expressions are not supported
+		return -1;
+	default:
+		return macho_itanium_type(dm, type);
+	}
+}
+
+static const char* macho_itanium_template_args(macho_demangle_state_t_64* dm) {
+	int tag = dm->tag;
+	uint64_t length = 0;
+	const char* text = "";
+	macho_itanium_type_t_64 arg;
+
+	dm->cur++;
+	dm->tag = 0;
+	if (tag) {
+		dm->params.count = 0;
+	}
+	while (!macho_demangle_consume(dm, "E")) {
+		if (dm->cur >= dm->end) {
+			return NULL;
+		}
+		if (macho_itanium_template_arg(dm, &arg) < 0) {
+			return NULL;
+		}
+		if (tag && macho_itanium_push(dm, &dm->params, &arg) < 0) {
+			return NULL;
+		}
+		text = macho_itanium_append(dm, text, macho_itanium_string(dm, &arg));
+		if (text == NULL) {
+			return NULL;
+		}
+	}
+	dm->tag = tag;
+	length = strlen(text);
+	return macho_demangle_cat(dm, 3, "<", text, (length && text[length - 1] == '>') ? " >" : ">");
+}
+
+// "operator<" followed by "<int>" needs a space to stay readable
+static const char* macho_itanium_with_args(macho_demangle_state_t_64* dm, const char* text, const char* args) {
+	uint64_t length = text ? strlen(text) : 0;
+	if (text == NULL || args == NULL) {
+		return NULL;
+	}
+	return macho_demangle_cat(dm, 3, text, (length && text[length - 1] == '<') ? " " : "", args);
+}
+
+static int macho_itanium_substitution(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	int i = 0;
+	char c = 0;
+	uint64_t index = 0;
+
+	dm->cur++;
+	c = macho_demangle_peek(dm, 0);
+	for (i = 0; macho_itanium_abbrevs[i][0]; i++) {
+		if (c == macho_itanium_abbrevs[i][0][0]) {
+			dm->cur++;
+			type->left = macho_itanium_abbrevs[i][1];
+			type->right = "";
+			type->paren = 0;
+			type->pack = 0;
+			return 0;
+		}
+	}
+	if (!macho_demangle_consume(dm, "_")) {
+		while (dm->cur < dm->end && *dm->cur != '_') {
+			c = *dm->cur++;
+			if (c >= '0' && c <= '9') {
+				index = index * 36 + (c - '0');
+			} else if (c >= 'A' && c <= 'Z') {
+				index = index * 36 + (c - 'A' + 10);
+			} else {
+				return -1;
+			}
+			if (index > 0xFFFFFFFF) {
+				return -1;
+			}
+		}
+		if (!macho_demangle_consume(dm, "_")) {
+			return -1;
+		}
+		index++;
+	}
+	if (index >= dm->subs.count) {
+		return -1;
+	}
+	*type = dm->subs.items[index];
+	// A parameter names whichever template is in scope when it is reused
+	if (type->param && type->param <= dm->params.count) {
+		index = type->param - 1;
+		*type = dm->params.items[index];
+		if (type->pack && dm->pack_index >= 0 && (uint64_t) dm->pack_index < type->count) {
+			*type = type->elems[dm->pack_index];
+		}
+	}
+	type->param = 0;
+	return 0;
+}
+
+static int macho_itanium_template_param(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	uint64_t index = 0;
+	dm->cur++;
+	if (!macho_demangle_consume(dm, "_")) {
+		if (macho_demangle_number(dm, &index) < 0 || !macho_demangle_consume(dm, "_")) {
+			return -1;
+		}
+		index++;
+	}
+	// Forward references, as in templated conversion operators, are not supported
+	if (index >= dm->params.count) {
+		return -1;
+	}
+	*type = dm->params.items[index];
+	type->param = index + 1;
+	if (type->pack) {
+		if (dm->pack_index >= 0 && (uint64_t) dm->pack_index < type->count) {
+			*type = type->elems[dm->pack_index];
+		} else if (dm->pack_count < 0) {
+			dm->pack_count = type->count;
+		}
+	}
+	return 0;
+}
+
+// Unqualified name of scope without its template arguments, for constructors
+static const char* macho_itanium_base_name(macho_demangle_state_t_64* dm, const char* scope) {
+	int depth = 0;
+	const char* end = NULL;
+	const char* start = NULL;
+
+	if (scope == NULL) {
+		return NULL;
+	}
+	end = scope + strlen(scope);
+	while (end > scope && end[-1] == ']') {
+		// ABI tags belong to the class, not to its constructors
+		while (end > scope && *--end != '[');
+	}
+	if (end > scope && end[-1] == '>') {
+		while (end > scope) {
+			end--;
+			if (*end == '>') depth++;
+			if (*end == '<' && --depth == 0) break;
+		}
+	}
+	for (start = end; start > scope; start--) {
+		if (start[-1] == '>') depth++;
+		if (start[-1] == '<') depth--;
+		if (depth == 0 && start - scope >= 2 && start[-1] == ':' && start[-2] == ':') break;
+	}
+	return macho_demangle_strndup(dm, start, end - start);
+}
+
+static const char* macho_itanium_operator(macho_demangle_state_t_64* dm, int* special) {
+	int i = 0;
+	const char* name = NULL;
+	macho_itanium_type_t_64 type;
+
+	if (macho_demangle_consume(dm, "cv")) {
+		if (macho_itanium_type(dm, &type) < 0) {
+			return NULL;
+		}
+		*special = 1;
+		return macho_demangle_cat(dm, 2, "operator ", macho_itanium_string(dm, &type));
+	}
+	if (macho_demangle_consume(dm, "li")) {
+		name = macho_itanium_source_name(dm);
+		return name ? macho_demangle_cat(dm, 2, "operator\"\" ", name) : NULL;
+	}
+	for (i = 0; macho_itanium_operators[i][0]; i++) {
+		if (macho_demangle_consume(dm, macho_itanium_operators[i][0])) {
+			name = macho_itanium_operators[i][1];
+			return macho_demangle_cat(dm, 3, "operator",
+					(name[0] >= 'a' && name[0] <= 'z') ? " " : "", name);
+		}
+	}
+	return NULL;
+}
+
+static const char* macho_itanium_unqualified(macho_demangle_state_t_64* dm, const char* scope, int* special) {
+	char c = 0;
+	char seq[24];
+	uint64_t value = 0;
+	const char* tag = NULL;
+	const char* text = NULL;
+	macho_itanium_type_t_64 type;
+
+	*special = 0;
+	macho_demangle_consume(dm, "L");
+	c = macho_demangle_peek(dm, 0);
+	if (c >= '0' && c <= '9') {
+		text = macho_itanium_source_name(dm);
+	} else if (c == 'C') {
+		dm->cur++;
+		if (macho_demangle_consume(dm, "I")) {
+			// Inheriting constructor, the base class type follows
+			if (macho_demangle_peek(dm, 0) < '1' || macho_demangle_peek(dm, 0) > '5') {
+				return NULL;
+			}
+			dm->cur++;
+			if (macho_itanium_type(dm, &type) < 0) {
+				return NULL;
+			}
+		} else {
+			if (macho_demangle_peek(dm, 0) < '1' || macho_demangle_peek(dm, 0) > '5') {
+				return NULL;
+			}
+			dm->cur++;
+		}
+		text = macho_itanium_base_name(dm, scope);
+		*special = 1;
+	} else if (c == 'D' && macho_demangle_peek(dm, 1) >= '0' && macho_demangle_peek(dm, 1) <= '5') {
+		dm->cur += 2;
+		text = macho_itanium_base_name(dm, scope);
+		text = text ? macho_demangle_cat(dm, 2, "~", text) : NULL;
+		*special = 1;
+	} else if (macho_demangle_consume(dm, "Ut")) {
+		if (macho_itanium_seq(dm, &value) < 0) {
+			return NULL;
+		}
+		snprintf(seq, sizeof(seq), "%llu", (unsigned long long) value);
+		text = macho_demangle_cat(dm, 3, "{unnamed type#", seq, "}");
+	} else if (macho_demangle_consume(dm, "Ul")) {
+		text = macho_itanium_params(dm);
+		if (text == NULL || !macho_demangle_consume(dm, "E") || macho_itanium_seq(dm, &value) < 0) {
+			return NULL;
+		}
+		snprintf(seq, sizeof(seq), "%llu", (unsigned long long) value);
+		text = macho_demangle_cat(dm, 5, "{lambda(", text, ")#", seq, "}");
+	} else if (c >= 'a' && c <= 'z') {
+		text = macho_itanium_operator(dm, special);
+	}
+
+	while (text && macho_demangle_consume(dm, "B")) {
+		tag = macho_itanium_source_name(dm);
+		text = tag ? macho_demangle_cat(dm, 4, text, "[abi:", tag, "]") : NULL;
+	}
+	return text;
+}
+
+static int macho_itanium_nested(macho_demangle_state_t_64* dm, macho_itanium_name_t_64* name) {
+	char c = 0;
+	int special = 0;
+	const char* cv = "";
+	const char* ref = "";
+	const char* text = NULL;
+	const char* component = NULL;
+	macho_itanium_type_t_64 type;
+
+	dm->cur++;
+	if (macho_demangle_consume(dm, "r")) cv = " restrict";
+	if (macho_demangle_consume(dm, "V")) cv = macho_demangle_cat(dm, 2, " volatile", cv);
+	if (macho_demangle_consume(dm, "K")) cv = macho_demangle_cat(dm, 2, " const", cv);
+	if (macho_demangle_consume(dm, "R")) ref = " &";
+	else if (macho_demangle_consume(dm, "O")) ref = " &&";
+
+	// Every prefix is a substitution candidate; the full name is popped
+	//   again at the end since only a type context may reuse it.
+	while (!macho_demangle_consume(dm, "E")) {
+		if (dm->cur >= dm->end) {
+			return -1;
+		}
+		macho_demangle_consume(dm, "L");
+		if (macho_demangle_consume(dm, "M")) {
+			continue;
+		}
+		c = macho_demangle_peek(dm, 0);
+		if (c == 'T') {
+			if (text || macho_itanium_template_param(dm, &type) < 0) {
+				return -1;
+			}
+			text = macho_itanium_string(dm, &type);
+			name->template = 0;
+			special = 0;
+		} else if (c == 'I') {
+			if (text == NULL || (component = macho_itanium_template_args(dm)) == NULL) {
+				return -1;
+			}
+			text = macho_itanium_with_args(dm, text, component);
+			name->template = 1;
+		} else if (c == 'D' && (macho_demangle_peek(dm, 1) == 't' || macho_demangle_peek(dm, 1) == 'T')) {
+			return -1;
+		} else if (c == 'S' && macho_demangle_peek(dm, 1) == 't') {
+			dm->cur += 2;
+			if (text || (component = macho_itanium_unqualified(dm, NULL, &special)) == NULL) {
+				return -1;
+			}
+			text = macho_demangle_cat(dm, 2, "std::", component);
+			name->template = 0;
+		} else if (c == 'S') {
+			if (text || macho_itanium_substitution(dm, &type) < 0) {
+				return -1;
+			}
+			text = macho_itanium_string(dm, &type);
+			continue;
+		} else {
+			component = macho_itanium_unqualified(dm, text, &special);
+			if (component == NULL) {
+				return -1;
+			}
+			text = text ? macho_demangle_cat(dm, 3, text, "::", component) : component;
+			name->template = 0;
+		}
+		if (text == NULL || macho_itanium_push_text(dm, text) < 0) {
+			return -1;
+		}
+	}
+	if (text == NULL || dm->subs.count == 0) {
+		return -1;
+	}
+	dm->subs.count--;
+
+	name->text = text;
+	name->quals = macho_demangle_cat(dm, 2, cv, ref);
+	name->special = special;
+	return name->quals ? 0 : -1;
+}
+
+static int macho_itanium_local(macho_demangle_state_t_64* dm, macho_itanium_name_t_64* name) {
+	const char* encoding = NULL;
+	macho_itanium_list_t_64 params = dm->params;
+	macho_itanium_name_t_64 entity;
+
+	// The enclosing function has template arguments of its own
+	dm->cur++;
+	memset(&dm->params, '\0', sizeof(macho_itanium_list_t_64));
+	dm->local = 1;
+	encoding = macho_itanium_encoding(dm);
+	dm->params = params;
+	if (encoding == NULL || !macho_demangle_consume(dm, "E")) {
+		return -1;
+	}
+	if (macho_demangle_consume(dm, "s")) {
+		name->text = macho_demangle_cat(dm, 2, encoding, "::string literal");
+		macho_itanium_discriminator(dm);
+		return name->text ? 0 : -1;
+	}
+	if (macho_itanium_name(dm, &entity) < 0) {
+		return -1;
+	}
+	macho_itanium_discriminator(dm);
+	*name = entity;
+	name->text = macho_demangle_cat(dm, 3, encoding, "::", entity.text);
+	return name->text ? 0 : -1;
+}
+
+static int macho_itanium_name(macho_demangle_state_t_64* dm, macho_itanium_name_t_64* name) {
+	int result = -1;
+	int special = 0;
+	const char* args = NULL;
+	const char* text = NULL;
+	macho_itanium_type_t_64 type;
+
+	memset(name, '\0', sizeof(macho_itanium_name_t_64));
+	name->quals = "";
+	if (++dm->depth > MACHO_DEMANGLE_MAX_DEPTH) {
+		return -1;
+	}
+
+	switch (macho_demangle_peek(dm, 0)) {
+	case 'N':
+		result = macho_itanium_nested(dm, name);
+		break;
+	case 'Z':
+		result = macho_itanium_local(dm, name);
+		break;
+	case 'S':
+		if (macho_demangle_peek(dm, 1) != 't') {
+			// Only a template name can be an unscoped substitution
+			if (macho_itanium_substitution(dm, &type) < 0 || macho_demangle_peek(dm, 0) != 'I') {
+				break;
+			}
+			text = macho_itanium_string(dm, &type);
+			args = macho_itanium_template_args(dm);
+			name->text = macho_itanium_with_args(dm, text, args);
+			name->template = 1;
+			result = name->text ? 0 : -1;
+			break;
+		}
+		// fall through
+	default:
+		if (macho_demangle_consume(dm, "St")) {
+			text = macho_itanium_unqualified(dm, NULL, &special);
+			text = text ? macho_demangle_cat(dm, 2, "std::", text) : NULL;
+		} else {
+			text = macho_itanium_unqualified(dm, NULL, &special);
+		}
+		if (text == NULL) {
+			break;
+		}
+		name->text = text;
+		name->special = special;
+		if (macho_demangle_peek(dm, 0) == 'I') {
+			if (macho_itanium_push_text(dm, text) < 0 || (args = macho_itanium_template_args(dm)) == NULL) {
+				break;
+			}
+			name->text = macho_itanium_with_args(dm, text, args);
+			name->template = 1;
+		}
+		result = name->text ? 0 : -1;
+		break;
+	}
+	dm->depth--;
+	return result;
+}
+
+static int macho_itanium_function_type(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	const char* ref = "";
+	const char* params = NULL;
+	macho_itanium_type_t_64 result;
+
+	dm->cur++;
+	macho_demangle_consume(dm, "Y");
+	if (macho_itanium_type(dm, &result) < 0 || (params = macho_itanium_params(dm)) == NULL) {
+		return -1;
+	}
+	if (macho_demangle_consume(dm, "R")) ref = " &";
+	else if (macho_demangle_consume(dm, "O")) ref = " &&";
+	if (!macho_demangle_consume(dm, "E")) {
+		return -1;
+	}
+	type->left = macho_demangle_cat(dm, 2, macho_itanium_string(dm, &result), " ");
+	type->right = macho_demangle_cat(dm, 4, "(", params, ")", ref);
+	type->paren = 1;
+	return (type->left && type->right) ? 0 : -1;
+}
+
+static int macho_itanium_array_type(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	const char* start = NULL;
+	const char* size = NULL;
+	macho_itanium_type_t_64 element;
+
+	dm->cur++;
+	start = dm->cur;
+	while (dm->cur < dm->end && *dm->cur >= '0' && *dm->cur <= '9') {
+		dm->cur++;
+	}
+	size = macho_demangle_strndup(dm, start, dm->cur - start);
+	if (size == NULL || !macho_demangle_consume(dm, "_") || macho_itanium_type(dm, &element) < 0) {
+		return -1;
+	}
+	type->left = element.left;
+	type->right = macho_demangle_cat(dm, 4, " [", size, "]",
+			element.paren == 2 ? element.right + 1 : element.right);
+	type->paren = 2;
+	return type->right ? 0 : -1;
+}
+
+static int macho_itanium_builtin(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	char c = macho_demangle_peek(dm, 0);
+	const char* text = NULL;
+
+	if (c >= 'a' && c <= 'z' && c != 'r' && macho_itanium_builtins[c - 'a']) {
+		text = macho_itanium_builtins[c - 'a'];
+		dm->cur++;
+	} else if (c == 'D') {
+		switch (macho_demangle_peek(dm, 1)) {
+		case 'n': text = "decltype(nullptr)"; break;
+		case 'i': text = "char32_t"; break;
+		case 's': text = "char16_t"; break;
+		case 'u': text = "char8_t"; break;
+		case 'a': text = "auto"; break;
+		case 'c': text = "decltype(auto)"; break;
+		case 'd': text = "decimal64"; break;
+		case 'e': text = "decimal128"; break;
+		case 'f': text = "decimal32"; break;
+		case 'h': text = "half"; break;
+		default: return -1;
+		}
+		dm->cur += 2;
+	} else {
+		return -1;
+	}
+	type->left = text;
+	type->right = "";
+	type->paren = 0;
+	return 0;
+}
+
+static int macho_itanium_ends_with(const char* text, const char* suffix) {
+	uint64_t length = strlen(text);
+	uint64_t size = strlen(suffix);
+	return size && length >= size && strcmp(&text[length - size], suffix) == 0;
+}
+
+/*
+ * Pack expansion: the pattern is parsed once to find the pack it names,
+ *   then again for each element, last first so the substitutions left
+ *   behind are the ones of the first element.
+ */
+static int macho_itanium_expansion(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	int result = -1;
+	uint64_t i = 0;
+	uint64_t count = 0;
+	uint64_t subs = dm->subs.count;
+	const char* start = dm->cur;
+	const char* text = "";
+	int64_t pack_index = dm->pack_index;
+	int64_t pack_count = dm->pack_count;
+	macho_itanium_type_t_64* elems = NULL;
+
+	dm->pack_index = -1;
+	dm->pack_count = -1;
+	if (macho_itanium_type(dm, type) < 0) {
+		goto done;
+	}
+	if (dm->pack_count < 0) {
+		type->left = macho_demangle_cat(dm, 2, macho_itanium_string(dm, type), "...");
+		type->right = "";
+		type->paren = 0;
+		type->ref = 0;
+		result = type->left ? 0 : -1;
+		goto done;
+	}
+	count = dm->pack_count;
+	if (count) {
+		elems = (macho_itanium_type_t_64*) macho_demangle_alloc(dm, count * sizeof(macho_itanium_type_t_64));
+		if (elems == NULL) {
+			goto done;
+		}
+	}
+	for (i = count; i > 0; i--) {
+		dm->cur = start;
+		dm->subs.count = subs;
+		dm->pack_index = i - 1;
+		if (macho_itanium_type(dm, &elems[i - 1]) < 0) {
+			goto done;
+		}
+	}
+	for (i = 0; i < count && text; i++) {
+		text = macho_itanium_append(dm, text, macho_itanium_string(dm, &elems[i]));
+	}
+	memset(type, '\0', sizeof(macho_itanium_type_t_64));
+	type->left = text;
+	type->right = "";
+	type->pack = 1;
+	type->count = count;
+	type->elems = elems;
+	result = text ? 0 : -1;
+
+done:
+	dm->pack_index = pack_index;
+	dm->pack_count = pack_count;
+	return result;
+}
+
+static int macho_itanium_type(macho_demangle_state_t_64* dm, macho_itanium_type_t_64* type) {
+	int result = -1;
+	char c = macho_demangle_peek(dm, 0);
+	const char* cv = "";
+	const char* args = NULL;
+	macho_itanium_name_t_64 name;
+
+	if (++dm->depth > MACHO_DEMANGLE_MAX_DEPTH) {
+		return -1;
+	}
+	memset(type, '\0', sizeof(macho_itanium_type_t_64));
+	type->right = "";
+
+	switch (c) {
+	case 'r':
+	case 'V':
+	case 'K':
+		if (macho_demangle_consume(dm, "r")) cv = " restrict";
+		if (macho_demangle_consume(dm, "V")) cv = macho_demangle_cat(dm, 2, " volatile", cv);
+		if (macho_demangle_consume(dm, "K")) cv = macho_demangle_cat(dm, 2, " const", cv);
+		c = macho_demangle_peek(dm, 0);
+		if (macho_itanium_type(dm, type) < 0) {
+			break;
+		}
+		if (type->paren == 1) {
+			// A qualified function type is a single substitution candidate
+			if (c == 'F') {
+				dm->subs.count--;
+			}
+			type->right = macho_demangle_cat(dm, 2, type->right, cv);
+		} else if (!macho_itanium_ends_with(type->left, cv)) {
+			// Qualifying a template parameter that already carries them
+			type->left = macho_demangle_cat(dm, 2, type->left, cv);
+		}
+		type->pack = 0;
+		result = macho_itanium_push(dm, &dm->subs, type);
+		break;
+	case 'P':
+	case 'R':
+	case 'O':
+		dm->cur++;
+		if (macho_itanium_type(dm, type) < 0
+				|| macho_itanium_declarator(dm, type, c == 'P' ? "*" : c == 'R' ? "&" : "&&") < 0) {
+			break;
+		}
+		result = macho_itanium_push(dm, &dm->subs, type);
+		break;
+	case 'F':
+		if (macho_itanium_function_type(dm, type) == 0) {
+			result = macho_itanium_push(dm, &dm->subs, type);
+		}
+		break;
+	case 'A':
+		if (macho_itanium_array_type(dm, type) == 0) {
+			result = macho_itanium_push(dm, &dm->subs, type);
+		}
+		break;
+	case 'M':
+		dm->cur++;
+		if (macho_itanium_type(dm, type) < 0) {
+			break;
+		}
+		args = macho_itanium_string(dm, type);
+		if (macho_itanium_type(dm, type) < 0 || args == NULL
+				|| macho_itanium_declarator(dm, type, macho_demangle_cat(dm, 2, args, "::*")) < 0) {
+			break;
+		}
+		result = macho_itanium_push(dm, &dm->subs, type);
+		break;
+	case 'T':
+		if (macho_itanium_template_param(dm, type) < 0 || macho_itanium_push(dm, &dm->subs, type) < 0) {
+			break;
+		}
+		type->param = 0;
+		result = 0;
+		if (macho_demangle_peek(dm, 0) == 'I') {
+			args = macho_itanium_template_args(dm);
+			type->left = macho_itanium_with_args(dm, macho_itanium_string(dm, type), args);
+			type->right = "";
+			type->paren = 0;
+			result = type->left ? macho_itanium_push(dm, &dm->subs, type) : -1;
+		}
+		break;
+	case 'D':
+		if (macho_demangle_peek(dm, 1) == 'p') {
+			dm->cur += 2;
+			if (macho_itanium_expansion(dm, type) == 0) {
+				result = macho_itanium_push(dm, &dm->subs, type);
+			}
+			break;
+		}
+		// Decltype and vector types are not supported
+		result = macho_itanium_builtin(dm, type);
+		break;
+	case 'u':
+		dm->cur++;
+		type->left = macho_itanium_source_name(dm);
+		result = type->left ? macho_itanium_push(dm, &dm->subs, type) : -1;
+		break;
+	case 'S':
+		if (macho_demangle_peek(dm, 1) != 't') {
+			if (macho_itanium_substitution(dm, type) < 0) {
+				break;
+			}
+			result = 0;
+			if (macho_demangle_peek(dm, 0) == 'I') {
+				args = macho_itanium_template_args(dm);
+				type->left = macho_itanium_with_args(dm, macho_itanium_string(dm, type), args);
+				type->right = "";
+				type->paren = 0;
+				result = type->left ? macho_itanium_push(dm, &dm->subs, type) : -1;
+			}
+			break;
+		}
+		// fall through
+	case 'N':
+	case 'Z':
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		if (macho_itanium_name(dm, &name) < 0) {
+			break;
+		}
+		type->left = name.text;
+		result = macho_itanium_push(dm, &dm->subs, type);
+		break;
+	default:
+		result = macho_itanium_builtin(dm, type);
+		break;
+	}
+
+	dm->depth--;
+	if (result == 0 && (type->left == NULL || type->right == NULL)) {
+		return -1;
+	}
+	return result;
+}
+
+static int macho_itanium_call_offset(macho_demangle_state_t_64* dm) {
+	uint64_t value = 0;
+	if (macho_demangle_consume(dm, "h")) {
+		macho_demangle_consume(dm, "n");
+		return (macho_demangle_number(dm, &value) == 0 && macho_demangle_consume(dm, "_")) ? 0 : -1;
+	}
+	if (macho_demangle_consume(dm, "v")) {
+		macho_demangle_consume(dm, "n");
+		if (macho_demangle_number(dm, &value) < 0 || !macho_demangle_consume(dm, "_")) {
+			return -1;
+		}
+		macho_demangle_consume(dm, "n");
+		return (macho_demangle_number(dm, &value) == 0 && macho_demangle_consume(dm, "_")) ? 0 : -1;
+	}
+	return -1;
+}
+
+static const char* macho_itanium_special(macho_demangle_state_t_64* dm) {
+	const char* prefix = NULL;
+	const char* text = NULL;
+	macho_itanium_name_t_64 name;
+	macho_itanium_type_t_64 type;
+
+	if (macho_demangle_consume(dm, "TV")) prefix = "vtable for ";
+	else if (macho_demangle_consume(dm, "TT")) prefix = "VTT for ";
+	else if (macho_demangle_consume(dm, "TI")) prefix = "typeinfo for ";
+	else if (macho_demangle_consume(dm, "TS")) prefix = "typeinfo name for ";
+	if (prefix) {
+		if (macho_itanium_type(dm, &type) < 0) {
+			return NULL;
+		}
+		return macho_demangle_cat(dm, 2, prefix, macho_itanium_string(dm, &type));
+	}
+
+	if (macho_demangle_peek(dm, 0) == 'T' && macho_demangle_peek(dm, 1) == 'c') {
+		dm->cur += 2;
+		if (macho_itanium_call_offset(dm) < 0 || macho_itanium_call_offset(dm) < 0) {
+			return NULL;
+		}
+		prefix = "covariant return thunk to ";
+	} else if (macho_demangle_peek(dm, 0) == 'T' && (macho_demangle_peek(dm, 1) == 'h'
+			|| macho_demangle_peek(dm, 1) == 'v')) {
+		dm->cur++;
+		prefix = *dm->cur == 'h' ? "non-virtual thunk to " : "virtual thunk to ";
+		if (macho_itanium_call_offset(dm) < 0) {
+			return NULL;
+		}
+	}
+	if (prefix) {
+		text = macho_itanium_encoding(dm);
+		return text ? macho_demangle_cat(dm, 2, prefix, text) : NULL;
+	}
+
+	if (macho_demangle_consume(dm, "TW")) prefix = "TLS wrapper function for ";
+	else if (macho_demangle_consume(dm, "TH")) prefix = "TLS init function for ";
+	else if (macho_demangle_consume(dm, "GV")) prefix = "guard variable for ";
+	if (prefix == NULL && macho_demangle_consume(dm, "GTt")) {
+		text = macho_itanium_encoding(dm);
+		return text ? macho_demangle_cat(dm, 2, "transaction clone for ", text) : NULL;
+	}
+	if (prefix == NULL || macho_itanium_name(dm, &name) < 0) {
+		return NULL;
+	}
+	return macho_demangle_cat(dm, 2, prefix, name.text);
+}
+
+static const char* macho_itanium_encoding(macho_demangle_state_t_64* dm) {
+	int tag = dm->tag;
+	int local = dm->local;
+	char c = macho_demangle_peek(dm, 0);
+	const char* params = NULL;
+	const char* result = "";
+	const char* text = NULL;
+	macho_itanium_name_t_64 name;
+	macho_itanium_type_t_64 type;
+
+	dm->local = 0;
+	if (++dm->depth > MACHO_DEMANGLE_MAX_DEPTH) {
+		return NULL;
+	}
+	if (c == 'T' || c == 'G') {
+		text = macho_itanium_special(dm);
+		dm->depth--;
+		return text;
+	}
+
+	// Only the entity's own template arguments are what T_ refers to
+	dm->tag = 1;
+	if (macho_itanium_name(dm, &name) < 0) {
+		return NULL;
+	}
+	dm->tag = 0;
+	if (macho_itanium_params_end(dm)) {
+		text = name.text;
+	} else {
+		// Template functions other than constructors also encode their result
+		if (name.template && !name.special) {
+			if (macho_itanium_type(dm, &type) < 0) {
+				return NULL;
+			}
+			result = local ? "" : macho_demangle_cat(dm, 2, macho_itanium_string(dm, &type), " ");
+		}
+		params = macho_itanium_params(dm);
+		if (params == NULL || result == NULL) {
+			return NULL;
+		}
+		text = macho_demangle_cat(dm, 6, result, name.text, "(", params, ")", name.quals);
+	}
+	dm->tag = tag;
+	dm->depth--;
+	return text;
+}
+
+static const char* macho_itanium_demangle(macho_demangle_state_t_64* dm) {
+	const char* text = macho_itanium_encoding(dm);
+	const char* clone = NULL;
+
+	if (text && dm->cur < dm->end && *dm->cur == '.') {
+		clone = macho_demangle_strndup(dm, dm->cur, dm->end - dm->cur);
+		text = clone ? macho_demangle_cat(dm, 4, text, " [clone ", clone, "]") : NULL;
+		dm->cur = dm->end;
+	}
+	if (text == NULL || dm->cur != dm->end) {
+		return NULL;
+	}
+	return text;
+}
+
+/*
+ * Swift, a postfix mangling demangled with a node stack
+ */
+static int macho_swift_push(macho_demangle_state_t_64* dm, macho_swift_list_t_64* list,
+		const macho_swift_node_t_64* node) {
+	if (macho_demangle_grow(dm, (void**) &list->items, &list->capacity, list->count,
+			sizeof(macho_swift_node_t_64)) < 0) {
+		return -1;
+	}
+	list->items[list->count++] = *node;
+	return 0;
+}
+
+static int macho_swift_push_text(macho_demangle_state_t_64* dm, int kind, const char* text) {
+	macho_swift_node_t_64 node;
+	if (text == NULL) {
+		return -1;
+	}
+	memset(&node, '\0', sizeof(macho_swift_node_t_64));
+	node.kind = kind;
+	node.text = text;
+	return macho_swift_push(dm, &dm->stack, &node);
+}
+
+// Pops the top node if it is of kind, any kind if zero
+static int macho_swift_pop(macho_demangle_state_t_64* dm, int kind, macho_swift_node_t_64* node) {
+	if (dm->stack.count == 0) {
+		return -1;
+	}
+	if (kind && dm->stack.items[dm->stack.count - 1].kind != kind) {
+		return -1;
+	}
+	*node = dm->stack.items[--dm->stack.count];
+	return 0;
+}
+
+static const char* macho_swift_pop_type(macho_demangle_state_t_64* dm) {
+	macho_swift_node_t_64 node;
+	if (macho_swift_pop(dm, 0, &node) < 0) {
+		return NULL;
+	}
+	if (node.kind == MACHO_SWIFT_TYPE || node.kind == MACHO_SWIFT_FUNC) {
+		return node.text;
+	}
+	dm->stack.count++;
+	return NULL;
+}
+
+static const char* macho_swift_pop_context(macho_demangle_state_t_64* dm) {
+	macho_swift_node_t_64 node;
+	if (macho_swift_pop(dm, 0, &node) < 0) {
+		return NULL;
+	}
+	if (node.kind == MACHO_SWIFT_IDENT || node.kind == MACHO_SWIFT_MODULE
+			|| node.kind == MACHO_SWIFT_TYPE || node.kind == MACHO_SWIFT_ENTITY) {
+		return node.text;
+	}
+	dm->stack.count++;
+	return NULL;
+}
+
+static int macho_swift_is_word_end(char c, char previous) {
+	return c == '_' || c == '\0' || (!(previous >= 'A' && previous <= 'Z') && c >= 'A' && c <= 'Z');
+}
+
+// Words of every literal identifier part can be reused by later identifiers
+static void macho_swift_add_words(macho_demangle_state_t_64* dm, const char* text, uint64_t length) {
+	uint64_t i = 0;
+	int64_t start = -1;
+	char c = 0;
+
+	for (i = 0; i <= length; i++) {
+		c = i < length ? text[i] : '\0';
+		if (start >= 0 && macho_swift_is_word_end(c, text[i - 1])) {
+			if (i - start >= 2 && dm->word_count < MACHO_SWIFT_MAX_WORDS) {
+				dm->words[dm->word_count] = macho_demangle_strndup(dm, &text[start], i - start);
+				if (dm->words[dm->word_count]) {
+					dm->word_count++;
+				}
+			}
+			start = -1;
+		}
+		if (start < 0 && !(c >= '0' && c <= '9') && c != '_' && c != '\0') {
+			start = i;
+		}
+	}
+}
+
+static int macho_swift_identifier(macho_demangle_state_t_64* dm) {
+	int index = 0;
+	int words = 0;
+	char c = 0;
+	uint64_t length = 0;
+	const char* text = "";
+	const char* literal = NULL;
+	macho_swift_node_t_64 node;
+
+	if (macho_demangle_consume(dm, "0")) {
+		// Punycode identifiers are not supported
+		if (macho_demangle_peek(dm, 0) == '0') {
+			return -1;
+		}
+		words = 1;
+	}
+	do {
+		while (words && ((macho_demangle_peek(dm, 0) >= 'a' && macho_demangle_peek(dm, 0) <= 'z')
+				|| (macho_demangle_peek(dm, 0) >= 'A' && macho_demangle_peek(dm, 0) <= 'Z'))) {
+			c = *dm->cur++;
+			if (c >= 'a') {
+				index = c - 'a';
+			} else {
+				index = c - 'A';
+				words = -1;
+			}
+			if (index >= dm->word_count) {
+				return -1;
+			}
+			text = macho_demangle_cat(dm, 2, text, dm->words[index]);
+			if (words < 0) {
+				break;
+			}
+		}
+		if (words < 0 || (words && macho_demangle_consume(dm, "0"))) {
+			break;
+		}
+		if (macho_demangle_number(dm, &length) < 0 || length == 0
+				|| length > (uint64_t) (dm->end - dm->cur)) {
+			return -1;
+		}
+		literal = dm->cur;
+		macho_swift_add_words(dm, literal, length);
+		literal = macho_demangle_strndup(dm, literal, length);
+		text = literal ? macho_demangle_cat(dm, 2, text, literal) : NULL;
+		dm->cur += length;
+	} while (words > 0 && text);
+
+	if (text == NULL) {
+		return -1;
+	}
+	memset(&node, '\0', sizeof(macho_swift_node_t_64));
+	node.kind = MACHO_SWIFT_IDENT;
+	node.text = text;
+	if (macho_swift_push(dm, &dm->stack, &node) < 0) {
+		return -1;
+	}
+	return macho_swift_push(dm, &dm->swift_subs, &node);
+}
+
+static int macho_swift_substitution(macho_demangle_state_t_64* dm) {
+	char c = 0;
+	uint64_t i = 0;
+	uint64_t index = 0;
+	uint64_t repeat = 1;
+
+	while (dm->cur < dm->end) {
+		c = *dm->cur;
+		if (c >= '0' && c <= '9') {
+			if (macho_demangle_number(dm, &repeat) < 0) {
+				return -1;
+			}
+			continue;
+		}
+		dm->cur++;
+		if (c == '_') {
+			index = repeat + 27;
+			repeat = 1;
+		} else if (c >= 'a' && c <= 'z') {
+			index = c - 'a';
+		} else if (c >= 'A' && c <= 'Z') {
+			index = c - 'A';
+		} else {
+			return -1;
+		}
+		if (index >= dm->swift_subs.count || repeat > 0x1000) {
+			return -1;
+		}
+		for (i = 0; i < repeat; i++) {
+			if (macho_swift_push(dm, &dm->stack, &dm->swift_subs.items[index]) < 0) {
+				return -1;
+			}
+		}
+		if (c < 'a' || c > 'z') {
+			return 0;
+		}
+		repeat = 1;
+	}
+	return -1;
+}
+
+static int macho_swift_standard_type(macho_demangle_state_t_64* dm) {
+	int i = 0;
+	char c = 0;
+	uint64_t n = 0;
+	uint64_t repeat = 1;
+	const char* text = NULL;
+	macho_swift_node_t_64 node;
+
+	if (macho_demangle_peek(dm, 0) >= '0' && macho_demangle_peek(dm, 0) <= '9'
+			&& (macho_demangle_number(dm, &repeat) < 0 || repeat > 0x1000)) {
+		return -1;
+	}
+	if (dm->cur >= dm->end) {
+		return -1;
+	}
+	c = *dm->cur++;
+	if (c == 'g') {
+		// Optional sugar
+		text = macho_swift_pop_type(dm);
+		if (text == NULL) {
+			return -1;
+		}
+		memset(&node, '\0', sizeof(macho_swift_node_t_64));
+		node.kind = MACHO_SWIFT_TYPE;
+		node.text = macho_demangle_cat(dm, 2, text, "?");
+		if (node.text == NULL || macho_swift_push(dm, &dm->stack, &node) < 0) {
+			return -1;
+		}
+		return macho_swift_push(dm, &dm->swift_subs, &node);
+	}
+	for (i = 0; macho_swift_standard[i][0]; i++) {
+		if (c == macho_swift_standard[i][0][0]) {
+			text = macho_demangle_cat(dm, 2, "Swift.", macho_swift_standard[i][1]);
+			for (n = 0; n < repeat; n++) {
+				if (macho_swift_push_text(dm, MACHO_SWIFT_TYPE, text) < 0) {
+					return -1;
+				}
+			}
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static int macho_swift_nominal(macho_demangle_state_t_64* dm) {
+	const char* context = NULL;
+	macho_swift_node_t_64 name;
+
+	if (macho_swift_pop(dm, MACHO_SWIFT_IDENT, &name) < 0 || (context = macho_swift_pop_context(dm)) == NULL) {
+		return -1;
+	}
+	name.kind = MACHO_SWIFT_TYPE;
+	name.text = macho_demangle_cat(dm, 3, context, ".", name.text);
+	if (name.text == NULL || macho_swift_push(dm, &dm->stack, &name) < 0) {
+		return -1;
+	}
+	return macho_swift_push(dm, &dm->swift_subs, &name);
+}
+
+static const char* macho_swift_join(macho_demangle_state_t_64* dm, const char** elems, uint64_t count,
+		const char** labels) {
+	uint64_t i = 0;
+	const char* text = "(";
+	for (i = 0; i < count && text; i++) {
+		text = macho_demangle_cat(dm, 5, text, i ? ", " : "", (labels && labels[i]) ? labels[i] : "",
+				(labels && labels[i]) ? ": " : "", elems[i]);
+	}
+	return text ? macho_demangle_cat(dm, 2, text, ")") : NULL;
+}
+
+static int macho_swift_tuple(macho_demangle_state_t_64* dm) {
+	int first = 0;
+	uint64_t i = 0;
+	uint64_t count = 0;
+	uint64_t capacity = 0;
+	const char* type = NULL;
+	const char** elems = NULL;
+	macho_swift_node_t_64 node;
+	macho_swift_node_t_64 label;
+
+	memset(&node, '\0', sizeof(macho_swift_node_t_64));
+	node.kind = MACHO_SWIFT_TYPE;
+	if (macho_swift_pop(dm, MACHO_SWIFT_EMPTY, &label) == 0) {
+		node.text = "()";
+		return macho_swift_push(dm, &dm->stack, &node);
+	}
+
+	// Elements come off the stack last first, and the first one is the
+	//   one followed by the '_' marker.
+	do {
+		first = macho_swift_pop(dm, MACHO_SWIFT_MARKER, &label) == 0;
+		if (macho_swift_pop(dm, MACHO_SWIFT_IDENT, &label) < 0) {
+			label.text = NULL;
+		}
+		type = macho_swift_pop_type(dm);
+		if (type == NULL || macho_demangle_grow(dm, (void**) &elems, &capacity, count, sizeof(char*)) < 0) {
+			return -1;
+		}
+		elems[count++] = label.text ? macho_demangle_cat(dm, 3, label.text, ": ", type) : type;
+	} while (!first);
+
+	for (i = 0; i < count / 2; i++) {
+		type = elems[i];
+		elems[i] = elems[count - 1 - i];
+		elems[count - 1 - i] = type;
+	}
+	node.count = count;
+	node.elems = elems;
+	node.text = macho_swift_join(dm, elems, count, NULL);
+	return node.text ? macho_swift_push(dm, &dm->stack, &node) : -1;
+}
+
+static int macho_swift_bound_generic(macho_demangle_state_t_64* dm) {
+	uint64_t start = 0;
+	uint64_t i = 0;
+	const char* text = NULL;
+	const char* args = "";
+	macho_swift_node_t_64 node;
+
+	// Argument lists of nested generic contexts are flattened into one
+	for (start = dm->stack.count; start > 0; start--) {
+		node = dm->stack.items[start - 1];
+		if (node.kind == MACHO_SWIFT_EMPTY) {
+			break;
+		}
+		if (node.kind != MACHO_SWIFT_TYPE && node.kind != MACHO_SWIFT_FUNC && node.kind != MACHO_SWIFT_MARKER) {
+			return -1;
+		}
+	}
+	if (start == 0) {
+		return -1;
+	}
+	for (i = start; i < dm->stack.count && args; i++) {
+		if (dm->stack.items[i].kind != MACHO_SWIFT_MARKER) {
+			args = macho_demangle_cat(dm, 3, args, args[0] ? ", " : "", dm->stack.items[i].text);
+		}
+	}
+	dm->stack.count = start - 1;
+	if (args == NULL || (text = macho_swift_pop_type(dm)) == NULL) {
+		return -1;
+	}
+	memset(&node, '\0', sizeof(macho_swift_node_t_64));
+	node.kind = MACHO_SWIFT_TYPE;
+	node.text = macho_demangle_cat(dm, 4, text, "<", args, ">");
+	if (node.text == NULL || macho_swift_push(dm, &dm->stack, &node) < 0) {
+		return -1;
+	}
+	return macho_swift_push(dm, &dm->swift_subs, &node);
+}
+
+// Result type, parameter type and throws annotation of a function
+static int macho_swift_signature(macho_demangle_state_t_64* dm, macho_swift_node_t_64* func) {
+	macho_swift_node_t_64 node;
+
+	memset(func, '\0', sizeof(macho_swift_node_t_64));
+	func->kind = MACHO_SWIFT_FUNC;
+	func->throws = macho_swift_pop(dm, MACHO_SWIFT_THROWS, &node) == 0;
+	if (macho_swift_pop(dm, 0, &node) < 0) {
+		return -1;
+	}
+	if (node.kind == MACHO_SWIFT_TYPE && node.elems) {
+		func->count = node.count;
+		func->elems = node.elems;
+	} else if (node.kind == MACHO_SWIFT_TYPE || node.kind == MACHO_SWIFT_FUNC) {
+		func->elems = (const char**) macho_demangle_alloc(dm, sizeof(char*));
+		if (func->elems == NULL) {
+			return -1;
+		}
+		func->elems[0] = node.text;
+		func->count = 1;
+	} else if (node.kind != MACHO_SWIFT_EMPTY) {
+		return -1;
+	}
+	if (macho_swift_pop(dm, MACHO_SWIFT_EMPTY, &node) == 0) {
+		func->result = "()";
+	} else if ((func->result = macho_swift_pop_type(dm)) == NULL) {
+		return -1;
+	}
+	func->text = macho_swift_join(dm, func->elems, func->count, NULL);
+	func->text = func->text ? macho_demangle_cat(dm, 4, func->text, func->throws ? " throws" : "",
+			" -> ", func->result) : NULL;
+	return func->text ? 0 : -1;
+}
+
+// Argument labels, one identifier or '_' per parameter, or 'y' for none
+static int macho_swift_labels(macho_demangle_state_t_64* dm, uint64_t count, const char*** labels) {
+	uint64_t i = 0;
+	macho_swift_node_t_64 node;
+
+	*labels = NULL;
+	if (count == 0 || macho_swift_pop(dm, MACHO_SWIFT_EMPTY, &node) == 0) {
+		return 0;
+	}
+	*labels = (const char**) macho_demangle_alloc(dm, count * sizeof(char*));
+	if (*labels == NULL) {
+		return -1;
+	}
+	for (i = count; i > 0; i--) {
+		if (macho_swift_pop(dm, 0, &node) < 0) {
+			return -1;
+		}
+		if (node.kind == MACHO_SWIFT_IDENT) {
+			(*labels)[i - 1] = node.text;
+		} else if (node.kind == MACHO_SWIFT_MARKER) {
+			(*labels)[i - 1] = NULL;
+		} else {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static const char* macho_swift_function(macho_demangle_state_t_64* dm, const macho_swift_node_t_64* func,
+		const char** labels) {
+	const char* params = macho_swift_join(dm, func->elems, func->count, labels);
+	return params ? macho_demangle_cat(dm, 4, params, func->throws ? " throws" : "", " -> ", func->result) : NULL;
+}
+
+static int macho_swift_entity(macho_demangle_state_t_64* dm) {
+	const char* name = NULL;
+	const char* text = NULL;
+	const char** labels = NULL;
+	macho_swift_node_t_64 func;
+	macho_swift_node_t_64 ident;
+
+	if (macho_swift_signature(dm, &func) < 0 || macho_swift_labels(dm, func.count, &labels) < 0
+			|| macho_swift_pop(dm, MACHO_SWIFT_IDENT, &ident) < 0 || (name = macho_swift_pop_context(dm)) == NULL) {
+		return -1;
+	}
+	text = macho_swift_function(dm, &func, labels);
+	return macho_swift_push_text(dm, MACHO_SWIFT_ENTITY, text ? macho_demangle_cat(dm, 4, name, ".", ident.text, text) : NULL);
+}
+
+static int macho_swift_initializer(macho_demangle_state_t_64* dm) {
+	char c = 0;
+	const char* text = NULL;
+	const char* context = NULL;
+	const char** labels = NULL;
+	macho_swift_node_t_64 func;
+
+	if (dm->cur >= dm->end) {
+		return -1;
+	}
+	c = *dm->cur++;
+	if (c == 'D' || c == 'd') {
+		context = macho_swift_pop_context(dm);
+		return macho_swift_push_text(dm, MACHO_SWIFT_ENTITY, context ? macho_demangle_cat(dm, 2, context,
+				c == 'D' ? ".__deallocating_deinit" : ".deinit") : NULL);
+	}
+	if ((c != 'C' && c != 'c') || macho_swift_pop(dm, MACHO_SWIFT_FUNC, &func) < 0
+			|| macho_swift_labels(dm, func.count, &labels) < 0 || (context = macho_swift_pop_context(dm)) == NULL) {
+		return -1;
+	}
+	text = macho_swift_function(dm, &func, labels);
+	return macho_swift_push_text(dm, MACHO_SWIFT_ENTITY, text ? macho_demangle_cat(dm, 3, context, ".init", text) : NULL);
+}
+
+static int macho_swift_variable(macho_demangle_state_t_64* dm) {
+	const char* type = NULL;
+	const char* context = NULL;
+	const char* accessor = NULL;
+	macho_swift_node_t_64 ident;
+
+	if ((type = macho_swift_pop_type(dm)) == NULL || macho_swift_pop(dm, MACHO_SWIFT_IDENT, &ident) < 0
+			|| (context = macho_swift_pop_context(dm)) == NULL || dm->cur >= dm->end) {
+		return -1;
+	}
+	switch (*dm->cur++) {
+	case 'p': accessor = ""; break;
+	case 'g': accessor = ".getter"; break;
+	case 's': accessor = ".setter"; break;
+	case 'M': accessor = ".modify"; break;
+	case 'r': accessor = ".read"; break;
+	case 'w': accessor = ".willset"; break;
+	case 'W': accessor = ".didset"; break;
+	case 'm': accessor = ".materializeForSet"; break;
+	case 'a':
+		accessor = ".unsafeMutableAddressor";
+		dm->cur++;
+		break;
+	case 'l':
+		accessor = ".unsafeAddressor";
+		dm->cur++;
+		break;
+	default:
+		return -1;
+	}
+	if (dm->cur > dm->end) {
+		return -1;
+	}
+	return macho_swift_push_text(dm, MACHO_SWIFT_ENTITY,
+			macho_demangle_cat(dm, 6, context, ".", ident.text, accessor, " : ", type));
+}
+
+static int macho_swift_metadata(macho_demangle_state_t_64* dm, const char* prefix) {
+	const char* type = NULL;
+	macho_swift_node_t_64 ident;
+
+	if (macho_swift_pop(dm, MACHO_SWIFT_IDENT, &ident) == 0) {
+		// Protocols are referenced by name rather than as a type
+		type = macho_swift_pop_context(dm);
+		type = type ? macho_demangle_cat(dm, 3, type, ".", ident.text) : NULL;
+	} else {
+		type = macho_swift_pop_type(dm);
+	}
+	return macho_swift_push_text(dm, MACHO_SWIFT_ENTITY, type ? macho_demangle_cat(dm, 2, prefix, type) : NULL);
+}
+
+static int macho_swift_wrap(macho_demangle_state_t_64* dm, int kind, const char* prefix, const char* suffix) {
+	macho_swift_node_t_64 node;
+	if (macho_swift_pop(dm, kind, &node) < 0) {
+		return -1;
+	}
+	return macho_swift_push_text(dm, kind, macho_demangle_cat(dm, 3, prefix, node.text, suffix));
+}
+
+static const char* macho_swift_demangle(macho_demangle_state_t_64* dm) {
+	int result = 0;
+	char c = 0;
+	macho_swift_node_t_64 func;
+
+	while (result == 0 && dm->cur < dm->end) {
+		c = *dm->cur;
+		if (c >= '0' && c <= '9') {
+			result = macho_swift_identifier(dm);
+			continue;
+		}
+		dm->cur++;
+		switch (c) {
+		case 'A': result = macho_swift_substitution(dm); break;
+		case 'S': result = macho_swift_standard_type(dm); break;
+		case 's': result = macho_swift_push_text(dm, MACHO_SWIFT_MODULE, "Swift"); break;
+		case 'x': result = macho_swift_push_text(dm, MACHO_SWIFT_TYPE, "A"); break;
+		case 'y': result = macho_swift_push_text(dm, MACHO_SWIFT_EMPTY, "()"); break;
+		case '_': result = macho_swift_push_text(dm, MACHO_SWIFT_MARKER, "_"); break;
+		case 'K': result = macho_swift_push_text(dm, MACHO_SWIFT_THROWS, "throws"); break;
+		case 'C':
+		case 'V':
+		case 'O':
+		case 'P': result = macho_swift_nominal(dm); break;
+		case 't': result = macho_swift_tuple(dm); break;
+		case 'G': result = macho_swift_bound_generic(dm); break;
+		case 'z': result = macho_swift_wrap(dm, MACHO_SWIFT_TYPE, "inout ", ""); break;
+		case 'c':
+			result = macho_swift_signature(dm, &func);
+			if (result == 0) {
+				result = macho_swift_push(dm, &dm->stack, &func);
+			}
+			break;
+		case 'F': result = macho_swift_entity(dm); break;
+		case 'f': result = macho_swift_initializer(dm); break;
+		case 'v': result = macho_swift_variable(dm); break;
+		case 'Z': result = macho_swift_wrap(dm, MACHO_SWIFT_ENTITY, "static ", ""); break;
+		case 'N': result = macho_swift_metadata(dm, "type metadata for "); break;
+		case 'D': result = macho_swift_metadata(dm, ""); break;
+		case 'M':
+			c = macho_demangle_peek(dm, 0);
+			dm->cur++;
+			switch (c) {
+			case 'a': result = macho_swift_metadata(dm, "type metadata accessor for "); break;
+			case 'n': result = macho_swift_metadata(dm, "nominal type descriptor for "); break;
+			case 'f': result = macho_swift_metadata(dm, "full type metadata for "); break;
+			case 'm': result = macho_swift_metadata(dm, "metaclass for "); break;
+			case 'p': result = macho_swift_metadata(dm, "protocol descriptor for "); break;
+			default: result = -1; break;
+			}
+			break;
+		case 'T':
+			c = macho_demangle_peek(dm, 0);
+			dm->cur++;
+			switch (c) {
+			case 'q': result = macho_swift_wrap(dm, MACHO_SWIFT_ENTITY, "method descriptor for ", ""); break;
+			case 'j': result = macho_swift_wrap(dm, MACHO_SWIFT_ENTITY, "dispatch thunk of ", ""); break;
+			case 'o': result = macho_swift_wrap(dm, MACHO_SWIFT_ENTITY, "@objc ", ""); break;
+			default: result = -1; break;
+			}
+			break;
+		default:
+			// Generic signatures, closures, protocol conformances and the
+			//   rest of the grammar are not supported
+			result = -1;
+			break;
+		}
+	}
+	// Entities, or a lone nominal or standard type such as $s4main3FooV
+	if (result < 0 || dm->cur != dm->end || dm->stack.count != 1
+			|| (dm->stack.items[0].kind != MACHO_SWIFT_ENTITY && dm->stack.items[0].kind != MACHO_SWIFT_TYPE)) {
+		return NULL;
+	}
+	return dm->stack.items[0].text;
+}
+
+/*
+ * Demangles name of at most length bytes into arena, using scratch for
+ *   everything that does not survive. Returns NULL when the name is not
+ *   mangled or not supported, and macho_demangle_retry when out of memory.
+ */
+static const char* macho_demangle_name_64(macho_arena_t_64* scratch, macho_arena_t_64* arena,
+		const char* name, uint64_t length) {
+	const char* text = NULL;
+	macho_demangle_state_t_64 dm;
+
+	memset(&dm, '\0', sizeof(macho_demangle_state_t_64));
+	dm.arena = scratch;
+	dm.pack_index = -1;
+	dm.pack_count = -1;
+	dm.cur = name;
+	dm.end = name + strnlen(name, length);
+
+	// Mach-O prepends an underscore to every C level name
+	if (macho_demangle_consume(&dm, "__Z") || macho_demangle_consume(&dm, "_Z")) {
+		text = macho_itanium_demangle(&dm);
+	} else if (macho_demangle_consume(&dm, "_$s") || macho_demangle_consume(&dm, "$s")
+			|| macho_demangle_consume(&dm, "_$S") || macho_demangle_consume(&dm, "$S")
+			|| macho_demangle_consume(&dm, "__T0") || macho_demangle_consume(&dm, "_T0")) {
+		text = macho_swift_demangle(&dm);
+	}
+	if (text) {
+		text = macho_arena_strndup_64(arena, text, strlen(text));
+		if (text == NULL) {
+			dm.oom = 1;
+		}
+	}
+	macho_arena_reset_64(scratch);
+	return dm.oom ? macho_demangle_retry : text;
+}
+
+/*
+ * Mach-O Demangler Functions
+ */
+typedef struct macho_demangle_batch_t_64 {
+	macho_symtab_t_64* symtab;
+	uint64_t count;
+	const uint32_t* strx;		/* string offsets still to demangle */
+	const char** names;
+	macho_arena_t_64* arenas;	/* one per chunk of names */
+} macho_demangle_batch_t_64;
+
+static int macho_demangle_chunk_64(uint64_t index, void* userdata) {
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint32_t strsize = 0;
+	macho_arena_t_64 scratch;
+	macho_demangle_batch_t_64* batch = (macho_demangle_batch_t_64*) userdata;
+
+	strsize = batch->symtab->cmd->strsize;
+	end = (index + 1) * MACHO_DEMANGLE_CHUNK;
+	if (end > batch->count) {
+		end = batch->count;
+	}
+	macho_arena_init_64(&scratch, 0x4000);
+	for (i = index * MACHO_DEMANGLE_CHUNK; i < end; i++) {
+		batch->names[i] = macho_demangle_name_64(&scratch, &batch->arenas[index],
+				(const char*) &batch->symtab->strings[batch->strx[i]], strsize - batch->strx[i]);
+		// Out of arena memory, the whole batch is left to be retried
+		if (batch->names[i] == macho_demangle_retry) {
+			break;
+		}
+	}
+	macho_arena_free_64(&scratch);
+	return (i < end) ? -1 : 0;
+}
+
+static uint64_t macho_demangler_slot_64(macho_demangler_t_64* demangler, uint64_t key) {
+	uint64_t slot = macho_hash_mix_64(key) & (demangler->capacity - 1);
+	while (demangler->keys[slot] && demangler->keys[slot] != key) {
+		slot = (slot + 1) & (demangler->capacity - 1);
+	}
+	return slot;
+}
+
+// Keeps the table at most half full with room for extra more entries
+static int macho_demangler_reserve_64(macho_demangler_t_64* demangler, uint64_t extra) {
+	uint64_t i = 0;
+	uint64_t slot = 0;
+	uint64_t capacity = demangler->capacity;
+	uint64_t* keys = demangler->keys;
+	const char** names = demangler->names;
+
+	if ((demangler->count + extra) * 2 <= capacity) {
+		return 0;
+	}
+	while ((demangler->count + extra) * 2 > demangler->capacity) {
+		demangler->capacity = demangler->capacity ? demangler->capacity * 2 : 1024;
+	}
+	demangler->keys = (uint64_t*) calloc(demangler->capacity, sizeof(uint64_t));
+	demangler->names = (const char**) calloc(demangler->capacity, sizeof(char*));
+	if (demangler->keys == NULL || demangler->names == NULL) {
+		free(demangler->keys);
+		free(demangler->names);
+		demangler->keys = keys;
+		demangler->names = names;
+		demangler->capacity = capacity;
+		return -1;
+	}
+	for (i = 0; i < capacity; i++) {
+		if (keys[i]) {
+			slot = macho_demangler_slot_64(demangler, keys[i]);
+			demangler->keys[slot] = keys[i];
+			demangler->names[slot] = names[i];
+		}
+	}
+	free(keys);
+	free(names);
+	return 0;
+}
+
+macho_demangler_t_64* macho_demangler_create_64(macho_symtab_t_64* symtab) {
+	macho_demangler_t_64* demangler = NULL;
+	if (symtab == NULL) {
+		return NULL;
+	}
+	demangler = (macho_demangler_t_64*) malloc(sizeof(macho_demangler_t_64));
+	if (demangler) {
+		memset(demangler, '\0', sizeof(macho_demangler_t_64));
+		demangler->symtab = symtab;
+		demangler->single = (macho_arena_t_64*) malloc(sizeof(macho_arena_t_64));
+		demangler->scratch = (macho_arena_t_64*) malloc(sizeof(macho_arena_t_64));
+		if (demangler->single == NULL || demangler->scratch == NULL) {
+			error("Unable to allocate demangler arenas\n");
+			free(demangler->single);
+			free(demangler->scratch);
+			free(demangler);
+			return NULL;
+		}
+		macho_arena_init_64(demangler->single, 0x4000);
+		macho_arena_init_64(demangler->scratch, 0x4000);
+	}
+	return demangler;
+}
+
+// Single lookups share one arena and one scratch buffer instead of paying
+//   for a batch each
+const char* macho_demangle_64(macho_demangler_t_64* demangler, uint64_t index) {
+	uint32_t strx = 0;
+	uint64_t slot = 0;
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+
+	if (demangler == NULL || index >= demangler->symtab->nsyms) {
+		return NULL;
+	}
+	symtab = demangler->symtab;
+	strx = symtab->strx ? symtab->strx[index] : symtab->symbols[index].n_un.n_strx;
+	if (symtab->strings == NULL || strx >= symtab->cmd->strsize
+			|| macho_demangler_reserve_64(demangler, 1) < 0) {
+		return NULL;
+	}
+	slot = macho_demangler_slot_64(demangler, (uint64_t) strx + 1);
+	if (demangler->keys[slot] && demangler->names[slot] != macho_demangle_retry) {
+		return demangler->names[slot];
+	}
+	if (demangler->keys[slot] == 0) {
+		demangler->keys[slot] = (uint64_t) strx + 1;
+		demangler->count++;
+	}
+	name = macho_demangle_name_64(demangler->scratch, demangler->single,
+			(const char*) &symtab->strings[strx], symtab->cmd->strsize - strx);
+	demangler->names[slot] = name;
+	return name == macho_demangle_retry ? NULL : name;
+}
+
+int macho_demangle_range_64(macho_demangler_t_64* demangler, uint64_t start, uint64_t count,
+		const char** results) {
+	int result = 0;
+	uint64_t i = 0;
+	uint64_t slot = 0;
+	uint64_t chunks = 0;
+	uint64_t failed = 0;
+	uint32_t strx = 0;
+	uint64_t* slots = NULL;
+	uint64_t* pending = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_arena_t_64* arenas = NULL;
+	macho_demangle_batch_t_64 batch;
+
+	if (demangler == NULL || results == NULL) {
+		return -1;
+	}
+	symtab = demangler->symtab;
+	if (start > symtab->nsyms || count > symtab->nsyms - start) {
+		return -1;
+	}
+	if (count == 0) {
+		return 0;
+	}
+	memset(&batch, '\0', sizeof(macho_demangle_batch_t_64));
+	batch.symtab = symtab;
+
+	slots = (uint64_t*) malloc(count * sizeof(uint64_t));
+	pending = (uint64_t*) malloc(count * sizeof(uint64_t));
+	batch.strx = (const uint32_t*) malloc(count * sizeof(uint32_t));
+	batch.names = (const char**) malloc(count * sizeof(char*));
+	if (slots == NULL || pending == NULL || batch.strx == NULL || batch.names == NULL
+			|| macho_demangler_reserve_64(demangler, count) < 0) {
+		error("Unable to allocate demangler batch\n");
+		result = -1;
+		goto done;
+	}
+
+	// Claim a slot for every string not seen before, so aliases within the
+	//   batch are demangled once and the table never moves under the workers.
+	for (i = 0; i < count; i++) {
+		strx = symtab->strx ? symtab->strx[start + i] : symtab->symbols[start + i].n_un.n_strx;
+		if (symtab->strings == NULL || strx >= symtab->cmd->strsize) {
+			slots[i] = UINT64_MAX;
+			continue;
+		}
+		slot = macho_demangler_slot_64(demangler, (uint64_t) strx + 1);
+		if (demangler->keys[slot] == 0 || demangler->names[slot] == macho_demangle_retry) {
+			if (demangler->keys[slot] == 0) {
+				demangler->keys[slot] = (uint64_t) strx + 1;
+				demangler->count++;
+			}
+			demangler->names[slot] = macho_demangle_pending;
+			pending[batch.count] = slot;
+			((uint32_t*) batch.strx)[batch.count++] = strx;
+		}
+		slots[i] = slot;
+	}
+
+	if (batch.count) {
+		chunks = (batch.count + MACHO_DEMANGLE_CHUNK - 1) / MACHO_DEMANGLE_CHUNK;
+		arenas = (macho_arena_t_64*) realloc(demangler->arenas,
+				(demangler->arena_count + chunks) * sizeof(macho_arena_t_64));
+		if (arenas == NULL) {
+			error("Unable to allocate demangler arenas\n");
+			result = -1;
+			goto done;
+		}
+		demangler->arenas = arenas;
+		for (i = 0; i < chunks; i++) {
+			macho_arena_init_64(&arenas[demangler->arena_count + i], 0);
+		}
+		batch.arenas = &arenas[demangler->arena_count];
+		demangler->arena_count += chunks;
+
+		if (chunks == 1) {
+			result = macho_demangle_chunk_64(0, &batch) ? -1 : 0;
+		} else if (macho_pool_run_64(chunks, 1, macho_demangle_chunk_64, &batch, &failed) != 0) {
+			error("Unable to demangle chunk %" PRIu64 "\n", failed);
+			result = -1;
+		}
+		for (i = 0; i < batch.count && result == 0; i++) {
+			demangler->names[pending[i]] = batch.names[i];
+		}
+		debug("Demangled %" PRIu64 " new names in %" PRIu64 " chunks\n", batch.count, chunks);
+	}
+	for (i = 0; i < count && result == 0; i++) {
+		results[i] = slots[i] == UINT64_MAX ? NULL : demangler->names[slots[i]];
+		if (results[i] == macho_demangle_retry) {
+			results[i] = NULL;
+		}
+	}
+
+done:
+	if (result < 0) {
+		// Unfinished claims are demangled again by the next lookup
+		for (i = 0; i < batch.count; i++) {
+			demangler->names[pending[i]] = macho_demangle_retry;
+		}
+	}
+	free(slots);
+	free(pending);
+	free((void*) batch.strx);
+	free(batch.names);
+	return result;
+}
+
+void macho_demangler_free_64(macho_demangler_t_64* demangler) {
+	uint64_t i = 0;
+	if (demangler) {
+		for (i = 0; i < demangler->arena_count; i++) {
+			macho_arena_free_64(&demangler->arenas[i]);
+		}
+		free(demangler->arenas);
+		macho_arena_free_64(demangler->single);
+		macho_arena_free_64(demangler->scratch);
+		free(demangler->single);
+		free(demangler->scratch);
+		free(demangler->keys);
+		free(demangler->names);
+		free(demangler);
+	}
+}
+
+char* macho_demangle_string_64(const char* name) {
+	char* result = NULL;
+	const char* text = NULL;
+	macho_arena_t_64 arena;
+	macho_arena_t_64 scratch;
+
+	if (name == NULL) {
+		return NULL;
+	}
+	macho_arena_init_64(&arena, 0x1000);
+	macho_arena_init_64(&scratch, 0x4000);
+	text = macho_demangle_name_64(&scratch, &arena, name, strlen(name));
+	if (text && text != macho_demangle_retry) {
+		result = strdup(text);
+	}
+	macho_arena_free_64(&scratch);
+	macho_arena_free_64(&arena);
+	return result;
+}
@@ -0,0 +1,507 @@
+/**
+ * libmacho-1.0 - diff.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/diff.h>
+
+#include "hash.h"
+#include "pool.h"
+
+#define MACHO_DIFF_CHUNK_SIZE 0x100000
+
+typedef struct macho_diff_section_t_64 {
+	char name[34];			/* "segname,sectname" */
+	uint64_t size;			/* vm size of the section */
+	uint64_t hash;
+	uint64_t chunk;			/* first chunk in the job list */
+	uint64_t chunk_count;
+	const unsigned char* data;	/* NULL for zerofill sections */
+	uint64_t data_size;
+} macho_diff_section_t_64;
+
+typedef struct macho_diff_chunk_t_64 {
+	const unsigned char* data;
+	uint64_t size;
+	uint64_t hash;
+} macho_diff_chunk_t_64;
+
+typedef struct macho_diff_symbol_t_64 {
+	const char* name;
+	uint64_t address;
+	uint64_t size;
+	uint64_t end;			/* end of its section, zero if unknown */
+	uint8_t sect;
+} macho_diff_symbol_t_64;
+
+static int macho_diff_section_compare(const void* a, const void* b) {
+	return strcmp(((const macho_diff_section_t_64*) a)->name, ((const macho_diff_section_t_64*) b)->name);
+}
+
+static int macho_diff_symbol_address_compare(const void* a, const void* b) {
+	const macho_diff_symbol_t_64* x = (const macho_diff_symbol_t_64*) a;
+	const macho_diff_symbol_t_64* y = (const macho_diff_symbol_t_64*) b;
+	if (x->address < y->address) return -1;
+	if (x->address > y->address) return 1;
+	if (x->sect < y->sect) return -1;
+	if (x->sect > y->sect) return 1;
+	return 0;
+}
+
+// Duplicate names, local symbols from different objects mostly, pair up in
+//   address order so the merge compares like with like
+static int macho_diff_symbol_name_compare(const void* a, const void* b) {
+	int cmp = strcmp(((const macho_diff_symbol_t_64*) a)->name, ((const macho_diff_symbol_t_64*) b)->name);
+	return cmp ? cmp : macho_diff_symbol_address_compare(a, b);
+}
+
+static int macho_diff_add_64(macho_diff_t_64* diff, uint32_t kind, uint32_t change,
+		const char* name, uint64_t old_size, uint64_t new_size) {
+	uint64_t capacity = 0;
+	char* copy = NULL;
+	macho_diff_entry_t_64* entries = NULL;
+	macho_diff_entry_t_64* entry = NULL;
+
+	copy = strdup(name);
+	if (copy == NULL) {
+		error("Unable to copy diff entry name\n");
+		return -1;
+	}
+	if (diff->count == diff->capacity) {
+		capacity = diff->capacity ? diff->capacity * 2 : 64;
+		entries = (macho_diff_entry_t_64*) realloc(diff->entries, capacity * sizeof(macho_diff_entry_t_64));
+		if (entries == NULL) {
+			error("Unable to grow diff entries\n");
+			free(copy);
+			return -1;
+		}
+		diff->entries = entries;
+		diff->capacity = capacity;
+	}
+	entry = &diff->entries[diff->count++];
+	entry->kind = kind;
+	entry->change = change;
+	entry->name = copy;
+	entry->old_size = old_size;
+	entry->new_size = new_size;
+	return 0;
+}
+
+static macho_diff_section_t_64* macho_diff_sections_load_64(macho_t_64* macho, uint64_t* count) {
+	int i = 0;
+	int j = 0;
+	uint64_t n = 0;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_diff_section_t_64* sections = NULL;
+
+	for (i = 0; i < macho->segment_count; i++) {
+		n += macho->segments[i]->section_count;
+	}
+	sections = (macho_diff_section_t_64*) malloc((n + 1) * sizeof(macho_diff_section_t_64));
+	if (sections == NULL) {
+		return NULL;
+	}
+	memset(sections, '\0', (n + 1) * sizeof(macho_diff_section_t_64));
+
+	n = 0;
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; j < segment->section_count; j++) {
+			if (segment->sections == NULL || segment->sections[j] == NULL) {
+				continue;
+			}
+			info = segment->sections[j]->info;
+			snprintf(sections[n].name, sizeof(sections[n].name), "%.16s,%.16s", info->segname, info->sectname);
+			sections[n].size = info->size;
+			if (segment->sections[j]->data) {
+				sections[n].data = segment->sections[j]->data;
+				sections[n].data_size = info->size;
+			}
+			n++;
+		}
+	}
+	*count = n;
+	return sections;
+}
+
+static int macho_diff_hash_chunk(uint64_t index, void* userdata) {
+	macho_diff_chunk_t_64* chunk = &((macho_diff_chunk_t_64*) userdata)[index];
+	chunk->hash = macho_hash_64(chunk->data, chunk->size, 0);
+	return 0;
+}
+
+static int macho_diff_sections_hash_64(macho_diff_section_t_64* old_sections, uint64_t old_count,
+		macho_diff_section_t_64* new_sections, uint64_t new_count) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t n = 0;
+	uint64_t total = 0;
+	uint64_t* hashes = NULL;
+	macho_diff_section_t_64* section = NULL;
+	macho_diff_chunk_t_64* chunks = NULL;
+
+	// Sections are cut into fixed size chunks so one huge __text doesn't
+	//   serialize the whole pass onto a single core.
+	for (i = 0; i < old_count + new_count; i++) {
+		section = (i < old_count) ? &old_sections[i] : &new_sections[i - old_count];
+		section->chunk = total;
+		section->chunk_count = (section->data_size + MACHO_DIFF_CHUNK_SIZE - 1) / MACHO_DIFF_CHUNK_SIZE;
+		total += section->chunk_count;
+	}
+
+	chunks = (macho_diff_chunk_t_64*) malloc((total + 1) * sizeof(macho_diff_chunk_t_64));
+	if (chunks == NULL) {
+		error("Unable to allocate diff chunks\n");
+		return -1;
+	}
+	for (i = 0; i < old_count + new_count; i++) {
+		section = (i < old_count) ? &old_sections[i] : &new_sections[i - old_count];
+		for (j = 0; j < section->chunk_count; j++) {
+			n = section->chunk + j;
+			chunks[n].data = section->data + j * MACHO_DIFF_CHUNK_SIZE;
+			chunks[n].size = section->data_size - j * MACHO_DIFF_CHUNK_SIZE;
+			if (chunks[n].size > MACHO_DIFF_CHUNK_SIZE) {
+				chunks[n].size = MACHO_DIFF_CHUNK_SIZE;
+			}
+		}
+	}
+
+	if (macho_pool_run_64(total, 1, macho_diff_hash_chunk, chunks, NULL) != 0) {
+		error("Unable to hash diff chunks\n");
+		free(chunks);
+		return -1;
+	}
+
+	hashes = (uint64_t*) malloc((total + 1) * sizeof(uint64_t));
+	if (hashes == NULL) {
+		free(chunks);
+		return -1;
+	}
+	for (i = 0; i < total; i++) {
+		hashes[i] = chunks[i].hash;
+	}
+	for (i = 0; i < old_count + new_count; i++) {
+		section = (i < old_count) ? &old_sections[i] : &new_sections[i - old_count];
+		section->hash = macho_hash_64(&hashes[section->chunk], section->chunk_count * sizeof(uint64_t), section->size);
+	}
+
+	free(hashes);
+	free(chunks);
+	return 0;
+}
+
+static int macho_diff_sections_64(macho_diff_t_64* diff, macho_t_64* old_macho, macho_t_64* new_macho) {
+	int cmp = 0;
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t old_count = 0;
+	uint64_t new_count = 0;
+	macho_diff_section_t_64* old_sections = NULL;
+	macho_diff_section_t_64* new_sections = NULL;
+
+	old_sections = macho_diff_sections_load_64(old_macho, &old_count);
+	new_sections = macho_diff_sections_load_64(new_macho, &new_count);
+	if (old_sections == NULL || new_sections == NULL
+			|| macho_diff_sections_hash_64(old_sections, old_count, new_sections, new_count) < 0) {
+		if (old_sections) free(old_sections);
+		if (new_sections) free(new_sections);
+		return -1;
+	}
+
+	qsort(old_sections, old_count, sizeof(macho_diff_section_t_64), macho_diff_section_compare);
+	qsort(new_sections, new_count, sizeof(macho_diff_section_t_64), macho_diff_section_compare);
+
+	while (ret == 0 && (i < old_count || j < new_count)) {
+		if (i == old_count) {
+			cmp = 1;
+		} else if (j == new_count) {
+			cmp = -1;
+		} else {
+			cmp = strcmp(old_sections[i].name, new_sections[j].name);
+		}
+
+		if (cmp < 0) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SECTION, MACHO_DIFF_REMOVED, old_sections[i].name, old_sections[i].size, 0);
+			i++;
+		} else if (cmp > 0) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SECTION, MACHO_DIFF_ADDED, new_sections[j].name, 0, new_sections[j].size);
+			j++;
+		} else {
+			if (old_sections[i].size != new_sections[j].size) {
+				ret = macho_diff_add_64(diff, MACHO_DIFF_SECTION, MACHO_DIFF_RESIZED, old_sections[i].name,
+						old_sections[i].size, new_sections[j].size);
+			} else if (old_sections[i].hash != new_sections[j].hash) {
+				ret = macho_diff_add_64(diff, MACHO_DIFF_SECTION, MACHO_DIFF_CHANGED, old_sections[i].name,
+						old_sections[i].size, new_sections[j].size);
+			} else {
+				diff->identical++;
+			}
+			i++;
+			j++;
+		}
+	}
+
+	free(old_sections);
+	free(new_sections);
+	return ret;
+}
+
+static int macho_diff_segments_64(macho_diff_t_64* diff, macho_t_64* old_macho, macho_t_64* new_macho) {
+	int ret = 0;
+	uint64_t i = 0;
+	macho_segment_t_64* old_segment = NULL;
+	macho_segment_t_64* new_segment = NULL;
+
+	// Segment counts are tiny, a nested lookup by name is all this needs
+	for (i = 0; ret == 0 && i < old_macho->segment_count; i++) {
+		old_segment = old_macho->segments[i];
+		new_segment = macho_get_segment_64(new_macho, old_segment->name);
+		if (new_segment == NULL) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SEGMENT, MACHO_DIFF_REMOVED, old_segment->name,
+					old_segment->command->vmsize, 0);
+		} else if (new_segment->command->vmsize != old_segment->command->vmsize
+				|| new_segment->command->filesize != old_segment->command->filesize) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SEGMENT, MACHO_DIFF_RESIZED, old_segment->name,
+					old_segment->command->vmsize, new_segment->command->vmsize);
+		}
+	}
+	for (i = 0; ret == 0 && i < new_macho->segment_count; i++) {
+		new_segment = new_macho->segments[i];
+		if (macho_get_segment_64(old_macho, new_segment->name) == NULL) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SEGMENT, MACHO_DIFF_ADDED, new_segment->name,
+					0, new_segment->command->vmsize);
+		}
+	}
+	return ret;
+}
+
+static macho_diff_symbol_t_64* macho_diff_symbols_load_64(macho_t_64* macho, uint64_t* count) {
+	int i = 0;
+	uint64_t j = 0;
+	uint64_t n = 0;
+	uint64_t end = 0;
+	uint64_t ends[MACHO_SECTION_ORDINAL_MAX + 1];
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_diff_symbol_t_64* symbols = NULL;
+
+	for (i = 0; i < macho->symtab_count; i++) {
+		n += macho->symtabs[i]->nsyms;
+	}
+	symbols = (macho_diff_symbol_t_64*) malloc((n + 1) * sizeof(macho_diff_symbol_t_64));
+	if (symbols == NULL) {
+		return NULL;
+	}
+
+	macho_section_ends_64(macho, ends);
+
+	n = 0;
+	for (i = 0; i < macho->symtab_count; i++) {
+		symtab = macho->symtabs[i];
+		for (j = 0; j < symtab->nsyms; j++) {
+			if (symtab->types[j] & MACHO_N_STAB) {
+				continue;
+			}
+			name = macho_symtab_name_64(symtab, j);
+			if (name == NULL) {
+				continue;
+			}
+			symbols[n].name = name;
+			symbols[n].address = symtab->values[j];
+			symbols[n].size = 0;
+			symbols[n].sect = symtab->sects[j];
+			symbols[n].end = ends[symtab->sects[j]];
+			if ((symtab->types[j] & MACHO_N_TYPE) != MACHO_N_SECT) {
+				symbols[n].address = UINT64_MAX;
+				symbols[n].end = 0;
+			}
+			n++;
+		}
+	}
+
+	// A symbol's size is the gap to the next defined symbol, cut off at the
+	//   end of its section; undefined symbols sort last and stay at zero.
+	qsort(symbols, n, sizeof(macho_diff_symbol_t_64), macho_diff_symbol_address_compare);
+	for (j = 0; j < n && symbols[j].address != UINT64_MAX; j++) {
+		end = symbols[j].end;
+		if (j + 1 < n && symbols[j + 1].address != UINT64_MAX
+				&& (end == 0 || symbols[j + 1].address < end)) {
+			end = symbols[j + 1].address;
+		}
+		if (end > symbols[j].address) {
+			symbols[j].size = end - symbols[j].address;
+		}
+	}
+	qsort(symbols, n, sizeof(macho_diff_symbol_t_64), macho_diff_symbol_name_compare);
+	*count = n;
+	return symbols;
+}
+
+static int macho_diff_symbols_64(macho_diff_t_64* diff, macho_t_64* old_macho, macho_t_64* new_macho) {
+	int cmp = 0;
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t old_count = 0;
+	uint64_t new_count = 0;
+	macho_diff_symbol_t_64* old_symbols = NULL;
+	macho_diff_symbol_t_64* new_symbols = NULL;
+
+	old_symbols = macho_diff_symbols_load_64(old_macho, &old_count);
+	new_symbols = macho_diff_symbols_load_64(new_macho, &new_count);
+	if (old_symbols == NULL || new_symbols == NULL) {
+		if (old_symbols) free(old_symbols);
+		if (new_symbols) free(new_symbols);
+		return -1;
+	}
+
+	while (ret == 0 && (i < old_count || j < new_count)) {
+		if (i == old_count) {
+			cmp = 1;
+		} else if (j == new_count) {
+			cmp = -1;
+		} else {
+			cmp = strcmp(old_symbols[i].name, new_symbols[j].name);
+		}
+
+		if (cmp < 0) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SYMBOL, MACHO_DIFF_REMOVED, old_symbols[i].name, old_symbols[i].size, 0);
+			i++;
+		} else if (cmp > 0) {
+			ret = macho_diff_add_64(diff, MACHO_DIFF_SYMBOL, MACHO_DIFF_ADDED, new_symbols[j].name, 0, new_symbols[j].size);
+			j++;
+		} else {
+			if (old_symbols[i].size != new_symbols[j].size) {
+				ret = macho_diff_add_64(diff, MACHO_DIFF_SYMBOL, MACHO_DIFF_RESIZED, old_symbols[i].name,
+						old_symbols[i].size, new_symbols[j].size);
+			}
+			i++;
+			j++;
+		}
+	}
+
+	free(old_symbols);
+	free(new_symbols);
+	return ret;
+}
+
+/*
+ * Mach-O Diff Functions
+ */
+macho_diff_t_64* macho_diff_create_64() {
+	macho_diff_t_64* diff = (macho_diff_t_64*) malloc(sizeof(macho_diff_t_64));
+	if (diff) {
+		memset(diff, '\0', sizeof(macho_diff_t_64));
+	}
+	return diff;
+}
+
+macho_diff_t_64* macho_diff_load_64(macho_t_64* old_macho, macho_t_64* new_macho) {
+	macho_diff_t_64* diff = NULL;
+
+	if (old_macho == NULL || new_macho == NULL) {
+		return NULL;
+	}
+
+	diff = macho_diff_create_64();
+	if (diff == NULL) {
+		error("Unable to create diff\n");
+		return NULL;
+	}
+	diff->size_delta = (int64_t) new_macho->size - (int64_t) old_macho->size;
+
+	debug("Diffing segments\n");
+	if (macho_diff_segments_64(diff, old_macho, new_macho) < 0) {
+		error("Unable to diff segments\n");
+		macho_diff_free_64(diff);
+		return NULL;
+	}
+	debug("Diffing sections\n");
+	if (macho_diff_sections_64(diff, old_macho, new_macho) < 0) {
+		error("Unable to diff sections\n");
+		macho_diff_free_64(diff);
+		return NULL;
+	}
+	debug("Diffing symbols\n");
+	if (macho_diff_symbols_64(diff, old_macho, new_macho) < 0) {
+		error("Unable to diff symbols\n");
+		macho_diff_free_64(diff);
+		return NULL;
+	}
+	return diff;
+}
+
+void macho_diff_count_64(macho_diff_t_64* diff, uint32_t kind, uint32_t change, uint64_t* count, int64_t* delta) {
+	uint64_t i = 0;
+	macho_diff_entry_t_64* entry = NULL;
+
+	if (count) *count = 0;
+	if (delta) *delta = 0;
+	if (diff == NULL) {
+		return;
+	}
+	for (i = 0; i < diff->count; i++) {
+		entry = &diff->entries[i];
+		if (entry->kind != kind || entry->change != change) {
+			continue;
+		}
+		if (count) *count += 1;
+		if (delta) *delta += (int64_t) entry->new_size - (int64_t) entry->old_size;
+	}
+}
+
+void macho_diff_debug_64(macho_diff_t_64* diff) {
+	uint64_t i = 0;
+	if (diff) {
+		debug("Mach-O Diff:\n");
+		debug("\t  entries: %llu\n", diff->count);
+		debug("\tidentical: %llu\n", diff->identical);
+		debug("\t    delta: %lld\n", diff->size_delta);
+		for (i = 0; i < diff->count; i++) {
+			debug("\t\t%u/%u %s 0x%llx -> 0x%llx\n", diff->entries[i].kind, diff->entries[i].change,
+					diff->entries[i].name, diff->entries[i].old_size, diff->entries[i].new_size);
+		}
+	}
+}
+
+void macho_diff_free_64(macho_diff_t_64* diff) {
+	uint64_t i = 0;
+	if (diff) {
+		if (diff->entries) {
+			for (i = 0; i < diff->count; i++) {
+				if (diff->entries[i].name) {
+					free(diff->entries[i].name);
+				}
+			}
+			free(diff->entries);
+			diff->entries = NULL;
+		}
+		free(diff);
+	}
+}
@@ -0,0 +1,372 @@
+/**
+ * libmacho-1.0 - fat.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/fat.h>
+
+#include "pool.h"
+
+typedef struct macho_fat_job_t_64 {
+	macho_fat_t_64* fat;
+	const char* directory;
+	const char* name;
+} macho_fat_job_t_64;
+
+static const struct {
+	const char* name;
+	uint32_t cputype;
+	uint32_t cpusubtype;
+} macho_fat_arch_names[] = {
+	{ "i386",     MACHO_CPU_TYPE_X86,      3 },
+	{ "x86_64",   MACHO_CPU_TYPE_X86_64,   3 },
+	{ "x86_64h",  MACHO_CPU_TYPE_X86_64,   8 },
+	{ "armv6",    MACHO_CPU_TYPE_ARM,      6 },
+	{ "armv7",    MACHO_CPU_TYPE_ARM,      9 },
+	{ "armv7s",   MACHO_CPU_TYPE_ARM,      11 },
+	{ "armv7k",   MACHO_CPU_TYPE_ARM,      12 },
+	{ "arm64",    MACHO_CPU_TYPE_ARM64,    0 },
+	{ "arm64v8",  MACHO_CPU_TYPE_ARM64,    1 },
+	{ "arm64e",   MACHO_CPU_TYPE_ARM64,    2 },
+	{ "arm64_32", MACHO_CPU_TYPE_ARM64_32, 1 },
+	{ NULL, 0, 0 }
+};
+
+static uint32_t macho_fat_read32(const unsigned char* data) {
+	uint32_t value = 0;
+	memcpy(&value, data, sizeof(value));
+	return be32toh(value);
+}
+
+static uint64_t macho_fat_read64(const unsigned char* data) {
+	uint64_t value = 0;
+	memcpy(&value, data, sizeof(value));
+	return be64toh(value);
+}
+
+const char* macho_fat_arch_name_64(uint32_t cputype, uint32_t cpusubtype) {
+	int i = 0;
+	cpusubtype &= ~MACHO_CPU_SUBTYPE_MASK;
+	for (i = 0; macho_fat_arch_names[i].name != NULL; i++) {
+		if (macho_fat_arch_names[i].cputype == cputype && macho_fat_arch_names[i].cpusubtype == cpusubtype) {
+			return macho_fat_arch_names[i].name;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Mach-O Universal Binary Functions
+ */
+macho_fat_t_64* macho_fat_create_64() {
+	macho_fat_t_64* fat = (macho_fat_t_64*) malloc(sizeof(macho_fat_t_64));
+	if (fat) {
+		memset(fat, '\0', sizeof(macho_fat_t_64));
+	}
+	return fat;
+}
+
+macho_fat_t_64* macho_fat_open_64(const char* path) {
+	macho_map_t_64* map = NULL;
+	macho_fat_t_64* fat = NULL;
+
+	map = macho_map_open_64(path);
+	if (map == NULL) {
+		return NULL;
+	}
+	fat = macho_fat_load_64(map);
+	if (fat == NULL) {
+		macho_map_free_64(map);
+	}
+	return fat;
+}
+
+/*
+ * Takes ownership of the mapping on success. A thin Mach-O is reported as a
+ *   single slice covering the whole file so callers don't have to care.
+ */
+macho_fat_t_64* macho_fat_load_64(macho_map_t_64* map) {
+	uint32_t i = 0;
+	uint32_t magic = 0;
+	uint32_t count = 0;
+	uint64_t entry = 0;
+	uint64_t entry_size = 0;
+	unsigned char* data = NULL;
+	macho_fat_t_64* fat = NULL;
+	macho_fat_arch_t_64* arch = NULL;
+
+	if (map == NULL || map->size < 8) {
+		return NULL;
+	}
+	data = map->data;
+	magic = macho_fat_read32(data);
+
+	fat = macho_fat_create_64();
+	if (fat == NULL) {
+		return NULL;
+	}
+	fat->magic = magic;
+
+	if (magic != MACHO_FAT_MAGIC && magic != MACHO_FAT_MAGIC_64) {
+		memcpy(&magic, data, sizeof(magic));
+		if (magic != MACHO_MAGIC_64 && magic != MACHO_MAGIC_32) {
+			error("%s is neither a universal binary nor a Mach-O\n", map->path);
+			macho_fat_free_64(fat);
+			return NULL;
+		}
+		fat->archs = (macho_fat_arch_t_64*) malloc(sizeof(macho_fat_arch_t_64));
+		if (fat->archs == NULL) {
+			macho_fat_free_64(fat);
+			return NULL;
+		}
+		memset(fat->archs, '\0', sizeof(macho_fat_arch_t_64));
+		memcpy(&fat->archs[0].cputype, &data[4], sizeof(uint32_t));
+		memcpy(&fat->archs[0].cpusubtype, &data[8], sizeof(uint32_t));
+		fat->archs[0].size = map->size;
+		fat->count = 1;
+		fat->map = map;
+		return fat;
+	}
+
+	count = macho_fat_read32(&data[4]);
+	entry_size = (magic == MACHO_FAT_MAGIC_64) ? 32 : 20;
+	if (8 + count * entry_size > map->size) {
+		error("Universal header of %s is truncated\n", map->path);
+		macho_fat_free_64(fat);
+		return NULL;
+	}
+
+	fat->archs = (macho_fat_arch_t_64*) malloc((count + 1) * sizeof(macho_fat_arch_t_64));
+	if (fat->archs == NULL) {
+		macho_fat_free_64(fat);
+		return NULL;
+	}
+	memset(fat->archs, '\0', (count + 1) * sizeof(macho_fat_arch_t_64));
+
+	for (i = 0; i < count; i++) {
+		entry = 8 + i * entry_size;
+		arch = &fat->archs[i];
+		arch->cputype = macho_fat_read32(&data[entry]);
+		arch->cpusubtype = macho_fat_read32(&data[entry + 4]);
+		if (magic == MACHO_FAT_MAGIC_64) {
+			arch->offset = macho_fat_read64(&data[entry + 8]);
+			arch->size = macho_fat_read64(&data[entry + 16]);
+			arch->align = macho_fat_read32(&data[entry + 24]);
+		} else {
+			arch->offset = macho_fat_read32(&data[entry + 8]);
+			arch->size = macho_fat_read32(&data[entry + 12]);
+			arch->align = macho_fat_read32(&data[entry + 16]);
+		}
+		if (arch->offset > map->size || arch->size > map->size - arch->offset) {
+			error("Slice %u of %s is out of bounds\n", i, map->path);
+			macho_fat_free_64(fat);
+			return NULL;
+		}
+	}
+	fat->count = count;
+	fat->map = map;
+	return fat;
+}
+
+int macho_fat_find_arch_64(macho_fat_t_64* fat, const char* name) {
+	uint32_t i = 0;
+	const char* arch = NULL;
+	if (fat && name) {
+		for (i = 0; i < fat->count; i++) {
+			arch = macho_fat_arch_name_64(fat->archs[i].cputype, fat->archs[i].cpusubtype);
+			if (arch && strcmp(arch, name) == 0) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+int macho_fat_extract_64(macho_fat_t_64* fat, uint32_t index, const char* path) {
+	int fd = -1;
+	ssize_t done = 0;
+	uint64_t size = 0;
+	uint64_t offset = 0;
+	macho_fat_arch_t_64* arch = NULL;
+
+	if (fat == NULL || path == NULL || index >= fat->count) {
+		return -1;
+	}
+	arch = &fat->archs[index];
+	offset = arch->offset;
+	size = arch->size;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+	if (fd < 0) {
+		error("Unable to create %s\n", path);
+		return -1;
+	}
+
+	// Let the kernel move the bytes file to file first; the mapping is only
+	//   touched if neither copy_file_range nor sendfile can do it.
+#ifdef __linux__
+	{
+		loff_t position = (loff_t) offset;
+		while (size > 0) {
+			done = copy_file_range(fat->map->fd, &position, fd, NULL, size, 0);
+			if (done < 0 && errno == EINTR) {
+				continue;
+			}
+			if (done <= 0) {
+				break;
+			}
+			size -= done;
+		}
+		offset = (uint64_t) position;
+	}
+	while (size > 0) {
+		off_t position = (off_t) offset;
+		done = sendfile(fd, fat->map->fd, &position, size);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			break;
+		}
+		offset = (uint64_t) position;
+		size -= done;
+	}
+#endif
+	while (size > 0) {
+		done = write(fd, &fat->map->data[offset], size);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			error("Unable to write %s: %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		offset += done;
+		size -= done;
+	}
+
+	if (close(fd) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+static int macho_fat_extract_job(uint64_t index, void* userdata) {
+	int ret = 0;
+	char* path = NULL;
+	char fallback[32];
+	const char* arch = NULL;
+	macho_fat_job_t_64* job = (macho_fat_job_t_64*) userdata;
+	macho_fat_t_64* fat = job->fat;
+
+	arch = macho_fat_arch_name_64(fat->archs[index].cputype, fat->archs[index].cpusubtype);
+	if (arch == NULL) {
+		snprintf(fallback, sizeof(fallback), "slice%llu", (unsigned long long) index);
+		arch = fallback;
+	}
+	path = (char*) malloc(strlen(job->directory) + strlen(job->name) + strlen(arch) + 3);
+	if (path == NULL) {
+		return -1;
+	}
+	sprintf(path, "%s/%s.%s", job->directory, job->name, arch);
+	debug("Extracting slice %llu to %s\n", (unsigned long long) index, path);
+	ret = macho_fat_extract_64(fat, index, path);
+	free(path);
+	return ret;
+}
+
+int macho_fat_extract_all_64(macho_fat_t_64* fat, const char* directory) {
+	int ret = 0;
+	char* copy = NULL;
+	uint64_t failed = 0;
+	macho_fat_job_t_64 job;
+
+	if (fat == NULL || directory == NULL) {
+		return -1;
+	}
+	copy = strdup(fat->map->path);
+	if (copy == NULL) {
+		return -1;
+	}
+	job.fat = fat;
+	job.directory = directory;
+	job.name = basename(copy);
+
+	if (macho_pool_run_64(fat->count, 1, macho_fat_extract_job, &job, &failed) != 0) {
+		error("Unable to extract slice %llu\n", (unsigned long long) failed);
+		ret = -1;
+	}
+	free(copy);
+	return ret;
+}
+
+// Only called from debug(), which may compile to nothing
+static inline const char* macho_fat_debug_name(macho_fat_arch_t_64* arch) {
+	const char* name = macho_fat_arch_name_64(arch->cputype, arch->cpusubtype);
+	return name ? name : "unknown";
+}
+
+void macho_fat_debug_64(macho_fat_t_64* fat) {
+	uint32_t i = 0;
+	if (fat) {
+		debug("Universal Binary:\n");
+		debug("\tmagic: 0x%08x\n", fat->magic);
+		debug("\tslices: %u\n", fat->count);
+		for (i = 0; i < fat->count; i++) {
+			debug("\t\t%-8s cputype=0x%08x cpusubtype=0x%08x offset=0x%" PRIx64 " size=0x%" PRIx64 " align=2^%u\n",
+					macho_fat_debug_name(&fat->archs[i]), fat->archs[i].cputype, fat->archs[i].cpusubtype,
+					fat->archs[i].offset, fat->archs[i].size, fat->archs[i].align);
+		}
+	}
+}
+
+void macho_fat_free_64(macho_fat_t_64* fat) {
+	if (fat) {
+		if (fat->archs) {
+			free(fat->archs);
+			fat->archs = NULL;
+		}
+		if (fat->map) {
+			macho_map_free_64(fat->map);
+			fat->map = NULL;
+		}
+		free(fat);
+	}
+}
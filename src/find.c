@@ -0,0 +1,271 @@
+/**
+ * libmacho-1.0 - find.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <fnmatch.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/find.h>
+
+static int macho_name_entry_compare(const void* a, const void* b) {
+	const macho_name_entry_t_64* x = (const macho_name_entry_t_64*) a;
+	const macho_name_entry_t_64* y = (const macho_name_entry_t_64*) b;
+	int result = strcmp(x->name, y->name);
+	if (result) return result;
+	if (x->symtab != y->symtab) return x->symtab < y->symtab ? -1 : 1;
+	if (x->index != y->index) return x->index < y->index ? -1 : 1;
+	return 0;
+}
+
+// First entry whose name does not sort below the prefix, or with upper set,
+//   the first one past every name starting with it
+static uint64_t macho_name_index_bound(macho_name_index_t_64* index, const char* prefix,
+		uint64_t length, int upper) {
+	int result = 0;
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = index->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		result = strncmp(index->entries[middle].name, prefix, length);
+		if (result < 0 || (upper && result == 0)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// Literal characters every glob match has to start with
+static uint64_t macho_find_glob_prefix(const char* pattern, char* prefix) {
+	uint64_t length = 0;
+	while (*pattern && !strchr("*?[", *pattern)) {
+		if (*pattern == '\\') {
+			if (*++pattern == '\0') {
+				break;
+			}
+		}
+		prefix[length++] = *pattern++;
+	}
+	prefix[length] = '\0';
+	return length;
+}
+
+// Literal characters every regex match has to start with, only an anchored
+//   expression without alternation has any
+static uint64_t macho_find_regex_prefix(const char* pattern, char* prefix) {
+	char c = 0;
+	uint64_t length = 0;
+
+	prefix[0] = '\0';
+	if (pattern[0] != '^' || strchr(pattern, '|')) {
+		return 0;
+	}
+	for (pattern++; *pattern; pattern++) {
+		c = *pattern;
+		if (c == '\\') {
+			// Escaped punctuation is literal, classes like \w are not
+			c = pattern[1];
+			if (c == '\0' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+				break;
+			}
+			pattern++;
+		} else if (strchr(".[]()*+?{}^$", c)) {
+			break;
+		}
+		// A quantified character may not be there at all
+		if (pattern[1] && strchr("*?{", pattern[1])) {
+			break;
+		}
+		prefix[length++] = c;
+		if (pattern[1] == '+') {
+			break;
+		}
+	}
+	prefix[length] = '\0';
+	return length;
+}
+
+/*
+ * Mach-O Symbol Name Index Functions
+ */
+macho_name_index_t_64* macho_name_index_create_64() {
+	macho_name_index_t_64* index = (macho_name_index_t_64*) malloc(sizeof(macho_name_index_t_64));
+	if (index) {
+		memset(index, '\0', sizeof(macho_name_index_t_64));
+	}
+	return index;
+}
+
+macho_name_index_t_64* macho_name_index_load_64(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t count = 0;
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_name_index_t_64* index = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	index = macho_name_index_create_64();
+	if (index == NULL) {
+		error("Unable to create symbol name index\n");
+		return NULL;
+	}
+	index->macho = macho;
+
+	for (i = 0; i < macho->symtab_count; i++) {
+		count += macho->symtabs[i]->nsyms;
+	}
+	if (count == 0) {
+		return index;
+	}
+
+	index->entries = (macho_name_entry_t_64*) malloc(count * sizeof(macho_name_entry_t_64));
+	if (index->entries == NULL) {
+		error("Unable to allocate symbol name index entries\n");
+		macho_name_index_free_64(index);
+		return NULL;
+	}
+
+	for (i = 0; i < macho->symtab_count; i++) {
+		symtab = macho->symtabs[i];
+		for (j = 0; j < symtab->nsyms; j++) {
+			name = macho_symtab_name_64(symtab, j);
+			if (name == NULL || name[0] == '\0') {
+				continue;
+			}
+			index->entries[index->count].name = name;
+			index->entries[index->count].symtab = i;
+			index->entries[index->count].index = j;
+			index->count++;
+		}
+	}
+
+	qsort(index->entries, index->count, sizeof(macho_name_entry_t_64), macho_name_entry_compare);
+	debug("Symbol name index loaded %llu names\n", index->count);
+	return index;
+}
+
+// Matches come back in name order. The literal prefix of the pattern picks
+//   the range of sorted names that can match at all; glob and regex
+//   patterns are only run against the names inside it.
+macho_query_result_t_64* macho_find_symbols_64(macho_name_index_t_64* index, const char* pattern, int mode) {
+	int failed = 0;
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint64_t start = 0;
+	uint64_t length = 0;
+	char* prefix = NULL;
+	regex_t regex;
+	macho_query_result_t_64* result = NULL;
+
+	if (index == NULL || pattern == NULL) {
+		return NULL;
+	}
+	if (mode != MACHO_FIND_PREFIX && mode != MACHO_FIND_GLOB && mode != MACHO_FIND_REGEX) {
+		error("Unknown symbol find mode %d\n", mode);
+		return NULL;
+	}
+	if (mode == MACHO_FIND_REGEX && regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+		error("Unable to compile symbol pattern %s\n", pattern);
+		return NULL;
+	}
+
+	prefix = (char*) malloc(strlen(pattern) + 1);
+	result = (macho_query_result_t_64*) malloc(sizeof(macho_query_result_t_64));
+	if (prefix == NULL || result == NULL) {
+		error("Unable to allocate find result\n");
+		if (mode == MACHO_FIND_REGEX) {
+			regfree(&regex);
+		}
+		free(prefix);
+		free(result);
+		return NULL;
+	}
+	memset(result, '\0', sizeof(macho_query_result_t_64));
+
+	if (mode == MACHO_FIND_PREFIX) {
+		length = strlen(pattern);
+		memcpy(prefix, pattern, length + 1);
+	} else if (mode == MACHO_FIND_GLOB) {
+		length = macho_find_glob_prefix(pattern, prefix);
+	} else {
+		length = macho_find_regex_prefix(pattern, prefix);
+	}
+	start = macho_name_index_bound(index, prefix, length, 0);
+	end = macho_name_index_bound(index, prefix, length, 1);
+
+	for (i = start; i < end; i++) {
+		if (mode == MACHO_FIND_GLOB && fnmatch(pattern, index->entries[i].name, 0) != 0) {
+			continue;
+		}
+		if (mode == MACHO_FIND_REGEX && regexec(&regex, index->entries[i].name, 0, NULL, 0) != 0) {
+			continue;
+		}
+		if (macho_query_result_add_64(result, index->entries[i].symtab, index->entries[i].index) < 0) {
+			error("Unable to allocate find matches\n");
+			failed = 1;
+			break;
+		}
+	}
+
+	if (mode == MACHO_FIND_REGEX) {
+		regfree(&regex);
+	}
+	free(prefix);
+	if (failed) {
+		macho_query_result_free_64(result);
+		return NULL;
+	}
+	debug("Symbol find scanned %llu of %llu names for %llu matches\n", end - start, index->count, result->count);
+	return result;
+}
+
+void macho_name_index_debug_64(macho_name_index_t_64* index) {
+	uint64_t i = 0;
+	if (index) {
+		debug("\tSymbol Name Index:\n");
+		debug("\t\tcount: 0x%llx\n", index->count);
+		for (i = 0; i < index->count; i++) {
+			debug("\t\t%llu:%llu\t%s\n", index->entries[i].symtab, index->entries[i].index, index->entries[i].name);
+		}
+	}
+}
+
+void macho_name_index_free_64(macho_name_index_t_64* index) {
+	if (index) {
+		if (index->entries) {
+			free(index->entries);
+			index->entries = NULL;
+		}
+		free(index);
+	}
+}
@@ -0,0 +1,250 @@
+/**
+ * libmacho-1.0 - function.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/function.h>
+
+static int macho_function_compare(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	if (x < y) return -1;
+	if (x > y) return 1;
+	return 0;
+}
+
+static int macho_functions_add(macho_functions_t_64* functions, uint64_t* capacity, uint64_t address) {
+	uint64_t size = 0;
+	uint64_t* starts = NULL;
+	if (functions->count == *capacity) {
+		size = *capacity ? *capacity * 2 : 1024;
+		starts = (uint64_t*) realloc(functions->starts, size * sizeof(uint64_t));
+		if (starts == NULL) {
+			return -1;
+		}
+		functions->starts = starts;
+		*capacity = size;
+	}
+	functions->starts[functions->count++] = address;
+	return 0;
+}
+
+// The first delta is from the start of the segment mapping the header,
+//   each following one from the previous function, and a zero ends the list
+static int macho_functions_load_starts(macho_functions_t_64* functions, macho_command_t_64* command,
+		uint64_t* capacity) {
+	int shift = 0;
+	uint64_t i = 0;
+	uint64_t delta = 0;
+	uint64_t address = 0;
+	const unsigned char* p = NULL;
+	const unsigned char* end = NULL;
+	macho_t_64* macho = functions->macho;
+	macho_segment_t_64* segment = NULL;
+	macho_linkedit_data_cmd_t_64* cmd = NULL;
+
+	cmd = (macho_linkedit_data_cmd_t_64*) macho_view_64(macho->data, macho->size, command->offset,
+			sizeof(macho_linkedit_data_cmd_t_64));
+	p = cmd ? (const unsigned char*) macho_view_64(macho->data, macho->size, cmd->dataoff, cmd->datasize) : NULL;
+	if (p == NULL) {
+		error("Function starts run past the end of the image\n");
+		return -1;
+	}
+	end = p + cmd->datasize;
+
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		if (segment && segment->command && segment->command->fileoff == 0 && segment->command->filesize) {
+			address = segment->command->vmaddr;
+			break;
+		}
+	}
+
+	while (p < end) {
+		delta = 0;
+		shift = 0;
+		while (p < end && shift < 64) {
+			delta |= (uint64_t) (*p & 0x7F) << shift;
+			shift += 7;
+			if ((*p++ & 0x80) == 0) {
+				break;
+			}
+		}
+		if (delta == 0) {
+			break;
+		}
+		address += delta;
+		if (macho_functions_add(functions, capacity, address) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Symbols are numbered by section ordinal, so the code sections are found
+//   by counting through every segment in load command order
+static int macho_functions_load_symbols(macho_functions_t_64* functions, uint64_t* capacity) {
+	int i = 0;
+	uint64_t j = 0;
+	uint64_t k = 0;
+	uint64_t ordinal = 0;
+	uint8_t code[256];
+	macho_t_64* macho = functions->macho;
+	macho_symtab_t_64* symtab = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+
+	memset(code, '\0', sizeof(code));
+	for (j = 0; j < macho->segment_count; j++) {
+		segment = macho->segments[j];
+		for (k = 0; segment && k < segment->section_count && ordinal < 255; k++) {
+			ordinal++;
+			info = segment->sections[k]->info;
+			if (info && (info->flags & (MACHO_SECTION_ATTR_PURE_INSTRUCTIONS | MACHO_SECTION_ATTR_SOME_INSTRUCTIONS))) {
+				code[ordinal] = 1;
+			}
+		}
+	}
+
+	for (i = 0; i < macho->symtab_count; i++) {
+		symtab = macho->symtabs[i];
+		for (j = 0; j < symtab->nsyms; j++) {
+			if ((symtab->types[j] & (MACHO_N_STAB | MACHO_N_TYPE)) != MACHO_N_SECT || !code[symtab->sects[j]]) {
+				continue;
+			}
+			if (macho_functions_add(functions, capacity, symtab->values[j]) < 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * Mach-O Function Start Functions
+ */
+macho_functions_t_64* macho_functions_create_64() {
+	macho_functions_t_64* functions = (macho_functions_t_64*) malloc(sizeof(macho_functions_t_64));
+	if (functions) {
+		memset(functions, '\0', sizeof(macho_functions_t_64));
+	}
+	return functions;
+}
+
+macho_functions_t_64* macho_functions_load_64(macho_t_64* macho) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t capacity = 0;
+	macho_command_t_64* command = NULL;
+	macho_functions_t_64* functions = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	functions = macho_functions_create_64();
+	if (functions == NULL) {
+		error("Unable to create function starts\n");
+		return NULL;
+	}
+	functions->macho = macho;
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd == MACHO_CMD_FUNCTION_STARTS) {
+			command = macho->commands[i];
+			break;
+		}
+	}
+	ret = command ? macho_functions_load_starts(functions, command, &capacity)
+			: macho_functions_load_symbols(functions, &capacity);
+	if (ret < 0) {
+		error("Unable to allocate function starts\n");
+		macho_functions_free_64(functions);
+		return NULL;
+	}
+
+	// Function starts come sorted already, symbols need sorting and can
+	//   alias the same address
+	if (functions->count > 1) {
+		qsort(functions->starts, functions->count, sizeof(uint64_t), macho_function_compare);
+		for (i = 1, j = 1; i < functions->count; i++) {
+			if (functions->starts[i] != functions->starts[j - 1]) {
+				functions->starts[j++] = functions->starts[i];
+			}
+		}
+		functions->count = j;
+	}
+	debug("Found %" PRIu64 " function starts from %s\n", functions->count, command ? "LC_FUNCTION_STARTS" : "symbols");
+	return functions;
+}
+
+// Index of the last function starting at or below address
+uint64_t macho_functions_find_64(macho_functions_t_64* functions, uint64_t address) {
+	uint64_t low = 0;
+	uint64_t high = 0;
+	uint64_t middle = 0;
+
+	if (functions == NULL) {
+		return MACHO_FUNCTION_NONE;
+	}
+	high = functions->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (functions->starts[middle] <= address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low ? low - 1 : MACHO_FUNCTION_NONE;
+}
+
+void macho_functions_debug_64(macho_functions_t_64* functions) {
+	uint64_t i = 0;
+	if (functions) {
+		debug("\tFunction Starts:\n");
+		debug("\t\tcount: 0x%" PRIx64 "\n", functions->count);
+		for (i = 0; i < functions->count; i++) {
+			debug("\t\t0x%016" PRIx64 "\n", functions->starts[i]);
+		}
+	}
+}
+
+void macho_functions_free_64(macho_functions_t_64* functions) {
+	if (functions) {
+		if (functions->starts) {
+			free(functions->starts);
+			functions->starts = NULL;
+		}
+		free(functions);
+	}
+}
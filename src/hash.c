@@ -0,0 +1,117 @@
+/**
+ * libmacho-1.0 - hash.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/libcrippy.h>
+
+#include "hash.h"
+
+/*
+ * XXH64. Fast enough to hash whole sections at memory bandwidth, and its
+ *   output is stable across platforms so hashes can be compared between runs.
+ */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+static uint64_t macho_hash_read64(const unsigned char* p) {
+	uint64_t value = 0;
+	memcpy(&value, p, sizeof(value));
+	return le64toh(value);
+}
+
+static uint32_t macho_hash_read32(const unsigned char* p) {
+	uint32_t value = 0;
+	memcpy(&value, p, sizeof(value));
+	return le32toh(value);
+}
+
+static uint64_t macho_hash_round(uint64_t acc, uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = ROTL64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static uint64_t macho_hash_merge(uint64_t acc, uint64_t value) {
+	acc ^= macho_hash_round(0, value);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t macho_hash_mix_64(uint64_t value) {
+	value ^= value >> 33;
+	value *= PRIME64_2;
+	value ^= value >> 29;
+	value *= PRIME64_3;
+	value ^= value >> 32;
+	return value;
+}
+
+uint64_t macho_hash_64(const void* data, uint64_t size, uint64_t seed) {
+	uint64_t h = 0;
+	uint64_t v1, v2, v3, v4;
+	const unsigned char* p = (const unsigned char*) data;
+	const unsigned char* end = p + size;
+
+	if (size >= 32) {
+		v1 = seed + PRIME64_1 + PRIME64_2;
+		v2 = seed + PRIME64_2;
+		v3 = seed;
+		v4 = seed - PRIME64_1;
+		do {
+			v1 = macho_hash_round(v1, macho_hash_read64(p));
+			v2 = macho_hash_round(v2, macho_hash_read64(p + 8));
+			v3 = macho_hash_round(v3, macho_hash_read64(p + 16));
+			v4 = macho_hash_round(v4, macho_hash_read64(p + 24));
+			p += 32;
+		} while (p + 32 <= end);
+		h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+		h = macho_hash_merge(h, v1);
+		h = macho_hash_merge(h, v2);
+		h = macho_hash_merge(h, v3);
+		h = macho_hash_merge(h, v4);
+	} else {
+		h = seed + PRIME64_5;
+	}
+	h += size;
+
+	while (p + 8 <= end) {
+		h ^= macho_hash_round(0, macho_hash_read64(p));
+		h = ROTL64(h, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end) {
+		h ^= (uint64_t) macho_hash_read32(p) * PRIME64_1;
+		h = ROTL64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	while (p < end) {
+		h ^= (*p) * PRIME64_5;
+		h = ROTL64(h, 11) * PRIME64_1;
+		p++;
+	}
+	return macho_hash_mix_64(h);
+}
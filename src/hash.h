@@ -0,0 +1,33 @@
+/**
+ * libmacho-1.0 - hash.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_HASH_H_
+#define MACHO_HASH_H_
+
+#include <stdint.h>
+
+/*
+ * Internal Non-Cryptographic Hash Functions
+ */
+uint64_t macho_hash_64(const void* data, uint64_t size, uint64_t seed);
+uint64_t macho_hash_mix_64(uint64_t value);
+
+#endif /* MACHO_HASH_H_ */
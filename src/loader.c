@@ -0,0 +1,583 @@
+/**
+ * libmacho-1.0 - loader.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/loader.h>
+
+#include "pool.h"
+
+#define MACHO_LOADER_PROBE      0x1000		// bytes read first to tell a Mach-O from anything else
+#define MACHO_LOADER_IO_THREADS 0x20		// preads in flight without io_uring
+#define MACHO_LOADER_READ_MAX   0x40000000	// largest single read request
+
+typedef struct macho_loader_file_t_64 {
+	uint64_t index;
+	int fd;
+	int body;		/* reading past the probe */
+	uint64_t size;
+	uint64_t offset;	/* next byte to read */
+	uint64_t end;		/* end of the current stage */
+	int64_t result;		/* bytes read or -errno */
+	unsigned char* data;
+	struct macho_loader_file_t_64* next;
+} macho_loader_file_t_64;
+
+typedef struct macho_loader_queue_t_64 {
+	macho_loader_file_t_64* head;
+	macho_loader_file_t_64* tail;
+} macho_loader_queue_t_64;
+
+typedef struct macho_loader_t_64 {
+	int backend;
+	int stop;		/* a callback failed */
+	int finished;		/* nothing more will be queued */
+	uint32_t inflight;	/* files opened and not yet parsed or dropped */
+	uint64_t loaded;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;	/* a queue or the in-flight count changed */
+	macho_loader_queue_t_64 parses;
+	macho_loader_queue_t_64 reads;		/* pread backend only */
+	macho_loader_queue_t_64 completions;
+	macho_loader_func_t_64 func;
+	void* userdata;
+#ifdef HAVE_LINUX_IO_URING_H
+	int ring;
+	unsigned submit;	/* entries queued but not yet handed to the kernel */
+	void* sq_ring;
+	void* cq_ring;
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqes_size;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_sqe* sqes;
+	struct io_uring_cqe* cqes;
+#endif
+} macho_loader_t_64;
+
+static void macho_loader_push(macho_loader_queue_t_64* queue, macho_loader_file_t_64* file) {
+	file->next = NULL;
+	if (queue->tail) {
+		queue->tail->next = file;
+	} else {
+		queue->head = file;
+	}
+	queue->tail = file;
+}
+
+static macho_loader_file_t_64* macho_loader_pop(macho_loader_queue_t_64* queue) {
+	macho_loader_file_t_64* file = queue->head;
+	if (file) {
+		queue->head = file->next;
+		if (queue->head == NULL) {
+			queue->tail = NULL;
+		}
+	}
+	return file;
+}
+
+static void macho_loader_file_free(macho_loader_file_t_64* file) {
+	if (file) {
+		if (file->fd >= 0) {
+			close(file->fd);
+		}
+		free(file->data);
+		free(file);
+	}
+}
+
+// Gives up on a file before it reaches the parse stage
+static void macho_loader_drop(macho_loader_t_64* loader, macho_loader_file_t_64* file) {
+	macho_loader_file_free(file);
+	pthread_mutex_lock(&loader->lock);
+	loader->inflight--;
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+static macho_loader_file_t_64* macho_loader_open(const char* path, uint64_t index) {
+	struct stat st;
+	macho_loader_file_t_64* file = NULL;
+
+	file = (macho_loader_file_t_64*) malloc(sizeof(macho_loader_file_t_64));
+	if (file == NULL) {
+		return NULL;
+	}
+	memset(file, '\0', sizeof(macho_loader_file_t_64));
+	file->index = index;
+	file->fd = path ? open(path, O_RDONLY) : -1;
+	if (file->fd < 0 || fstat(file->fd, &st) < 0 || st.st_size < (off_t) sizeof(macho_header_t_64)) {
+		macho_loader_file_free(file);
+		return NULL;
+	}
+	file->size = st.st_size;
+	file->end = file->size < MACHO_LOADER_PROBE ? file->size : MACHO_LOADER_PROBE;
+	file->data = (unsigned char*) malloc(file->end);
+	if (file->data == NULL) {
+		macho_loader_file_free(file);
+		return NULL;
+	}
+	return file;
+}
+
+/*
+ * io_uring Backend
+ */
+#ifdef HAVE_LINUX_IO_URING_H
+static void macho_loader_uring_free(macho_loader_t_64* loader) {
+	if (loader->sqes && loader->sqes != MAP_FAILED) {
+		munmap(loader->sqes, loader->sqes_size);
+	}
+	if (loader->cq_ring && loader->cq_ring != MAP_FAILED && loader->cq_ring != loader->sq_ring) {
+		munmap(loader->cq_ring, loader->cq_size);
+	}
+	if (loader->sq_ring && loader->sq_ring != MAP_FAILED) {
+		munmap(loader->sq_ring, loader->sq_size);
+	}
+	if (loader->ring >= 0) {
+		close(loader->ring);
+	}
+	loader->ring = -1;
+	loader->sqes = NULL;
+	loader->sq_ring = NULL;
+	loader->cq_ring = NULL;
+}
+
+// Sets the rings up straight through the system calls, without liburing
+static int macho_loader_uring_init(macho_loader_t_64* loader, uint32_t entries) {
+	unsigned char* sq = NULL;
+	unsigned char* cq = NULL;
+	struct io_uring_params params;
+
+	memset(&params, '\0', sizeof(params));
+	loader->ring = (int) syscall(__NR_io_uring_setup, entries, &params);
+	if (loader->ring < 0) {
+		return -1;
+	}
+	// IORING_OP_READ arrived in the same release as this feature flag
+	if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+		macho_loader_uring_free(loader);
+		return -1;
+	}
+	loader->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	loader->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (loader->cq_size > loader->sq_size) {
+			loader->sq_size = loader->cq_size;
+		}
+		loader->cq_size = loader->sq_size;
+	}
+	loader->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	loader->sq_ring = mmap(NULL, loader->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			loader->ring, IORING_OFF_SQ_RING);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		loader->cq_ring = loader->sq_ring;
+	} else {
+		loader->cq_ring = mmap(NULL, loader->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				loader->ring, IORING_OFF_CQ_RING);
+	}
+	loader->sqes = (struct io_uring_sqe*) mmap(NULL, loader->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, loader->ring, IORING_OFF_SQES);
+	if (loader->sq_ring == MAP_FAILED || loader->cq_ring == MAP_FAILED || loader->sqes == MAP_FAILED) {
+		macho_loader_uring_free(loader);
+		return -1;
+	}
+
+	sq = (unsigned char*) loader->sq_ring;
+	cq = (unsigned char*) loader->cq_ring;
+	loader->sq_tail = (unsigned*) &sq[params.sq_off.tail];
+	loader->sq_mask = (unsigned*) &sq[params.sq_off.ring_mask];
+	loader->sq_array = (unsigned*) &sq[params.sq_off.array];
+	loader->cq_head = (unsigned*) &cq[params.cq_off.head];
+	loader->cq_tail = (unsigned*) &cq[params.cq_off.tail];
+	loader->cq_mask = (unsigned*) &cq[params.cq_off.ring_mask];
+	loader->cqes = (struct io_uring_cqe*) &cq[params.cq_off.cqes];
+	return 0;
+}
+#endif
+
+/*
+ * pread Backend
+ */
+static void* macho_loader_reader(void* userdata) {
+	ssize_t done = 0;
+	uint64_t length = 0;
+	macho_loader_file_t_64* file = NULL;
+	macho_loader_t_64* loader = (macho_loader_t_64*) userdata;
+
+	pthread_mutex_lock(&loader->lock);
+	while (1) {
+		while ((file = macho_loader_pop(&loader->reads)) == NULL && !loader->finished) {
+			pthread_cond_wait(&loader->changed, &loader->lock);
+		}
+		if (file == NULL) {
+			break;
+		}
+		pthread_mutex_unlock(&loader->lock);
+		length = file->end - file->offset;
+		if (length > MACHO_LOADER_READ_MAX) {
+			length = MACHO_LOADER_READ_MAX;
+		}
+		do {
+			done = pread(file->fd, &file->data[file->offset], length, file->offset);
+		} while (done < 0 && errno == EINTR);
+		file->result = done < 0 ? -errno : done;
+		pthread_mutex_lock(&loader->lock);
+		macho_loader_push(&loader->completions, file);
+		pthread_cond_broadcast(&loader->changed);
+	}
+	pthread_mutex_unlock(&loader->lock);
+	return NULL;
+}
+
+// Issues a read for the rest of the file's current stage
+static void macho_loader_submit(macho_loader_t_64* loader, macho_loader_file_t_64* file) {
+#ifdef HAVE_LINUX_IO_URING_H
+	unsigned tail = 0;
+	unsigned index = 0;
+	uint64_t length = 0;
+	struct io_uring_sqe* sqe = NULL;
+
+	if (loader->backend == MACHO_LOADER_URING) {
+		length = file->end - file->offset;
+		if (length > MACHO_LOADER_READ_MAX) {
+			length = MACHO_LOADER_READ_MAX;
+		}
+		// Reads in flight never outnumber the files in flight, the ring
+		//   always has room for the next one
+		tail = *loader->sq_tail;
+		index = tail & *loader->sq_mask;
+		sqe = &loader->sqes[index];
+		memset(sqe, '\0', sizeof(struct io_uring_sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = file->fd;
+		sqe->addr = (uint64_t) (uintptr_t) &file->data[file->offset];
+		sqe->len = (uint32_t) length;
+		sqe->off = file->offset;
+		sqe->user_data = (uint64_t) (uintptr_t) file;
+		loader->sq_array[index] = index;
+		__atomic_store_n(loader->sq_tail, tail + 1, __ATOMIC_RELEASE);
+		loader->submit++;
+		return;
+	}
+#endif
+	pthread_mutex_lock(&loader->lock);
+	macho_loader_push(&loader->reads, file);
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+// Waits for the next read to finish, NULL if the ring failed
+static macho_loader_file_t_64* macho_loader_complete(macho_loader_t_64* loader) {
+	macho_loader_file_t_64* file = NULL;
+#ifdef HAVE_LINUX_IO_URING_H
+	int ret = 0;
+	unsigned head = 0;
+	struct io_uring_cqe* cqe = NULL;
+
+	if (loader->backend == MACHO_LOADER_URING) {
+		while (1) {
+			head = *loader->cq_head;
+			if (head != __atomic_load_n(loader->cq_tail, __ATOMIC_ACQUIRE)) {
+				cqe = &loader->cqes[head & *loader->cq_mask];
+				file = (macho_loader_file_t_64*) (uintptr_t) cqe->user_data;
+				file->result = cqe->res;
+				__atomic_store_n(loader->cq_head, head + 1, __ATOMIC_RELEASE);
+				return file;
+			}
+			ret = (int) syscall(__NR_io_uring_enter, loader->ring, loader->submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+			if (ret < 0 && errno != EINTR) {
+				error("Unable to wait for reads: %s\n", strerror(errno));
+				return NULL;
+			}
+			if (ret > 0) {
+				loader->submit -= ret;
+			}
+		}
+	}
+#endif
+	pthread_mutex_lock(&loader->lock);
+	while ((file = macho_loader_pop(&loader->completions)) == NULL) {
+		pthread_cond_wait(&loader->changed, &loader->lock);
+	}
+	pthread_mutex_unlock(&loader->lock);
+	return file;
+}
+
+// Moves a file on after a read, returning one if another read was issued
+static int macho_loader_advance(macho_loader_t_64* loader, macho_loader_file_t_64* file) {
+	uint32_t magic = 0;
+
+	if (file->result == -EINTR || file->result == -EAGAIN) {
+		macho_loader_submit(loader, file);
+		return 1;
+	}
+	if (file->result <= 0) {
+		macho_loader_drop(loader, file);
+		return 0;
+	}
+	file->offset += file->result;
+	if (file->offset < file->end) {
+		macho_loader_submit(loader, file);
+		return 1;
+	}
+
+	// Files that are not thin 64-bit Mach-Os are dropped after the probe
+	if (!file->body) {
+		memcpy(&magic, file->data, sizeof(magic));
+		if (magic != MACHO_MAGIC_64 && magic != __builtin_bswap32(MACHO_MAGIC_64)) {
+			macho_loader_drop(loader, file);
+			return 0;
+		}
+		file->body = 1;
+		if (file->size > file->end) {
+			unsigned char* data = (unsigned char*) realloc(file->data, file->size);
+			if (data == NULL) {
+				macho_loader_drop(loader, file);
+				return 0;
+			}
+			file->data = data;
+			file->end = file->size;
+			macho_loader_submit(loader, file);
+			return 1;
+		}
+	}
+
+	close(file->fd);
+	file->fd = -1;
+	pthread_mutex_lock(&loader->lock);
+	macho_loader_push(&loader->parses, file);
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+	return 0;
+}
+
+// Parses files as their reads complete, while the next ones are in flight
+static void* macho_loader_parser(void* userdata) {
+	int stop = 0;
+	int failed = 0;
+	macho_t_64* macho = NULL;
+	macho_loader_file_t_64* file = NULL;
+	macho_loader_t_64* loader = (macho_loader_t_64*) userdata;
+
+	pthread_mutex_lock(&loader->lock);
+	while (1) {
+		while ((file = macho_loader_pop(&loader->parses)) == NULL && !loader->finished) {
+			pthread_cond_wait(&loader->changed, &loader->lock);
+		}
+		if (file == NULL) {
+			break;
+		}
+		stop = loader->stop;
+		pthread_mutex_unlock(&loader->lock);
+
+		failed = 0;
+		macho = stop ? NULL : macho_load_64(file->data, file->size);
+		if (macho) {
+			failed = loader->func(file->index, macho, loader->userdata) != 0;
+			macho_free_64(macho);
+		}
+		macho_loader_file_free(file);
+
+		pthread_mutex_lock(&loader->lock);
+		if (failed) {
+			loader->stop = 1;
+		}
+		if (macho) {
+			loader->loaded++;
+		}
+		loader->inflight--;
+		pthread_cond_broadcast(&loader->changed);
+	}
+	pthread_mutex_unlock(&loader->lock);
+	return NULL;
+}
+
+/*
+ * Mach-O Bulk Loader Functions
+ */
+int macho_loader_backend_64() {
+	char* env = getenv("LIBMACHO_LOADER");
+#ifdef HAVE_LINUX_IO_URING_H
+	macho_loader_t_64 probe;
+#endif
+
+	if (env && !strcmp(env, "threads")) {
+		return MACHO_LOADER_THREADS;
+	}
+#ifdef HAVE_LINUX_IO_URING_H
+	// Kernels without io_uring, or sandboxes that filter it, use the preads
+	memset(&probe, '\0', sizeof(probe));
+	probe.ring = -1;
+	if (macho_loader_uring_init(&probe, 1) == 0) {
+		macho_loader_uring_free(&probe);
+		return MACHO_LOADER_URING;
+	}
+#endif
+	return MACHO_LOADER_THREADS;
+}
+
+int macho_loader_run_64(const char* const* paths, uint64_t count, uint32_t depth,
+		macho_loader_func_t_64 func, void* userdata) {
+	int ret = 0;
+	int i = 0;
+	int parsers = 0;
+	int readers = 0;
+	int threads = 0;
+	uint32_t room = 0;
+	uint64_t next = 0;
+	uint64_t pending = 0;
+	pthread_t parser_threads[0x40];
+	pthread_t reader_threads[MACHO_LOADER_IO_THREADS];
+	macho_loader_file_t_64* file = NULL;
+	macho_loader_t_64 loader;
+
+	if (paths == NULL || func == NULL) {
+		return -1;
+	}
+	if (depth == 0) {
+		depth = MACHO_LOADER_DEPTH;
+	}
+
+	memset(&loader, '\0', sizeof(loader));
+	pthread_mutex_init(&loader.lock, NULL);
+	pthread_cond_init(&loader.changed, NULL);
+	loader.func = func;
+	loader.userdata = userdata;
+	loader.backend = macho_loader_backend_64();
+#ifdef HAVE_LINUX_IO_URING_H
+	loader.ring = -1;
+	if (loader.backend == MACHO_LOADER_URING && macho_loader_uring_init(&loader, depth) < 0) {
+		loader.backend = MACHO_LOADER_THREADS;
+	}
+#endif
+
+	threads = macho_pool_threads_64();
+	for (i = 0; i < threads && i < (int) (sizeof(parser_threads) / sizeof(pthread_t)); i++) {
+		if (pthread_create(&parser_threads[parsers], NULL, macho_loader_parser, &loader) != 0) {
+			break;
+		}
+		parsers++;
+	}
+	for (i = 0; loader.backend == MACHO_LOADER_THREADS && i < MACHO_LOADER_IO_THREADS && (uint32_t) i < depth; i++) {
+		if (pthread_create(&reader_threads[readers], NULL, macho_loader_reader, &loader) != 0) {
+			break;
+		}
+		readers++;
+	}
+	if (parsers == 0 || (loader.backend == MACHO_LOADER_THREADS && readers == 0)) {
+		error("Unable to start loader threads\n");
+		ret = -1;
+		goto done;
+	}
+	debug("Loading %" PRIu64 " files, %u in flight, with %s\n", count, depth,
+			loader.backend == MACHO_LOADER_URING ? "io_uring" : "preads");
+
+	while (1) {
+		// Files are started while there is room, once a callback fails only
+		//   the reads already issued are seen through
+		pthread_mutex_lock(&loader.lock);
+		while (pending == 0 && loader.inflight > 0 && (loader.inflight >= depth || next >= count || loader.stop)) {
+			pthread_cond_wait(&loader.changed, &loader.lock);
+		}
+		if (pending == 0 && loader.inflight == 0 && (next >= count || loader.stop)) {
+			pthread_mutex_unlock(&loader.lock);
+			break;
+		}
+		room = loader.stop ? 0 : depth - loader.inflight;
+		pthread_mutex_unlock(&loader.lock);
+
+		for (; room > 0 && next < count; next++) {
+			file = macho_loader_open(paths[next], next);
+			if (file == NULL) {
+				continue;
+			}
+			pthread_mutex_lock(&loader.lock);
+			loader.inflight++;
+			pthread_mutex_unlock(&loader.lock);
+			macho_loader_submit(&loader, file);
+			pending++;
+			room--;
+		}
+		if (pending == 0) {
+			continue;
+		}
+
+		file = macho_loader_complete(&loader);
+		if (file == NULL) {
+			// The buffers of reads still in the ring cannot be reclaimed
+			ret = -1;
+			pthread_mutex_lock(&loader.lock);
+			loader.stop = 1;
+			pthread_mutex_unlock(&loader.lock);
+			break;
+		}
+		pending--;
+		pending += macho_loader_advance(&loader, file);
+	}
+
+done:
+	pthread_mutex_lock(&loader.lock);
+	loader.finished = 1;
+	if (loader.stop) {
+		ret = -1;
+	}
+	pthread_cond_broadcast(&loader.changed);
+	pthread_mutex_unlock(&loader.lock);
+	for (i = 0; i < parsers; i++) {
+		pthread_join(parser_threads[i], NULL);
+	}
+	for (i = 0; i < readers; i++) {
+		pthread_join(reader_threads[i], NULL);
+	}
+	debug("Loaded %" PRIu64 " Mach-Os\n", loader.loaded);
+#ifdef HAVE_LINUX_IO_URING_H
+	macho_loader_uring_free(&loader);
+#endif
+	pthread_cond_destroy(&loader.changed);
+	pthread_mutex_destroy(&loader.lock);
+	return ret;
+}
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <inttypes.h>
 
 #define _DEBUG
 #include <libcrippy-1.0/debug.h>
@@ -30,6 +31,7 @@
 #include "libmacho-1.0/macho.h"
 #include "libmacho-1.0/symtab.h"
 #include "libmacho-1.0/section.h"
+#include "libmacho-1.0/swap.h"
 
 /*
  * Mach-O Functions
@@ -37,14 +39,12 @@
 macho_t_64* macho_create_64() {
 	macho_t_64* macho = (macho_t_64*) malloc(sizeof(macho_t_64));
 	if (macho) {
-		memset(macho, '\0', sizeof(macho));
+		memset(macho, '\0', sizeof(macho_t_64));
 	}
 	return macho;
 }
 //
 macho_t_64* macho_load_64(unsigned char* data, uint64_t size) {
-	int i = 0;
-	int err = 0;
 	macho_t_64* macho = NULL;
 
 	macho = macho_create_64();
@@ -54,38 +54,60 @@ macho_t_64* macho_load_64(unsigned char* data, uint64_t size) {
 		macho->size = size;
 		macho->symtab_count = 0;
 		macho->segment_count = 0;//
+		macho->swapped = 0;
+
+		// Images written for the other byte order are swapped once into a
+		//   private copy, so everything below only ever sees native fields
+		//   and the caller's buffer, possibly a read-only mapping, is never
+		//   written to.
+		if (macho_is_swapped_64(data, size)) {
+			debug("Swapping Mach-O byte order\n");
+			macho->data = (unsigned char*) malloc(size);
+			if (macho->data == NULL) {
+				error("Unable to allocate byte-swapped Mach-O copy\n");
+				macho_free_64(macho);
+				return NULL;
+			}
+			memcpy(macho->data, data, size);
+			macho->swapped = 1;
+			if (macho_swap_image_64(macho->data, size) < 0) {
+				error("Unable to swap Mach-O byte order\n");
+				macho_free_64(macho);
+				return NULL;
+			}
+		}
 
 		debug("Loading Mach-O header\n");
 		macho->header = macho_header_load_64(macho);
 		if (macho->header == NULL) {
 			error("Unable to load Mach-O header information\n");
-			macho_free(macho);
+			macho_free_64(macho);
 			return NULL;
 		}
 		macho->offset += sizeof(macho_header_t_64);
 
 		debug("Loading Mach-O commands\n");
 		macho->command_count = macho->header->ncmds;
-		macho->commands = macho_commands_load(macho);
+		macho->commands = macho_commands_load_64(macho);
 		if (macho->commands == NULL) {
 			error("Unable to parse Mach-O load commands\n");
-			macho_free(macho);
+			macho_free_64(macho);
 			return NULL;
 		}
 
 		debug("Loading Mach-O segments\n");
-		macho->segments = macho_segments_load(macho);
+		macho->segments = macho_segments_load_64(macho);
 		if (macho->segments == NULL) {
 			error("Unable to parse Mach-O segment commands\n");
-			macho_free(macho);
+			macho_free_64(macho);
 			return NULL;
 		}
 
 		debug("Loading Mach-O symtabs\n");
-		macho->symtabs = macho_symtabs_load(macho);
+		macho->symtabs = macho_symtabs_load_64(macho);
 		if (macho->symtabs == NULL) {
 			error("Unable to parse Mach-O symtab commands\n");
-			macho_free(macho);
+			macho_free_64(macho);
 			return NULL;
 		}
 	}
@@ -95,7 +117,7 @@ macho_t_64* macho_load_64(unsigned char* data, uint64_t size) {
 
 macho_t_64* macho_open_64(const char* path) {
 	int err = 0;
-	uint64_t size = 0;
+	unsigned int size = 0;
 	macho_t_64* macho = NULL;
 	unsigned char* data = NULL;
 
@@ -104,7 +126,6 @@ macho_t_64* macho_open_64(const char* path) {
 		err = file_read(path, &data, &size);
 		if (err < 0 || size == 0) {
 			error("Unable to read Mach-O file\n");
-			macho_free(macho);
 			return NULL;
 		}
 
@@ -120,16 +141,16 @@ macho_t_64* macho_open_64(const char* path) {
 
 uint64_t macho_lookup_64(macho_t_64* macho, const char* sym) {
 	int i = 0;
-	int j = 0;
-	nlist_64* nl = NULL;
+	uint64_t j = 0;
+	const char* name = NULL;
 	macho_symtab_t_64* symtab = NULL;
 	for (i = 0; i < macho->symtab_count; i++) {
 		symtab = macho->symtabs[i];
 		for (j = 0; j < symtab->nsyms; j++) {
-			nl = &symtab->symbols[j];
-			if (nl->n_un.n_name != NULL) {
-				if (strcmp(sym, nl->n_un.n_name) == 0) {
-					return nl->n_value;
+			name = macho_symtab_name_64(symtab, j);
+			if (name != NULL) {
+				if (strcmp(sym, name) == 0) {
+					return symtab->values[j];
 				}
 			}
 		}
@@ -171,21 +192,54 @@ macho_section_t_64* macho_get_section_64(macho_t_64* macho, const char* segment,
 	return NULL;
 }
 
+uint64_t macho_offset_to_address_64(macho_t_64* macho, uint64_t offset) {
+	int i = 0;
+	macho_segment_t_64* seg = NULL;
+	for (i = 0; i < macho->segment_count; i++) {
+		seg = macho->segments[i];
+		if (seg == NULL || seg->command == NULL) {
+			continue;
+		}
+		if ((offset >= seg->command->fileoff)
+				&& (offset < seg->command->fileoff + seg->command->filesize)) {
+			return (offset - seg->command->fileoff) + seg->address;
+		}
+	}
+	return 0;
+}
+
 void macho_list_symbols_64(macho_t_64* macho,
 		void (*print_func)(const char*, uint64_t, void*), void* userdata) {
-	int i = 0;
-	int j = 0;
-	nlist_64* nl = NULL;
-	macho_symtab_t_64* symtab = NULL;
-	for (i = 0; i < macho->symtab_count; i++) {
-		symtab = macho->symtabs[i];
-		for (j = 0; j < symtab->nsyms; j++) {
-			nl = &symtab->symbols[j];
-			if ((nl->n_un.n_name != NULL) && (nl->n_value != 0)) {
-				print_func(nl->n_un.n_name, nl->n_value, userdata);
-			}
+	uint64_t i = 0;
+	uint64_t count = 0;
+	macho_symbol_record_t_64 records[256];
+	macho_symbol_cursor_t_64 cursor = { 0, 0 };
+	macho_symbol_filter_t_64 filter = { 0, 0, 0, 0, MACHO_SYMBOL_FILTER_NAMED | MACHO_SYMBOL_FILTER_NONZERO };
+	while ((count = macho_symbols_next_64(macho, &cursor, &filter, records, 256)) > 0) {
+		for (i = 0; i < count; i++) {
+			print_func(records[i].name, records[i].value, userdata);
+		}
+	}
+}
+
+// Batch form of macho_list_symbols_64. Returns how many records were
+//   filled; zero means every symtab has been walked. A zeroed cursor
+//   starts from the beginning and is advanced on every call.
+uint64_t macho_symbols_next_64(macho_t_64* macho, macho_symbol_cursor_t_64* cursor,
+		const macho_symbol_filter_t_64* filter, macho_symbol_record_t_64* records, uint64_t max) {
+	uint64_t count = 0;
+	if (macho == NULL || cursor == NULL || records == NULL) {
+		return 0;
+	}
+	while (count < max && cursor->symtab < macho->symtab_count) {
+		count += macho_symtab_next_64(macho->symtabs[cursor->symtab], &cursor->index, filter,
+				&records[count], max - count);
+		if (cursor->index >= macho->symtabs[cursor->symtab]->nsyms) {
+			cursor->symtab++;
+			cursor->index = 0;
 		}
 	}
+	return count;
 }
 
 void macho_debug_64(macho_t_64* macho) {
@@ -203,10 +257,7 @@ void macho_debug_64(macho_t_64* macho) {
 
 void macho_free_64(macho_t_64* macho) {
 	if (macho) {
-		if (macho->header) {
-			macho_header_free_64(macho->header);
-			macho->header = NULL;
-		}
+		macho->header = NULL;
 		if (macho->commands) {
 			macho_commands_free_64(macho->commands);
 			macho->commands = NULL;
@@ -222,6 +273,9 @@ void macho_free_64(macho_t_64* macho) {
 		}
 
 		if (macho->data) {
+			if (macho->swapped) {
+				free(macho->data);
+			}
 			macho->size = 0;
 			macho->offset = 0;
 			macho->data = NULL;
@@ -234,30 +288,21 @@ void macho_free_64(macho_t_64* macho) {
 /*
  * Mach-O Header Functions
  */
-macho_header_t_64* macho_header_create_64() {
-	macho_header_t_64* header = (macho_header_t_64*) malloc(sizeof(macho_header_t_64));
-	if (header) {
-		memset(header, '\0', sizeof(macho_header_t_64));
-	}
-	return header;
-}
-//
 macho_header_t_64* macho_header_load_64(macho_t_64* macho) {
-	uint64_t size = 0;
-	uint64_t offset = 0;
-	unsigned char* data = NULL;
 	macho_header_t_64* header = NULL;
 	if (macho) {
-		offset = 0;
-		data = macho->data;
-		size = macho->size;
-		header = macho_header_create_64();
-		if (header) {
-			memcpy(header, &data[offset], sizeof(macho_header_t_64));
-			if (header->magic != MACHO_MAGIC_32) {
-				error("Unknown filetype\n");
-				return NULL;
-			}
+		header = (macho_header_t_64*) macho_view_64(macho->data, macho->size, 0, sizeof(macho_header_t_64));
+		if (header == NULL) {
+			error("Mach-O header is truncated\n");
+			return NULL;
+		}
+		if (header->magic != MACHO_MAGIC_64) {
+			error("Unknown filetype\n");
+			return NULL;
+		}
+		if (header->sizeofcmds > macho->size - sizeof(macho_header_t_64)) {
+			error("Mach-O load commands are truncated\n");
+			return NULL;
 		}
 	}
 	return header;
@@ -280,19 +325,13 @@ void macho_header_debug_64(macho_t_64* macho) {
 	}
 }
 
-void macho_header_free_64(macho_header_t_64* header) {
-	if (header) {
-		free(header);
-	}
-}
-//
 int macho_handle_command_64(macho_t_64* macho, macho_command_t_64* command) {
 	int ret = 0;
 	if (macho) {
 		// If load command is a segment command, then load a segment
 		//   if a symbol table, then load a symbol table... etc...
 		switch (command->info->cmd) {
-		case MACHO_CMD_SEGMENT:  // segment of this file to be mapped
+		case MACHO_CMD_SEGMENT_64:  // segment of this file to be mapped
 		{
 			debug("Found segment command\n");
 			macho_segment_t_64* seg = macho_segment_load_64(macho->data,
@@ -312,7 +351,7 @@ int macho_handle_command_64(macho_t_64* macho, macho_command_t_64* command) {
 		{
 			debug("Found symtab command\n");
 			macho_symtab_t_64* symtab = macho_symtab_load_64(
-					macho->data + command->offset, macho->data);
+					macho->data, command->offset);
 			if (symtab) {
 				macho->symtabs[macho->symtab_count++] = symtab;
 			} else {
@@ -344,7 +383,9 @@ macho_command_t_64** macho_commands_create_64(uint64_t count) {
 
 macho_command_t_64** macho_commands_load_64(macho_t_64* macho) {
 	int i = 0;
+	uint64_t end = 0;
 	uint64_t count = 0;
+	macho_command_info_t_64* info = NULL;
 	macho_command_t_64** commands = NULL;
 	if (macho) {
 		count = macho->command_count;
@@ -355,9 +396,20 @@ macho_command_t_64** macho_commands_load_64(macho_t_64* macho) {
 			return NULL;
 		}
 
+		// Every command has to lie inside sizeofcmds before it is viewed
+		end = sizeof(macho_header_t_64) + macho->header->sizeofcmds;
+
 		debug("Loading Mach-O commands array\n");
 		for (i = 0; i < count; i++) {
-			debug("Loading Mach-O command %d from offset 0x%x\n", i, macho->offset);
+			debug("Loading Mach-O command %d from offset 0x%" PRIx64 "\n", i, macho->offset);
+			info = (macho_command_info_t_64*) macho_view_64(macho->data, end, macho->offset,
+					sizeof(macho_command_info_t_64));
+			if (info == NULL || info->cmdsize < sizeof(macho_command_info_t_64)
+					|| info->cmdsize > end - macho->offset) {
+				error("Mach-O load command %d is out of bounds\n", i);
+				macho_commands_free_64(commands);
+				return NULL;
+			}
 			commands[i] = macho_command_load_64(macho->data, macho->offset);
 			if (commands[i] == NULL) {
 				error("Unable to parse Mach-O load command\n");
@@ -391,7 +443,7 @@ void macho_commands_free_64(macho_command_t_64** commands) {
 	int i = 0;
 	if (commands) {
 		while (commands[i] != NULL) {
-			macho_commands_free_64(commands[i]);
+			macho_command_free_64(commands[i]);
 			commands[i] = NULL;
 			i++;
 		}
@@ -424,10 +476,10 @@ macho_segment_t_64** macho_segments_load_64(macho_t_64* macho) {
 	if (macho) {
 		debug("Searching for segment commands\n");
 		for (i = 0; i < macho->command_count; i++) {
-			if (macho->commands[i]->cmd == MACHO_CMD_SEGMENT) {
+			if (macho->commands[i]->cmd == MACHO_CMD_SEGMENT_64) {
 				count++;
 			}
-		} debug("Found %d segment commands\n", count);
+		} debug("Found %" PRIu64 " segment commands\n", count);
 		macho->segment_count = count;
 
 
@@ -440,20 +492,42 @@ macho_segment_t_64** macho_segments_load_64(macho_t_64* macho) {
 
 		debug("Loading Mach-O segments\n");
 		for (i = 0; i < macho->command_count; i++) {
-			if (macho->commands[i]->cmd == MACHO_CMD_SEGMENT) {
+			if (macho->commands[i]->cmd == MACHO_CMD_SEGMENT_64) {
 				macho_command_t_64* command = macho->commands[i];
+				if (command->size < sizeof(macho_segment_cmd_t_64)) {
+					error("Mach-O segment command is truncated\n");
+					macho_segments_free_64(segments);
+					return NULL;
+				}
 				segment = macho_segment_load_64(macho->data, command->offset);
 				if(segment == NULL) {
 					error("Unable to load Mach-O segment\n");
+					macho_segments_free_64(segments);
 					return NULL;
 				}
 				debug("Loaded in segment %s\n", segment->name);
 				segments[j++] = segment;
 
-				macho_section_t_64* section = NULL;
-				macho_section_t_64** sections = NULL;
+				// Only the bytes the image actually has are reachable through data
+				if (segment->command->fileoff > macho->size) {
+					segment->data = NULL;
+					segment->size = 0;
+				} else if (segment->size > macho->size - segment->command->fileoff) {
+					segment->size = macho->size - segment->command->fileoff;
+				}
+
+				// The section headers have to fit inside the segment command
+				if (segment->section_count > (command->size - sizeof(macho_segment_cmd_t_64))
+						/ sizeof(macho_section_info_t_64)) {
+					error("Mach-O segment %s has too many sections\n", segment->name);
+					macho_segments_free_64(segments);
+					return NULL;
+				}
 				segment->sections = macho_sections_load_64(macho, segment);
-				offset = command->offset + sizeof(macho_segment_cmd_t);
+				if (segment->sections == NULL) {
+					macho_segments_free_64(segments);
+					return NULL;
+				}
 			}
 		}
 	}
@@ -507,17 +581,19 @@ macho_symtab_t_64** macho_symtabs_create_64(uint64_t count) {
 
 macho_symtab_t_64** macho_symtabs_load_64(macho_t_64* macho) {
 	int i = 0;
+	int j = 0;
 	uint64_t count = 0;
 	uint64_t offset = 0;
 	macho_symtab_t_64* symtab = NULL;
 	macho_symtab_t_64** symtabs = NULL;
+	macho_symtab_cmd_t_64* cmd = NULL;
 	if (macho) {
 		debug("Searching for symtab commands\n");
 		for (i = 0; i < macho->command_count; i++) {
 			if (macho->commands[i]->cmd == MACHO_CMD_SYMTAB) {
 				count++;
 			}
-		} debug("Found %d symtab commands\n", count);
+		} debug("Found %" PRIu64 " symtab commands\n", count);
 		macho->symtab_count = count;
 
 		debug("Creating Mach-O symtabs array\n");
@@ -531,12 +607,26 @@ macho_symtab_t_64** macho_symtabs_load_64(macho_t_64* macho) {
 		for (i = 0; i < macho->command_count; i++) {
 			if (macho->commands[i]->cmd == MACHO_CMD_SYMTAB) {
 				offset =  macho->commands[i]->offset;
+				if (macho->commands[i]->size < sizeof(macho_symtab_cmd_t_64)) {
+					error("Mach-O symtab command is truncated\n");
+					macho_symtabs_free_64(symtabs);
+					return NULL;
+				}
+				cmd = macho_symtab_cmd_view_64(macho->data, offset);
+				if (macho_view_64(macho->data, macho->size, cmd->symoff,
+						(uint64_t) cmd->nsyms * sizeof(nlist_64)) == NULL
+						|| macho_view_64(macho->data, macho->size, cmd->stroff, cmd->strsize) == NULL) {
+					error("Mach-O symtab is out of bounds\n");
+					macho_symtabs_free_64(symtabs);
+					return NULL;
+				}
 				symtab = macho_symtab_load_64(macho->data, offset);
 				if(symtab == NULL) {
 					error("Unable to load Mach-O symtab\n");
+					macho_symtabs_free_64(symtabs);
 					return NULL;
 				}
-				symtabs[i] = symtab;
+				symtabs[j++] = symtab;
 			}
 		}
 	}
@@ -592,6 +682,7 @@ macho_section_t_64** macho_sections_load_64(macho_t_64* macho, macho_segment_t_6
 	uint64_t offset = 0;
 	macho_section_t_64* section = NULL;
 	macho_section_t_64** sections = NULL;
+	macho_section_info_t_64* info = NULL;
 
 	if (macho && segment) {
 		debug("Creating section array for segment\n");
@@ -601,10 +692,20 @@ macho_section_t_64** macho_sections_load_64(macho_t_64* macho, macho_segment_t_6
 			return NULL;
 		}
 
-		offset = segment->offset + sizeof(macho_segment_cmd_t);
+		offset = segment->offset + sizeof(macho_segment_cmd_t_64);
 		for (i = 0; i < segment->section_count; i++) {
 			debug("Loading section %d\n", i);
 			sections[i] = macho_section_load_64(macho->data, offset);
+			if (sections[i] == NULL) {
+				error("Unable to load section %d\n", i);
+				macho_sections_free_64(sections);
+				return NULL;
+			}
+			info = sections[i]->info;
+			if (!macho_section_info_zerofill_64(info)) {
+				sections[i]->data = (unsigned char*) macho_view_64(macho->data, macho->size,
+						info->offset, info->size);
+			}
 			offset += sizeof(macho_section_info_t_64);
 		}
 	}
@@ -616,8 +717,12 @@ void macho_sections_debug_64(macho_section_t_64** sections) {
 }
 
 void macho_sections_free_64(macho_section_t_64** sections) {
-	// TODO: Loop through and free each item
+	int i = 0;
 	if (sections) {
+		while (sections[i]) {
+			macho_section_free_64(sections[i]);
+			i++;
+		}
 		free(sections);
 	}
 }
@@ -0,0 +1,272 @@
+/**
+ * libmacho-1.0 - map.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/map.h>
+
+/*
+ * Mach-O File Mapping Functions
+ */
+macho_map_t_64* macho_map_create_64() {
+	macho_map_t_64* map = (macho_map_t_64*) malloc(sizeof(macho_map_t_64));
+	if (map) {
+		memset(map, '\0', sizeof(macho_map_t_64));
+		map->fd = -1;
+	}
+	return map;
+}
+
+macho_map_t_64* macho_map_open_64(const char* path) {
+	struct stat st;
+	macho_map_t_64* map = NULL;
+
+	if (path == NULL) {
+		return NULL;
+	}
+
+	map = macho_map_create_64();
+	if (map == NULL) {
+		error("Unable to create file mapping\n");
+		return NULL;
+	}
+
+	map->path = strdup(path);
+	map->fd = open(path, O_RDONLY);
+	if (map->fd < 0) {
+		error("Unable to open %s\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+	if (fstat(map->fd, &st) < 0 || st.st_size == 0) {
+		error("Unable to stat %s\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+	map->size = st.st_size;
+
+	map->data = (unsigned char*) mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, map->fd, 0);
+	if (map->data == MAP_FAILED) {
+		error("Unable to map %s\n", path);
+		map->data = NULL;
+		macho_map_free_64(map);
+		return NULL;
+	}
+	debug("Mapped %s at %p (0x%" PRIx64 " bytes)\n", path, map->data, map->size);
+	return map;
+}
+
+macho_map_t_64* macho_map_open_huge_64(const char* path) {
+	ssize_t got = 0;
+	uint64_t done = 0;
+	uint64_t length = 0;
+	unsigned char* base = NULL;
+	unsigned char* data = NULL;
+	struct stat st;
+	macho_map_t_64* map = NULL;
+
+	if (path == NULL) {
+		return NULL;
+	}
+
+	map = macho_map_create_64();
+	if (map == NULL) {
+		error("Unable to create file mapping\n");
+		return NULL;
+	}
+
+	map->path = strdup(path);
+	map->fd = open(path, O_RDONLY);
+	if (map->fd < 0) {
+		error("Unable to open %s\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+	if (fstat(map->fd, &st) < 0 || st.st_size == 0) {
+		error("Unable to stat %s\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+	map->size = st.st_size;
+
+	// Transparent huge pages are generally only available to anonymous
+	//   memory, so the file is copied into a region aligned to a huge page
+	//   boundary instead of being mapped. The extra page of reservation is
+	//   trimmed back off once the aligned start is known.
+	length = (map->size + MACHO_MAP_HUGE_PAGE - 1) & ~((uint64_t) MACHO_MAP_HUGE_PAGE - 1);
+	base = (unsigned char*) mmap(NULL, length + MACHO_MAP_HUGE_PAGE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		error("Unable to reserve 0x%" PRIx64 " bytes for %s\n", length, path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+	data = (unsigned char*) (((uintptr_t) base + MACHO_MAP_HUGE_PAGE - 1) & ~((uintptr_t) MACHO_MAP_HUGE_PAGE - 1));
+	if (data > base) {
+		munmap(base, data - base);
+	}
+	if (data + length < base + length + MACHO_MAP_HUGE_PAGE) {
+		munmap(data + length, (base + length + MACHO_MAP_HUGE_PAGE) - (data + length));
+	}
+	map->data = data;
+	map->huge = 1;
+
+#ifdef MADV_HUGEPAGE
+	if (madvise(map->data, length, MADV_HUGEPAGE) < 0) {
+		debug("Huge pages unavailable for %s, using normal pages\n", path);
+	}
+#endif
+
+	while (done < map->size) {
+		got = pread(map->fd, map->data + done, map->size - done, done);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			error("Unable to read %s\n", path);
+			macho_map_free_64(map);
+			return NULL;
+		}
+		done += got;
+	}
+
+	// The copy is all that is needed from here on
+	close(map->fd);
+	map->fd = -1;
+	debug("Copied %s to huge pages at %p (0x%" PRIx64 " bytes)\n", path, map->data, map->size);
+	return map;
+}
+
+int macho_map_advise_64(macho_map_t_64* map, uint64_t offset, uint64_t size, int advice) {
+	long page = sysconf(_SC_PAGESIZE);
+	uint64_t start = 0;
+	uint64_t end = 0;
+	int madv = 0;
+	int fadv = 0;
+
+	if (map == NULL || map->data == NULL || offset >= map->size) {
+		return -1;
+	}
+
+	// A zero size covers the rest of the mapping, and the range is widened
+	//   out to whole pages as madvise requires
+	if (size == 0 || size > map->size - offset) {
+		size = map->size - offset;
+	}
+	start = offset & ~((uint64_t) page - 1);
+	end = offset + size;
+
+	switch (advice) {
+	case MACHO_MAP_NORMAL:
+		madv = MADV_NORMAL;
+		fadv = POSIX_FADV_NORMAL;
+		break;
+	case MACHO_MAP_SEQUENTIAL:
+		madv = MADV_SEQUENTIAL;
+		fadv = POSIX_FADV_SEQUENTIAL;
+		break;
+	case MACHO_MAP_RANDOM:
+		madv = MADV_RANDOM;
+		fadv = POSIX_FADV_RANDOM;
+		break;
+	case MACHO_MAP_WILLNEED:
+		madv = MADV_WILLNEED;
+		fadv = POSIX_FADV_WILLNEED;
+		break;
+	default:
+		error("Unknown access pattern %d\n", advice);
+		return -1;
+	}
+
+	// A huge page copy is already resident, so there is nothing to read
+	//   ahead or hold back
+	if (map->huge) {
+		return 0;
+	}
+
+	// Hints only ever tune paging, so a kernel that ignores one is no
+	//   reason to fail the caller
+	if (madvise(map->data + start, end - start, madv) < 0) {
+		debug("Unable to advise %s at 0x%" PRIx64 "\n", map->path, start);
+	}
+
+	// The page cache keeps its own read-ahead state per file; sequential
+	//   doubles its window and willneed starts reading the range right away
+	if (map->fd >= 0) {
+		posix_fadvise(map->fd, start, end - start, fadv);
+	}
+	return 0;
+}
+
+void macho_map_faults_64(macho_map_faults_t_64* faults) {
+	struct rusage usage;
+	if (faults) {
+		memset(faults, '\0', sizeof(macho_map_faults_t_64));
+		if (getrusage(RUSAGE_SELF, &usage) == 0) {
+			faults->minor = usage.ru_minflt;
+			faults->major = usage.ru_majflt;
+		}
+	}
+}
+
+void macho_map_debug_64(macho_map_t_64* map) {
+	if (map) {
+		debug("\tMapping:\n");
+		debug("\t\tpath: %s\n", map->path);
+		debug("\t\tdata: %p\n", map->data);
+		debug("\t\tsize: 0x%" PRIx64 "\n", map->size);
+		debug("\t\thuge: %d\n", map->huge);
+	}
+}
+
+void macho_map_free_64(macho_map_t_64* map) {
+	if (map) {
+		if (map->data && map->huge) {
+			munmap(map->data, (map->size + MACHO_MAP_HUGE_PAGE - 1) & ~((uint64_t) MACHO_MAP_HUGE_PAGE - 1));
+			map->data = NULL;
+		}
+		if (map->data) {
+			munmap(map->data, map->size);
+			map->data = NULL;
+		}
+		if (map->fd >= 0) {
+			close(map->fd);
+			map->fd = -1;
+		}
+		if (map->path) {
+			free(map->path);
+			map->path = NULL;
+		}
+		free(map);
+	}
+}
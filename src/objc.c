@@ -0,0 +1,370 @@
+/**
+ * libmacho-1.0 - objc.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/vm.h>
+#include <libmacho-1.0/objc.h>
+
+#define MACHO_OBJC_CLASS_PREFIX "_OBJC_CLASS_$_"
+
+// The ObjC sections move between __DATA, __DATA_CONST and __DATA_DIRTY
+//   depending on the linker, so only the section name is matched
+static macho_section_info_t_64* macho_objc_section(macho_t_64* macho, const char* name) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	macho_segment_t_64* segment = NULL;
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; segment && j < segment->section_count; j++) {
+			if (segment->sections[j]->info && !strncmp(segment->sections[j]->info->sectname, name,
+					sizeof(segment->sections[j]->info->sectname))) {
+				return segment->sections[j]->info;
+			}
+		}
+	}
+	return NULL;
+}
+
+static uint64_t macho_objc_class_ro(macho_objc_t_64* objc, uint64_t address) {
+	uint64_t data = macho_vm_pointer_64(objc->vm, address + offsetof(macho_objc_class_info_t_64, data), NULL);
+	return data & MACHO_OBJC_DATA_MASK;
+}
+
+// Name of the class a pointer slot refers to, whether it is defined in this
+//   image or bound to another one
+static const char* macho_objc_class_ref(macho_objc_t_64* objc, uint64_t slot) {
+	uint64_t ro = 0;
+	uint64_t address = 0;
+	const char* bind = NULL;
+
+	address = macho_vm_pointer_64(objc->vm, slot, &bind);
+	if (address == 0) {
+		if (bind && !strncmp(bind, MACHO_OBJC_CLASS_PREFIX, strlen(MACHO_OBJC_CLASS_PREFIX))) {
+			return bind + strlen(MACHO_OBJC_CLASS_PREFIX);
+		}
+		return bind;
+	}
+	ro = macho_objc_class_ro(objc, address);
+	if (ro == 0) {
+		return NULL;
+	}
+	return macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+			ro + offsetof(macho_objc_class_ro_t_64, name), NULL));
+}
+
+static int macho_objc_load_class(macho_objc_t_64* objc, uint64_t address, macho_objc_class_t_64* cls) {
+	uint64_t ro = 0;
+	uint64_t meta = 0;
+	macho_objc_class_ro_t_64* info = NULL;
+
+	ro = macho_objc_class_ro(objc, address);
+	info = (macho_objc_class_ro_t_64*) macho_vm_view_64(objc->vm, ro, sizeof(macho_objc_class_ro_t_64));
+	if (info == NULL) {
+		return -1;
+	}
+	memset(cls, '\0', sizeof(macho_objc_class_t_64));
+	cls->address = address;
+	cls->flags = info->flags;
+	cls->instance_size = info->instance_size;
+	cls->name = macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+			ro + offsetof(macho_objc_class_ro_t_64, name), NULL));
+	cls->superclass = macho_objc_class_ref(objc, address + offsetof(macho_objc_class_info_t_64, superclass));
+	cls->instance_methods.list = macho_vm_pointer_64(objc->vm,
+			ro + offsetof(macho_objc_class_ro_t_64, base_methods), NULL);
+
+	// Class methods live on the metaclass the isa points to
+	meta = macho_vm_pointer_64(objc->vm, address + offsetof(macho_objc_class_info_t_64, isa), NULL);
+	ro = meta ? macho_objc_class_ro(objc, meta) : 0;
+	if (ro) {
+		cls->class_methods.list = macho_vm_pointer_64(objc->vm,
+				ro + offsetof(macho_objc_class_ro_t_64, base_methods), NULL);
+	}
+	return cls->name ? 0 : -1;
+}
+
+static int macho_objc_load_category(macho_objc_t_64* objc, uint64_t address, macho_objc_category_t_64* category) {
+	if (macho_vm_view_64(objc->vm, address, sizeof(macho_objc_category_info_t_64)) == NULL) {
+		return -1;
+	}
+	memset(category, '\0', sizeof(macho_objc_category_t_64));
+	category->address = address;
+	category->name = macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+			address + offsetof(macho_objc_category_info_t_64, name), NULL));
+	category->cls = macho_objc_class_ref(objc, address + offsetof(macho_objc_category_info_t_64, cls));
+	category->instance_methods.list = macho_vm_pointer_64(objc->vm,
+			address + offsetof(macho_objc_category_info_t_64, instance_methods), NULL);
+	category->class_methods.list = macho_vm_pointer_64(objc->vm,
+			address + offsetof(macho_objc_category_info_t_64, class_methods), NULL);
+	return category->name ? 0 : -1;
+}
+
+static void macho_objc_methods_free(macho_objc_methods_t_64* methods) {
+	if (methods->methods) {
+		free(methods->methods);
+		methods->methods = NULL;
+	}
+}
+
+/*
+ * Mach-O Objective-C Metadata Functions
+ */
+macho_objc_t_64* macho_objc_create_64() {
+	macho_objc_t_64* objc = (macho_objc_t_64*) malloc(sizeof(macho_objc_t_64));
+	if (objc) {
+		memset(objc, '\0', sizeof(macho_objc_t_64));
+	}
+	return objc;
+}
+
+macho_objc_t_64* macho_objc_load_64(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t count = 0;
+	uint64_t address = 0;
+	const char* name = NULL;
+	macho_objc_t_64* objc = NULL;
+	macho_section_info_t_64* section = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	objc = macho_objc_create_64();
+	if (objc == NULL) {
+		error("Unable to create Objective-C metadata\n");
+		return NULL;
+	}
+	objc->macho = macho;
+	objc->vm = macho_vm_load_64(macho);
+	if (objc->vm == NULL) {
+		macho_objc_free_64(objc);
+		return NULL;
+	}
+
+	// A list entry that does not resolve is skipped rather than failing the
+	//   image, stripped or damaged binaries still have the rest worth seeing
+	section = macho_objc_section(macho, "__objc_classlist");
+	count = section ? section->size / sizeof(uint64_t) : 0;
+	if (count) {
+		objc->classes = (macho_objc_class_t_64*) malloc(count * sizeof(macho_objc_class_t_64));
+		if (objc->classes == NULL) {
+			error("Unable to allocate Objective-C classes\n");
+			macho_objc_free_64(objc);
+			return NULL;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		address = macho_vm_pointer_64(objc->vm, section->addr + i * sizeof(uint64_t), NULL);
+		if (address && macho_objc_load_class(objc, address, &objc->classes[objc->class_count]) == 0) {
+			objc->class_count++;
+		}
+	}
+
+	section = macho_objc_section(macho, "__objc_catlist");
+	count = section ? section->size / sizeof(uint64_t) : 0;
+	if (count) {
+		objc->categories = (macho_objc_category_t_64*) malloc(count * sizeof(macho_objc_category_t_64));
+		if (objc->categories == NULL) {
+			error("Unable to allocate Objective-C categories\n");
+			macho_objc_free_64(objc);
+			return NULL;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		address = macho_vm_pointer_64(objc->vm, section->addr + i * sizeof(uint64_t), NULL);
+		if (address && macho_objc_load_category(objc, address, &objc->categories[objc->category_count]) == 0) {
+			objc->category_count++;
+		}
+	}
+
+	// A protocol_t starts with its isa, the name follows
+	section = macho_objc_section(macho, "__objc_protolist");
+	count = section ? section->size / sizeof(uint64_t) : 0;
+	if (count) {
+		objc->protocols = (const char**) malloc(count * sizeof(const char*));
+		if (objc->protocols == NULL) {
+			error("Unable to allocate Objective-C protocols\n");
+			macho_objc_free_64(objc);
+			return NULL;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		address = macho_vm_pointer_64(objc->vm, section->addr + i * sizeof(uint64_t), NULL);
+		name = address ? macho_vm_string_64(objc->vm,
+				macho_vm_pointer_64(objc->vm, address + sizeof(uint64_t), NULL)) : NULL;
+		if (name) {
+			objc->protocols[objc->protocol_count++] = name;
+		}
+	}
+
+	section = macho_objc_section(macho, "__objc_selrefs");
+	if (section) {
+		objc->selrefs = section->addr;
+		objc->selref_count = section->size / sizeof(uint64_t);
+	}
+
+	debug("Objective-C metadata loaded %" PRIu64 " classes, %" PRIu64 " categories, %" PRIu64 " protocols, %" PRIu64 " selectors\n",
+			objc->class_count, objc->category_count, objc->protocol_count, objc->selref_count);
+	return objc;
+}
+
+macho_objc_class_t_64* macho_objc_find_class_64(macho_objc_t_64* objc, const char* name) {
+	uint64_t i = 0;
+	if (objc == NULL || name == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < objc->class_count; i++) {
+		if (!strcmp(objc->classes[i].name, name)) {
+			return &objc->classes[i];
+		}
+	}
+	return NULL;
+}
+
+// Decodes a method list the first time it is asked for. Relative lists hold
+//   32 bit offsets from each field, the selector one through a selector
+//   reference; pointer lists hold the addresses themselves.
+macho_objc_methods_t_64* macho_objc_methods_64(macho_objc_t_64* objc, macho_objc_methods_t_64* methods) {
+	uint32_t i = 0;
+	uint32_t entsize = 0;
+	uint64_t entry = 0;
+	macho_objc_method_t_64* method = NULL;
+	macho_objc_method_list_t_64* list = NULL;
+	macho_objc_relative_method_t_64* relative = NULL;
+
+	if (objc == NULL || methods == NULL) {
+		return NULL;
+	}
+	if (methods->loaded || methods->list == 0) {
+		methods->loaded = 1;
+		return methods;
+	}
+
+	list = (macho_objc_method_list_t_64*) macho_vm_view_64(objc->vm, methods->list, sizeof(macho_objc_method_list_t_64));
+	if (list == NULL) {
+		error("Method list at 0x%" PRIx64 " is not in the image\n", methods->list);
+		return NULL;
+	}
+	entsize = list->entsize_and_flags & MACHO_OBJC_METHOD_LIST_ENTSIZE;
+	if (entsize < ((list->entsize_and_flags & MACHO_OBJC_METHOD_LIST_RELATIVE)
+			? sizeof(macho_objc_relative_method_t_64) : sizeof(macho_objc_method_info_t_64))
+			|| macho_vm_view_64(objc->vm, methods->list + sizeof(macho_objc_method_list_t_64),
+					(uint64_t) entsize * list->count) == NULL) {
+		error("Method list at 0x%" PRIx64 " is malformed\n", methods->list);
+		return NULL;
+	}
+
+	if (list->count) {
+		methods->methods = (macho_objc_method_t_64*) malloc(list->count * sizeof(macho_objc_method_t_64));
+		if (methods->methods == NULL) {
+			error("Unable to allocate methods\n");
+			return NULL;
+		}
+	}
+	for (i = 0; i < list->count; i++) {
+		entry = methods->list + sizeof(macho_objc_method_list_t_64) + (uint64_t) i * entsize;
+		method = &methods->methods[i];
+		if (list->entsize_and_flags & MACHO_OBJC_METHOD_LIST_RELATIVE) {
+			relative = (macho_objc_relative_method_t_64*) macho_vm_view_64(objc->vm, entry,
+					sizeof(macho_objc_relative_method_t_64));
+			method->name = macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+					entry + offsetof(macho_objc_relative_method_t_64, name) + relative->name, NULL));
+			method->types = macho_vm_string_64(objc->vm,
+					entry + offsetof(macho_objc_relative_method_t_64, types) + relative->types);
+			method->imp = relative->imp ? entry + offsetof(macho_objc_relative_method_t_64, imp) + relative->imp : 0;
+		} else {
+			method->name = macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+					entry + offsetof(macho_objc_method_info_t_64, name), NULL));
+			method->types = macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm,
+					entry + offsetof(macho_objc_method_info_t_64, types), NULL));
+			method->imp = macho_vm_pointer_64(objc->vm, entry + offsetof(macho_objc_method_info_t_64, imp), NULL);
+		}
+	}
+	methods->count = list->count;
+	methods->loaded = 1;
+	return methods;
+}
+
+const char* macho_objc_selector_64(macho_objc_t_64* objc, uint64_t index) {
+	if (objc == NULL || index >= objc->selref_count) {
+		return NULL;
+	}
+	return macho_vm_string_64(objc->vm, macho_vm_pointer_64(objc->vm, objc->selrefs + index * sizeof(uint64_t), NULL));
+}
+
+void macho_objc_debug_64(macho_objc_t_64* objc) {
+	uint64_t i = 0;
+	if (objc) {
+		debug("\tObjective-C:\n");
+		debug("\t\tclasses: 0x%" PRIx64 "\n", objc->class_count);
+		for (i = 0; i < objc->class_count; i++) {
+			debug("\t\t0x%016" PRIx64 "\t%s : %s\n", objc->classes[i].address, objc->classes[i].name,
+					objc->classes[i].superclass ? objc->classes[i].superclass : "(root)");
+		}
+		debug("\t\tcategories: 0x%" PRIx64 "\n", objc->category_count);
+		for (i = 0; i < objc->category_count; i++) {
+			debug("\t\t0x%016" PRIx64 "\t%s (%s)\n", objc->categories[i].address,
+					objc->categories[i].cls ? objc->categories[i].cls : "?", objc->categories[i].name);
+		}
+		debug("\t\tprotocols: 0x%" PRIx64 "\n", objc->protocol_count);
+		debug("\t\tselectors: 0x%" PRIx64 "\n", objc->selref_count);
+	}
+}
+
+void macho_objc_free_64(macho_objc_t_64* objc) {
+	uint64_t i = 0;
+	if (objc) {
+		if (objc->classes) {
+			for (i = 0; i < objc->class_count; i++) {
+				macho_objc_methods_free(&objc->classes[i].instance_methods);
+				macho_objc_methods_free(&objc->classes[i].class_methods);
+			}
+			free(objc->classes);
+			objc->classes = NULL;
+		}
+		if (objc->categories) {
+			for (i = 0; i < objc->category_count; i++) {
+				macho_objc_methods_free(&objc->categories[i].instance_methods);
+				macho_objc_methods_free(&objc->categories[i].class_methods);
+			}
+			free(objc->categories);
+			objc->categories = NULL;
+		}
+		if (objc->protocols) {
+			free(objc->protocols);
+			objc->protocols = NULL;
+		}
+		if (objc->vm) {
+			macho_vm_free_64(objc->vm);
+			objc->vm = NULL;
+		}
+		free(objc);
+	}
+}
@@ -0,0 +1,149 @@
+/**
+ * libmacho-1.0 - pool.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libcrippy-1.0/debug.h>
+
+#include "pool.h"
+
+#define MACHO_POOL_MAX_THREADS 64
+
+typedef struct macho_pool_t_64 {
+	uint64_t next;
+	uint64_t count;
+	uint64_t batch;
+	uint64_t failed;
+	int stop;
+	void* userdata;
+	macho_pool_func_t_64 func;
+} macho_pool_t_64;
+
+int macho_pool_threads_64() {
+	char* env = NULL;
+	long threads = 0;
+
+	env = getenv("LIBMACHO_THREADS");
+	if (env) {
+		threads = strtol(env, NULL, 0);
+	}
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+	if (threads > MACHO_POOL_MAX_THREADS) {
+		threads = MACHO_POOL_MAX_THREADS;
+	}
+	return (int) threads;
+}
+
+static void macho_pool_fail_64(macho_pool_t_64* pool, uint64_t index) {
+	uint64_t failed = __atomic_load_n(&pool->failed, __ATOMIC_RELAXED);
+	while (index < failed) {
+		if (__atomic_compare_exchange_n(&pool->failed, &failed, index, 0,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+}
+
+static void* macho_pool_worker_64(void* arg) {
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint64_t start = 0;
+	macho_pool_t_64* pool = (macho_pool_t_64*) arg;
+
+	// Each worker claims the next batch of indices until the work runs out
+	//   or someone reports a failure.
+	while (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+		start = __atomic_fetch_add(&pool->next, pool->batch, __ATOMIC_RELAXED);
+		if (start >= pool->count) {
+			break;
+		}
+		end = start + pool->batch;
+		if (end > pool->count) {
+			end = pool->count;
+		}
+		for (i = start; i < end; i++) {
+			if (pool->func(i, pool->userdata) != 0) {
+				macho_pool_fail_64(pool, i);
+				return NULL;
+			}
+		}
+	}
+	return NULL;
+}
+
+int macho_pool_run_64(uint64_t count, uint64_t batch, macho_pool_func_t_64 func,
+		void* userdata, uint64_t* failed) {
+	int i = 0;
+	int threads = 0;
+	int started = 0;
+	macho_pool_t_64 pool;
+	pthread_t workers[MACHO_POOL_MAX_THREADS];
+
+	if (func == NULL) {
+		return -1;
+	}
+	if (batch == 0) {
+		batch = 1;
+	}
+
+	memset(&pool, '\0', sizeof(pool));
+	pool.count = count;
+	pool.batch = batch;
+	pool.failed = UINT64_MAX;
+	pool.func = func;
+	pool.userdata = userdata;
+
+	threads = macho_pool_threads_64();
+	if ((uint64_t) threads > (count + batch - 1) / batch) {
+		threads = (int) ((count + batch - 1) / batch);
+	}
+
+	// The calling thread does its share of the work too
+	for (i = 1; i < threads; i++) {
+		if (pthread_create(&workers[started], NULL, macho_pool_worker_64, &pool) != 0) {
+			debug("Unable to start pool worker, continuing with %d\n", started + 1);
+			break;
+		}
+		started++;
+	}
+	macho_pool_worker_64(&pool);
+	for (i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	if (pool.failed != UINT64_MAX) {
+		if (failed) {
+			*failed = pool.failed;
+		}
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * libmacho-1.0 - pool.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_POOL_H_
+#define MACHO_POOL_H_
+
+#include <stdint.h>
+
+/*
+ * Work callback: returns 0 to keep going, anything else stops the run.
+ *   Batches are claimed in index order and a claimed batch always runs until
+ *   it ends or fails, so the index reported is the lowest failing one.
+ */
+typedef int (*macho_pool_func_t_64)(uint64_t index, void* userdata);
+
+/*
+ * Internal Thread Pool Functions
+ */
+int macho_pool_threads_64();
+int macho_pool_run_64(uint64_t count, uint64_t batch, macho_pool_func_t_64 func,
+		void* userdata, uint64_t* failed);
+
+#endif /* MACHO_POOL_H_ */
@@ -0,0 +1,290 @@
+/**
+ * libmacho-1.0 - query.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MACHO_QUERY_X86 1
+#include <immintrin.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/query.h>
+
+// Predicates are evaluated 64 symbols at a time into one bit per symbol
+#define MACHO_QUERY_BLOCK 64
+
+typedef uint64_t (*macho_query_block_t_64)(macho_symtab_t_64* symtab, uint64_t start,
+		const macho_query_t_64* query);
+
+/*
+ * Generic implementation, also used for the tail of every symtab
+ */
+static uint64_t macho_query_range_generic(macho_symtab_t_64* symtab, uint64_t start, uint64_t count,
+		const macho_query_t_64* query) {
+	uint64_t i = 0;
+	uint64_t bits = 0;
+	uint64_t span = query->value_max - query->value_min;
+	uint8_t type_value = query->type_value & query->type_mask;
+	int keep = 0;
+
+	if ((query->fields & MACHO_QUERY_VALUE) && query->value_max <= query->value_min) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		keep = 1;
+		if (query->fields & MACHO_QUERY_TYPE) {
+			keep &= (symtab->types[start + i] & query->type_mask) == type_value;
+		}
+		if (query->fields & MACHO_QUERY_SECT) {
+			keep &= symtab->sects[start + i] == query->sect;
+		}
+		if (query->fields & MACHO_QUERY_ORDINAL) {
+			keep &= MACHO_LIBRARY_ORDINAL(symtab->descs[start + i]) == query->ordinal;
+		}
+		if (query->fields & MACHO_QUERY_VALUE) {
+			keep &= (symtab->values[start + i] - query->value_min) < span;
+		}
+		bits |= (uint64_t) keep << i;
+	}
+	return bits;
+}
+
+static uint64_t macho_query_block_generic(macho_symtab_t_64* symtab, uint64_t start,
+		const macho_query_t_64* query) {
+	return macho_query_range_generic(symtab, start, MACHO_QUERY_BLOCK, query);
+}
+
+#ifdef MACHO_QUERY_X86
+/*
+ * AVX2 compares, 32 types or sects, 16 descs or 4 values per instruction
+ */
+__attribute__((target("avx2")))
+static uint64_t macho_query_bytes_avx2(const uint8_t* column, uint8_t mask, uint8_t value) {
+	__m256i m = _mm256_set1_epi8((char) mask);
+	__m256i v = _mm256_set1_epi8((char) (value & mask));
+	__m256i lo = _mm256_loadu_si256((const __m256i*) column);
+	__m256i hi = _mm256_loadu_si256((const __m256i*) (column + 32));
+	uint32_t a = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, m), v));
+	uint32_t b = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(hi, m), v));
+	return (uint64_t) a | ((uint64_t) b << 32);
+}
+
+__attribute__((target("avx2")))
+static uint64_t macho_query_ordinals_avx2(const uint16_t* column, uint8_t ordinal) {
+	int i = 0;
+	uint64_t bits = 0;
+	__m256i o = _mm256_set1_epi16(ordinal);
+	for (i = 0; i < MACHO_QUERY_BLOCK; i += 32) {
+		__m256i a = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*) &column[i]), 8);
+		__m256i b = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*) &column[i + 16]), 8);
+		// packs works per 128 bit half, the permute puts the lanes back in order
+		__m256i packed = _mm256_packs_epi16(_mm256_cmpeq_epi16(a, o), _mm256_cmpeq_epi16(b, o));
+		packed = _mm256_permute4x64_epi64(packed, 0xD8);
+		bits |= (uint64_t) (uint32_t) _mm256_movemask_epi8(packed) << i;
+	}
+	return bits;
+}
+
+__attribute__((target("avx2")))
+static uint64_t macho_query_values_avx2(const uint64_t* column, uint64_t min, uint64_t max) {
+	int i = 0;
+	uint64_t bits = 0;
+	// Unsigned (value - min) < span, done as a signed compare with the
+	//   sign bits flipped since AVX2 only has pcmpgtq.
+	__m256i flip = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+	__m256i base = _mm256_set1_epi64x((long long) min);
+	__m256i span = _mm256_xor_si256(_mm256_set1_epi64x((long long) (max - min)), flip);
+	for (i = 0; i < MACHO_QUERY_BLOCK; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) &column[i]);
+		v = _mm256_xor_si256(_mm256_sub_epi64(v, base), flip);
+		bits |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(span, v))) << i;
+	}
+	return bits;
+}
+
+__attribute__((target("avx2")))
+static uint64_t macho_query_block_avx2(macho_symtab_t_64* symtab, uint64_t start,
+		const macho_query_t_64* query) {
+	uint64_t bits = ~0ULL;
+	const uint8_t* types = &symtab->types[start];
+	const uint8_t* sects = &symtab->sects[start];
+	const uint16_t* descs = &symtab->descs[start];
+	const uint64_t* values = &symtab->values[start];
+
+	if (query->fields & MACHO_QUERY_TYPE) {
+		bits &= macho_query_bytes_avx2(types, query->type_mask, query->type_value);
+	}
+	if ((query->fields & MACHO_QUERY_SECT) && bits) {
+		bits &= macho_query_bytes_avx2(sects, 0xFF, query->sect);
+	}
+	if ((query->fields & MACHO_QUERY_ORDINAL) && bits) {
+		bits &= macho_query_ordinals_avx2(descs, query->ordinal);
+	}
+	if ((query->fields & MACHO_QUERY_VALUE) && bits) {
+		if (query->value_max <= query->value_min) {
+			return 0;
+		}
+		bits &= macho_query_values_avx2(values, query->value_min, query->value_max);
+	}
+	return bits;
+}
+#endif /* MACHO_QUERY_X86 */
+
+/*
+ * Backend selection, done once per process
+ */
+static pthread_once_t macho_query_once = PTHREAD_ONCE_INIT;
+static const char* macho_query_backend = "generic";
+static macho_query_block_t_64 macho_query_block = macho_query_block_generic;
+
+static void macho_query_init_64() {
+	if (getenv("LIBMACHO_NO_QUERY_SIMD")) {
+		return;
+	}
+#ifdef MACHO_QUERY_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		macho_query_backend = "avx2";
+		macho_query_block = macho_query_block_avx2;
+	}
+#endif
+}
+
+const char* macho_query_backend_64() {
+	pthread_once(&macho_query_once, macho_query_init_64);
+	return macho_query_backend;
+}
+
+/*
+ * Mach-O Symbol Query Functions
+ */
+int macho_query_result_add_64(macho_query_result_t_64* result, uint64_t symtab, uint64_t index) {
+	uint64_t capacity = 0;
+	macho_query_match_t_64* matches = NULL;
+	if (result->count == result->capacity) {
+		capacity = result->capacity ? result->capacity * 2 : 256;
+		matches = (macho_query_match_t_64*) realloc(result->matches, capacity * sizeof(macho_query_match_t_64));
+		if (matches == NULL) {
+			return -1;
+		}
+		result->matches = matches;
+		result->capacity = capacity;
+	}
+	result->matches[result->count].symtab = symtab;
+	result->matches[result->count].index = index;
+	result->count++;
+	return 0;
+}
+
+static int macho_query_symtab_64(macho_query_result_t_64* result, macho_symtab_t_64* symtab,
+		uint64_t number, const macho_query_t_64* query) {
+	uint64_t start = 0;
+	uint64_t bits = 0;
+	uint64_t index = 0;
+	uint64_t length = 0;
+	const char* name = NULL;
+
+	if (query->prefix) {
+		length = strlen(query->prefix);
+	}
+	for (start = 0; start < symtab->nsyms; start += MACHO_QUERY_BLOCK) {
+		if (symtab->nsyms - start >= MACHO_QUERY_BLOCK) {
+			bits = macho_query_block(symtab, start, query);
+		} else {
+			bits = macho_query_range_generic(symtab, start, symtab->nsyms - start, query);
+		}
+		// Only the survivors of the column compares have their names read
+		while (bits) {
+			index = start + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			if (query->fields & MACHO_QUERY_PREFIX) {
+				name = macho_symtab_name_64(symtab, index);
+				if (name == NULL || strncmp(name, query->prefix, length) != 0) {
+					continue;
+				}
+			}
+			if (macho_query_result_add_64(result, number, index) < 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+macho_query_result_t_64* macho_query_symtabs_64(macho_symtab_t_64** symtabs, uint64_t count,
+		const macho_query_t_64* query) {
+	uint64_t i = 0;
+	macho_query_result_t_64* result = NULL;
+
+	if (symtabs == NULL || query == NULL) {
+		return NULL;
+	}
+	if ((query->fields & MACHO_QUERY_PREFIX) && query->prefix == NULL) {
+		error("Symbol query has no prefix\n");
+		return NULL;
+	}
+	pthread_once(&macho_query_once, macho_query_init_64);
+
+	result = (macho_query_result_t_64*) malloc(sizeof(macho_query_result_t_64));
+	if (result == NULL) {
+		error("Unable to allocate query result\n");
+		return NULL;
+	}
+	memset(result, '\0', sizeof(macho_query_result_t_64));
+
+	for (i = 0; i < count; i++) {
+		if (symtabs[i] == NULL || symtabs[i]->types == NULL) {
+			continue;
+		}
+		if (macho_query_symtab_64(result, symtabs[i], i, query) < 0) {
+			error("Unable to allocate query matches\n");
+			macho_query_result_free_64(result);
+			return NULL;
+		}
+	}
+	debug("Symbol query matched %" PRIu64 " symbols with the %s backend\n", result->count, macho_query_backend);
+	return result;
+}
+
+macho_query_result_t_64* macho_query_symbols_64(macho_t_64* macho, const macho_query_t_64* query) {
+	if (macho == NULL) {
+		return NULL;
+	}
+	return macho_query_symtabs_64(macho->symtabs, macho->symtab_count, query);
+}
+
+void macho_query_result_free_64(macho_query_result_t_64* result) {
+	if (result) {
+		if (result->matches) {
+			free(result->matches);
+			result->matches = NULL;
+		}
+		free(result);
+	}
+}
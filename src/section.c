@@ -21,94 +21,92 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 
 #define _DEBUG
 #include <libcrippy-1.0/debug.h>
 #include <libcrippy-1.0/libcrippy.h>
 
+#include <libmacho-1.0/macho.h>
 #include <libmacho-1.0/section.h>
 
 /*
- * Mach-O Segment Functions
+ * Mach-O Section Functions
  */
-macho_section_t* macho_section_create() {
-	macho_section_t* section = (macho_section_t*) malloc(sizeof(macho_section_t));
+macho_section_t_64* macho_section_create_64() {
+	macho_section_t_64* section = (macho_section_t_64*) malloc(sizeof(macho_section_t_64));
 	if(section) {
-		memset(section, '\0', sizeof(macho_section_t));
+		memset(section, '\0', sizeof(macho_section_t_64));
 	}
 	return section;
 }
 
-macho_section_t* macho_section_load(unsigned char* data, uint32_t offset) {
-	macho_section_t* section = NULL;
+macho_section_t_64* macho_section_load_64(unsigned char* data, uint64_t offset) {
+	macho_section_t_64* section = NULL;
 	if(data) {
 		debug("Creating Mach-O Section\n");
-		section = macho_section_create();
+		section = macho_section_create_64();
 		if(section) {
 			debug("Loading Mach-O Section\n");
-			section->info = macho_section_info_load(data, offset);
-			if(section->info) {
-				section->name = strdup(section->info->sectname);
-				debug("Section %s Loaded\n", section->name);
-			}
+			section->info = macho_section_info_view_64(data, offset);
+			section->name = strndup(section->info->sectname, sizeof(section->info->sectname));
+			debug("Section %s Loaded\n", section->name);
 		}
 	}
 	return section;
 }
 
-void macho_section_debug(macho_section_t* section) {
+void macho_section_debug_64(macho_section_t_64* section) {
 	if(section && section->info) {
-		macho_section_info_debug(section->info);
+		macho_section_info_debug_64(section->info);
 	}
 
 }
 
-void macho_section_free(macho_section_t* section) {
-
-}
-
-/*
- * Mach-O Segment Info Functions
- */
-macho_section_info_t* macho_section_info_create() {
-	macho_section_info_t* info = malloc(sizeof(macho_section_info_t));
-	if(info) {
-		memset(info, '\0', sizeof(macho_section_info_t));
+void macho_section_free_64(macho_section_t_64* section) {
+	if(section) {
+		if(section->name) {
+			free(section->name);
+		}
+		free(section);
 	}
-	return info;
 }
 
-macho_section_info_t* macho_section_info_load(unsigned char* data, uint32_t offset) {
-	macho_section_info_t* info = macho_section_info_create();
-	if(info) {
-		memcpy(info, &data[offset], sizeof(macho_section_info_t));
-		//macho_section_info_debug(info);
+// Symbols name their section by its ordinal across all segments, starting
+//   at 1. Each ordinal gets the end address of its section, or 0 when the
+//   section has no header.
+void macho_section_ends_64(macho_t_64* macho, uint64_t ends[MACHO_SECTION_ORDINAL_MAX + 1]) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t ordinal = 0;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+
+	memset(ends, '\0', (MACHO_SECTION_ORDINAL_MAX + 1) * sizeof(uint64_t));
+	for (i = 0; macho && i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; segment && j < segment->section_count && ordinal < MACHO_SECTION_ORDINAL_MAX; j++) {
+			info = segment->sections[j]->info;
+			ordinal++;
+			if (info) {
+				ends[ordinal] = info->addr + info->size;
+			}
+		}
 	}
-	return info;
 }
 
-void macho_section_info_debug(macho_section_info_t* info) {
+/*
+ * Mach-O Section Info Functions
+ */
+void macho_section_info_debug_64(macho_section_info_t_64* info) {
 	debug("\t\tSection:\n");
-	debug("\t\t\tSectName: %s\n", info->sectname);
-  	//char		sectname[16];	/* name of this section */
-	debug("\t\t\tSegName: %s\n", info->segname);
-	//char		segname[16];	/* segment this section goes in */
-	debug("\t\t\tAddress: 0x%x\n", info->addr);
-	//uint32_t	addr;		/* memory address of this section */
-	debug("\t\t\tSize: 0x%x\n", info->size);
-	//uint32_t	size;		/* size in bytes of this section */
+	debug("\t\t\tSectName: %.16s\n", info->sectname);
+	debug("\t\t\tSegName: %.16s\n", info->segname);
+	debug("\t\t\tAddress: 0x%016" PRIx64 "\n", info->addr);
+	debug("\t\t\tSize: 0x%" PRIx64 "\n", info->size);
 	debug("\t\t\tOffset: 0x%x\n", info->offset);
-	//uint32_t	offset;		/* file offset of this section */
 	debug("\t\t\tAlign: 0x%x\n", info->align);
-	//uint32_t	align;		/* section alignment (power of 2) */
 	debug("\t\t\tRelOff: 0x%x\n", info->reloff);
-	//uint32_t	reloff;		/* file offset of relocation entries */
 	debug("\t\t\tnreloc: 0x%x\n", info->nreloc);
-	//uint32_t	nreloc;		/* number of relocation entries */
 	debug("\t\t\tflags: 0x%x\n\n", info->flags);
-	//uint32_t	flags;		/* flags (section type and attributes)*/
-}
-
-void macho_section_info_free(macho_section_info_t* info) {
-
 }
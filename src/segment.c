@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 
 #define _DEBUG
 #include <libcrippy-1.0/debug.h>
@@ -31,24 +32,19 @@
 /*
  * Mach-O Segment Functions
  */
-macho_segment_t* macho_segment_create() {
-	macho_segment_t* segment = (macho_segment_t*) malloc(sizeof(macho_segment_t));
+macho_segment_t_64* macho_segment_create_64() {
+	macho_segment_t_64* segment = (macho_segment_t_64*) malloc(sizeof(macho_segment_t_64));
 	if(segment) {
-		memset(segment, '\0', sizeof(macho_segment_t));
+		memset(segment, '\0', sizeof(macho_segment_t_64));
 	}
 	return segment;
 }
 
-macho_segment_t* macho_segment_load(unsigned char* data, uint64_t offset) {
-	unsigned char* address = NULL;
-	macho_segment_t* segment = macho_segment_create();
+macho_segment_t_64* macho_segment_load_64(unsigned char* data, uint64_t offset) {
+	macho_segment_t_64* segment = macho_segment_create_64();
 	if (segment) {
-		segment->command = macho_segment_cmd_load(data, offset);
-		if (!segment->command) {
-			macho_segment_free(segment);
-			return NULL;
-		}
-		segment->name = strdup(segment->command->segname);
+		segment->command = macho_segment_cmd_view_64(data, offset);
+		segment->name = strndup(segment->command->segname, sizeof(segment->command->segname));
 		segment->size = segment->command->filesize;
 		segment->offset = offset;
 		segment->address = segment->command->vmaddr;
@@ -58,34 +54,38 @@ macho_segment_t* macho_segment_load(unsigned char* data, uint64_t offset) {
 	return segment;
 }
 
-macho_section_t* macho_segment_get_section(macho_segment_t* segment, const char* section) {
+macho_section_t_64* macho_segment_get_section_64(macho_segment_t_64* segment, const char* section) {
 	int i = 0;
 	for(i = 0; i < segment->section_count; i++) {
-		macho_section_t* sect = segment->sections[i];
-		if(strcmp(sect->name, section) == 0) {
+		macho_section_t_64* sect = segment->sections[i];
+		if(sect && strcmp(sect->name, section) == 0) {
 			return sect;
 		}
 	}
 	return NULL;
 }
 
-void macho_segment_debug(macho_segment_t* segment) {
+void macho_segment_debug_64(macho_segment_t_64* segment) {
 	if(segment) {
 		debug("\tSegment:\n");
 		debug("\t\t   name: %s\n", segment->name);
-		debug("\t\t   size: 0x%x\n", segment->size);
-		debug("\t\t offset: 0x%x\n", segment->offset);
-		debug("\t\taddress: 0x%08x\n", segment->address);
+		debug("\t\t   size: 0x%" PRIx64 "\n", segment->size);
+		debug("\t\t offset: 0x%" PRIx64 "\n", segment->offset);
+		debug("\t\taddress: 0x%016" PRIx64 "\n", segment->address);
 		if(segment->command) {
-			macho_segment_cmd_debug(segment->command);
+			macho_segment_cmd_debug_64(segment->command);
 		}
 	}
 }
 
-void macho_segment_free(macho_segment_t* segment) {
+void macho_segment_free_64(macho_segment_t_64* segment) {
+	int i = 0;
 	if (segment) {
-		if (segment->command) {
-			macho_segment_cmd_free(segment->command);
+		if (segment->sections) {
+			for (i = 0; i < segment->section_count; i++) {
+				macho_section_free_64(segment->sections[i]);
+			}
+			free(segment->sections);
 		}
 		if (segment->name) {
 			free(segment->name);
@@ -95,36 +95,19 @@ void macho_segment_free(macho_segment_t* segment) {
 }
 
 /*
- * Mach-O Segment Info Functions
+ * Mach-O Segment Command Functions
  */
-macho_segment_cmd_t* macho_segment_cmd_create() {
-	macho_segment_cmd_t* info = malloc(sizeof(macho_segment_cmd_t));
-	if (info) {
-		memset(info, '\0', sizeof(macho_segment_cmd_t));
-	}
-	return info;
-}
-
-macho_segment_cmd_t* macho_segment_cmd_load(unsigned char* data, uint64_t offset) {
-	macho_segment_cmd_t* cmd = macho_segment_cmd_create();
-	if (cmd) {
-		memcpy(cmd, data+offset, sizeof(macho_segment_cmd_t));
-		//macho_segment_cmd_debug(cmd);
-	}
-	return cmd;
-}
-
-void macho_segment_cmd_debug(macho_segment_cmd_t* cmd) {
+void macho_segment_cmd_debug_64(macho_segment_cmd_t_64* cmd) {
 
 	if(cmd) {
 		debug("\tSegment Command:\n");
 		debug("\t\t     cmd = 0x%x\n", cmd->cmd);
 		debug("\t\t cmdsize = 0x%x\n", cmd->cmdsize);
-		debug("\t\t segname = %s\n", cmd->segname);
-		debug("\t\t  vmaddr = 0x%08x\n", cmd->vmaddr);
-		debug("\t\t  vmsize = 0x%x\n", cmd->vmsize);
-		debug("\t\t fileoff = 0x%x\n", cmd->fileoff);
-		debug("\t\tfilesize = 0x%x\n", cmd->filesize);
+		debug("\t\t segname = %.16s\n", cmd->segname);
+		debug("\t\t  vmaddr = 0x%016" PRIx64 "\n", cmd->vmaddr);
+		debug("\t\t  vmsize = 0x%" PRIx64 "\n", cmd->vmsize);
+		debug("\t\t fileoff = 0x%" PRIx64 "\n", cmd->fileoff);
+		debug("\t\tfilesize = 0x%" PRIx64 "\n", cmd->filesize);
 		debug("\t\t maxprot = 0x%08x\n", cmd->maxprot);
 		debug("\t\tinitprot = 0x%08x\n", cmd->initprot);
 		debug("\t\t  nsects = 0x%x\n", cmd->nsects);
@@ -132,8 +115,3 @@ void macho_segment_cmd_debug(macho_segment_cmd_t* cmd) {
 	}
 
 }
-void macho_segment_cmd_free(macho_segment_cmd_t* cmd) {
-	if (cmd) {
-		free(cmd);
-	}
-}
@@ -0,0 +1,818 @@
+/**
+ * libmacho-1.0 - server.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/query.h>
+#include <libmacho-1.0/find.h>
+#include <libmacho-1.0/trigram.h>
+#include <libmacho-1.0/symbolicate.h>
+#include <libmacho-1.0/server.h>
+
+#define MACHO_SERVER_CLIENTS_MAX 0x100	// connections served at once, more are refused
+#define MACHO_SERVER_POLL_MS     500	// how often idle loops look for a stop request
+#define MACHO_SERVER_IO_TIMEOUT  2	// seconds a client may stall partway through a message
+#define MACHO_SERVER_SYMBOL_COST 0x20	// parsed bytes charged per symbol besides the mapping
+
+#ifdef MSG_NOSIGNAL
+#define MACHO_SERVER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define MACHO_SERVER_SEND_FLAGS 0
+#endif
+
+typedef struct macho_server_client_t_64 {
+	int fd;
+	macho_server_t_64* server;
+} macho_server_client_t_64;
+
+// Response records, capped so the payload stays under MACHO_SERVER_PAYLOAD_MAX
+typedef struct macho_server_buffer_t_64 {
+	unsigned char* data;
+	uint64_t size;
+	uint64_t capacity;
+	uint32_t count;
+	int truncated;
+} macho_server_buffer_t_64;
+
+static int macho_server_buffer_add(macho_server_buffer_t_64* buffer, const void* record, uint64_t record_size,
+		const char* name, uint64_t name_size) {
+	uint64_t capacity = 0;
+	unsigned char* data = NULL;
+	if (buffer->size + record_size + name_size > MACHO_SERVER_PAYLOAD_MAX) {
+		buffer->truncated = 1;
+		return 0;
+	}
+	if (buffer->size + record_size + name_size > buffer->capacity) {
+		capacity = buffer->capacity ? buffer->capacity * 2 : 0x1000;
+		while (capacity < buffer->size + record_size + name_size) {
+			capacity *= 2;
+		}
+		data = (unsigned char*) realloc(buffer->data, capacity);
+		if (data == NULL) {
+			return -1;
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	memcpy(&buffer->data[buffer->size], record, record_size);
+	if (name_size) {
+		memcpy(&buffer->data[buffer->size + record_size], name, name_size);
+	}
+	buffer->size += record_size + name_size;
+	buffer->count++;
+	return 0;
+}
+
+static int macho_server_read(int fd, void* data, uint64_t size) {
+	ssize_t done = 0;
+	unsigned char* bytes = (unsigned char*) data;
+	while (size > 0) {
+		done = read(fd, bytes, size);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			return -1;
+		}
+		bytes += done;
+		size -= done;
+	}
+	return 0;
+}
+
+static int macho_server_write(int fd, const void* data, uint64_t size) {
+	ssize_t done = 0;
+	const unsigned char* bytes = (const unsigned char*) data;
+	while (size > 0) {
+		done = send(fd, bytes, size, MACHO_SERVER_SEND_FLAGS);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			return -1;
+		}
+		bytes += done;
+		size -= done;
+	}
+	return 0;
+}
+
+/*
+ * Image Cache
+ */
+static void macho_server_image_free(macho_server_image_t_64* image) {
+	if (image) {
+		macho_trigram_index_free_64(image->trigrams);
+		macho_name_index_free_64(image->names);
+		macho_symbolicator_free_64(image->symbolicator);
+		if (image->macho) {
+			macho_free_64(image->macho);
+		}
+		macho_map_free_64(image->map);
+		pthread_mutex_destroy(&image->lock);
+		free(image->path);
+		free(image);
+	}
+}
+
+// Called with the server lock held
+static void macho_server_unlink(macho_server_t_64* server, macho_server_image_t_64* image) {
+	if (image->prev) {
+		image->prev->next = image->next;
+	} else {
+		server->head = image->next;
+	}
+	if (image->next) {
+		image->next->prev = image->prev;
+	} else {
+		server->tail = image->prev;
+	}
+	image->prev = NULL;
+	image->next = NULL;
+	image->cached = 0;
+	server->used -= image->cost;
+	server->count--;
+}
+
+// Called with the server lock held
+static void macho_server_push(macho_server_t_64* server, macho_server_image_t_64* image) {
+	image->prev = NULL;
+	image->next = server->head;
+	if (server->head) {
+		server->head->prev = image;
+	}
+	server->head = image;
+	if (server->tail == NULL) {
+		server->tail = image;
+	}
+	image->cached = 1;
+	server->used += image->cost;
+	server->count++;
+}
+
+// Drops least recently used images until the cache fits its budget again;
+//   images a client is still using stay, they are freed on release instead.
+//   Called with the server lock held.
+static void macho_server_evict(macho_server_t_64* server) {
+	macho_server_image_t_64* image = server->tail;
+	macho_server_image_t_64* prev = NULL;
+	while (image && server->used > server->limit) {
+		prev = image->prev;
+		if (image->references == 0) {
+			debug("Evicting %s\n", image->path);
+			macho_server_unlink(server, image);
+			macho_server_image_free(image);
+		}
+		image = prev;
+	}
+}
+
+static void macho_server_charge(macho_server_t_64* server, macho_server_image_t_64* image, uint64_t cost) {
+	pthread_mutex_lock(&server->lock);
+	image->cost += cost;
+	if (image->cached) {
+		server->used += cost;
+		// An image grown past the whole budget is freed on release
+		if (image->cost > server->limit) {
+			debug("Evicting %s\n", image->path);
+			macho_server_unlink(server, image);
+		}
+		macho_server_evict(server);
+	}
+	pthread_mutex_unlock(&server->lock);
+}
+
+static void macho_server_release(macho_server_t_64* server, macho_server_image_t_64* image) {
+	int unused = 0;
+	pthread_mutex_lock(&server->lock);
+	image->references--;
+	unused = image->references == 0 && !image->cached;
+	pthread_mutex_unlock(&server->lock);
+	if (unused) {
+		macho_server_image_free(image);
+	}
+}
+
+static macho_server_image_t_64* macho_server_find(macho_server_t_64* server, const char* path) {
+	macho_server_image_t_64* image = NULL;
+	for (image = server->head; image; image = image->next) {
+		if (!strcmp(image->path, path)) {
+			return image;
+		}
+	}
+	return NULL;
+}
+
+// The cached image for path, parsed on a miss and reparsed if the file
+//   changed since; the caller releases it when done
+static macho_server_image_t_64* macho_server_acquire(macho_server_t_64* server, const char* path) {
+	uint64_t i = 0;
+	uint64_t nsyms = 0;
+	struct stat st;
+	macho_map_faults_t_64 before;
+	macho_map_faults_t_64 after;
+	macho_server_image_t_64* image = NULL;
+	macho_server_image_t_64* stale = NULL;
+	macho_server_image_t_64* loaded = NULL;
+
+	if (stat(path, &st) < 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&server->lock);
+	image = macho_server_find(server, path);
+	if (image && image->inode == (uint64_t) st.st_ino && image->mtime == (uint64_t) st.st_mtime
+			&& image->size == (uint64_t) st.st_size) {
+		macho_server_unlink(server, image);
+		macho_server_push(server, image);
+		image->references++;
+		pthread_mutex_unlock(&server->lock);
+		return image;
+	}
+	if (image) {
+		macho_server_unlink(server, image);
+		if (image->references == 0) {
+			stale = image;
+		}
+	}
+	pthread_mutex_unlock(&server->lock);
+	macho_server_image_free(stale);
+
+	// Parsed outside the lock so one large image does not hold up the rest
+	loaded = (macho_server_image_t_64*) malloc(sizeof(macho_server_image_t_64));
+	if (loaded == NULL) {
+		return NULL;
+	}
+	memset(loaded, '\0', sizeof(macho_server_image_t_64));
+	pthread_mutex_init(&loaded->lock, NULL);
+	loaded->path = strdup(path);
+	loaded->inode = st.st_ino;
+	loaded->mtime = st.st_mtime;
+	loaded->size = st.st_size;
+	macho_map_faults_64(&before);
+	loaded->map = server->huge ? macho_map_open_huge_64(path) : macho_map_open_64(path);
+	if (loaded->path == NULL || loaded->map == NULL
+			|| (loaded->macho = macho_load_64(loaded->map->data, loaded->map->size)) == NULL) {
+		macho_server_image_free(loaded);
+		return NULL;
+	}
+	macho_map_faults_64(&after);
+	debug("Loaded %s with %" PRIu64 " minor and %" PRIu64 " major faults\n", path,
+			after.minor - before.minor, after.major - before.major);
+
+	// Requests probe the image through indexes from here on
+	macho_map_advise_64(loaded->map, 0, 0, MACHO_MAP_RANDOM);
+	for (i = 0; i < loaded->macho->symtab_count; i++) {
+		nsyms += loaded->macho->symtabs[i]->nsyms;
+	}
+	loaded->cost = loaded->map->size + nsyms * MACHO_SERVER_SYMBOL_COST;
+
+	// Another client may have parsed the same image meanwhile
+	pthread_mutex_lock(&server->lock);
+	image = macho_server_find(server, path);
+	if (image && image->inode == loaded->inode && image->mtime == loaded->mtime && image->size == loaded->size) {
+		image->references++;
+		pthread_mutex_unlock(&server->lock);
+		macho_server_image_free(loaded);
+		return image;
+	}
+	loaded->references = 1;
+	// An image larger than the whole budget serves this request uncached
+	if (loaded->cost <= server->limit) {
+		macho_server_push(server, loaded);
+		macho_server_evict(server);
+	}
+	debug("Cached %s, %" PRIu64 " images in %" PRIu64 " bytes\n", path, server->count, server->used);
+	pthread_mutex_unlock(&server->lock);
+	return loaded;
+}
+
+// Every index build walks all the names, so the string tables are read in
+//   up front rather than one random fault at a time
+static void macho_server_prefetch(macho_server_image_t_64* image) {
+	uint64_t i = 0;
+	macho_symtab_t_64* symtab = NULL;
+	for (i = 0; i < image->macho->symtab_count; i++) {
+		symtab = image->macho->symtabs[i];
+		if (symtab->cmd) {
+			macho_map_advise_64(image->map, symtab->cmd->stroff, symtab->cmd->strsize, MACHO_MAP_WILLNEED);
+		}
+	}
+}
+
+// Builds the index an op needs the first time the image is asked for it
+static int macho_server_prepare(macho_server_t_64* server, macho_server_image_t_64* image, uint32_t op) {
+	int ret = 0;
+	uint64_t cost = 0;
+
+	pthread_mutex_lock(&image->lock);
+	if ((op == MACHO_SERVER_LOOKUP && image->names == NULL)
+			|| (op == MACHO_SERVER_SYMBOLICATE && image->symbolicator == NULL)
+			|| (op == MACHO_SERVER_SEARCH && image->trigrams == NULL)) {
+		macho_server_prefetch(image);
+	}
+	switch (op) {
+	case MACHO_SERVER_LOOKUP:
+		if (image->names == NULL) {
+			image->names = macho_name_index_load_64(image->macho);
+			cost = image->names ? image->names->count * sizeof(macho_name_entry_t_64) : 0;
+		}
+		ret = image->names ? 0 : -1;
+		break;
+	case MACHO_SERVER_SYMBOLICATE:
+		if (image->symbolicator == NULL) {
+			image->symbolicator = macho_symbolicator_load_64(image->macho);
+			cost = image->symbolicator ? image->symbolicator->count * sizeof(macho_symbolicator_entry_t_64) : 0;
+		}
+		ret = image->symbolicator ? 0 : -1;
+		break;
+	case MACHO_SERVER_SEARCH:
+		if (image->trigrams == NULL) {
+			image->trigrams = macho_trigram_index_load_64(image->macho);
+			cost = image->trigrams ? image->trigrams->size + image->trigrams->term_count * sizeof(macho_trigram_term_t_64) : 0;
+		}
+		ret = image->trigrams ? 0 : -1;
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&image->lock);
+	if (cost) {
+		macho_server_charge(server, image, cost);
+	}
+	return ret;
+}
+
+/*
+ * Request Handlers
+ */
+static int macho_server_add_symbol(macho_server_buffer_t_64* buffer, macho_symtab_t_64* symtab, uint64_t symbol_index,
+		const char* name) {
+	macho_server_symbol_t_64 symbol;
+	symbol.value = symtab->values[symbol_index];
+	symbol.type = symtab->types[symbol_index];
+	symbol.sect = symtab->sects[symbol_index];
+	symbol.desc = symtab->descs[symbol_index];
+	symbol.name_size = (uint32_t) strlen(name);
+	return macho_server_buffer_add(buffer, &symbol, sizeof(symbol), name, symbol.name_size);
+}
+
+static int macho_server_symbols(macho_server_image_t_64* image, macho_query_result_t_64* result,
+		const char* exact, macho_server_buffer_t_64* buffer) {
+	uint64_t i = 0;
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+
+	if (result == NULL) {
+		return MACHO_SERVER_FAILED;
+	}
+	for (i = 0; i < result->count && !buffer->truncated; i++) {
+		symtab = image->macho->symtabs[result->matches[i].symtab];
+		name = macho_symtab_name_64(symtab, result->matches[i].index);
+		if (name == NULL || (exact && strcmp(name, exact))) {
+			continue;
+		}
+		if (macho_server_add_symbol(buffer, symtab, result->matches[i].index, name) < 0) {
+			macho_query_result_free_64(result);
+			return MACHO_SERVER_FAILED;
+		}
+	}
+	macho_query_result_free_64(result);
+	return buffer->count ? MACHO_SERVER_OK : MACHO_SERVER_NOT_FOUND;
+}
+
+static int macho_server_symbolicate(macho_server_image_t_64* image, const unsigned char* payload, uint32_t size,
+		macho_server_buffer_t_64* buffer) {
+	int ret = MACHO_SERVER_OK;
+	uint64_t i = 0;
+	uint64_t count = size / sizeof(uint64_t);
+	uint64_t* addresses = NULL;
+	macho_server_frame_t_64 frame;
+	macho_symbolication_t_64* results = NULL;
+
+	if (size % sizeof(uint64_t)) {
+		return MACHO_SERVER_BAD_REQUEST;
+	}
+	addresses = (uint64_t*) malloc((count ? count : 1) * sizeof(uint64_t));
+	results = (macho_symbolication_t_64*) malloc((count ? count : 1) * sizeof(macho_symbolication_t_64));
+	if (addresses == NULL || results == NULL) {
+		ret = MACHO_SERVER_FAILED;
+		goto done;
+	}
+	memcpy(addresses, payload, size);
+	if (macho_symbolicator_resolve_64(image->symbolicator, addresses, count, results) < 0) {
+		ret = MACHO_SERVER_FAILED;
+		goto done;
+	}
+	for (i = 0; i < count && !buffer->truncated; i++) {
+		frame.address = results[i].address;
+		frame.offset = results[i].offset;
+		frame.name_size = results[i].name ? (uint32_t) strlen(results[i].name) : 0;
+		if (macho_server_buffer_add(buffer, &frame, sizeof(frame), results[i].name, frame.name_size) < 0) {
+			ret = MACHO_SERVER_FAILED;
+			goto done;
+		}
+	}
+
+done:
+	free(addresses);
+	free(results);
+	return ret;
+}
+
+static int macho_server_section(macho_server_image_t_64* image, const char* payload, uint32_t size,
+		macho_server_buffer_t_64* buffer) {
+	const char* segment = payload;
+	const char* name = NULL;
+	macho_section_t_64* section = NULL;
+	macho_server_section_t_64 record;
+
+	// The payload is terminated on receipt, so only the split needs checking
+	name = segment + strlen(segment) + 1;
+	if (name >= payload + size) {
+		return MACHO_SERVER_BAD_REQUEST;
+	}
+	section = macho_get_section_64(image->macho, segment, name);
+	if (section == NULL || section->info == NULL) {
+		return MACHO_SERVER_NOT_FOUND;
+	}
+	record.addr = section->info->addr;
+	record.size = section->info->size;
+	record.offset = section->info->offset;
+	record.flags = section->info->flags;
+	return macho_server_buffer_add(buffer, &record, sizeof(record), NULL, 0) < 0 ? MACHO_SERVER_FAILED : MACHO_SERVER_OK;
+}
+
+static int macho_server_handle(macho_server_t_64* server, uint32_t op, const char* path, const unsigned char* payload,
+		uint32_t size, macho_server_buffer_t_64* buffer) {
+	int ret = MACHO_SERVER_OK;
+	const char* text = (const char*) payload;
+	macho_server_image_t_64* image = NULL;
+
+	if (op < MACHO_SERVER_LOOKUP || op > MACHO_SERVER_SEARCH) {
+		return MACHO_SERVER_BAD_REQUEST;
+	}
+	image = macho_server_acquire(server, path);
+	if (image == NULL) {
+		return MACHO_SERVER_NO_IMAGE;
+	}
+	if (macho_server_prepare(server, image, op) < 0) {
+		macho_server_release(server, image);
+		return MACHO_SERVER_FAILED;
+	}
+	switch (op) {
+	case MACHO_SERVER_LOOKUP:
+		ret = macho_server_symbols(image, macho_find_symbols_64(image->names, text, MACHO_FIND_PREFIX), text, buffer);
+		break;
+	case MACHO_SERVER_SYMBOLICATE:
+		ret = macho_server_symbolicate(image, payload, size, buffer);
+		break;
+	case MACHO_SERVER_SECTION:
+		ret = macho_server_section(image, text, size, buffer);
+		break;
+	case MACHO_SERVER_SEARCH:
+		ret = macho_server_symbols(image, macho_trigram_search_64(image->trigrams, text), NULL, buffer);
+		break;
+	}
+	macho_server_release(server, image);
+	if (ret == MACHO_SERVER_OK && buffer->truncated) {
+		ret = MACHO_SERVER_TRUNCATED;
+	}
+	return ret;
+}
+
+// Waits for the next request, giving up when the server is stopping
+static int macho_server_wait(macho_server_t_64* server, int fd) {
+	int ready = 0;
+	struct pollfd poller;
+	while (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) {
+		poller.fd = fd;
+		poller.events = POLLIN;
+		poller.revents = 0;
+		ready = poll(&poller, 1, MACHO_SERVER_POLL_MS);
+		if (ready < 0 && errno != EINTR) {
+			return -1;
+		}
+		if (ready > 0) {
+			return 0;
+		}
+	}
+	return -1;
+}
+
+// Serves one connection, which may send any number of requests in turn
+static void* macho_server_client(void* userdata) {
+	char* path = NULL;
+	unsigned char* payload = NULL;
+	macho_server_request_t_64 request;
+	macho_server_response_t_64 response;
+	macho_server_buffer_t_64 buffer;
+	macho_server_client_t_64* client = (macho_server_client_t_64*) userdata;
+	macho_server_t_64* server = client->server;
+
+	path = (char*) malloc(MACHO_SERVER_PATH_MAX + 1);
+	while (path && macho_server_wait(server, client->fd) == 0) {
+		if (macho_server_read(client->fd, &request, sizeof(request)) < 0) {
+			break;
+		}
+		memset(&buffer, '\0', sizeof(buffer));
+		memset(&response, '\0', sizeof(response));
+		response.magic = MACHO_SERVER_MAGIC;
+		if (request.magic != MACHO_SERVER_MAGIC || request.path_size == 0 || request.path_size > MACHO_SERVER_PATH_MAX
+				|| request.payload_size > MACHO_SERVER_PAYLOAD_MAX) {
+			// The stream cannot be resynchronized after a bad header
+			response.status = MACHO_SERVER_BAD_REQUEST;
+			macho_server_write(client->fd, &response, sizeof(response));
+			break;
+		}
+		free(payload);
+		payload = (unsigned char*) malloc(request.payload_size + 1);
+		if (payload == NULL || macho_server_read(client->fd, path, request.path_size) < 0
+				|| macho_server_read(client->fd, payload, request.payload_size) < 0) {
+			break;
+		}
+		path[request.path_size] = '\0';
+		payload[request.payload_size] = '\0';
+
+		response.status = macho_server_handle(server, request.op, path, payload, request.payload_size, &buffer);
+		if (response.status == MACHO_SERVER_OK || response.status == MACHO_SERVER_TRUNCATED) {
+			response.count = buffer.count;
+			response.payload_size = (uint32_t) buffer.size;
+		}
+		if (macho_server_write(client->fd, &response, sizeof(response)) < 0
+				|| (response.payload_size && macho_server_write(client->fd, buffer.data, response.payload_size) < 0)) {
+			free(buffer.data);
+			break;
+		}
+		free(buffer.data);
+	}
+
+	close(client->fd);
+	free(payload);
+	free(path);
+	free(client);
+	pthread_mutex_lock(&server->lock);
+	server->clients--;
+	pthread_cond_broadcast(&server->idle);
+	pthread_mutex_unlock(&server->lock);
+	return NULL;
+}
+
+/*
+ * Mach-O Query Server Functions
+ */
+macho_server_t_64* macho_server_create_64() {
+	macho_server_t_64* server = (macho_server_t_64*) malloc(sizeof(macho_server_t_64));
+	if (server) {
+		memset(server, '\0', sizeof(macho_server_t_64));
+		server->fd = -1;
+		pthread_mutex_init(&server->lock, NULL);
+		pthread_cond_init(&server->idle, NULL);
+	}
+	return server;
+}
+
+macho_server_t_64* macho_server_open_64(const char* path, uint64_t limit) {
+	int fd = -1;
+	struct stat st;
+	struct sockaddr_un address;
+	macho_server_t_64* server = NULL;
+
+	if (path == NULL || strlen(path) >= sizeof(address.sun_path)) {
+		return NULL;
+	}
+
+	server = macho_server_create_64();
+	if (server == NULL) {
+		error("Unable to create query server\n");
+		return NULL;
+	}
+	server->limit = limit;
+
+	memset(&address, '\0', sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	// A socket nobody answers on is left over from a server that died
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		fd = macho_server_connect_64(path);
+		if (fd >= 0) {
+			close(fd);
+			error("A query server is already listening on %s\n", path);
+			macho_server_free_64(server);
+			return NULL;
+		}
+		unlink(path);
+	}
+
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->fd < 0 || bind(server->fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+		error("Unable to bind %s: %s\n", path, strerror(errno));
+		macho_server_free_64(server);
+		return NULL;
+	}
+	server->path = strdup(path);
+	if (server->path == NULL || listen(server->fd, 0x40) < 0) {
+		error("Unable to listen on %s: %s\n", path, strerror(errno));
+		macho_server_free_64(server);
+		return NULL;
+	}
+	return server;
+}
+
+int macho_server_run_64(macho_server_t_64* server, volatile int* stop) {
+	int fd = -1;
+	int ready = 0;
+	pthread_t thread;
+	pthread_attr_t attributes;
+	struct pollfd poller;
+	struct timeval timeout;
+	macho_server_client_t_64* client = NULL;
+
+	if (server == NULL || server->fd < 0 || stop == NULL) {
+		return -1;
+	}
+	pthread_attr_init(&attributes);
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+	debug("Serving queries on %s with a %" PRIu64 " byte cache\n", server->path, server->limit);
+
+	while (!*stop) {
+		poller.fd = server->fd;
+		poller.events = POLLIN;
+		poller.revents = 0;
+		ready = poll(&poller, 1, MACHO_SERVER_POLL_MS);
+		if (ready <= 0) {
+			continue;
+		}
+		fd = accept(server->fd, NULL, NULL);
+		if (fd < 0) {
+			continue;
+		}
+		// Only the wait between requests is unbounded, a read or write that
+		//   stalls mid message drops the client instead of holding up a stop
+		timeout.tv_sec = MACHO_SERVER_IO_TIMEOUT;
+		timeout.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		client = (macho_server_client_t_64*) malloc(sizeof(macho_server_client_t_64));
+		pthread_mutex_lock(&server->lock);
+		if (client == NULL || server->clients >= MACHO_SERVER_CLIENTS_MAX) {
+			pthread_mutex_unlock(&server->lock);
+			debug("Refusing query client, %d connected\n", server->clients);
+			free(client);
+			close(fd);
+			continue;
+		}
+		server->clients++;
+		pthread_mutex_unlock(&server->lock);
+		client->fd = fd;
+		client->server = server;
+		if (pthread_create(&thread, &attributes, macho_server_client, client) != 0) {
+			pthread_mutex_lock(&server->lock);
+			server->clients--;
+			pthread_mutex_unlock(&server->lock);
+			free(client);
+			close(fd);
+		}
+	}
+	pthread_attr_destroy(&attributes);
+
+	// Idle clients notice within one poll interval, busy ones once their
+	//   request is answered or times out, and hang up
+	__atomic_store_n(&server->stopping, 1, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&server->lock);
+	while (server->clients > 0) {
+		pthread_cond_wait(&server->idle, &server->lock);
+	}
+	pthread_mutex_unlock(&server->lock);
+	return 0;
+}
+
+void macho_server_debug_64(macho_server_t_64* server) {
+	macho_server_image_t_64* image = NULL;
+	if (server) {
+		debug("\tQuery Server:\n");
+		debug("\t\tpath: %s\n", server->path);
+		debug("\t\tlimit: 0x%" PRIx64 "\n", server->limit);
+		debug("\t\tused: 0x%" PRIx64 "\n", server->used);
+		debug("\t\timages: 0x%" PRIx64 "\n", server->count);
+		for (image = server->head; image; image = image->next) {
+			debug("\t\t0x%016" PRIx64 "\t%d\t%s\n", image->cost, image->references, image->path);
+		}
+	}
+}
+
+void macho_server_free_64(macho_server_t_64* server) {
+	macho_server_image_t_64* image = NULL;
+	if (server) {
+		if (server->fd >= 0) {
+			close(server->fd);
+			server->fd = -1;
+		}
+		if (server->path) {
+			unlink(server->path);
+			free(server->path);
+			server->path = NULL;
+		}
+		while ((image = server->head) != NULL) {
+			macho_server_unlink(server, image);
+			macho_server_image_free(image);
+		}
+		pthread_cond_destroy(&server->idle);
+		pthread_mutex_destroy(&server->lock);
+		free(server);
+	}
+}
+
+/*
+ * Mach-O Query Client Functions
+ */
+int macho_server_connect_64(const char* path) {
+	int fd = -1;
+	struct sockaddr_un address;
+
+	if (path == NULL || strlen(path) >= sizeof(address.sun_path)) {
+		return -1;
+	}
+	memset(&address, '\0', sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Sends one request and reads its response; the records are allocated
+//   for the caller to free and NULL when the response has none
+int macho_server_request_64(int fd, uint32_t op, const char* image, const void* payload, uint32_t size,
+		macho_server_response_t_64* response, unsigned char** records) {
+	macho_server_request_t_64 request;
+
+	if (fd < 0 || image == NULL || (payload == NULL && size) || response == NULL || records == NULL) {
+		return -1;
+	}
+	*records = NULL;
+	request.magic = MACHO_SERVER_MAGIC;
+	request.op = op;
+	request.path_size = (uint32_t) strlen(image);
+	request.payload_size = size;
+	if (macho_server_write(fd, &request, sizeof(request)) < 0
+			|| macho_server_write(fd, image, request.path_size) < 0
+			|| (size && macho_server_write(fd, payload, size) < 0)
+			|| macho_server_read(fd, response, sizeof(macho_server_response_t_64)) < 0
+			|| response->magic != MACHO_SERVER_MAGIC || response->payload_size > MACHO_SERVER_PAYLOAD_MAX) {
+		return -1;
+	}
+	if (response->payload_size == 0) {
+		return 0;
+	}
+	*records = (unsigned char*) malloc(response->payload_size);
+	if (*records == NULL || macho_server_read(fd, *records, response->payload_size) < 0) {
+		free(*records);
+		*records = NULL;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,385 @@
+/**
+ * libmacho-1.0 - sha.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MACHO_SHA_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#define MACHO_SHA_ARM 1
+#include <arm_neon.h>
+#endif
+
+#include "sha.h"
+
+typedef void (*macho_sha_blocks_t_64)(uint32_t* state, const unsigned char* data, uint64_t blocks);
+
+static const uint32_t macho_sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define LOAD32BE(p) (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+
+/*
+ * Portable block functions
+ */
+static void macho_sha1_blocks_generic(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	int i = 0;
+	uint32_t w[80];
+	uint32_t a, b, c, d, e, f, k, t;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i++) {
+			w[i] = LOAD32BE(&data[i * 4]);
+		}
+		for (i = 16; i < 80; i++) {
+			w[i] = ROTL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+		}
+		a = state[0]; b = state[1]; c = state[2]; d = state[3]; e = state[4];
+		for (i = 0; i < 80; i++) {
+			if (i < 20) {
+				f = (b & c) | (~b & d);
+				k = 0x5a827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ed9eba1;
+			} else if (i < 60) {
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8f1bbcdc;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xca62c1d6;
+			}
+			t = ROTL32(a, 5) + f + e + k + w[i];
+			e = d; d = c; c = ROTL32(b, 30); b = a; a = t;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+		data += 64;
+	}
+}
+
+static void macho_sha256_blocks_generic(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	int i = 0;
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, s0, s1, t1, t2;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i++) {
+			w[i] = LOAD32BE(&data[i * 4]);
+		}
+		for (i = 16; i < 64; i++) {
+			s0 = ROTR32(w[i-15], 7) ^ ROTR32(w[i-15], 18) ^ (w[i-15] >> 3);
+			s1 = ROTR32(w[i-2], 17) ^ ROTR32(w[i-2], 19) ^ (w[i-2] >> 10);
+			w[i] = w[i-16] + s0 + w[i-7] + s1;
+		}
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+		for (i = 0; i < 64; i++) {
+			s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+			t1 = h + s1 + ((e & f) ^ (~e & g)) + macho_sha256_k[i] + w[i];
+			s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+			t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+		data += 64;
+	}
+}
+
+#ifdef MACHO_SHA_X86
+/*
+ * x86 SHA extensions (SHA-NI)
+ */
+#define MACHO_SHA_NI __attribute__((target("sha,sse4.1,ssse3")))
+
+#define MACHO_SHA1_NI_ROUND(g) do { \
+	if ((g) < 4) { \
+		m[(g)] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + (g) * 16)), mask); \
+	} \
+	if ((g) == 0) { \
+		e0 = _mm_add_epi32(e0, m[0]); \
+		e1 = abcd; \
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0); \
+	} else if ((g) & 1) { \
+		e1 = _mm_sha1nexte_epu32(e1, m[(g) & 3]); \
+		e0 = abcd; \
+		if ((g) >= 3 && (g) <= 18) m[((g) + 1) & 3] = _mm_sha1msg2_epu32(m[((g) + 1) & 3], m[(g) & 3]); \
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, (g) / 5); \
+	} else { \
+		e0 = _mm_sha1nexte_epu32(e0, m[(g) & 3]); \
+		e1 = abcd; \
+		if ((g) >= 3 && (g) <= 18) m[((g) + 1) & 3] = _mm_sha1msg2_epu32(m[((g) + 1) & 3], m[(g) & 3]); \
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, (g) / 5); \
+	} \
+	if ((g) >= 1 && (g) <= 16) m[((g) + 3) & 3] = _mm_sha1msg1_epu32(m[((g) + 3) & 3], m[(g) & 3]); \
+	if ((g) >= 2 && (g) <= 17) m[((g) + 2) & 3] = _mm_xor_si128(m[((g) + 2) & 3], m[(g) & 3]); \
+} while (0)
+
+static MACHO_SHA_NI void macho_sha1_blocks_shani(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	__m128i abcd, abcd_save, e0, e0_save, e1;
+	__m128i m[4];
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state), 0x1B);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	while (blocks--) {
+		abcd_save = abcd;
+		e0_save = e0;
+		MACHO_SHA1_NI_ROUND(0);  MACHO_SHA1_NI_ROUND(1);  MACHO_SHA1_NI_ROUND(2);  MACHO_SHA1_NI_ROUND(3);
+		MACHO_SHA1_NI_ROUND(4);  MACHO_SHA1_NI_ROUND(5);  MACHO_SHA1_NI_ROUND(6);  MACHO_SHA1_NI_ROUND(7);
+		MACHO_SHA1_NI_ROUND(8);  MACHO_SHA1_NI_ROUND(9);  MACHO_SHA1_NI_ROUND(10); MACHO_SHA1_NI_ROUND(11);
+		MACHO_SHA1_NI_ROUND(12); MACHO_SHA1_NI_ROUND(13); MACHO_SHA1_NI_ROUND(14); MACHO_SHA1_NI_ROUND(15);
+		MACHO_SHA1_NI_ROUND(16); MACHO_SHA1_NI_ROUND(17); MACHO_SHA1_NI_ROUND(18); MACHO_SHA1_NI_ROUND(19);
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+		data += 64;
+	}
+
+	_mm_storeu_si128((__m128i*) state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+static MACHO_SHA_NI void macho_sha256_blocks_shani(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	int i = 0;
+	__m128i state0, state1, msg, tmp, abef_save, cdgh_save;
+	__m128i m[4];
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[0]), 0xB1);	/* CDAB */
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[4]), 0x1B);	/* EFGH */
+	state0 = _mm_alignr_epi8(tmp, state1, 8);					/* ABEF */
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);					/* CDGH */
+
+	while (blocks--) {
+		abef_save = state0;
+		cdgh_save = state1;
+		for (i = 0; i < 4; i++) {
+			m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + i * 16)), mask);
+		}
+		// Four rounds per step; the schedule for step i+4 is derived from
+		//   the four message words currently in flight.
+		for (i = 0; i < 16; i++) {
+			msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i*) &macho_sha256_k[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+			if (i < 12) {
+				tmp = _mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+				m[i & 3] = _mm_sha256msg2_epu32(tmp, m[(i + 3) & 3]);
+			}
+		}
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+		data += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);		/* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xB1);	/* DCHG */
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);	/* DCBA */
+	state1 = _mm_alignr_epi8(state1, tmp, 8);	/* ABEF */
+	_mm_storeu_si128((__m128i*) &state[0], state0);
+	_mm_storeu_si128((__m128i*) &state[4], state1);
+}
+
+static int macho_sha_cpu_has_shani() {
+	unsigned int a = 0, b = 0, c = 0, d = 0;
+	if (!__get_cpuid(1, &a, &b, &c, &d)) {
+		return 0;
+	}
+	if (!(c & bit_SSSE3) || !(c & bit_SSE4_1)) {
+		return 0;
+	}
+	if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+		return 0;
+	}
+	return (b & (1 << 29)) != 0;
+}
+#endif /* MACHO_SHA_X86 */
+
+#ifdef MACHO_SHA_ARM
+/*
+ * ARMv8 cryptography extensions
+ */
+static void macho_sha1_blocks_armv8(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	int g = 0;
+	uint32_t e0, e1, e0_save;
+	uint32x4_t abcd, abcd_save, tmp;
+	uint32x4_t m[4];
+	const uint32_t k[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+
+	abcd = vld1q_u32(state);
+	e0 = state[4];
+
+	while (blocks--) {
+		abcd_save = abcd;
+		e0_save = e0;
+		for (g = 0; g < 4; g++) {
+			m[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + g * 16)));
+		}
+		for (g = 0; g < 20; g++) {
+			tmp = vaddq_u32(m[g & 3], vdupq_n_u32(k[g / 5]));
+			e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+			if (g < 5) {
+				abcd = vsha1cq_u32(abcd, e0, tmp);
+			} else if (g < 10 || g >= 15) {
+				abcd = vsha1pq_u32(abcd, e0, tmp);
+			} else {
+				abcd = vsha1mq_u32(abcd, e0, tmp);
+			}
+			e0 = e1;
+			if (g < 16) {
+				m[g & 3] = vsha1su1q_u32(vsha1su0q_u32(m[g & 3], m[(g + 1) & 3], m[(g + 2) & 3]), m[(g + 3) & 3]);
+			}
+		}
+		abcd = vaddq_u32(abcd, abcd_save);
+		e0 += e0_save;
+		data += 64;
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e0;
+}
+
+static void macho_sha256_blocks_armv8(uint32_t* state, const unsigned char* data, uint64_t blocks) {
+	int i = 0;
+	uint32x4_t state0, state1, abef_save, cdgh_save, tmp0, tmp2;
+	uint32x4_t m[4];
+
+	state0 = vld1q_u32(&state[0]);
+	state1 = vld1q_u32(&state[4]);
+
+	while (blocks--) {
+		abef_save = state0;
+		cdgh_save = state1;
+		for (i = 0; i < 4; i++) {
+			m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+		}
+		for (i = 0; i < 16; i++) {
+			tmp0 = vaddq_u32(m[i & 3], vld1q_u32(&macho_sha256_k[i * 4]));
+			tmp2 = state0;
+			state0 = vsha256hq_u32(state0, state1, tmp0);
+			state1 = vsha256h2q_u32(state1, tmp2, tmp0);
+			if (i < 12) {
+				m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]), m[(i + 2) & 3], m[(i + 3) & 3]);
+			}
+		}
+		state0 = vaddq_u32(state0, abef_save);
+		state1 = vaddq_u32(state1, cdgh_save);
+		data += 64;
+	}
+
+	vst1q_u32(&state[0], state0);
+	vst1q_u32(&state[4], state1);
+}
+#endif /* MACHO_SHA_ARM */
+
+/*
+ * Backend selection, done once per process
+ */
+static pthread_once_t macho_sha_once = PTHREAD_ONCE_INIT;
+static const char* macho_sha_backend = "generic";
+static macho_sha_blocks_t_64 macho_sha1_blocks = macho_sha1_blocks_generic;
+static macho_sha_blocks_t_64 macho_sha256_blocks = macho_sha256_blocks_generic;
+
+static void macho_sha_init_64() {
+	if (getenv("LIBMACHO_NO_SHA_SIMD")) {
+		return;
+	}
+#ifdef MACHO_SHA_X86
+	if (macho_sha_cpu_has_shani()) {
+		macho_sha_backend = "sha-ni";
+		macho_sha1_blocks = macho_sha1_blocks_shani;
+		macho_sha256_blocks = macho_sha256_blocks_shani;
+	}
+#endif
+#ifdef MACHO_SHA_ARM
+	macho_sha_backend = "armv8-crypto";
+	macho_sha1_blocks = macho_sha1_blocks_armv8;
+	macho_sha256_blocks = macho_sha256_blocks_armv8;
+#endif
+}
+
+const char* macho_sha_backend_64() {
+	pthread_once(&macho_sha_once, macho_sha_init_64);
+	return macho_sha_backend;
+}
+
+static void macho_sha_digest_64(macho_sha_blocks_t_64 blocks, uint32_t* state, int words,
+		const unsigned char* data, uint64_t size, unsigned char* digest) {
+	int i = 0;
+	uint64_t tail = 0;
+	uint64_t bits = size * 8;
+	unsigned char buffer[128];
+
+	blocks(state, data, size / 64);
+	tail = size % 64;
+
+	// Pad the trailing partial block: 0x80, zeros, then the big-endian bit count
+	memset(buffer, '\0', sizeof(buffer));
+	memcpy(buffer, data + size - tail, tail);
+	buffer[tail] = 0x80;
+	tail = (tail < 56) ? 64 : 128;
+	for (i = 0; i < 8; i++) {
+		buffer[tail - 1 - i] = (unsigned char) (bits >> (i * 8));
+	}
+	blocks(state, buffer, tail / 64);
+
+	for (i = 0; i < words; i++) {
+		digest[i * 4 + 0] = (unsigned char) (state[i] >> 24);
+		digest[i * 4 + 1] = (unsigned char) (state[i] >> 16);
+		digest[i * 4 + 2] = (unsigned char) (state[i] >> 8);
+		digest[i * 4 + 3] = (unsigned char) (state[i]);
+	}
+}
+
+void macho_sha1_64(const unsigned char* data, uint64_t size, unsigned char* digest) {
+	uint32_t state[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+	pthread_once(&macho_sha_once, macho_sha_init_64);
+	macho_sha_digest_64(macho_sha1_blocks, state, 5, data, size, digest);
+}
+
+void macho_sha256_64(const unsigned char* data, uint64_t size, unsigned char* digest) {
+	uint32_t state[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	pthread_once(&macho_sha_once, macho_sha_init_64);
+	macho_sha_digest_64(macho_sha256_blocks, state, 8, data, size, digest);
+}
@@ -0,0 +1,37 @@
+/**
+ * libmacho-1.0 - sha.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef MACHO_SHA_H_
+#define MACHO_SHA_H_
+
+#include <stdint.h>
+
+#define MACHO_SHA1_DIGEST_SIZE   20
+#define MACHO_SHA256_DIGEST_SIZE 32
+
+/*
+ * Internal SHA Functions
+ */
+void macho_sha1_64(const unsigned char* data, uint64_t size, unsigned char* digest);
+void macho_sha256_64(const unsigned char* data, uint64_t size, unsigned char* digest);
+const char* macho_sha_backend_64();
+
+#endif /* MACHO_SHA_H_ */
@@ -0,0 +1,473 @@
+/**
+ * libmacho-1.0 - signature.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/signature.h>
+
+#include "pool.h"
+#include "sha.h"
+
+#define MACHO_SIGNATURE_PAGE_BATCH 16
+#define MACHO_SIGNATURE_PAGE_SHIFT_MIN 12 // 4K pages
+#define MACHO_SIGNATURE_PAGE_SHIFT_MAX 16 // 64K pages
+
+typedef struct macho_signature_job_t_64 {
+	uint64_t page_size;
+	uint64_t code_limit;
+	macho_signature_t_64* signature;
+} macho_signature_job_t_64;
+
+static uint32_t macho_signature_read32(const unsigned char* data) {
+	uint32_t value = 0;
+	memcpy(&value, data, sizeof(value));
+	return be32toh(value);
+}
+
+static uint64_t macho_signature_read64(const unsigned char* data) {
+	uint64_t value = 0;
+	memcpy(&value, data, sizeof(value));
+	return be64toh(value);
+}
+
+static int macho_signature_hash_rank(uint8_t type) {
+	switch (type) {
+	case MACHO_CS_HASHTYPE_SHA256:
+		return 3;
+	case MACHO_CS_HASHTYPE_SHA256_TRUNCATED:
+		return 2;
+	case MACHO_CS_HASHTYPE_SHA1:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static macho_code_directory_t_64* macho_code_directory_load_64(unsigned char* data, uint64_t size) {
+	macho_code_directory_t_64* cd = NULL;
+
+	// Everything up to and including spare2 is present in every version
+	if (size < 44) {
+		return NULL;
+	}
+	cd = (macho_code_directory_t_64*) malloc(sizeof(macho_code_directory_t_64));
+	if (cd == NULL) {
+		return NULL;
+	}
+	memset(cd, '\0', sizeof(macho_code_directory_t_64));
+	cd->magic = macho_signature_read32(&data[0]);
+	cd->length = macho_signature_read32(&data[4]);
+	cd->version = macho_signature_read32(&data[8]);
+	cd->flags = macho_signature_read32(&data[12]);
+	cd->hashOffset = macho_signature_read32(&data[16]);
+	cd->identOffset = macho_signature_read32(&data[20]);
+	cd->nSpecialSlots = macho_signature_read32(&data[24]);
+	cd->nCodeSlots = macho_signature_read32(&data[28]);
+	cd->codeLimit = macho_signature_read32(&data[32]);
+	cd->hashSize = data[36];
+	cd->hashType = data[37];
+	cd->platform = data[38];
+	cd->pageSize = data[39];
+	cd->spare2 = macho_signature_read32(&data[40]);
+	if (cd->version >= 0x20300 && size >= 64) {
+		cd->codeLimit64 = macho_signature_read64(&data[56]);
+	}
+	if (cd->magic != MACHO_CSMAGIC_CODEDIRECTORY || cd->length > size) {
+		free(cd);
+		return NULL;
+	}
+	return cd;
+}
+
+/*
+ * Mach-O Code Signature Functions
+ */
+macho_signature_t_64* macho_signature_create_64() {
+	macho_signature_t_64* signature = (macho_signature_t_64*) malloc(sizeof(macho_signature_t_64));
+	if (signature) {
+		memset(signature, '\0', sizeof(macho_signature_t_64));
+	}
+	return signature;
+}
+
+macho_signature_t_64* macho_signature_load_64(macho_t_64* macho, int* status) {
+	int i = 0;
+	uint32_t j = 0;
+	uint32_t type = 0;
+	uint32_t offset = 0;
+	unsigned char* data = NULL;
+	unsigned char* blob = NULL;
+	macho_command_t_64* command = NULL;
+	macho_linkedit_data_cmd_t_64 cmd;
+	macho_section_t_64* section = NULL;
+	macho_code_directory_t_64* cd = NULL;
+	macho_signature_t_64* signature = NULL;
+
+	if (status) {
+		*status = MACHO_SIGNATURE_UNSIGNED;
+	}
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	data = (unsigned char*) macho->data;
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd == MACHO_CMD_CODE_SIGNATURE) {
+			command = macho->commands[i];
+			break;
+		}
+	}
+	if (command == NULL) {
+		return NULL;
+	}
+
+	if (status) {
+		*status = MACHO_SIGNATURE_MALFORMED;
+	}
+	if (command->size < sizeof(cmd)) {
+		error("Code signature command is truncated\n");
+		return NULL;
+	}
+	memcpy(&cmd, &data[command->offset], sizeof(cmd));
+	if ((uint64_t) cmd.dataoff + cmd.datasize > macho->size || cmd.datasize < 12) {
+		error("Code signature is out of bounds\n");
+		return NULL;
+	}
+
+	signature = macho_signature_create_64();
+	if (signature == NULL) {
+		return NULL;
+	}
+	signature->image = data;
+	signature->image_size = macho->size;
+	signature->data = &data[cmd.dataoff];
+	signature->size = cmd.datasize;
+
+	if (macho_signature_read32(&signature->data[0]) != MACHO_CSMAGIC_EMBEDDED_SIGNATURE) {
+		error("Code signature is not an embedded SuperBlob\n");
+		macho_signature_free_64(signature);
+		return NULL;
+	}
+	signature->count = macho_signature_read32(&signature->data[8]);
+	if (12 + signature->count * 8 > signature->size) {
+		error("Code signature blob index is truncated\n");
+		macho_signature_free_64(signature);
+		return NULL;
+	}
+
+	// Pick the strongest hash among the primary and alternate CodeDirectories
+	for (j = 0; j < signature->count; j++) {
+		type = macho_signature_read32(&signature->data[12 + j * 8]);
+		offset = macho_signature_read32(&signature->data[12 + j * 8 + 4]);
+		if (type != MACHO_CSSLOT_CODEDIRECTORY && (type < MACHO_CSSLOT_ALTERNATE_CODEDIRECTORIES
+				|| type >= MACHO_CSSLOT_ALTERNATE_CODEDIRECTORIES + MACHO_CSSLOT_ALTERNATE_CODEDIRECTORY_MAX)) {
+			continue;
+		}
+		if (offset >= signature->size) {
+			continue;
+		}
+		cd = macho_code_directory_load_64(&signature->data[offset], signature->size - offset);
+		if (cd == NULL) {
+			continue;
+		}
+		if (signature->directory == NULL
+				|| macho_signature_hash_rank(cd->hashType) > macho_signature_hash_rank(signature->directory->hashType)) {
+			if (signature->directory) {
+				free(signature->directory);
+			}
+			signature->directory = cd;
+			blob = &signature->data[offset];
+		} else {
+			free(cd);
+		}
+	}
+
+	cd = signature->directory;
+	if (cd == NULL) {
+		error("Code signature has no CodeDirectory\n");
+		macho_signature_free_64(signature);
+		return NULL;
+	}
+	if ((uint64_t) cd->hashOffset + (uint64_t) cd->nCodeSlots * cd->hashSize > cd->length
+			|| (uint64_t) cd->nSpecialSlots * cd->hashSize > cd->hashOffset
+			|| cd->identOffset >= cd->length) {
+		error("CodeDirectory hash slots are out of bounds\n");
+		macho_signature_free_64(signature);
+		return NULL;
+	}
+	signature->hashes = &blob[cd->hashOffset];
+	if (memchr(&blob[cd->identOffset], '\0', cd->length - cd->identOffset)) {
+		signature->identifier = (const char*) &blob[cd->identOffset];
+	}
+	section = macho_get_section_64(macho, "__TEXT", "__info_plist");
+	if (section && section->data) {
+		signature->info_plist = section->data;
+		signature->info_plist_size = section->info->size;
+	}
+
+	if (macho_signature_hash_rank(cd->hashType) == 0) {
+		if (status) {
+			*status = MACHO_SIGNATURE_UNSUPPORTED_HASH;
+		}
+		return signature;
+	}
+	if (status) {
+		*status = MACHO_SIGNATURE_VALID;
+	}
+	return signature;
+}
+
+// The blob of a type in the SuperBlob, or NULL if there is none
+static unsigned char* macho_signature_blob(macho_signature_t_64* signature, uint32_t type, uint64_t* size) {
+	uint64_t i = 0;
+	uint32_t offset = 0;
+	uint32_t length = 0;
+
+	for (i = 0; i < signature->count; i++) {
+		if (macho_signature_read32(&signature->data[12 + i * 8]) != type) {
+			continue;
+		}
+		offset = macho_signature_read32(&signature->data[12 + i * 8 + 4]);
+		if ((uint64_t) offset + 8 > signature->size) {
+			return NULL;
+		}
+		length = macho_signature_read32(&signature->data[offset + 4]);
+		if (length < 8 || length > signature->size - offset) {
+			return NULL;
+		}
+		*size = length;
+		return &signature->data[offset];
+	}
+	return NULL;
+}
+
+// Special slots sit below code slot zero, slot n at -n. An empty slot is all
+//   zeroes, and a blob the CodeDirectory has no slot for isn't bound to it.
+static int macho_signature_check_slots(macho_signature_t_64* signature, uint32_t* failed) {
+	uint32_t i = 0;
+	uint32_t slot = 0;
+	uint32_t zero = 0;
+	uint64_t size = 0;
+	unsigned char* data = NULL;
+	unsigned char* hash = NULL;
+	unsigned char digest[MACHO_SHA256_DIGEST_SIZE];
+	macho_code_directory_t_64* cd = signature->directory;
+	static const uint32_t slots[] = {
+		MACHO_CSSLOT_INFOSLOT,
+		MACHO_CSSLOT_REQUIREMENTS,
+		MACHO_CSSLOT_ENTITLEMENTS,
+		MACHO_CSSLOT_DER_ENTITLEMENTS
+	};
+
+	for (i = 0; i < sizeof(slots) / sizeof(slots[0]); i++) {
+		slot = slots[i];
+		size = 0;
+		if (slot == MACHO_CSSLOT_INFOSLOT) {
+			data = signature->info_plist;
+			size = signature->info_plist_size;
+		} else {
+			data = macho_signature_blob(signature, slot, &size);
+		}
+		if (slot > cd->nSpecialSlots) {
+			if (data && slot != MACHO_CSSLOT_INFOSLOT) {
+				*failed = slot;
+				return -1;
+			}
+			continue;
+		}
+
+		hash = signature->hashes - (uint64_t) slot * cd->hashSize;
+		for (zero = 0; zero < cd->hashSize && hash[zero] == 0; zero++);
+		if (data == NULL) {
+			if (zero != cd->hashSize) {
+				*failed = slot;
+				return -1;
+			}
+			continue;
+		}
+		if (cd->hashType == MACHO_CS_HASHTYPE_SHA1) {
+			macho_sha1_64(data, size, digest);
+		} else {
+			macho_sha256_64(data, size, digest);
+		}
+		if (memcmp(digest, hash, cd->hashSize) != 0) {
+			*failed = slot;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int macho_signature_check_page(uint64_t index, void* userdata) {
+	uint64_t end = 0;
+	uint64_t start = 0;
+	unsigned char digest[MACHO_SHA256_DIGEST_SIZE];
+	macho_signature_job_t_64* job = (macho_signature_job_t_64*) userdata;
+	macho_signature_t_64* signature = job->signature;
+	macho_code_directory_t_64* cd = signature->directory;
+
+	start = index * job->page_size;
+	end = start + job->page_size;
+	if (end > job->code_limit) {
+		end = job->code_limit;
+	}
+
+	if (cd->hashType == MACHO_CS_HASHTYPE_SHA1) {
+		macho_sha1_64(&signature->image[start], end - start, digest);
+	} else {
+		macho_sha256_64(&signature->image[start], end - start, digest);
+	}
+	return memcmp(digest, &signature->hashes[index * cd->hashSize], cd->hashSize) != 0;
+}
+
+int macho_signature_verify_64(macho_signature_t_64* signature, macho_signature_verdict_t_64* verdict) {
+	uint64_t failed = 0;
+	uint64_t digest_size = 0;
+	macho_code_directory_t_64* cd = NULL;
+	macho_signature_job_t_64 job;
+
+	if (signature == NULL || signature->directory == NULL || verdict == NULL) {
+		return -1;
+	}
+
+	cd = signature->directory;
+	memset(verdict, '\0', sizeof(macho_signature_verdict_t_64));
+	verdict->hash_type = cd->hashType;
+	verdict->hash_size = cd->hashSize;
+	verdict->page_count = cd->nCodeSlots;
+	verdict->code_limit = cd->codeLimit64 ? cd->codeLimit64 : cd->codeLimit;
+	verdict->identifier = signature->identifier;
+	verdict->backend = macho_sha_backend_64();
+
+	// A page size of 0 means the whole limit is one page, anything else is
+	//   a shift that has to be checked before it is used
+	if (cd->pageSize && (cd->pageSize < MACHO_SIGNATURE_PAGE_SHIFT_MIN || cd->pageSize > MACHO_SIGNATURE_PAGE_SHIFT_MAX)) {
+		verdict->status = MACHO_SIGNATURE_MALFORMED;
+		return 0;
+	}
+	verdict->page_size = cd->pageSize ? (1U << cd->pageSize) : (uint32_t) verdict->code_limit;
+
+	if (macho_signature_hash_rank(cd->hashType) == 0) {
+		verdict->status = MACHO_SIGNATURE_UNSUPPORTED_HASH;
+		return 0;
+	}
+	digest_size = (cd->hashType == MACHO_CS_HASHTYPE_SHA1) ? MACHO_SHA1_DIGEST_SIZE : MACHO_SHA256_DIGEST_SIZE;
+	if (cd->hashSize == 0 || cd->hashSize > digest_size || verdict->page_size == 0
+			|| verdict->code_limit > signature->image_size
+			|| (verdict->code_limit + verdict->page_size - 1) / verdict->page_size != cd->nCodeSlots) {
+		verdict->status = MACHO_SIGNATURE_MALFORMED;
+		return 0;
+	}
+
+	if (macho_signature_check_slots(signature, &verdict->failed_slot) < 0) {
+		verdict->status = MACHO_SIGNATURE_SLOT_MISMATCH;
+		return 0;
+	}
+
+	memset(&job, '\0', sizeof(job));
+	job.signature = signature;
+	job.page_size = verdict->page_size;
+	job.code_limit = verdict->code_limit;
+
+	if (macho_pool_run_64(cd->nCodeSlots, MACHO_SIGNATURE_PAGE_BATCH,
+			macho_signature_check_page, &job, &failed) != 0) {
+		verdict->status = MACHO_SIGNATURE_PAGE_MISMATCH;
+		verdict->failed_page = failed;
+		return 0;
+	}
+	verdict->status = MACHO_SIGNATURE_VALID;
+	return 0;
+}
+
+int macho_verify_signature_64(macho_t_64* macho, macho_signature_verdict_t_64* verdict) {
+	int ret = 0;
+	int status = 0;
+	macho_signature_t_64* signature = NULL;
+
+	if (macho == NULL || verdict == NULL) {
+		return -1;
+	}
+	signature = macho_signature_load_64(macho, &status);
+	if (signature == NULL) {
+		memset(verdict, '\0', sizeof(macho_signature_verdict_t_64));
+		verdict->status = status;
+		return 0;
+	}
+	ret = macho_signature_verify_64(signature, verdict);
+	macho_signature_free_64(signature);
+	return ret;
+}
+
+const char* macho_signature_status_string_64(int status) {
+	switch (status) {
+	case MACHO_SIGNATURE_VALID:
+		return "valid";
+	case MACHO_SIGNATURE_UNSIGNED:
+		return "unsigned";
+	case MACHO_SIGNATURE_MALFORMED:
+		return "malformed";
+	case MACHO_SIGNATURE_UNSUPPORTED_HASH:
+		return "unsupported hash type";
+	case MACHO_SIGNATURE_PAGE_MISMATCH:
+		return "page hash mismatch";
+	case MACHO_SIGNATURE_SLOT_MISMATCH:
+		return "special slot hash mismatch";
+	default:
+		return "unknown";
+	}
+}
+
+void macho_signature_debug_64(macho_signature_t_64* signature) {
+	macho_code_directory_t_64* cd = NULL;
+	if (signature) {
+		debug("\tCode Signature:\n");
+		debug("\t\t      size: 0x%llx\n", signature->size);
+		debug("\t\t     blobs: %llu\n", signature->count);
+		cd = signature->directory;
+		if (cd) {
+			debug("\t\t   version: 0x%x\n", cd->version);
+			debug("\t\t     flags: 0x%x\n", cd->flags);
+			debug("\t\tidentifier: %s\n", signature->identifier ? signature->identifier : "(none)");
+			debug("\t\t code slots: %u\n", cd->nCodeSlots);
+			debug("\t\t code limit: 0x%x\n", cd->codeLimit);
+			debug("\t\t  hash type: %u (%u bytes)\n", cd->hashType, cd->hashSize);
+			debug("\t\t page size: 2^%u\n", cd->pageSize);
+		}
+	}
+}
+
+void macho_signature_free_64(macho_signature_t_64* signature) {
+	if (signature) {
+		if (signature->directory) {
+			free(signature->directory);
+			signature->directory = NULL;
+		}
+		free(signature);
+	}
+}
@@ -0,0 +1,525 @@
+/**
+ * libmacho-1.0 - swap.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MACHO_SWAP_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define MACHO_SWAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/swap.h>
+#include <libmacho-1.0/vm.h>
+
+/*
+ * Byte shuffle patterns, one 16 byte lane at a time. An nlist_64 is exactly
+ *   one lane: n_strx (4), n_type (1), n_sect (1), n_desc (2), n_value (8).
+ */
+static const unsigned char macho_swap32_mask[16] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+static const unsigned char macho_swap64_mask[16] = {
+	7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+};
+static const unsigned char macho_swap_nlist_mask[16] = {
+	3, 2, 1, 0, 4, 5, 7, 6, 15, 14, 13, 12, 11, 10, 9, 8
+};
+
+typedef void (*macho_swap_lanes_t_64)(unsigned char* data, uint64_t lanes, const unsigned char* mask);
+typedef void (*macho_swap_sections_t_64)(unsigned char* data, uint64_t count);
+
+/*
+ * Generic implementation
+ */
+static void macho_swap_lanes_generic(unsigned char* data, uint64_t lanes, const unsigned char* mask) {
+	int i = 0;
+	uint64_t j = 0;
+	unsigned char lane[16];
+	for (j = 0; j < lanes; j++, data += 16) {
+		memcpy(lane, data, 16);
+		for (i = 0; i < 16; i++) {
+			data[i] = lane[mask[i]];
+		}
+	}
+}
+
+static void macho_swap_sections_generic(unsigned char* data, uint64_t count) {
+	uint64_t i = 0;
+	// sectname and segname stay as they are, addr and size are 64 bit,
+	//   the eight trailing fields are all 32 bit.
+	for (i = 0; i < count; i++, data += MACHO_SECTION_64_SIZE) {
+		macho_swap_lanes_generic(data + 32, 1, macho_swap64_mask);
+		macho_swap_lanes_generic(data + 48, 2, macho_swap32_mask);
+	}
+}
+
+#ifdef MACHO_SWAP_X86
+/*
+ * SSSE3 and AVX2 shuffles
+ */
+__attribute__((target("ssse3")))
+static void macho_swap_lanes_ssse3(unsigned char* data, uint64_t lanes, const unsigned char* mask) {
+	uint64_t i = 0;
+	__m128i m = _mm_loadu_si128((const __m128i*) mask);
+	for (i = 0; i < lanes; i++, data += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) data);
+		_mm_storeu_si128((__m128i*) data, _mm_shuffle_epi8(v, m));
+	}
+}
+
+__attribute__((target("ssse3")))
+static void macho_swap_sections_ssse3(unsigned char* data, uint64_t count) {
+	uint64_t i = 0;
+	__m128i m32 = _mm_loadu_si128((const __m128i*) macho_swap32_mask);
+	__m128i m64 = _mm_loadu_si128((const __m128i*) macho_swap64_mask);
+	for (i = 0; i < count; i++, data += MACHO_SECTION_64_SIZE) {
+		__m128i a = _mm_loadu_si128((const __m128i*) (data + 32));
+		__m128i b = _mm_loadu_si128((const __m128i*) (data + 48));
+		__m128i c = _mm_loadu_si128((const __m128i*) (data + 64));
+		_mm_storeu_si128((__m128i*) (data + 32), _mm_shuffle_epi8(a, m64));
+		_mm_storeu_si128((__m128i*) (data + 48), _mm_shuffle_epi8(b, m32));
+		_mm_storeu_si128((__m128i*) (data + 64), _mm_shuffle_epi8(c, m32));
+	}
+}
+
+__attribute__((target("avx2")))
+static void macho_swap_lanes_avx2(unsigned char* data, uint64_t lanes, const unsigned char* mask) {
+	uint64_t i = 0;
+	// vpshufb works within each 128 bit half, so the same pattern is
+	//   broadcast to both and two lanes go through per instruction.
+	__m256i m = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) mask));
+	for (i = 0; i + 2 <= lanes; i += 2, data += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) data);
+		_mm256_storeu_si256((__m256i*) data, _mm256_shuffle_epi8(v, m));
+	}
+	if (i < lanes) {
+		__m128i v = _mm_loadu_si128((const __m128i*) data);
+		_mm_storeu_si128((__m128i*) data, _mm_shuffle_epi8(v, _mm256_castsi256_si128(m)));
+	}
+}
+#endif /* MACHO_SWAP_X86 */
+
+#ifdef MACHO_SWAP_NEON
+/*
+ * NEON table lookups
+ */
+static void macho_swap_lanes_neon(unsigned char* data, uint64_t lanes, const unsigned char* mask) {
+	uint64_t i = 0;
+	uint8x16_t m = vld1q_u8(mask);
+	for (i = 0; i < lanes; i++, data += 16) {
+		vst1q_u8(data, vqtbl1q_u8(vld1q_u8(data), m));
+	}
+}
+
+static void macho_swap_sections_neon(unsigned char* data, uint64_t count) {
+	uint64_t i = 0;
+	for (i = 0; i < count; i++, data += MACHO_SECTION_64_SIZE) {
+		vst1q_u8(data + 32, vrev64q_u8(vld1q_u8(data + 32)));
+		vst1q_u8(data + 48, vrev32q_u8(vld1q_u8(data + 48)));
+		vst1q_u8(data + 64, vrev32q_u8(vld1q_u8(data + 64)));
+	}
+}
+#endif /* MACHO_SWAP_NEON */
+
+/*
+ * Backend selection, done once per process
+ */
+static pthread_once_t macho_swap_once = PTHREAD_ONCE_INIT;
+static const char* macho_swap_backend = "generic";
+static macho_swap_lanes_t_64 macho_swap_lanes = macho_swap_lanes_generic;
+static macho_swap_sections_t_64 macho_swap_sections = macho_swap_sections_generic;
+
+static void macho_swap_init_64() {
+	if (getenv("LIBMACHO_NO_SWAP_SIMD")) {
+		return;
+	}
+#ifdef MACHO_SWAP_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3")) {
+		macho_swap_backend = "ssse3";
+		macho_swap_lanes = macho_swap_lanes_ssse3;
+		macho_swap_sections = macho_swap_sections_ssse3;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		macho_swap_backend = "avx2";
+		macho_swap_lanes = macho_swap_lanes_avx2;
+	}
+#endif
+#ifdef MACHO_SWAP_NEON
+	macho_swap_backend = "neon";
+	macho_swap_lanes = macho_swap_lanes_neon;
+	macho_swap_sections = macho_swap_sections_neon;
+#endif
+}
+
+const char* macho_swap_backend_64() {
+	pthread_once(&macho_swap_once, macho_swap_init_64);
+	return macho_swap_backend;
+}
+
+/*
+ * Bulk Byte Swapping Functions
+ */
+void macho_swap32_array_64(void* data, uint64_t count) {
+	uint64_t i = 0;
+	uint32_t word = 0;
+	unsigned char* bytes = (unsigned char*) data;
+	pthread_once(&macho_swap_once, macho_swap_init_64);
+	macho_swap_lanes(bytes, count / 4, macho_swap32_mask);
+	for (i = count & ~3ULL; i < count; i++) {
+		memcpy(&word, bytes + i * 4, sizeof(word));
+		word = __builtin_bswap32(word);
+		memcpy(bytes + i * 4, &word, sizeof(word));
+	}
+}
+
+void macho_swap64_array_64(void* data, uint64_t count) {
+	uint64_t i = 0;
+	uint64_t word = 0;
+	unsigned char* bytes = (unsigned char*) data;
+	pthread_once(&macho_swap_once, macho_swap_init_64);
+	macho_swap_lanes(bytes, count / 2, macho_swap64_mask);
+	for (i = count & ~1ULL; i < count; i++) {
+		memcpy(&word, bytes + i * 8, sizeof(word));
+		word = __builtin_bswap64(word);
+		memcpy(bytes + i * 8, &word, sizeof(word));
+	}
+}
+
+void macho_swap_nlists_64(void* data, uint64_t count) {
+	pthread_once(&macho_swap_once, macho_swap_init_64);
+	macho_swap_lanes((unsigned char*) data, count, macho_swap_nlist_mask);
+}
+
+void macho_swap_sections_64(void* data, uint64_t count) {
+	pthread_once(&macho_swap_once, macho_swap_init_64);
+	macho_swap_sections((unsigned char*) data, count);
+}
+
+/*
+ * Byte-swapped Image Functions
+ */
+int macho_is_swapped_64(const unsigned char* data, uint64_t size) {
+	uint32_t magic = 0;
+	if (data == NULL || size < sizeof(uint32_t)) {
+		return 0;
+	}
+	memcpy(&magic, data, sizeof(uint32_t));
+	return (magic == MACHO_CIGAM_64 || magic == MACHO_CIGAM_32);
+}
+
+// Commands with MACHO_CMD_REQ_DYLD set are matched on their low bits
+#define MACHO_SWAP_CMD(cmd) ((cmd) & ~MACHO_CMD_REQ_DYLD)
+
+static int macho_swap_range_ok(uint64_t size, uint64_t offset, uint64_t count, uint64_t width) {
+	if (offset > size || width == 0) {
+		return 0;
+	}
+	return count <= (size - offset) / width;
+}
+
+static void macho_swap16_array(unsigned char* data, uint64_t count) {
+	uint64_t i = 0;
+	uint16_t half = 0;
+	for (i = 0; i < count; i++, data += sizeof(uint16_t)) {
+		memcpy(&half, data, sizeof(half));
+		half = __builtin_bswap16(half);
+		memcpy(data, &half, sizeof(half));
+	}
+}
+
+// The LC_DYLD_CHAINED_FIXUPS payload: the header, the starts of every
+//   segment with their page tables, and the import table. The fixup chains
+//   in the segments themselves are swapped when they are read.
+static int macho_swap_chained_fixups_64(unsigned char* data, uint64_t size, uint32_t dataoff, uint32_t datasize) {
+	uint32_t i = 0;
+	uint32_t count = 0;
+	uint32_t offset = 0;
+	uint32_t length = 0;
+	uint64_t entry = 0;
+	unsigned char* fixups = NULL;
+	unsigned char* starts = NULL;
+	macho_chained_fixups_header_t_64 header;
+
+	if (!macho_swap_range_ok(size, dataoff, datasize, 1) || datasize < sizeof(header)) {
+		return -1;
+	}
+	fixups = data + dataoff;
+	macho_swap32_array_64(fixups, sizeof(header) / sizeof(uint32_t));
+	memcpy(&header, fixups, sizeof(header));
+
+	if (header.starts_offset && macho_swap_range_ok(datasize, header.starts_offset, 1, sizeof(uint32_t))) {
+		macho_swap32_array_64(fixups + header.starts_offset, 1);
+		memcpy(&count, fixups + header.starts_offset, sizeof(uint32_t));
+		if (!macho_swap_range_ok(datasize, header.starts_offset + sizeof(uint32_t), count, sizeof(uint32_t))) {
+			return -1;
+		}
+		macho_swap32_array_64(fixups + header.starts_offset + sizeof(uint32_t), count);
+		for (i = 0; i < count; i++) {
+			memcpy(&offset, fixups + header.starts_offset + sizeof(uint32_t) * (i + 1), sizeof(uint32_t));
+			if (offset == 0) {
+				continue;
+			}
+			// size, page_size, pointer_format, segment_offset,
+			//   max_valid_pointer, page_count, then 16 bit page starts
+			if (!macho_swap_range_ok(datasize, (uint64_t) header.starts_offset + offset, 1,
+					sizeof(macho_chained_starts_segment_t_64))) {
+				return -1;
+			}
+			starts = fixups + header.starts_offset + offset;
+			macho_swap32_array_64(starts, 1);
+			macho_swap16_array(starts + 4, 2);
+			macho_swap64_array_64(starts + 8, 1);
+			macho_swap32_array_64(starts + 16, 1);
+			macho_swap16_array(starts + 20, 1);
+			memcpy(&length, starts, sizeof(uint32_t));
+			if (length < sizeof(macho_chained_starts_segment_t_64)
+					|| !macho_swap_range_ok(datasize, (uint64_t) header.starts_offset + offset, 1, length)) {
+				return -1;
+			}
+			macho_swap16_array(starts + sizeof(macho_chained_starts_segment_t_64),
+					(length - sizeof(macho_chained_starts_segment_t_64)) / sizeof(uint16_t));
+		}
+	}
+
+	switch (header.imports_format) {
+	case MACHO_CHAINED_IMPORT:
+		entry = sizeof(uint32_t);
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND:
+		entry = sizeof(uint32_t) * 2;
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND64:
+		entry = sizeof(uint64_t) * 2;
+		break;
+	default:
+		return 0;
+	}
+	if (!macho_swap_range_ok(datasize, header.imports_offset, header.imports_count, entry)) {
+		return -1;
+	}
+	if (header.imports_format == MACHO_CHAINED_IMPORT_ADDEND64) {
+		macho_swap64_array_64(fixups + header.imports_offset, (uint64_t) header.imports_count * 2);
+	} else {
+		macho_swap32_array_64(fixups + header.imports_offset, header.imports_count * entry / sizeof(uint32_t));
+	}
+	return 0;
+}
+
+static int macho_swap_command_64(unsigned char* data, uint64_t size, unsigned char* command,
+		uint32_t cmd, uint32_t cmdsize) {
+	uint32_t nsects = 0;
+	uint32_t* words = (uint32_t*) command;
+
+	switch (MACHO_SWAP_CMD(cmd)) {
+	case MACHO_CMD_SEGMENT_64:
+		// cmd, cmdsize, segname[16], vmaddr, vmsize, fileoff, filesize,
+		//   maxprot, initprot, nsects, flags, then the section headers
+		if (cmdsize < 72) {
+			return -1;
+		}
+		macho_swap64_array_64(command + 24, 4);
+		macho_swap32_array_64(command + 56, 4);
+		memcpy(&nsects, command + 64, sizeof(uint32_t));
+		if (nsects > (cmdsize - 72) / MACHO_SECTION_64_SIZE) {
+			return -1;
+		}
+		macho_swap_sections_64(command + 72, nsects);
+		return 0;
+
+	case MACHO_CMD_SYMTAB:
+		// cmd, cmdsize, symoff, nsyms, stroff, strsize
+		if (cmdsize < 24) {
+			return -1;
+		}
+		macho_swap32_array_64(words + 2, 4);
+		if (!macho_swap_range_ok(size, words[2], words[3], MACHO_NLIST_64_SIZE)) {
+			return -1;
+		}
+		macho_swap_nlists_64(data + words[2], words[3]);
+		return 0;
+
+	case MACHO_CMD_DYSYMTAB:
+		// Twenty 32 bit fields; indirectsymoff and nindirectsyms are 14 and 15
+		if (cmdsize < 80) {
+			return -1;
+		}
+		macho_swap32_array_64(words + 2, 18);
+		if (!macho_swap_range_ok(size, words[14], words[15], sizeof(uint32_t))) {
+			return -1;
+		}
+		macho_swap32_array_64(data + words[14], words[15]);
+		return 0;
+
+	case MACHO_CMD_UUID:
+		return 0;
+
+	case MACHO_CMD_SOURCE_VERSION:
+		if (cmdsize >= 16) {
+			macho_swap64_array_64(command + 8, 1);
+		}
+		return 0;
+
+	case MACHO_SWAP_CMD(MACHO_CMD_MAIN):
+		if (cmdsize >= 24) {
+			macho_swap64_array_64(command + 8, 2);
+		}
+		return 0;
+
+	case MACHO_CMD_LOAD_DYLIB:
+	case MACHO_CMD_ID_DYLIB:
+	case MACHO_SWAP_CMD(MACHO_CMD_LOAD_WEAK_DYLIB):
+	case MACHO_SWAP_CMD(MACHO_CMD_REEXPORT_DYLIB):
+	case MACHO_CMD_LAZY_LOAD_DYLIB:
+	case MACHO_SWAP_CMD(MACHO_CMD_LOAD_UPWARD_DYLIB):
+		// name offset, timestamp, current and compatibility versions; the
+		//   path string that follows is left alone
+		if (cmdsize >= 24) {
+			macho_swap32_array_64(words + 2, 4);
+		}
+		return 0;
+
+	case MACHO_CMD_LOAD_DYLINKER:
+	case MACHO_CMD_ID_DYLINKER:
+	case MACHO_CMD_DYLD_ENVIRONMENT:
+	case MACHO_SWAP_CMD(MACHO_CMD_RPATH):
+	case MACHO_CMD_LINKER_OPTION:
+		// A single offset or count ahead of the strings
+		if (cmdsize >= 12) {
+			macho_swap32_array_64(words + 2, 1);
+		}
+		return 0;
+
+	case MACHO_SWAP_CMD(MACHO_CMD_DYLD_CHAINED_FIXUPS):
+		// cmd, cmdsize, dataoff, datasize
+		if (cmdsize < 16) {
+			return -1;
+		}
+		macho_swap32_array_64(words + 2, 2);
+		return macho_swap_chained_fixups_64(data, size, words[2], words[3]);
+
+	case MACHO_CMD_CODE_SIGNATURE:
+	case MACHO_CMD_SEGMENT_SPLIT_INFO:
+	case MACHO_CMD_FUNCTION_STARTS:
+	case MACHO_CMD_DATA_IN_CODE:
+	case MACHO_CMD_DYLIB_CODE_SIGN_DRS:
+	case MACHO_CMD_LINKER_OPTIMIZATION_HINT:
+	case MACHO_SWAP_CMD(MACHO_CMD_DYLD_EXPORTS_TRIE):
+	case MACHO_CMD_DYLD_INFO:
+	case MACHO_CMD_ENCRYPTION_INFO:
+	case MACHO_CMD_ENCRYPTION_INFO_64:
+	case MACHO_CMD_VERSION_MIN_MACOSX:
+	case MACHO_CMD_VERSION_MIN_IPHONEOS:
+	case MACHO_CMD_VERSION_MIN_TVOS:
+	case MACHO_CMD_VERSION_MIN_WATCHOS:
+	case MACHO_CMD_BUILD_VERSION:
+		// Flat runs of 32 bit fields, build tool entries included
+		macho_swap32_array_64(words + 2, (cmdsize - 8) / sizeof(uint32_t));
+		return 0;
+
+	case MACHO_CMD_NOTE:
+		// data_owner[16], offset, size
+		if (cmdsize >= 40) {
+			macho_swap64_array_64(command + 24, 2);
+		}
+		return 0;
+
+	case MACHO_SWAP_CMD(MACHO_CMD_FILESET_ENTRY):
+		// vmaddr, fileoff, entry_id, reserved
+		if (cmdsize >= 32) {
+			macho_swap64_array_64(command + 8, 2);
+			macho_swap32_array_64(words + 6, 2);
+		}
+		return 0;
+
+	default:
+		// Thread states and the obsolete commands carry nothing this
+		//   library reads, so only their cmd and cmdsize are swapped.
+		return 0;
+	}
+}
+
+int macho_swap_image_64(unsigned char* data, uint64_t size) {
+	uint32_t i = 0;
+	uint32_t cmd = 0;
+	uint32_t ncmds = 0;
+	uint32_t cmdsize = 0;
+	uint32_t sizeofcmds = 0;
+	uint64_t offset = 0;
+	uint32_t* header = (uint32_t*) data;
+
+	if (!macho_is_swapped_64(data, size)) {
+		return 0;
+	}
+	if (header[0] != MACHO_CIGAM_64) {
+		error("Byte-swapped 32-bit Mach-O images are not supported\n");
+		return -1;
+	}
+	if (size < 32) {
+		error("Byte-swapped Mach-O header is truncated\n");
+		return -1;
+	}
+
+	// magic, cputype, cpusubtype, filetype, ncmds, sizeofcmds, flags, reserved
+	macho_swap32_array_64(header, 8);
+	ncmds = header[4];
+	sizeofcmds = header[5];
+	if (sizeofcmds > size - 32) {
+		error("Byte-swapped Mach-O load commands are truncated\n");
+		return -1;
+	}
+
+	offset = 32;
+	for (i = 0; i < ncmds; i++) {
+		if (offset + 8 > 32 + (uint64_t) sizeofcmds) {
+			error("Byte-swapped Mach-O load command %u is out of bounds\n", i);
+			return -1;
+		}
+		macho_swap32_array_64(data + offset, 2);
+		memcpy(&cmd, data + offset, sizeof(uint32_t));
+		memcpy(&cmdsize, data + offset + 4, sizeof(uint32_t));
+		if (cmdsize < 8 || (cmdsize & 3) || offset + cmdsize > 32 + (uint64_t) sizeofcmds) {
+			error("Byte-swapped Mach-O load command %u has a bad size\n", i);
+			return -1;
+		}
+		if (macho_swap_command_64(data, size, data + offset, cmd, cmdsize) < 0) {
+			error("Unable to swap Mach-O load command 0x%x\n", cmd);
+			return -1;
+		}
+		offset += cmdsize;
+	}
+
+	debug("Byte-swapped %u load commands with the %s backend\n", ncmds, macho_swap_backend_64());
+	return 1;
+}
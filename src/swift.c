@@ -0,0 +1,390 @@
+/**
+ * libmacho-1.0 - swift.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/vm.h>
+#include <libmacho-1.0/swift.h>
+
+#include "pool.h"
+
+#define MACHO_SWIFT_BATCH 0x100 // conformances handed to a worker at a time
+
+typedef struct macho_swift_each_t_64 {
+	macho_swift_t_64* swift;
+	macho_swift_conformance_func_t_64 func;
+	void* userdata;
+} macho_swift_each_t_64;
+
+static macho_section_info_t_64* macho_swift_section(macho_t_64* macho, const char* name) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	macho_segment_t_64* segment = NULL;
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		for (j = 0; segment && j < segment->section_count; j++) {
+			if (segment->sections[j]->info && !strncmp(segment->sections[j]->info->sectname, name,
+					sizeof(segment->sections[j]->info->sectname))) {
+				return segment->sections[j]->info;
+			}
+		}
+	}
+	return NULL;
+}
+
+// Target of the relative offset stored at address, zero if there is none
+static uint64_t macho_swift_relative(macho_swift_t_64* swift, uint64_t address) {
+	int32_t offset = 0;
+	const void* field = macho_vm_view_64(swift->vm, address, sizeof(int32_t));
+	if (field == NULL) {
+		return 0;
+	}
+	offset = (int32_t) macho_read32_64(field);
+	return offset ? address + (int64_t) offset : 0;
+}
+
+// As above, following the pointer when the low bit says the target is one;
+//   a bound pointer leaves its imported symbol in bind
+static uint64_t macho_swift_indirect(macho_swift_t_64* swift, uint64_t address, const char** bind) {
+	int32_t offset = 0;
+	const void* field = macho_vm_view_64(swift->vm, address, sizeof(int32_t));
+
+	if (bind) {
+		*bind = NULL;
+	}
+	if (field == NULL) {
+		return 0;
+	}
+	offset = (int32_t) macho_read32_64(field);
+	if (offset == 0) {
+		return 0;
+	}
+	if (offset & 1) {
+		return macho_vm_pointer_64(swift->vm, address + (int64_t) (offset & ~1), bind);
+	}
+	return address + (int64_t) offset;
+}
+
+// Symbolic references embed raw offset bytes that may be zero, so a
+//   mangled name is walked reference by reference up to its terminator
+static const char* macho_swift_mangled(macho_swift_t_64* swift, uint64_t address, uint32_t* size) {
+	uint64_t step = 0;
+	uint64_t length = 0;
+	const unsigned char* c = NULL;
+
+	*size = 0;
+	if (address == 0) {
+		return NULL;
+	}
+	while ((c = (const unsigned char*) macho_vm_view_64(swift->vm, address + length, 1)) != NULL && *c) {
+		step = (*c >= 0x01 && *c <= 0x17) ? 5 : (*c >= 0x18 && *c <= 0x1F) ? 9 : 1;
+		if (length + step >= UINT32_MAX) {
+			return NULL;
+		}
+		length += step;
+	}
+	if (c == NULL) {
+		return NULL;
+	}
+	*size = (uint32_t) length;
+	// One view over the whole name, so it cannot straddle two mappings
+	return (const char*) macho_vm_view_64(swift->vm, address, length + 1);
+}
+
+// Only modules, protocols and nominal types carry a name
+static const char* macho_swift_context_name(macho_swift_t_64* swift, uint64_t context) {
+	uint32_t kind = 0;
+	macho_swift_context_info_t_64* info = NULL;
+
+	info = (macho_swift_context_info_t_64*) macho_vm_view_64(swift->vm, context, sizeof(macho_swift_context_info_t_64));
+	if (info == NULL) {
+		return NULL;
+	}
+	kind = info->flags & MACHO_SWIFT_KIND_MASK;
+	if (kind != MACHO_SWIFT_KIND_MODULE && kind != MACHO_SWIFT_KIND_PROTOCOL && kind != MACHO_SWIFT_KIND_CLASS
+			&& kind != MACHO_SWIFT_KIND_STRUCT && kind != MACHO_SWIFT_KIND_ENUM) {
+		return NULL;
+	}
+	return macho_vm_string_64(swift->vm, macho_swift_relative(swift, context + offsetof(macho_swift_context_info_t_64, name)));
+}
+
+static int macho_swift_each_job(uint64_t index, void* userdata) {
+	macho_swift_each_t_64* each = (macho_swift_each_t_64*) userdata;
+	macho_swift_conformance_t_64 conformance;
+	if (macho_swift_conformance_64(each->swift, index, &conformance) < 0) {
+		return 0;
+	}
+	return each->func(index, &conformance, each->userdata);
+}
+
+/*
+ * Mach-O Swift Reflection Functions
+ */
+macho_swift_t_64* macho_swift_create_64() {
+	macho_swift_t_64* swift = (macho_swift_t_64*) malloc(sizeof(macho_swift_t_64));
+	if (swift) {
+		memset(swift, '\0', sizeof(macho_swift_t_64));
+	}
+	return swift;
+}
+
+macho_swift_t_64* macho_swift_load_64(macho_t_64* macho) {
+	macho_swift_t_64* swift = NULL;
+	macho_section_info_t_64* section = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	swift = macho_swift_create_64();
+	if (swift == NULL) {
+		error("Unable to create Swift reflection reader\n");
+		return NULL;
+	}
+	swift->macho = macho;
+	swift->vm = macho_vm_load_64(macho);
+	if (swift->vm == NULL) {
+		macho_swift_free_64(swift);
+		return NULL;
+	}
+
+	// Nothing is decoded up front, the sections are only located
+	if ((section = macho_swift_section(macho, "__swift5_types"))) {
+		swift->types = section->addr;
+		swift->type_count = section->size / sizeof(int32_t);
+	}
+	if ((section = macho_swift_section(macho, "__swift5_proto"))) {
+		swift->conformances = section->addr;
+		swift->conformance_count = section->size / sizeof(int32_t);
+	}
+	if ((section = macho_swift_section(macho, "__swift5_fieldmd"))) {
+		swift->fields = section->addr;
+		swift->fields_size = section->size;
+	}
+	if ((section = macho_swift_section(macho, "__swift5_reflstr"))) {
+		swift->strings = section->addr;
+		swift->strings_size = section->size;
+	}
+
+	debug("Swift reflection found %" PRIu64 " types, %" PRIu64 " conformances, 0x%" PRIx64 " bytes of fields\n",
+			swift->type_count, swift->conformance_count, swift->fields_size);
+	return swift;
+}
+
+// The low two bits of a type list entry say whether it points at the
+//   descriptor or at a pointer to it
+int macho_swift_type_64(macho_swift_t_64* swift, uint64_t index, macho_swift_type_t_64* type) {
+	int32_t offset = 0;
+	uint64_t entry = 0;
+	uint64_t address = 0;
+	const void* field = NULL;
+	macho_swift_type_info_t_64* info = NULL;
+
+	if (swift == NULL || type == NULL || index >= swift->type_count) {
+		return -1;
+	}
+	entry = swift->types + index * sizeof(int32_t);
+	field = macho_vm_view_64(swift->vm, entry, sizeof(int32_t));
+	if (field == NULL) {
+		return -1;
+	}
+	offset = (int32_t) macho_read32_64(field);
+	address = entry + (int64_t) (offset & ~3);
+	if ((offset & 3) == 1) {
+		address = macho_vm_pointer_64(swift->vm, address, NULL);
+	}
+	info = (macho_swift_type_info_t_64*) macho_vm_view_64(swift->vm, address, sizeof(macho_swift_type_info_t_64));
+	if (info == NULL) {
+		return -1;
+	}
+
+	memset(type, '\0', sizeof(macho_swift_type_t_64));
+	type->address = address;
+	type->flags = info->flags;
+	type->kind = info->flags & MACHO_SWIFT_KIND_MASK;
+	type->name = macho_swift_context_name(swift, address);
+	type->parent = macho_swift_context_name(swift,
+			macho_swift_indirect(swift, address + offsetof(macho_swift_type_info_t_64, parent), NULL));
+	type->fields = macho_swift_relative(swift, address + offsetof(macho_swift_type_info_t_64, fields));
+	return 0;
+}
+
+int macho_swift_conformance_64(macho_swift_t_64* swift, uint64_t index, macho_swift_conformance_t_64* conformance) {
+	uint64_t target = 0;
+	uint64_t address = 0;
+	const char* bind = NULL;
+	macho_swift_conformance_info_t_64* info = NULL;
+
+	if (swift == NULL || conformance == NULL || index >= swift->conformance_count) {
+		return -1;
+	}
+	address = macho_swift_relative(swift, swift->conformances + index * sizeof(int32_t));
+	info = (macho_swift_conformance_info_t_64*) macho_vm_view_64(swift->vm, address,
+			sizeof(macho_swift_conformance_info_t_64));
+	if (info == NULL) {
+		return -1;
+	}
+
+	memset(conformance, '\0', sizeof(macho_swift_conformance_t_64));
+	conformance->address = address;
+	conformance->flags = info->flags;
+	conformance->witness_table = macho_swift_relative(swift,
+			address + offsetof(macho_swift_conformance_info_t_64, witness_table));
+
+	// Protocols from other modules are bound, their symbol is the best name
+	target = macho_swift_indirect(swift, address + offsetof(macho_swift_conformance_info_t_64, protocol), &bind);
+	conformance->protocol = bind ? bind : macho_swift_context_name(swift, target);
+
+	target = macho_swift_relative(swift, address + offsetof(macho_swift_conformance_info_t_64, type));
+	switch (MACHO_SWIFT_CONFORMANCE_TYPE(info->flags)) {
+	case MACHO_SWIFT_TYPE_DIRECT:
+		conformance->type = macho_swift_context_name(swift, target);
+		break;
+	case MACHO_SWIFT_TYPE_INDIRECT:
+		target = target ? macho_vm_pointer_64(swift->vm, target, &bind) : 0;
+		conformance->type = target ? macho_swift_context_name(swift, target) : bind;
+		break;
+	case MACHO_SWIFT_TYPE_OBJC_NAME:
+		conformance->type = macho_vm_string_64(swift->vm, target);
+		break;
+	case MACHO_SWIFT_TYPE_OBJC_INDIRECT:
+		bind = NULL;
+		if (target) {
+			macho_vm_pointer_64(swift->vm, target, &bind);
+		}
+		conformance->type = bind;
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+// Spreads the conformance list over the worker pool. Records are decoded
+//   into each worker's stack, so the callback has to copy what it keeps.
+int macho_swift_conformances_each_64(macho_swift_t_64* swift, macho_swift_conformance_func_t_64 func, void* userdata) {
+	uint64_t failed = 0;
+	macho_swift_each_t_64 each;
+
+	if (swift == NULL || func == NULL) {
+		return -1;
+	}
+	if (swift->conformance_count == 0) {
+		return 0;
+	}
+	each.swift = swift;
+	each.func = func;
+	each.userdata = userdata;
+	if (macho_pool_run_64(swift->conformance_count, MACHO_SWIFT_BATCH, macho_swift_each_job, &each, &failed) != 0) {
+		debug("Swift conformance walk stopped at %" PRIu64 "\n", failed);
+		return -1;
+	}
+	return 0;
+}
+
+// Field descriptors are packed back to back, each followed by its records.
+//   A zeroed cursor starts at the first one; returns 1 while there are more.
+int macho_swift_fields_next_64(macho_swift_t_64* swift, uint64_t* cursor, macho_swift_field_t_64* field) {
+	uint64_t size = 0;
+	macho_swift_field_info_t_64* info = NULL;
+
+	if (swift == NULL || cursor == NULL || field == NULL) {
+		return 0;
+	}
+	if (*cursor > swift->fields_size || swift->fields_size - *cursor < sizeof(macho_swift_field_info_t_64)) {
+		return 0;
+	}
+	info = (macho_swift_field_info_t_64*) macho_vm_view_64(swift->vm, swift->fields + *cursor,
+			sizeof(macho_swift_field_info_t_64));
+	if (info == NULL || (info->count && info->record_size < sizeof(macho_swift_record_info_t_64))) {
+		return 0;
+	}
+	size = sizeof(macho_swift_field_info_t_64) + (uint64_t) info->count * info->record_size;
+	if (size > swift->fields_size - *cursor) {
+		error("Swift field descriptor at 0x%" PRIx64 " runs past its section\n", swift->fields + *cursor);
+		return 0;
+	}
+
+	memset(field, '\0', sizeof(macho_swift_field_t_64));
+	field->address = swift->fields + *cursor;
+	field->kind = info->kind;
+	field->record_size = info->record_size;
+	field->count = info->count;
+	field->type = macho_swift_mangled(swift,
+			macho_swift_relative(swift, field->address + offsetof(macho_swift_field_info_t_64, type)),
+			&field->type_size);
+	field->superclass = macho_swift_mangled(swift,
+			macho_swift_relative(swift, field->address + offsetof(macho_swift_field_info_t_64, superclass)),
+			&field->superclass_size);
+	*cursor += size;
+	return 1;
+}
+
+int macho_swift_record_64(macho_swift_t_64* swift, macho_swift_field_t_64* field, uint32_t index,
+		macho_swift_record_t_64* record) {
+	uint64_t address = 0;
+	macho_swift_record_info_t_64* info = NULL;
+
+	if (swift == NULL || field == NULL || record == NULL || index >= field->count) {
+		return -1;
+	}
+	address = field->address + sizeof(macho_swift_field_info_t_64) + (uint64_t) index * field->record_size;
+	info = (macho_swift_record_info_t_64*) macho_vm_view_64(swift->vm, address, sizeof(macho_swift_record_info_t_64));
+	if (info == NULL) {
+		return -1;
+	}
+	record->flags = info->flags;
+	record->name = macho_vm_string_64(swift->vm,
+			macho_swift_relative(swift, address + offsetof(macho_swift_record_info_t_64, name)));
+	record->type = macho_swift_mangled(swift,
+			macho_swift_relative(swift, address + offsetof(macho_swift_record_info_t_64, type)),
+			&record->type_size);
+	return 0;
+}
+
+void macho_swift_debug_64(macho_swift_t_64* swift) {
+	if (swift) {
+		debug("\tSwift:\n");
+		debug("\t\ttypes: 0x%" PRIx64 " at 0x%" PRIx64 "\n", swift->type_count, swift->types);
+		debug("\t\tconformances: 0x%" PRIx64 " at 0x%" PRIx64 "\n", swift->conformance_count, swift->conformances);
+		debug("\t\tfields: 0x%" PRIx64 " bytes at 0x%" PRIx64 "\n", swift->fields_size, swift->fields);
+		debug("\t\tstrings: 0x%" PRIx64 " bytes at 0x%" PRIx64 "\n", swift->strings_size, swift->strings);
+	}
+}
+
+void macho_swift_free_64(macho_swift_t_64* swift) {
+	if (swift) {
+		if (swift->vm) {
+			macho_vm_free_64(swift->vm);
+			swift->vm = NULL;
+		}
+		free(swift);
+	}
+}
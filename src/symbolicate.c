@@ -0,0 +1,216 @@
+/**
+ * libmacho-1.0 - symbolicate.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/symbolicate.h>
+
+typedef struct macho_symbolicate_request_t_64 {
+	uint64_t address;
+	uint64_t index;
+} macho_symbolicate_request_t_64;
+
+static int macho_symbolicator_entry_compare(const void* a, const void* b) {
+	const macho_symbolicator_entry_t_64* x = (const macho_symbolicator_entry_t_64*) a;
+	const macho_symbolicator_entry_t_64* y = (const macho_symbolicator_entry_t_64*) b;
+	if (x->address < y->address) return -1;
+	if (x->address > y->address) return 1;
+	return 0;
+}
+
+static int macho_symbolicate_request_compare(const void* a, const void* b) {
+	const macho_symbolicate_request_t_64* x = (const macho_symbolicate_request_t_64*) a;
+	const macho_symbolicate_request_t_64* y = (const macho_symbolicate_request_t_64*) b;
+	if (x->address < y->address) return -1;
+	if (x->address > y->address) return 1;
+	return 0;
+}
+
+// Where a symbol stops covering addresses: the end of its section, or of
+//   the segment it lies in when its section number is unusable, or just
+//   the symbol itself when neither is known
+static uint64_t macho_symbolicator_end(macho_t_64* macho, const uint64_t* ends, uint8_t sect, uint64_t address) {
+	uint64_t i = 0;
+	macho_segment_t_64* segment = NULL;
+	if (sect && ends[sect] > address) {
+		return ends[sect];
+	}
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		if (segment && segment->command && address >= segment->command->vmaddr
+				&& address - segment->command->vmaddr < segment->command->vmsize) {
+			return segment->command->vmaddr + segment->command->vmsize;
+		}
+	}
+	return address + 1;
+}
+
+/*
+ * Mach-O Symbolicator Functions
+ */
+macho_symbolicator_t_64* macho_symbolicator_create_64() {
+	macho_symbolicator_t_64* symbolicator = (macho_symbolicator_t_64*) malloc(sizeof(macho_symbolicator_t_64));
+	if (symbolicator) {
+		memset(symbolicator, '\0', sizeof(macho_symbolicator_t_64));
+	}
+	return symbolicator;
+}
+
+macho_symbolicator_t_64* macho_symbolicator_load_64(macho_t_64* macho) {
+	int i = 0;
+	uint64_t j = 0;
+	uint64_t count = 0;
+	uint64_t ends[MACHO_SECTION_ORDINAL_MAX + 1];
+	const char* name = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_symbolicator_t_64* symbolicator = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	symbolicator = macho_symbolicator_create_64();
+	if (symbolicator == NULL) {
+		error("Unable to create symbolicator\n");
+		return NULL;
+	}
+	symbolicator->macho = macho;
+
+	for (i = 0; i < macho->symtab_count; i++) {
+		count += macho->symtabs[i]->nsyms;
+	}
+	if (count == 0) {
+		return symbolicator;
+	}
+
+	symbolicator->entries = (macho_symbolicator_entry_t_64*) malloc(count * sizeof(macho_symbolicator_entry_t_64));
+	if (symbolicator->entries == NULL) {
+		error("Unable to allocate symbolicator entries\n");
+		macho_symbolicator_free_64(symbolicator);
+		return NULL;
+	}
+
+	macho_section_ends_64(macho, ends);
+
+	// Only symbols defined in a section have an address worth attributing
+	//   anything to; stabs, undefined and absolute symbols are skipped.
+	for (i = 0; i < macho->symtab_count; i++) {
+		symtab = macho->symtabs[i];
+		for (j = 0; j < symtab->nsyms; j++) {
+			if ((symtab->types[j] & (MACHO_N_STAB | MACHO_N_TYPE)) != MACHO_N_SECT) {
+				continue;
+			}
+			name = macho_symtab_name_64(symtab, j);
+			if (name == NULL) {
+				continue;
+			}
+			symbolicator->entries[symbolicator->count].address = symtab->values[j];
+			symbolicator->entries[symbolicator->count].end = macho_symbolicator_end(macho, ends,
+					symtab->sects[j], symtab->values[j]);
+			symbolicator->entries[symbolicator->count].name = name;
+			symbolicator->count++;
+		}
+	}
+
+	qsort(symbolicator->entries, symbolicator->count, sizeof(macho_symbolicator_entry_t_64),
+			macho_symbolicator_entry_compare);
+	debug("Symbolicator loaded %llu symbols\n", symbolicator->count);
+	return symbolicator;
+}
+
+int macho_symbolicator_resolve_64(macho_symbolicator_t_64* symbolicator, const uint64_t* addresses,
+		uint64_t count, macho_symbolication_t_64* results) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	macho_symbolication_t_64* result = NULL;
+	macho_symbolicator_entry_t_64* entry = NULL;
+	macho_symbolicate_request_t_64* requests = NULL;
+
+	if (symbolicator == NULL || addresses == NULL || results == NULL) {
+		return -1;
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	requests = (macho_symbolicate_request_t_64*) malloc(count * sizeof(macho_symbolicate_request_t_64));
+	if (requests == NULL) {
+		error("Unable to allocate symbolication requests\n");
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		requests[i].address = addresses[i];
+		requests[i].index = i;
+	}
+	qsort(requests, count, sizeof(macho_symbolicate_request_t_64), macho_symbolicate_request_compare);
+
+	// Both sides are sorted now, so a single forward merge resolves every
+	//   request to the last symbol starting at or below its address, as
+	//   long as the address is still inside that symbol's section.
+	for (i = 0; i < count; i++) {
+		while (j < symbolicator->count && symbolicator->entries[j].address <= requests[i].address) {
+			j++;
+		}
+		result = &results[requests[i].index];
+		if (j == 0 || requests[i].address >= symbolicator->entries[j - 1].end) {
+			result->name = NULL;
+			result->address = 0;
+			result->offset = requests[i].address;
+			continue;
+		}
+		entry = &symbolicator->entries[j - 1];
+		result->name = entry->name;
+		result->address = entry->address;
+		result->offset = requests[i].address - entry->address;
+	}
+
+	free(requests);
+	return 0;
+}
+
+void macho_symbolicator_debug_64(macho_symbolicator_t_64* symbolicator) {
+	uint64_t i = 0;
+	if (symbolicator) {
+		debug("\tSymbolicator:\n");
+		debug("\t\tcount: 0x%llx\n", symbolicator->count);
+		for (i = 0; i < symbolicator->count; i++) {
+			debug("\t\t0x%016llx\t%s\n", symbolicator->entries[i].address, symbolicator->entries[i].name);
+		}
+	}
+}
+
+void macho_symbolicator_free_64(macho_symbolicator_t_64* symbolicator) {
+	if (symbolicator) {
+		if (symbolicator->entries) {
+			free(symbolicator->entries);
+			symbolicator->entries = NULL;
+		}
+		free(symbolicator);
+	}
+}
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 
 #define _DEBUG
 #include <libcrippy-1.0/debug.h>
@@ -39,77 +40,141 @@ macho_symtab_t_64* macho_symtab_create_64() {
 	return symtab;
 }
 
-macho_symtab_t_64* macho_symtab_load_64(unsigned char* data, unsigned int offset) {
-	int i = 0;
+macho_symtab_t_64* macho_symtab_load_64(unsigned char* data, uint64_t offset) {
 	macho_symtab_t_64* symtab = macho_symtab_create_64();
 	if (symtab) {
-		symtab->cmd = macho_symtab_cmd_load_64(&data[offset]);
-		if (!symtab->cmd) {
+		symtab->cmd = macho_symtab_cmd_view_64(data, offset);
+		symtab->nsyms = symtab->cmd->nsyms;
+		symtab->symbols = (nlist_64*) &data[symtab->cmd->symoff];
+		debug("Found %" PRIu64 " symbols in symtab\n", symtab->nsyms);
+		// Names are looked up through macho_symtab_name_64, the nlist
+		//   entries themselves are never rewritten.
+		symtab->strings = &data[symtab->cmd->stroff];
+		if (macho_symtab_columns_load_64(symtab) < 0) {
 			macho_symtab_free_64(symtab);
 			return NULL;
 		}
-		symtab->nsyms = symtab->cmd->nsyms;
-		symtab->symbols = (struct nlist*)(&data[symtab->cmd->symoff]);
-		debug("Found %d symbols in symtab\n", symtab->nsyms);
-		for (i = 0; i < symtab->nsyms; i++) {
-			uint32_t off = symtab->symbols[i].n_un.n_strx;
-			if (off >= symtab->cmd->strsize) {
-				symtab->symbols[i].n_un.n_name = NULL;
-			} else {
-				symtab->symbols[i].n_un.n_name = (char*)(data+symtab->cmd->stroff + off);
-			}
-		}
-		//macho_symtab_debug(symtab);
 	}
 	return symtab;
 }
 
-void macho_symtab_debug(macho_symtab_t_64* symtab) {
-	int i = 0;
+// Splits the nlist records into per-field columns so a filter over one
+//   field walks a dense array instead of striding over 16 byte records.
+int macho_symtab_columns_load_64(macho_symtab_t_64* symtab) {
+	uint64_t i = 0;
+	unsigned char* block = NULL;
+	nlist_64* nl = NULL;
+
+	if (symtab == NULL) {
+		return -1;
+	}
+	if (symtab->values || symtab->nsyms == 0) {
+		return 0;
+	}
+
+	// Widest column first so each one stays naturally aligned
+	block = (unsigned char*) malloc(symtab->nsyms * (sizeof(uint64_t) + sizeof(uint32_t)
+			+ sizeof(uint16_t) + 2 * sizeof(uint8_t)));
+	if (block == NULL) {
+		error("Unable to allocate symbol columns\n");
+		return -1;
+	}
+	symtab->values = (uint64_t*) block;
+	symtab->strx = (uint32_t*) &symtab->values[symtab->nsyms];
+	symtab->descs = (uint16_t*) &symtab->strx[symtab->nsyms];
+	symtab->types = (uint8_t*) &symtab->descs[symtab->nsyms];
+	symtab->sects = &symtab->types[symtab->nsyms];
+
+	for (i = 0; i < symtab->nsyms; i++) {
+		nl = &symtab->symbols[i];
+		symtab->values[i] = nl->n_value;
+		symtab->strx[i] = nl->n_un.n_strx;
+		symtab->descs[i] = nl->n_desc;
+		symtab->types[i] = nl->n_type;
+		symtab->sects[i] = nl->n_sect;
+	}
+	return 0;
+}
+
+// Fills up to max records with symbols at or after *index that pass the
+//   filter, and leaves *index just past the last symbol examined so the
+//   next call picks up where this one stopped. A NULL filter keeps all.
+uint64_t macho_symtab_next_64(macho_symtab_t_64* symtab, uint64_t* index,
+		const macho_symbol_filter_t_64* filter, macho_symbol_record_t_64* records, uint64_t max) {
+	uint64_t i = 0;
+	uint64_t count = 0;
+	uint8_t type_mask = 0, type_value = 0;
+	uint8_t sect_mask = 0, sect_value = 0;
+	uint32_t flags = 0;
+	const char* name = NULL;
+
+	if (symtab == NULL || index == NULL || records == NULL || symtab->types == NULL) {
+		return 0;
+	}
+	if (filter) {
+		type_mask = filter->type_mask;
+		type_value = filter->type_value & type_mask;
+		sect_mask = filter->sect_mask;
+		sect_value = filter->sect_value & sect_mask;
+		flags = filter->flags;
+	}
+
+	for (i = *index; i < symtab->nsyms && count < max; i++) {
+		if ((symtab->types[i] & type_mask) != type_value
+				|| (symtab->sects[i] & sect_mask) != sect_value) {
+			continue;
+		}
+		if ((flags & MACHO_SYMBOL_FILTER_NONZERO) && symtab->values[i] == 0) {
+			continue;
+		}
+		name = macho_symtab_name_64(symtab, i);
+		if ((flags & MACHO_SYMBOL_FILTER_NAMED) && name == NULL) {
+			continue;
+		}
+		records[count].name = name;
+		records[count].value = symtab->values[i];
+		records[count].index = i;
+		records[count].type = symtab->types[i];
+		records[count].sect = symtab->sects[i];
+		records[count].desc = symtab->descs[i];
+		count++;
+	}
+	*index = i;
+	return count;
+}
+
+void macho_symtab_debug_64(macho_symtab_t_64* symtab) {
+	uint64_t i = 0;
+	const char* name = NULL;
 	if(symtab) {
 		debug("\tSymtab:\n");
-		debug("\t\tnsyms: 0x%08x\n", symtab->nsyms);
+		debug("\t\tnsyms: 0x%08" PRIx64 "\n", symtab->nsyms);
 		for (i = 0; i < symtab->nsyms; i++) {
-			struct nlist sym = symtab->symbols[i];
-			if (sym.n_un.n_name) {
-				debug("\t\t0x%x\tname=%s\n", i, sym.n_un.n_name);
+			nlist_64* sym = &symtab->symbols[i];
+			name = macho_symtab_name_64(symtab, i);
+			if (name) {
+				debug("\t\t0x%" PRIx64 "\tname=%s\n", i, name);
 			} else {
-				debug("\t\t0x%x\tname=(no name)\n", i);
+				debug("\t\t0x%" PRIx64 "\tname=(no name)\n", i);
 			}
-			debug("\t\t\tn_type=0x%02x,n_sect=0x%02x,n_desc=0x%04x,n_value=0x%08x\n", sym.n_type, sym.n_sect, sym.n_desc, sym.n_value);
+			debug("\t\t\tn_type=0x%02x,n_sect=0x%02x,n_desc=0x%04x,n_value=0x%016" PRIx64 "\n", sym->n_type, sym->n_sect, sym->n_desc, sym->n_value);
 		}
 	}
-}//
+}
 
 void macho_symtab_free_64(macho_symtab_t_64* symtab) {
 	if (symtab) {
-		if (symtab->cmd) {
-			macho_symtab_cmd_free_64(symtab->cmd);
+		if (symtab->values) {
+			free(symtab->values);
+			symtab->values = NULL;
 		}
 		free(symtab);
 	}
 }
 
 /*
- * Mach-O Symtab Info Functions 
+ * Mach-O Symtab Command Functions
  */
-macho_symtab_cmd_t_64* macho_symtab_cmd_create_64() {
-	macho_symtab_cmd_t_64* info = malloc(sizeof(macho_symtab_cmd_t_64));
-	if (info) {
-		memset(info, '\0', sizeof(macho_symtab_cmd_t_64));
-	}
-	return info;
-}
-
-macho_symtab_cmd_t_64* macho_symtab_cmd_load_64(unsigned char* data) {
-	macho_symtab_cmd_t_64* cmd = macho_symtab_cmd_create_64();
-	if (cmd) {
-		memcpy(cmd, data, sizeof(macho_symtab_cmd_t_64));
-		//macho_symtab_cmd_debug(cmd);
-	}
-	return cmd;
-}
-
 void macho_symtab_cmd_debug_64(macho_symtab_cmd_t_64* cmd) {
 	debug("\tSymtab Command:\n");
 	debug("\t\t     cmd = 0x%x\n", cmd->cmd);
@@ -119,9 +184,3 @@ void macho_symtab_cmd_debug_64(macho_symtab_cmd_t_64* cmd) {
 	debug("\t\t  stroff = 0x%x\n", cmd->stroff);
 	debug("\t\t strsize = 0x%x\n", cmd->strsize);
 }
-
-void macho_symtab_cmd_free_64(macho_symtab_cmd_t_64* cmd) {
-	if (cmd) {
-		free(cmd);
-	}
-}
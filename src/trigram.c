@@ -0,0 +1,747 @@
+/**
+ * libmacho-1.0 - trigram.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/view.h>
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/query.h>
+#include <libmacho-1.0/trigram.h>
+
+#include "hash.h"
+#include "pool.h"
+
+#define MACHO_TRIGRAM_CHUNK 0x10000	// symbol ordinals per build job
+#define MACHO_TRIGRAM_PARTS 0x100	// merge jobs, one per leading trigram byte
+
+typedef struct macho_trigram_part_t_64 {
+	uint64_t term_count;
+	uint64_t term_capacity;
+	macho_trigram_term_t_64* terms;
+	uint64_t* last;			/* last ordinal of each posting list */
+	uint64_t size;
+	uint64_t capacity;
+	unsigned char* postings;
+} macho_trigram_part_t_64;
+
+typedef struct macho_trigram_build_t_64 {
+	macho_t_64* macho;
+	uint64_t nsyms;
+	uint64_t chunk_count;
+	macho_trigram_part_t_64* chunks;	/* posting lists of one ordinal range each */
+	macho_trigram_part_t_64* parts;		/* merged posting lists of one leading byte each */
+} macho_trigram_build_t_64;
+
+static int macho_trigram_reserve(macho_trigram_part_t_64* part, uint64_t size) {
+	uint64_t capacity = 0;
+	unsigned char* postings = NULL;
+	if (part->size + size > part->capacity) {
+		capacity = part->capacity ? part->capacity * 2 : 0x1000;
+		while (capacity < part->size + size) {
+			capacity *= 2;
+		}
+		postings = (unsigned char*) realloc(part->postings, capacity);
+		if (postings == NULL) {
+			return -1;
+		}
+		part->postings = postings;
+		part->capacity = capacity;
+	}
+	return 0;
+}
+
+static int macho_trigram_put(macho_trigram_part_t_64* part, uint64_t value) {
+	if (macho_trigram_reserve(part, 10) < 0) {
+		return -1;
+	}
+	while (value >= 0x80) {
+		part->postings[part->size++] = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	part->postings[part->size++] = (unsigned char) value;
+	return 0;
+}
+
+static int macho_trigram_get(const unsigned char** data, const unsigned char* end, uint64_t* value) {
+	int shift = 0;
+	const unsigned char* p = *data;
+	*value = 0;
+	while (p < end && shift < 64) {
+		*value |= (uint64_t) (*p & 0x7F) << shift;
+		if ((*p++ & 0x80) == 0) {
+			*data = p;
+			return 0;
+		}
+		shift += 7;
+	}
+	return -1;
+}
+
+static int macho_trigram_add_term(macho_trigram_part_t_64* part, uint32_t trigram, uint64_t count,
+		uint64_t offset, uint64_t last) {
+	uint64_t capacity = 0;
+	uint64_t* lasts = NULL;
+	macho_trigram_term_t_64* terms = NULL;
+	if (part->term_count == part->term_capacity) {
+		capacity = part->term_capacity ? part->term_capacity * 2 : 0x400;
+		terms = (macho_trigram_term_t_64*) realloc(part->terms, capacity * sizeof(macho_trigram_term_t_64));
+		if (terms == NULL) {
+			return -1;
+		}
+		part->terms = terms;
+		lasts = (uint64_t*) realloc(part->last, capacity * sizeof(uint64_t));
+		if (lasts == NULL) {
+			return -1;
+		}
+		part->last = lasts;
+		part->term_capacity = capacity;
+	}
+	part->terms[part->term_count].trigram = trigram;
+	part->terms[part->term_count].count = (uint32_t) count;
+	part->terms[part->term_count].offset = offset;
+	part->last[part->term_count] = last;
+	part->term_count++;
+	return 0;
+}
+
+static void macho_trigram_part_free(macho_trigram_part_t_64* part) {
+	free(part->terms);
+	free(part->last);
+	free(part->postings);
+	memset(part, '\0', sizeof(macho_trigram_part_t_64));
+}
+
+// Walks the symtabs forward to the one holding the ordinal, ordinals asked
+//   for must not go backwards
+static macho_symtab_t_64* macho_trigram_locate(macho_t_64* macho, uint64_t ordinal,
+		uint64_t* symtab, uint64_t* base) {
+	while (*symtab < macho->symtab_count && ordinal >= *base + macho->symtabs[*symtab]->nsyms) {
+		*base += macho->symtabs[*symtab]->nsyms;
+		(*symtab)++;
+	}
+	if (*symtab >= macho->symtab_count) {
+		return NULL;
+	}
+	return macho->symtabs[*symtab];
+}
+
+static uint64_t macho_trigram_checksum(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t checksum = 0;
+	macho_symtab_t_64* symtab = NULL;
+	for (i = 0; i < macho->symtab_count; i++) {
+		symtab = macho->symtabs[i];
+		checksum = macho_hash_mix_64(checksum ^ symtab->nsyms);
+		if (symtab->strings && symtab->cmd) {
+			checksum = macho_hash_64(symtab->strings, symtab->cmd->strsize, checksum);
+		}
+	}
+	return checksum;
+}
+
+static uint64_t macho_trigram_lower(const macho_trigram_term_t_64* terms, uint64_t count, uint32_t trigram) {
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (terms[middle].trigram < trigram) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// Every trigram of every name in one ordinal range, keyed trigram << 32 by
+//   offset into the range. Names are visited in ordinal order, so a stable
+//   radix sort on the trigram alone leaves each posting list ascending.
+static int macho_trigram_chunk_job(uint64_t index, void* userdata) {
+	int pass = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t end = 0;
+	uint64_t base = 0;
+	uint64_t start = 0;
+	uint64_t count = 0;
+	uint64_t length = 0;
+	uint64_t symtab = 0;
+	uint64_t ordinal = 0;
+	uint64_t capacity = 0;
+	uint64_t offset = 0;
+	uint64_t previous = 0;
+	uint64_t* keys = NULL;
+	uint64_t* sorted = NULL;
+	uint64_t* swap = NULL;
+	uint64_t counts[0x100];
+	uint32_t trigram = 0;
+	const unsigned char* name = NULL;
+	macho_symtab_t_64* table = NULL;
+	macho_trigram_build_t_64* build = (macho_trigram_build_t_64*) userdata;
+	macho_trigram_part_t_64* chunk = &build->chunks[index];
+
+	start = index * MACHO_TRIGRAM_CHUNK;
+	end = start + MACHO_TRIGRAM_CHUNK;
+	if (end > build->nsyms) {
+		end = build->nsyms;
+	}
+
+	for (ordinal = start; ordinal < end; ordinal++) {
+		table = macho_trigram_locate(build->macho, ordinal, &symtab, &base);
+		name = (const unsigned char*) macho_symtab_name_64(table, ordinal - base);
+		if (name == NULL) {
+			continue;
+		}
+		length = strlen((const char*) name);
+		if (length < 3) {
+			continue;
+		}
+		if (count + length > capacity) {
+			capacity = capacity ? capacity * 2 : 0x40000;
+			while (capacity < count + length) {
+				capacity *= 2;
+			}
+			swap = (uint64_t*) realloc(keys, capacity * sizeof(uint64_t));
+			if (swap == NULL) {
+				free(keys);
+				return -1;
+			}
+			keys = swap;
+		}
+		for (i = 0; i + 2 < length; i++) {
+			trigram = ((uint32_t) name[i] << 16) | ((uint32_t) name[i + 1] << 8) | name[i + 2];
+			keys[count++] = ((uint64_t) trigram << 32) | (ordinal - start);
+		}
+	}
+	if (count == 0) {
+		free(keys);
+		return 0;
+	}
+
+	sorted = (uint64_t*) malloc(count * sizeof(uint64_t));
+	if (sorted == NULL) {
+		free(keys);
+		return -1;
+	}
+	for (pass = 0; pass < 3; pass++) {
+		memset(counts, '\0', sizeof(counts));
+		for (i = 0; i < count; i++) {
+			counts[(keys[i] >> (32 + pass * 8)) & 0xFF]++;
+		}
+		for (i = 0, offset = 0; i < 0x100; i++) {
+			offset += counts[i];
+			counts[i] = offset - counts[i];
+		}
+		for (i = 0; i < count; i++) {
+			sorted[counts[(keys[i] >> (32 + pass * 8)) & 0xFF]++] = keys[i];
+		}
+		swap = keys;
+		keys = sorted;
+		sorted = swap;
+	}
+	free(sorted);
+
+	// A name repeating a trigram leaves equal keys next to each other
+	for (i = 0; i < count; i = j) {
+		trigram = (uint32_t) (keys[i] >> 32);
+		offset = chunk->size;
+		previous = 0;
+		length = 0;
+		for (j = i; j < count && (uint32_t) (keys[j] >> 32) == trigram; j++) {
+			ordinal = start + (keys[j] & 0xFFFFFFFF);
+			if (length && ordinal == previous) {
+				continue;
+			}
+			if (macho_trigram_put(chunk, ordinal - previous) < 0) {
+				free(keys);
+				return -1;
+			}
+			previous = ordinal;
+			length++;
+		}
+		if (macho_trigram_add_term(chunk, trigram, length, offset, previous) < 0) {
+			free(keys);
+			return -1;
+		}
+	}
+	free(keys);
+	return 0;
+}
+
+// Joins the posting lists of every chunk for trigrams with one leading
+//   byte. Each chunk list starts with an absolute ordinal, which becomes a
+//   delta from the end of the list before it; the rest is copied as is.
+static int macho_trigram_merge_job(uint64_t index, void* userdata) {
+	uint64_t c = 0;
+	uint64_t count = 0;
+	uint64_t first = 0;
+	uint64_t offset = 0;
+	uint64_t last = 0;
+	uint64_t length = 0;
+	uint64_t* cursors = NULL;
+	uint64_t* stops = NULL;
+	uint32_t trigram = 0;
+	const unsigned char* data = NULL;
+	const unsigned char* end = NULL;
+	macho_trigram_part_t_64* chunk = NULL;
+	macho_trigram_build_t_64* build = (macho_trigram_build_t_64*) userdata;
+	macho_trigram_part_t_64* part = &build->parts[index];
+
+	cursors = (uint64_t*) malloc(build->chunk_count * 2 * sizeof(uint64_t));
+	if (cursors == NULL) {
+		return -1;
+	}
+	stops = &cursors[build->chunk_count];
+	for (c = 0; c < build->chunk_count; c++) {
+		chunk = &build->chunks[c];
+		cursors[c] = macho_trigram_lower(chunk->terms, chunk->term_count, (uint32_t) index << 16);
+		stops[c] = macho_trigram_lower(chunk->terms, chunk->term_count, (uint32_t) (index + 1) << 16);
+	}
+
+	for (;;) {
+		trigram = UINT32_MAX;
+		for (c = 0; c < build->chunk_count; c++) {
+			if (cursors[c] < stops[c] && build->chunks[c].terms[cursors[c]].trigram < trigram) {
+				trigram = build->chunks[c].terms[cursors[c]].trigram;
+			}
+		}
+		if (trigram == UINT32_MAX) {
+			break;
+		}
+
+		count = 0;
+		offset = part->size;
+		for (c = 0; c < build->chunk_count; c++) {
+			chunk = &build->chunks[c];
+			if (cursors[c] >= stops[c] || chunk->terms[cursors[c]].trigram != trigram) {
+				continue;
+			}
+			data = &chunk->postings[chunk->terms[cursors[c]].offset];
+			end = cursors[c] + 1 < chunk->term_count
+					? &chunk->postings[chunk->terms[cursors[c] + 1].offset] : &chunk->postings[chunk->size];
+			if (count) {
+				if (macho_trigram_get(&data, end, &first) < 0 || macho_trigram_put(part, first - last) < 0) {
+					free(cursors);
+					return -1;
+				}
+			}
+			length = end - data;
+			if (macho_trigram_reserve(part, length) < 0) {
+				free(cursors);
+				return -1;
+			}
+			memcpy(&part->postings[part->size], data, length);
+			part->size += length;
+			count += chunk->terms[cursors[c]].count;
+			last = chunk->last[cursors[c]];
+			cursors[c]++;
+		}
+		if (macho_trigram_add_term(part, trigram, count, offset, last) < 0) {
+			free(cursors);
+			return -1;
+		}
+	}
+	free(cursors);
+	return 0;
+}
+
+static int macho_trigram_write(int fd, const void* data, uint64_t size) {
+	ssize_t done = 0;
+	const unsigned char* p = (const unsigned char*) data;
+	while (size > 0) {
+		done = write(fd, p, size);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			return -1;
+		}
+		p += done;
+		size -= done;
+	}
+	return 0;
+}
+
+static int macho_trigram_term_compare(const void* a, const void* b) {
+	const macho_trigram_term_t_64* x = *(const macho_trigram_term_t_64**) a;
+	const macho_trigram_term_t_64* y = *(const macho_trigram_term_t_64**) b;
+	if (x->count < y->count) return -1;
+	if (x->count > y->count) return 1;
+	return 0;
+}
+
+/*
+ * Mach-O Symbol Trigram Index Functions
+ */
+macho_trigram_index_t_64* macho_trigram_index_create_64() {
+	macho_trigram_index_t_64* index = (macho_trigram_index_t_64*) malloc(sizeof(macho_trigram_index_t_64));
+	if (index) {
+		memset(index, '\0', sizeof(macho_trigram_index_t_64));
+	}
+	return index;
+}
+
+macho_trigram_index_t_64* macho_trigram_index_load_64(macho_t_64* macho) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t failed = 0;
+	uint64_t size = 0;
+	uint64_t count = 0;
+	macho_trigram_part_t_64* part = NULL;
+	macho_trigram_build_t_64 build;
+	macho_trigram_index_t_64* index = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	index = macho_trigram_index_create_64();
+	if (index == NULL) {
+		error("Unable to create trigram index\n");
+		return NULL;
+	}
+	index->macho = macho;
+	index->checksum = macho_trigram_checksum(macho);
+	for (i = 0; i < macho->symtab_count; i++) {
+		index->nsyms += macho->symtabs[i]->nsyms;
+	}
+	if (index->nsyms == 0) {
+		return index;
+	}
+
+	memset(&build, '\0', sizeof(build));
+	build.macho = macho;
+	build.nsyms = index->nsyms;
+	build.chunk_count = (index->nsyms + MACHO_TRIGRAM_CHUNK - 1) / MACHO_TRIGRAM_CHUNK;
+	build.chunks = (macho_trigram_part_t_64*) calloc(build.chunk_count, sizeof(macho_trigram_part_t_64));
+	build.parts = (macho_trigram_part_t_64*) calloc(MACHO_TRIGRAM_PARTS, sizeof(macho_trigram_part_t_64));
+	if (build.chunks == NULL || build.parts == NULL) {
+		error("Unable to allocate trigram index build\n");
+		ret = -1;
+	}
+
+	if (ret == 0 && macho_pool_run_64(build.chunk_count, 1, macho_trigram_chunk_job, &build, &failed) != 0) {
+		error("Unable to index trigram chunk %" PRIu64 "\n", failed);
+		ret = -1;
+	}
+	if (ret == 0 && macho_pool_run_64(MACHO_TRIGRAM_PARTS, 1, macho_trigram_merge_job, &build, &failed) != 0) {
+		error("Unable to merge trigram part %" PRIu64 "\n", failed);
+		ret = -1;
+	}
+
+	if (ret == 0) {
+		for (i = 0; i < MACHO_TRIGRAM_PARTS; i++) {
+			count += build.parts[i].term_count;
+			size += build.parts[i].size;
+		}
+		index->terms = (macho_trigram_term_t_64*) malloc((count ? count : 1) * sizeof(macho_trigram_term_t_64));
+		index->postings = (unsigned char*) malloc(size ? size : 1);
+		if (index->terms == NULL || index->postings == NULL) {
+			error("Unable to allocate trigram index\n");
+			ret = -1;
+		}
+	}
+	if (ret == 0) {
+		for (i = 0; i < MACHO_TRIGRAM_PARTS; i++) {
+			part = &build.parts[i];
+			for (count = 0; count < part->term_count; count++) {
+				index->terms[index->term_count] = part->terms[count];
+				index->terms[index->term_count].offset += index->size;
+				index->term_count++;
+			}
+			if (part->size) {
+				memcpy(&index->postings[index->size], part->postings, part->size);
+				index->size += part->size;
+			}
+		}
+	}
+
+	for (i = 0; build.chunks && i < build.chunk_count; i++) {
+		macho_trigram_part_free(&build.chunks[i]);
+	}
+	for (i = 0; build.parts && i < MACHO_TRIGRAM_PARTS; i++) {
+		macho_trigram_part_free(&build.parts[i]);
+	}
+	free(build.chunks);
+	free(build.parts);
+	if (ret < 0) {
+		macho_trigram_index_free_64(index);
+		return NULL;
+	}
+	debug("Trigram index holds %" PRIu64 " trigrams in %" PRIu64 " bytes\n", index->term_count, index->size);
+	return index;
+}
+
+macho_trigram_index_t_64* macho_trigram_index_open_64(macho_t_64* macho, const char* path) {
+	uint64_t i = 0;
+	uint64_t nsyms = 0;
+	macho_map_t_64* map = NULL;
+	macho_trigram_header_t_64* header = NULL;
+	macho_trigram_index_t_64* index = NULL;
+
+	if (macho == NULL || path == NULL) {
+		return NULL;
+	}
+
+	map = macho_map_open_64(path);
+	if (map == NULL) {
+		return NULL;
+	}
+	macho_map_advise_64(map, 0, 0, MACHO_MAP_RANDOM);
+	header = (macho_trigram_header_t_64*) macho_view_64(map->data, map->size, 0, sizeof(macho_trigram_header_t_64));
+	if (header == NULL || memcmp(header->magic, MACHO_TRIGRAM_MAGIC, sizeof(header->magic)) != 0
+			|| header->term_count > (map->size - sizeof(macho_trigram_header_t_64)) / sizeof(macho_trigram_term_t_64)
+			|| header->size != map->size - sizeof(macho_trigram_header_t_64)
+					- header->term_count * sizeof(macho_trigram_term_t_64)) {
+		error("Unable to read trigram index %s\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+
+	// An index built from other string tables would hand back wrong symbols
+	for (i = 0; i < macho->symtab_count; i++) {
+		nsyms += macho->symtabs[i]->nsyms;
+	}
+	if (header->nsyms != nsyms || header->checksum != macho_trigram_checksum(macho)) {
+		error("Trigram index %s does not match this image\n", path);
+		macho_map_free_64(map);
+		return NULL;
+	}
+
+	index = macho_trigram_index_create_64();
+	if (index == NULL) {
+		error("Unable to create trigram index\n");
+		macho_map_free_64(map);
+		return NULL;
+	}
+	index->macho = macho;
+	index->map = map;
+	index->nsyms = header->nsyms;
+	index->checksum = header->checksum;
+	index->term_count = header->term_count;
+	index->terms = (macho_trigram_term_t_64*) &map->data[sizeof(macho_trigram_header_t_64)];
+	index->size = header->size;
+	index->postings = &map->data[map->size - header->size];
+	return index;
+}
+
+int macho_trigram_index_save_64(macho_trigram_index_t_64* index, const char* path) {
+	int fd = -1;
+	macho_trigram_header_t_64 header;
+
+	if (index == NULL || path == NULL) {
+		return -1;
+	}
+
+	memset(&header, '\0', sizeof(header));
+	memcpy(header.magic, MACHO_TRIGRAM_MAGIC, sizeof(header.magic));
+	header.nsyms = index->nsyms;
+	header.term_count = index->term_count;
+	header.size = index->size;
+	header.checksum = index->checksum;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		error("Unable to create %s\n", path);
+		return -1;
+	}
+	if (macho_trigram_write(fd, &header, sizeof(header)) < 0
+			|| macho_trigram_write(fd, index->terms, index->term_count * sizeof(macho_trigram_term_t_64)) < 0
+			|| macho_trigram_write(fd, index->postings, index->size) < 0) {
+		error("Unable to write %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (close(fd) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+// Candidates are the ordinals on every posting list of the substring's
+//   trigrams, intersected shortest list first; only those names are read
+//   to confirm the match. Substrings under three bytes scan every name.
+macho_query_result_t_64* macho_trigram_search_64(macho_trigram_index_t_64* index, const char* substring) {
+	int failed = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t k = 0;
+	uint64_t base = 0;
+	uint64_t value = 0;
+	uint64_t symtab = 0;
+	uint64_t length = 0;
+	uint64_t ordinal = 0;
+	uint64_t count = 0;
+	uint64_t term_count = 0;
+	uint64_t candidate_count = 0;
+	uint64_t* candidates = NULL;
+	uint32_t trigram = 0;
+	const char* name = NULL;
+	const unsigned char* data = NULL;
+	const unsigned char* end = NULL;
+	const unsigned char* text = (const unsigned char*) substring;
+	macho_symtab_t_64* table = NULL;
+	macho_trigram_term_t_64** terms = NULL;
+	macho_query_result_t_64* result = NULL;
+
+	if (index == NULL || index->macho == NULL || substring == NULL) {
+		return NULL;
+	}
+	result = (macho_query_result_t_64*) malloc(sizeof(macho_query_result_t_64));
+	if (result == NULL) {
+		error("Unable to allocate trigram search result\n");
+		return NULL;
+	}
+	memset(result, '\0', sizeof(macho_query_result_t_64));
+
+	length = strlen(substring);
+	if (length < 3) {
+		for (ordinal = 0; ordinal < index->nsyms; ordinal++) {
+			table = macho_trigram_locate(index->macho, ordinal, &symtab, &base);
+			name = macho_symtab_name_64(table, ordinal - base);
+			if (name && strstr(name, substring) && macho_query_result_add_64(result, symtab, ordinal - base) < 0) {
+				failed = 1;
+				break;
+			}
+		}
+		goto done;
+	}
+
+	terms = (macho_trigram_term_t_64**) malloc((length - 2) * sizeof(macho_trigram_term_t_64*));
+	if (terms == NULL) {
+		failed = 1;
+		goto done;
+	}
+	for (i = 0; i + 2 < length; i++) {
+		trigram = ((uint32_t) text[i] << 16) | ((uint32_t) text[i + 1] << 8) | text[i + 2];
+		k = macho_trigram_lower(index->terms, index->term_count, trigram);
+		if (k >= index->term_count || index->terms[k].trigram != trigram) {
+			goto done;
+		}
+		for (j = 0; j < term_count && terms[j] != &index->terms[k]; j++);
+		if (j == term_count) {
+			terms[term_count++] = &index->terms[k];
+		}
+	}
+	qsort(terms, term_count, sizeof(macho_trigram_term_t_64*), macho_trigram_term_compare);
+
+	candidates = (uint64_t*) malloc(terms[0]->count * sizeof(uint64_t));
+	if (candidates == NULL) {
+		failed = 1;
+		goto done;
+	}
+	end = &index->postings[index->size];
+	for (i = 0; i < term_count; i++) {
+		if (terms[i]->offset > index->size) {
+			failed = 1;
+			goto done;
+		}
+		data = &index->postings[terms[i]->offset];
+		ordinal = 0;
+		k = 0;
+		count = 0;
+		for (j = 0; j < terms[i]->count && (i == 0 || k < candidate_count); j++) {
+			if (macho_trigram_get(&data, end, &value) < 0) {
+				failed = 1;
+				goto done;
+			}
+			ordinal += value;
+			if (i == 0) {
+				candidates[count++] = ordinal;
+				continue;
+			}
+			while (k < candidate_count && candidates[k] < ordinal) {
+				k++;
+			}
+			if (k < candidate_count && candidates[k] == ordinal) {
+				candidates[count++] = ordinal;
+				k++;
+			}
+		}
+		candidate_count = count;
+		if (candidate_count == 0) {
+			goto done;
+		}
+	}
+
+	for (i = 0; i < candidate_count; i++) {
+		table = macho_trigram_locate(index->macho, candidates[i], &symtab, &base);
+		if (table == NULL) {
+			break;
+		}
+		name = macho_symtab_name_64(table, candidates[i] - base);
+		if (name && strstr(name, substring) && macho_query_result_add_64(result, symtab, candidates[i] - base) < 0) {
+			failed = 1;
+			break;
+		}
+	}
+	debug("Trigram search confirmed %" PRIu64 " of %" PRIu64 " candidates\n", result->count, candidate_count);
+
+done:
+	free(terms);
+	free(candidates);
+	if (failed) {
+		error("Unable to search trigram index\n");
+		macho_query_result_free_64(result);
+		return NULL;
+	}
+	return result;
+}
+
+void macho_trigram_index_debug_64(macho_trigram_index_t_64* index) {
+	uint64_t i = 0;
+	if (index) {
+		debug("\tTrigram Index:\n");
+		debug("\t\tnsyms: 0x%" PRIx64 "\n", index->nsyms);
+		debug("\t\tterms: 0x%" PRIx64 "\n", index->term_count);
+		debug("\t\tsize: 0x%" PRIx64 "\n", index->size);
+		for (i = 0; i < index->term_count; i++) {
+			debug("\t\t%06x\t%u\n", index->terms[i].trigram, index->terms[i].count);
+		}
+	}
+}
+
+void macho_trigram_index_free_64(macho_trigram_index_t_64* index) {
+	if (index) {
+		if (index->map) {
+			// Terms and postings point into the mapped file
+			macho_map_free_64(index->map);
+			index->map = NULL;
+		} else {
+			free(index->terms);
+			free(index->postings);
+		}
+		index->terms = NULL;
+		index->postings = NULL;
+		free(index);
+	}
+}
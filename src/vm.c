@@ -0,0 +1,358 @@
+/**
+ * libmacho-1.0 - vm.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/command.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/vm.h>
+
+static int macho_vm_range_compare(const void* a, const void* b) {
+	const macho_vm_range_t_64* x = (const macho_vm_range_t_64*) a;
+	const macho_vm_range_t_64* y = (const macho_vm_range_t_64*) b;
+	if (x->address < y->address) return -1;
+	if (x->address > y->address) return 1;
+	return 0;
+}
+
+// Range holding an address, whether or not the file backs that byte
+static macho_vm_range_t_64* macho_vm_find(macho_vm_t_64* vm, uint64_t address) {
+	uint64_t low = 0;
+	uint64_t middle = 0;
+	uint64_t high = vm->count;
+	macho_vm_range_t_64* range = NULL;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (vm->ranges[middle].address <= address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0) {
+		return NULL;
+	}
+	range = &vm->ranges[low - 1];
+	return address - range->address < range->size ? range : NULL;
+}
+
+// Pointer format and import table from LC_DYLD_CHAINED_FIXUPS. Every
+//   segment of an image uses the same format, so the first one with any
+//   fixups stands for all of them.
+static int macho_vm_load_fixups(macho_vm_t_64* vm, macho_command_t_64* command) {
+	uint32_t i = 0;
+	uint32_t count = 0;
+	uint32_t offset = 0;
+	uint64_t entry = 0;
+	unsigned char* data = NULL;
+	macho_linkedit_data_cmd_t_64* cmd = NULL;
+	macho_chained_fixups_header_t_64* header = NULL;
+	macho_chained_starts_segment_t_64* starts = NULL;
+
+	cmd = (macho_linkedit_data_cmd_t_64*) macho_view_64(vm->macho->data, vm->macho->size, command->offset,
+			sizeof(macho_linkedit_data_cmd_t_64));
+	if (cmd == NULL) {
+		return -1;
+	}
+	data = (unsigned char*) macho_view_64(vm->macho->data, vm->macho->size, cmd->dataoff, cmd->datasize);
+	header = data ? (macho_chained_fixups_header_t_64*) macho_view_64(data, cmd->datasize, 0,
+			sizeof(macho_chained_fixups_header_t_64)) : NULL;
+	if (header == NULL) {
+		error("Chained fixups run past the end of the image\n");
+		return -1;
+	}
+
+	if (macho_view_64(data, cmd->datasize, header->starts_offset, sizeof(uint32_t))) {
+		count = macho_read32_64(data + header->starts_offset);
+		for (i = 0; i < count && vm->pointer_format == 0; i++) {
+			if (macho_view_64(data, cmd->datasize, header->starts_offset + sizeof(uint32_t) * (i + 1),
+					sizeof(uint32_t)) == NULL) {
+				break;
+			}
+			offset = macho_read32_64(data + header->starts_offset + sizeof(uint32_t) * (i + 1));
+			if (offset == 0) {
+				continue;
+			}
+			starts = (macho_chained_starts_segment_t_64*) macho_view_64(data, cmd->datasize,
+					(uint64_t) header->starts_offset + offset, sizeof(macho_chained_starts_segment_t_64));
+			if (starts) {
+				vm->pointer_format = starts->pointer_format;
+			}
+		}
+	}
+
+	switch (header->imports_format) {
+	case MACHO_CHAINED_IMPORT:
+		entry = sizeof(uint32_t);
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND:
+		entry = sizeof(uint32_t) * 2;
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND64:
+		entry = sizeof(uint64_t) * 2;
+		break;
+	default:
+		entry = 0;
+		break;
+	}
+	if (entry && header->symbols_format == 0 && header->symbols_offset <= cmd->datasize
+			&& macho_view_64(data, cmd->datasize, header->imports_offset, entry * header->imports_count)) {
+		vm->imports = data + header->imports_offset;
+		vm->import_count = header->imports_count;
+		vm->import_format = header->imports_format;
+		vm->symbols = (const char*) data + header->symbols_offset;
+		vm->symbols_size = cmd->datasize - header->symbols_offset;
+	}
+	return 0;
+}
+
+// Name of an import by ordinal, as long as it is terminated inside the table
+static const char* macho_vm_import(macho_vm_t_64* vm, uint64_t ordinal) {
+	uint64_t name = 0;
+	if (vm->imports == NULL || ordinal >= vm->import_count) {
+		return NULL;
+	}
+	switch (vm->import_format) {
+	case MACHO_CHAINED_IMPORT:
+		name = macho_read32_64(vm->imports + ordinal * sizeof(uint32_t)) >> 9;
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND:
+		name = macho_read32_64(vm->imports + ordinal * sizeof(uint32_t) * 2) >> 9;
+		break;
+	case MACHO_CHAINED_IMPORT_ADDEND64:
+		name = macho_read64_64(vm->imports + ordinal * sizeof(uint64_t) * 2) >> 32;
+		break;
+	default:
+		return NULL;
+	}
+	if (name >= vm->symbols_size || memchr(vm->symbols + name, '\0', vm->symbols_size - name) == NULL) {
+		return NULL;
+	}
+	return vm->symbols + name;
+}
+
+/*
+ * Mach-O Address Space Functions
+ */
+macho_vm_t_64* macho_vm_create_64() {
+	macho_vm_t_64* vm = (macho_vm_t_64*) malloc(sizeof(macho_vm_t_64));
+	if (vm) {
+		memset(vm, '\0', sizeof(macho_vm_t_64));
+	}
+	return vm;
+}
+
+macho_vm_t_64* macho_vm_load_64(macho_t_64* macho) {
+	uint64_t i = 0;
+	macho_vm_t_64* vm = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_vm_range_t_64* range = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+
+	vm = macho_vm_create_64();
+	if (vm == NULL) {
+		error("Unable to create address space\n");
+		return NULL;
+	}
+	vm->macho = macho;
+
+	if (macho->segment_count) {
+		vm->ranges = (macho_vm_range_t_64*) malloc(macho->segment_count * sizeof(macho_vm_range_t_64));
+		if (vm->ranges == NULL) {
+			error("Unable to allocate address ranges\n");
+			macho_vm_free_64(vm);
+			return NULL;
+		}
+	}
+
+	// Bytes the file does not have, zero fill or a truncated image, still
+	//   resolve to a range but never to a view
+	vm->base = (uint64_t) -1;
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		if (segment == NULL || segment->command == NULL || segment->command->vmsize == 0) {
+			continue;
+		}
+		range = &vm->ranges[vm->count++];
+		range->address = segment->command->vmaddr;
+		range->size = segment->command->vmsize;
+		range->offset = segment->command->fileoff;
+		range->filesize = segment->data ? segment->size : 0;
+		range->data = segment->data;
+		if (range->filesize > range->size) {
+			range->filesize = range->size;
+		}
+		if (range->offset == 0 && range->filesize) {
+			vm->base = range->address;
+		}
+	}
+	if (vm->count > 1) {
+		qsort(vm->ranges, vm->count, sizeof(macho_vm_range_t_64), macho_vm_range_compare);
+	}
+	if (vm->base == (uint64_t) -1) {
+		vm->base = vm->count ? vm->ranges[0].address : 0;
+	}
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho->commands[i]->cmd == MACHO_CMD_DYLD_CHAINED_FIXUPS) {
+			macho_vm_load_fixups(vm, macho->commands[i]);
+			break;
+		}
+	}
+
+	debug("Address space loaded %llu ranges, base 0x%llx, pointer format %u\n", vm->count, vm->base,
+			vm->pointer_format);
+	return vm;
+}
+
+// Bytes of the mapped image behind an address, or NULL if any of them is
+//   not in the file
+void* macho_vm_view_64(macho_vm_t_64* vm, uint64_t address, uint64_t size) {
+	uint64_t offset = 0;
+	macho_vm_range_t_64* range = NULL;
+
+	if (vm == NULL) {
+		return NULL;
+	}
+	range = macho_vm_find(vm, address);
+	if (range == NULL) {
+		return NULL;
+	}
+	offset = address - range->address;
+	if (offset > range->filesize || size > range->filesize - offset) {
+		return NULL;
+	}
+	return range->data + offset;
+}
+
+const char* macho_vm_string_64(macho_vm_t_64* vm, uint64_t address) {
+	uint64_t offset = 0;
+	const char* string = NULL;
+	macho_vm_range_t_64* range = NULL;
+
+	if (vm == NULL) {
+		return NULL;
+	}
+	range = macho_vm_find(vm, address);
+	if (range == NULL) {
+		return NULL;
+	}
+	offset = address - range->address;
+	if (offset >= range->filesize) {
+		return NULL;
+	}
+	string = (const char*) range->data + offset;
+	return memchr(string, '\0', range->filesize - offset) ? string : NULL;
+}
+
+// Address a stored pointer resolves to. A bind resolves to zero, with the
+//   imported symbol's name in bind when the import table has it.
+uint64_t macho_vm_decode_64(macho_vm_t_64* vm, uint64_t raw, const char** bind) {
+	uint64_t target = 0;
+
+	if (bind) {
+		*bind = NULL;
+	}
+	if (vm == NULL) {
+		return 0;
+	}
+
+	// Stored pointers live in the segment data, which a byte-swapped image
+	//   keeps in its original order
+	if (vm->macho->swapped) {
+		raw = __builtin_bswap64(raw);
+	}
+
+	switch (vm->pointer_format) {
+	case MACHO_CHAINED_PTR_64:
+	case MACHO_CHAINED_PTR_64_OFFSET:
+		if (raw >> 63) {
+			if (bind) {
+				*bind = macho_vm_import(vm, raw & 0xFFFFFF);
+			}
+			return 0;
+		}
+		target = (raw & 0xFFFFFFFFFULL) | (((raw >> 36) & 0xFF) << 56);
+		return vm->pointer_format == MACHO_CHAINED_PTR_64_OFFSET ? vm->base + target : target;
+	case MACHO_CHAINED_PTR_ARM64E:
+	case MACHO_CHAINED_PTR_ARM64E_KERNEL:
+	case MACHO_CHAINED_PTR_ARM64E_USERLAND:
+	case MACHO_CHAINED_PTR_ARM64E_USERLAND24:
+		if ((raw >> 62) & 1) {
+			if (bind) {
+				*bind = macho_vm_import(vm, raw & (vm->pointer_format == MACHO_CHAINED_PTR_ARM64E_USERLAND24
+						? 0xFFFFFF : 0xFFFF));
+			}
+			return 0;
+		}
+		// Authenticated pointers carry a signing schema instead of high bits
+		if (raw >> 63) {
+			return vm->base + (raw & 0xFFFFFFFF);
+		}
+		target = (raw & 0x7FFFFFFFFFFULL) | (((raw >> 43) & 0xFF) << 56);
+		return vm->pointer_format == MACHO_CHAINED_PTR_ARM64E ? target : vm->base + target;
+	default:
+		return raw;
+	}
+}
+
+uint64_t macho_vm_pointer_64(macho_vm_t_64* vm, uint64_t address, const char** bind) {
+	const void* slot = macho_vm_view_64(vm, address, sizeof(uint64_t));
+	if (slot == NULL) {
+		if (bind) {
+			*bind = NULL;
+		}
+		return 0;
+	}
+	return macho_vm_decode_64(vm, macho_read64_64(slot), bind);
+}
+
+void macho_vm_debug_64(macho_vm_t_64* vm) {
+	uint64_t i = 0;
+	if (vm) {
+		debug("\tAddress Space:\n");
+		debug("\t\tbase: 0x%llx\n", vm->base);
+		debug("\t\tpointer format: %u\n", vm->pointer_format);
+		debug("\t\timports: %u\n", vm->import_count);
+		for (i = 0; i < vm->count; i++) {
+			debug("\t\t0x%016llx-0x%016llx\tfile 0x%llx+0x%llx\n", vm->ranges[i].address,
+					vm->ranges[i].address + vm->ranges[i].size, vm->ranges[i].offset, vm->ranges[i].filesize);
+		}
+	}
+}
+
+void macho_vm_free_64(macho_vm_t_64* vm) {
+	if (vm) {
+		if (vm->ranges) {
+			free(vm->ranges);
+			vm->ranges = NULL;
+		}
+		free(vm);
+	}
+}
@@ -0,0 +1,471 @@
+/**
+ * libmacho-1.0 - writer.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/writer.h>
+
+#define MACHO_WRITER_HEADER_SIZE      sizeof(macho_header_t_64)
+#define MACHO_WRITER_NCMDS_OFFSET     offsetof(macho_header_t_64, ncmds)
+#define MACHO_WRITER_SIZEOFCMDS_OFFSET offsetof(macho_header_t_64, sizeofcmds)
+#define MACHO_WRITER_SEGNAME_OFFSET   offsetof(macho_segment_cmd_t_64, segname)
+#define MACHO_WRITER_VMSIZE_OFFSET    offsetof(macho_segment_cmd_t_64, vmsize)
+#define MACHO_WRITER_FILESIZE_OFFSET  offsetof(macho_segment_cmd_t_64, filesize)
+#define MACHO_WRITER_VM_PAGE_SIZE     0x4000
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+typedef struct macho_writer_output_t_64 {
+	int fd;
+	int source_fd;
+	int iov_count;
+	struct iovec iov[IOV_MAX];
+} macho_writer_output_t_64;
+
+/*
+ * Output helpers: buffered iovecs for writev, copy_file_range for source
+ *   ranges when the caller gave us a descriptor for the original file.
+ */
+static int macho_writer_flush_64(macho_writer_output_t_64* out) {
+	int i = 0;
+	ssize_t written = 0;
+	struct iovec* iov = out->iov;
+	int count = out->iov_count;
+
+	while (count > 0) {
+		written = writev(out->fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			error("Unable to write output: %s\n", strerror(errno));
+			return -1;
+		}
+		// Skip whatever the kernel consumed and retry the rest
+		for (i = 0; i < count && (size_t) written >= iov[i].iov_len; i++) {
+			written -= iov[i].iov_len;
+		}
+		iov += i;
+		count -= i;
+		if (count > 0) {
+			iov[0].iov_base = (unsigned char*) iov[0].iov_base + written;
+			iov[0].iov_len -= written;
+		}
+	}
+	out->iov_count = 0;
+	return 0;
+}
+
+static int macho_writer_emit_64(macho_writer_output_t_64* out, const unsigned char* data, uint64_t size) {
+	uint64_t chunk = 0;
+	while (size > 0) {
+		if (out->iov_count == IOV_MAX && macho_writer_flush_64(out) < 0) {
+			return -1;
+		}
+		chunk = (size > SSIZE_MAX / 2) ? SSIZE_MAX / 2 : size;
+		out->iov[out->iov_count].iov_base = (void*) data;
+		out->iov[out->iov_count].iov_len = chunk;
+		out->iov_count++;
+		data += chunk;
+		size -= chunk;
+	}
+	return 0;
+}
+
+static int macho_writer_emit_source_64(macho_writer_output_t_64* out, const unsigned char* base,
+		uint64_t offset, uint64_t size) {
+#ifdef __linux__
+	ssize_t copied = 0;
+	loff_t position = (loff_t) offset;
+
+	if (out->source_fd >= 0 && size > 0) {
+		if (macho_writer_flush_64(out) < 0) {
+			return -1;
+		}
+		while (size > 0) {
+			copied = copy_file_range(out->source_fd, &position, out->fd, NULL, size, 0);
+			if (copied < 0 && errno == EINTR) {
+				continue;
+			}
+			if (copied <= 0) {
+				// Cross-filesystem or unsupported, the mapping still works
+				debug("copy_file_range unavailable, falling back to writev\n");
+				out->source_fd = -1;
+				break;
+			}
+			size -= copied;
+		}
+		offset = (uint64_t) position;
+		if (size == 0) {
+			return 0;
+		}
+	}
+#endif
+	return macho_writer_emit_64(out, base + offset, size);
+}
+
+/*
+ * Mach-O Writer Functions
+ */
+macho_writer_t_64* macho_writer_create_64() {
+	macho_writer_t_64* writer = (macho_writer_t_64*) malloc(sizeof(macho_writer_t_64));
+	if (writer) {
+		memset(writer, '\0', sizeof(macho_writer_t_64));
+		writer->source_fd = -1;
+	}
+	return writer;
+}
+
+macho_writer_t_64* macho_writer_load_64(macho_t_64* macho) {
+	int i = 0;
+	int j = 0;
+	uint32_t type = 0;
+	unsigned char* data = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_writer_t_64* writer = NULL;
+
+	if (macho == NULL) {
+		return NULL;
+	}
+	if (macho->swapped) {
+		error("Unable to write a byte-swapped Mach-O\n");
+		return NULL;
+	}
+
+	writer = macho_writer_create_64();
+	if (writer == NULL) {
+		error("Unable to create writer\n");
+		return NULL;
+	}
+	writer->macho = macho;
+	data = (unsigned char*) macho->data;
+
+	for (i = 0; i < macho->command_count; i++) {
+		if (macho_writer_add_command_64(writer, &data[macho->commands[i]->offset], macho->commands[i]->size) < 0) {
+			macho_writer_free_64(writer);
+			return NULL;
+		}
+	}
+
+	// The load commands can grow into the padding up to the first byte of
+	//   real segment data, never past it.
+	writer->header_limit = macho->size;
+	for (i = 0; i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		if (segment->command->fileoff > 0 && segment->command->filesize > 0
+				&& segment->command->fileoff < writer->header_limit) {
+			writer->header_limit = segment->command->fileoff;
+		}
+		for (j = 0; j < segment->section_count; j++) {
+			if (segment->sections == NULL || segment->sections[j] == NULL) {
+				continue;
+			}
+			info = segment->sections[j]->info;
+			type = info->flags & MACHO_SECTION_TYPE;
+			if (type == MACHO_SECTION_ZEROFILL || type == MACHO_SECTION_GB_ZEROFILL
+					|| type == MACHO_SECTION_THREAD_LOCAL_ZEROFILL) {
+				continue;
+			}
+			if (info->offset > 0 && info->size > 0 && info->offset < writer->header_limit) {
+				writer->header_limit = info->offset;
+			}
+		}
+	}
+
+	segment = macho_get_segment_64(macho, "__LINKEDIT");
+	if (segment && segment->command->fileoff < macho->size) {
+		writer->linkedit_offset = segment->command->fileoff;
+		writer->linkedit_size = segment->command->filesize;
+		if (writer->linkedit_offset + writer->linkedit_size > macho->size) {
+			writer->linkedit_size = macho->size - writer->linkedit_offset;
+		}
+	}
+	return writer;
+}
+
+int macho_writer_set_source_fd_64(macho_writer_t_64* writer, int fd) {
+	if (writer == NULL) {
+		return -1;
+	}
+	writer->source_fd = fd;
+	return 0;
+}
+
+int macho_writer_remove_command_64(macho_writer_t_64* writer, uint64_t index) {
+	if (writer == NULL || index >= writer->command_count) {
+		return -1;
+	}
+	free(writer->commands[index].data);
+	memmove(&writer->commands[index], &writer->commands[index + 1],
+			(writer->command_count - index - 1) * sizeof(macho_writer_command_t_64));
+	writer->command_count--;
+	return 0;
+}
+
+int macho_writer_add_command_64(macho_writer_t_64* writer, const unsigned char* data, uint32_t size) {
+	uint64_t capacity = 0;
+	macho_writer_command_t_64* commands = NULL;
+	macho_writer_command_t_64* command = NULL;
+
+	if (writer == NULL || data == NULL || size < 8) {
+		return -1;
+	}
+	if (writer->command_count == writer->command_capacity) {
+		capacity = writer->command_capacity ? writer->command_capacity * 2 : 32;
+		commands = (macho_writer_command_t_64*) realloc(writer->commands, capacity * sizeof(macho_writer_command_t_64));
+		if (commands == NULL) {
+			error("Unable to grow writer commands\n");
+			return -1;
+		}
+		writer->commands = commands;
+		writer->command_capacity = capacity;
+	}
+
+	command = &writer->commands[writer->command_count];
+	command->data = (unsigned char*) malloc(size);
+	if (command->data == NULL) {
+		return -1;
+	}
+	memcpy(command->data, data, size);
+	memcpy(&command->cmd, data, sizeof(uint32_t));
+	command->size = size;
+	writer->command_count++;
+	return 0;
+}
+
+macho_writer_command_t_64* macho_writer_find_command_64(macho_writer_t_64* writer, uint32_t cmd) {
+	uint64_t i = 0;
+	if (writer) {
+		for (i = 0; i < writer->command_count; i++) {
+			if (writer->commands[i].cmd == cmd) {
+				return &writer->commands[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+int macho_writer_set_linkedit_64(macho_writer_t_64* writer, unsigned char* data, uint64_t size) {
+	if (writer == NULL || writer->linkedit_offset == 0) {
+		return -1;
+	}
+	writer->linkedit = data;
+	writer->linkedit_size = size;
+	return 0;
+}
+
+int macho_writer_remove_signature_64(macho_writer_t_64* writer) {
+	uint64_t i = 0;
+	macho_linkedit_data_cmd_t_64 cmd;
+
+	if (writer == NULL) {
+		return -1;
+	}
+	for (i = 0; i < writer->command_count; i++) {
+		if (writer->commands[i].cmd == MACHO_CMD_CODE_SIGNATURE) {
+			break;
+		}
+	}
+	if (i == writer->command_count) {
+		return 0;
+	}
+
+	memcpy(&cmd, writer->commands[i].data, sizeof(cmd));
+	// The signature is normally the last blob in __LINKEDIT, in which case
+	//   dropping it is only a matter of ending the copy earlier.
+	if (writer->linkedit == NULL && cmd.dataoff >= writer->linkedit_offset
+			&& cmd.dataoff + cmd.datasize >= writer->linkedit_offset + writer->linkedit_size) {
+		writer->linkedit_size = cmd.dataoff - writer->linkedit_offset;
+	}
+	return macho_writer_remove_command_64(writer, i);
+}
+
+static void macho_writer_fixup_linkedit_64(macho_writer_t_64* writer) {
+	uint64_t i = 0;
+	uint64_t vmsize = 0;
+	uint64_t filesize = 0;
+	macho_writer_command_t_64* command = NULL;
+
+	for (i = 0; i < writer->command_count; i++) {
+		command = &writer->commands[i];
+		if (command->cmd != MACHO_CMD_SEGMENT_64 || command->size < MACHO_WRITER_FILESIZE_OFFSET + 8) {
+			continue;
+		}
+		if (strncmp((const char*) &command->data[MACHO_WRITER_SEGNAME_OFFSET], "__LINKEDIT", 16) != 0) {
+			continue;
+		}
+		filesize = writer->linkedit_size;
+		memcpy(&command->data[MACHO_WRITER_FILESIZE_OFFSET], &filesize, sizeof(filesize));
+		memcpy(&vmsize, &command->data[MACHO_WRITER_VMSIZE_OFFSET], sizeof(vmsize));
+		if (vmsize < filesize) {
+			vmsize = (filesize + MACHO_WRITER_VM_PAGE_SIZE - 1) & ~((uint64_t) MACHO_WRITER_VM_PAGE_SIZE - 1);
+			memcpy(&command->data[MACHO_WRITER_VMSIZE_OFFSET], &vmsize, sizeof(vmsize));
+		}
+	}
+}
+
+int macho_writer_write_64(macho_writer_t_64* writer, int fd) {
+	int ret = 0;
+	uint64_t i = 0;
+	uint64_t end = 0;
+	uint32_t ncmds = 0;
+	uint32_t sizeofcmds = 0;
+	unsigned char* data = NULL;
+	unsigned char* header = NULL;
+	macho_segment_t_64* segment = NULL;
+	macho_writer_output_t_64* out = NULL;
+
+	if (writer == NULL || fd < 0) {
+		return -1;
+	}
+	data = (unsigned char*) writer->macho->data;
+
+	// The output ends with __LINKEDIT, so anything the source carries past
+	//   it would be dropped; refuse instead of writing a shorter image
+	segment = macho_get_segment_64(writer->macho, "__LINKEDIT");
+	if (writer->linkedit_offset && segment
+			&& segment->command->fileoff + segment->command->filesize < writer->macho->size) {
+		error("Unable to write 0x%" PRIx64 " bytes following __LINKEDIT\n",
+				writer->macho->size - (segment->command->fileoff + segment->command->filesize));
+		return -1;
+	}
+
+	for (i = 0; i < writer->command_count; i++) {
+		sizeofcmds += writer->commands[i].size;
+	}
+	ncmds = writer->command_count;
+	if (MACHO_WRITER_HEADER_SIZE + sizeofcmds > writer->header_limit) {
+		error("Load commands need 0x%" PRIx64 " bytes but only 0x%" PRIx64 " are available\n",
+				(uint64_t) MACHO_WRITER_HEADER_SIZE + sizeofcmds, writer->header_limit);
+		return -1;
+	}
+	macho_writer_fixup_linkedit_64(writer);
+
+	// Only the header and load commands are materialized here; the padding
+	//   after them is zeroed so stale commands don't linger.
+	header = (unsigned char*) malloc(writer->header_limit);
+	out = (macho_writer_output_t_64*) malloc(sizeof(macho_writer_output_t_64));
+	if (header == NULL || out == NULL) {
+		error("Unable to allocate writer output\n");
+		if (header) free(header);
+		if (out) free(out);
+		return -1;
+	}
+	memset(header, '\0', writer->header_limit);
+	memcpy(header, data, MACHO_WRITER_HEADER_SIZE);
+	memcpy(&header[MACHO_WRITER_NCMDS_OFFSET], &ncmds, sizeof(ncmds));
+	memcpy(&header[MACHO_WRITER_SIZEOFCMDS_OFFSET], &sizeofcmds, sizeof(sizeofcmds));
+	end = MACHO_WRITER_HEADER_SIZE;
+	for (i = 0; i < writer->command_count; i++) {
+		memcpy(&header[end], writer->commands[i].data, writer->commands[i].size);
+		end += writer->commands[i].size;
+	}
+
+	memset(out, '\0', sizeof(macho_writer_output_t_64));
+	out->fd = fd;
+	out->source_fd = writer->source_fd;
+
+	end = writer->linkedit_offset ? writer->linkedit_offset : writer->macho->size;
+	ret = macho_writer_emit_64(out, header, writer->header_limit);
+	if (ret == 0) {
+		ret = macho_writer_emit_source_64(out, data, writer->header_limit, end - writer->header_limit);
+	}
+	if (ret == 0 && writer->linkedit_offset) {
+		if (writer->linkedit) {
+			ret = macho_writer_emit_64(out, writer->linkedit, writer->linkedit_size);
+		} else {
+			ret = macho_writer_emit_source_64(out, data, writer->linkedit_offset, writer->linkedit_size);
+		}
+	}
+	if (ret == 0) {
+		ret = macho_writer_flush_64(out);
+	}
+
+	free(out);
+	free(header);
+	return ret;
+}
+
+int macho_writer_save_64(macho_writer_t_64* writer, const char* path) {
+	int fd = -1;
+	int ret = 0;
+
+	if (writer == NULL || path == NULL) {
+		return -1;
+	}
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+	if (fd < 0) {
+		error("Unable to create %s\n", path);
+		return -1;
+	}
+	ret = macho_writer_write_64(writer, fd);
+	if (close(fd) < 0) {
+		ret = -1;
+	}
+	return ret;
+}
+
+void macho_writer_debug_64(macho_writer_t_64* writer) {
+	uint64_t i = 0;
+	if (writer) {
+		debug("\tWriter:\n");
+		debug("\t\t   header limit: 0x%" PRIx64 "\n", writer->header_limit);
+		debug("\t\tlinkedit offset: 0x%" PRIx64 "\n", writer->linkedit_offset);
+		debug("\t\t  linkedit size: 0x%" PRIx64 "%s\n", writer->linkedit_size, writer->linkedit ? " (rewritten)" : "");
+		for (i = 0; i < writer->command_count; i++) {
+			debug("\t\tcommand %" PRIu64 ": cmd=0x%x size=0x%x\n", i, writer->commands[i].cmd, writer->commands[i].size);
+		}
+	}
+}
+
+void macho_writer_free_64(macho_writer_t_64* writer) {
+	uint64_t i = 0;
+	if (writer) {
+		if (writer->commands) {
+			for (i = 0; i < writer->command_count; i++) {
+				free(writer->commands[i].data);
+			}
+			free(writer->commands);
+			writer->commands = NULL;
+		}
+		free(writer);
+	}
+}
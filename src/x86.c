@@ -0,0 +1,252 @@
+/**
+ * libmacho-1.0 - x86.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "x86.h"
+
+#define MACHO_X86_MAX_LENGTH 15
+
+#define MACHO_X86_MODRM   0x01 // ModRM byte, and whatever it implies, follows the opcode
+#define MACHO_X86_IMM8    0x02
+#define MACHO_X86_IMMZ    0x04 // 32 bit immediate, 16 bit with an operand size prefix
+#define MACHO_X86_IMM16   0x08
+#define MACHO_X86_INVALID 0x10 // undefined in 64 bit mode
+#define MACHO_X86_IMMV    0x20 // 32 bit immediate, 64 bit with REX.W
+#define MACHO_X86_MOFFS   0x40 // 64 bit absolute address, 32 bit with an address size prefix
+#define MACHO_X86_IMM32   0x80 // 32 bit displacement whatever the prefixes
+
+/*
+ * One byte opcode map
+ */
+static const uint8_t macho_x86_map_one[256] = {
+	0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x10, 0x10, 0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x10, 0x00,
+	0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x10, 0x10, 0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x10, 0x10,
+	0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x00, 0x10, 0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x00, 0x10,
+	0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x00, 0x10, 0x01, 0x01, 0x01, 0x01, 0x02, 0x04, 0x00, 0x10,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x10, 0x10, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x05, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+	0x03, 0x05, 0x10, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+	0x03, 0x03, 0x08, 0x00, 0x00, 0x00, 0x03, 0x05, 0x0A, 0x00, 0x08, 0x00, 0x00, 0x02, 0x10, 0x00,
+	0x01, 0x01, 0x01, 0x01, 0x10, 0x10, 0x10, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x80, 0x80, 0x10, 0x02, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01,
+};
+
+/*
+ * Two byte opcode map, after 0F
+ */
+static const uint8_t macho_x86_map_two[256] = {
+	0x01, 0x01, 0x01, 0x01, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x10, 0x01, 0x00, 0x03,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x10, 0x10, 0x10, 0x10, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x03, 0x03, 0x03, 0x03, 0x01, 0x01, 0x01, 0x00, 0x01, 0x01, 0x10, 0x10, 0x01, 0x01, 0x01, 0x01,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x00, 0x00, 0x00, 0x01, 0x03, 0x01, 0x10, 0x10, 0x00, 0x00, 0x00, 0x01, 0x03, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x03, 0x01, 0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+};
+
+// VEX and EVEX encode the opcode map as 1 for 0F, 2 for 0F 38 and 3 for
+//   0F 3A, and every instruction in them but VZEROUPPER and VZEROALL has a
+//   ModRM byte
+static uint8_t macho_x86_map_flags(uint32_t map, uint8_t opcode) {
+	if (map == 1 && opcode == 0x77) {
+		return 0;
+	}
+	if (map == 1) {
+		return (macho_x86_map_two[opcode] & MACHO_X86_IMM8) | MACHO_X86_MODRM;
+	}
+	return map == 3 ? MACHO_X86_MODRM | MACHO_X86_IMM8 : MACHO_X86_MODRM;
+}
+
+/*
+ * Internal x86_64 Length Decoder Functions
+ */
+
+// Fills in the length of the instruction at code and returns 0, or returns
+//   -1 if the bytes do not form a valid instruction within size
+int macho_x86_decode_64(const unsigned char* code, uint64_t size, macho_x86_insn_t_64* insn) {
+	int rex = 0;
+	int opsize = 0;
+	int adsize = 0;
+	uint8_t flags = 0;
+	uint8_t opcode = 0;
+	uint8_t modrm = 0;
+	uint32_t map = 0;
+	uint32_t i = 0;
+	uint32_t limit = 0;
+	uint32_t displacement = 0;
+	uint32_t immediate = 0;
+	uint32_t operand = 0;
+
+	memset(insn, '\0', sizeof(macho_x86_insn_t_64));
+	limit = size < MACHO_X86_MAX_LENGTH ? (uint32_t) size : MACHO_X86_MAX_LENGTH;
+
+	// Legacy prefixes in any order, then at most one REX directly before
+	//   the opcode
+	for (; i < limit; i++) {
+		if (code[i] == 0x66) {
+			opsize = 1;
+		} else if (code[i] == 0x67) {
+			adsize = 1;
+		} else if (code[i] != 0xF0 && code[i] != 0xF2 && code[i] != 0xF3 && code[i] != 0x2E && code[i] != 0x36
+				&& code[i] != 0x3E && code[i] != 0x26 && code[i] != 0x64 && code[i] != 0x65) {
+			break;
+		}
+	}
+	if (i < limit && (code[i] & 0xF0) == 0x40) {
+		rex = code[i++];
+	}
+	if (i >= limit) {
+		return -1;
+	}
+
+	opcode = code[i++];
+	if (opcode == 0xC5 || opcode == 0xC4 || opcode == 0x62) {
+		// VEX and EVEX carry their own REX, operand size and map
+		if (rex || i >= limit) {
+			return -1;
+		}
+		if (opcode == 0xC5) {
+			map = 1;
+			i += 1;
+		} else if (opcode == 0xC4) {
+			map = code[i] & 0x1F;
+			i += 2;
+		} else {
+			map = code[i] & 0x07;
+			i += 3;
+		}
+		if (map == 0 || i >= limit) {
+			return -1;
+		}
+		opcode = code[i++];
+		flags = macho_x86_map_flags(map, opcode);
+	} else if (opcode == 0x0F) {
+		if (i >= limit) {
+			return -1;
+		}
+		opcode = code[i++];
+		if (opcode == 0x38 || opcode == 0x3A) {
+			map = opcode == 0x38 ? 2 : 3;
+			if (i >= limit) {
+				return -1;
+			}
+			opcode = code[i++];
+			flags = macho_x86_map_flags(map, opcode);
+		} else {
+			map = 1;
+			flags = macho_x86_map_two[opcode];
+		}
+	} else {
+		flags = macho_x86_map_one[opcode];
+	}
+	if (flags & MACHO_X86_INVALID) {
+		return -1;
+	}
+
+	if (flags & MACHO_X86_MODRM) {
+		if (i >= limit) {
+			return -1;
+		}
+		modrm = code[i++];
+		if ((modrm & 0xC0) != 0xC0) {
+			if ((modrm & 0x07) == 0x04) {
+				// SIB, a missing base takes a 32 bit displacement
+				if (i >= limit) {
+					return -1;
+				}
+				if ((modrm & 0xC0) == 0x00 && (code[i] & 0x07) == 0x05) {
+					displacement = 4;
+				}
+				i++;
+			} else if ((modrm & 0xC7) == 0x05) {
+				insn->flags |= MACHO_X86_RIP;
+				displacement = 4;
+			}
+			if ((modrm & 0xC0) == 0x40) {
+				displacement = 1;
+			} else if ((modrm & 0xC0) == 0x80) {
+				displacement = 4;
+			}
+		}
+		if (map == 0 && (opcode == 0xF6 || opcode == 0xF7) && (modrm & 0x38) < 0x10) {
+			// TEST carries an immediate, the other group 3 forms do not
+			flags |= opcode == 0xF6 ? MACHO_X86_IMM8 : MACHO_X86_IMMZ;
+		}
+		if (map == 0 && opcode == 0x8D) {
+			insn->flags |= MACHO_X86_LEA;
+		}
+		if (map == 0 && opcode == 0xFF && (modrm & 0x38) == 0x10) {
+			insn->flags |= MACHO_X86_CALL;
+		}
+	}
+
+	operand = i + displacement;
+	if (flags & MACHO_X86_IMM8) {
+		immediate += 1;
+	}
+	if (flags & MACHO_X86_IMM16) {
+		immediate += 2;
+	}
+	if (flags & MACHO_X86_IMMZ) {
+		immediate += opsize ? 2 : 4;
+	}
+	if (flags & MACHO_X86_IMMV) {
+		immediate += (rex & 0x08) ? 8 : (opsize ? 2 : 4);
+	}
+	if (flags & MACHO_X86_MOFFS) {
+		immediate += adsize ? 4 : 8;
+	}
+	if (flags & MACHO_X86_IMM32) {
+		immediate += 4;
+		insn->flags |= MACHO_X86_REL32;
+		if (map == 0 && opcode == 0xE8) {
+			insn->flags |= MACHO_X86_CALL;
+		}
+	}
+	if (operand + immediate > limit) {
+		return -1;
+	}
+	insn->length = operand + immediate;
+
+	if (insn->flags & MACHO_X86_RIP) {
+		insn->displacement = (int32_t) (code[i] | (code[i + 1] << 8) | (code[i + 2] << 16) | ((uint32_t) code[i + 3] << 24));
+	} else if (insn->flags & MACHO_X86_REL32) {
+		insn->displacement = (int32_t) (code[operand] | (code[operand + 1] << 8) | (code[operand + 2] << 16)
+				| ((uint32_t) code[operand + 3] << 24));
+	}
+	return 0;
+}
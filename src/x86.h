@@ -0,0 +1,46 @@
+/**
+ * libmacho-1.0 - x86.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_X86_H_
+#define MACHO_X86_H_
+
+#include <stdint.h>
+
+#define MACHO_X86_RIP    0x1 // memory operand is relative to the next instruction
+#define MACHO_X86_LEA    0x2 // operand address is computed rather than accessed
+#define MACHO_X86_REL32  0x4 // CALL or JMP with a 32 bit displacement
+#define MACHO_X86_CALL   0x8 // CALL, either direct or through memory
+
+/*
+ * Only as much of an instruction as it takes to find its length and any
+ *   operand relative to the instruction pointer.
+ */
+typedef struct macho_x86_insn_t_64 {
+	uint32_t length;
+	uint32_t flags;		/* MACHO_X86_* */
+	int64_t displacement;	/* from the end of the instruction */
+} macho_x86_insn_t_64;
+
+/*
+ * Internal x86_64 Length Decoder Functions
+ */
+int macho_x86_decode_64(const unsigned char* code, uint64_t size, macho_x86_insn_t_64* insn);
+
+#endif /* MACHO_X86_H_ */
@@ -0,0 +1,644 @@
+/**
+ * libmacho-1.0 - xref.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MACHO_XREF_X86 1
+#include <immintrin.h>
+#endif
+
+#include <libcrippy-1.0/debug.h>
+#include <libcrippy-1.0/libcrippy.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/fat.h>
+#include <libmacho-1.0/vm.h>
+#include <libmacho-1.0/function.h>
+#include <libmacho-1.0/xref.h>
+
+#include "pool.h"
+#include "x86.h"
+
+#define MACHO_XREF_CHUNK        0x40000 // bytes of a section scanned by one job, at least
+#define MACHO_XREF_BLOCK        64      // instructions classified per mask
+#define MACHO_XREF_ARM64_WINDOW 0x20    // instructions searched for the other half of an ADRP pair
+#define MACHO_XREF_PROT_WRITE   0x2
+
+typedef uint64_t (*macho_xref_block_t_64)(const unsigned char* code);
+
+typedef struct macho_xref_chunk_t_64 {
+	uint32_t cputype;	/* of the instructions, 0 for pointers */
+	uint64_t address;	/* of the section */
+	const unsigned char* data;	/* view of the whole section */
+	uint64_t size;
+	uint64_t start;		/* of this chunk within the section */
+	uint64_t end;
+	uint64_t count;
+	uint64_t capacity;
+	macho_xref_t_64* xrefs;	/* sorted once the chunk is done */
+} macho_xref_chunk_t_64;
+
+typedef struct macho_xref_build_t_64 {
+	uint32_t cputype;
+	macho_vm_t_64* vm;
+	macho_functions_t_64* functions;
+	uint64_t chunk_count;
+	uint64_t chunk_capacity;
+	macho_xref_chunk_t_64* chunks;
+} macho_xref_build_t_64;
+
+static int macho_xref_compare(const void* a, const void* b) {
+	const macho_xref_t_64* x = (const macho_xref_t_64*) a;
+	const macho_xref_t_64* y = (const macho_xref_t_64*) b;
+	if (x->target != y->target) return x->target < y->target ? -1 : 1;
+	if (x->source != y->source) return x->source < y->source ? -1 : 1;
+	return 0;
+}
+
+static int macho_xref_add(macho_xref_chunk_t_64* chunk, uint64_t target, uint64_t source, uint32_t kind) {
+	uint64_t capacity = 0;
+	macho_xref_t_64* xrefs = NULL;
+	if (chunk->count == chunk->capacity) {
+		capacity = chunk->capacity ? chunk->capacity * 2 : 256;
+		xrefs = (macho_xref_t_64*) realloc(chunk->xrefs, capacity * sizeof(macho_xref_t_64));
+		if (xrefs == NULL) {
+			return -1;
+		}
+		chunk->xrefs = xrefs;
+		chunk->capacity = capacity;
+	}
+	chunk->xrefs[chunk->count].target = target;
+	chunk->xrefs[chunk->count].source = source;
+	chunk->xrefs[chunk->count].kind = kind;
+	chunk->xrefs[chunk->count].reserved = 0;
+	chunk->count++;
+	return 0;
+}
+
+static int64_t macho_xref_sign_extend(uint64_t value, int bits) {
+	return (int64_t) (value << (64 - bits)) >> (64 - bits);
+}
+
+/*
+ * ARM64 candidate classification. ADR and ADRP share an encoding apart
+ *   from the top bit, literal loads cover LDR, LDRSW and PRFM.
+ */
+static uint64_t macho_xref_arm64_block_generic(const unsigned char* code) {
+	int i = 0;
+	uint32_t insn = 0;
+	uint64_t bits = 0;
+	for (i = 0; i < MACHO_XREF_BLOCK; i++) {
+		insn = macho_read32_64(code + i * sizeof(uint32_t));
+		if ((insn & 0x1F000000) == 0x10000000 || (insn & 0x3B000000) == 0x18000000) {
+			bits |= 1ULL << i;
+		}
+	}
+	return bits;
+}
+
+#ifdef MACHO_XREF_X86
+/*
+ * AVX2 classification, 8 instructions per compare
+ */
+__attribute__((target("avx2")))
+static uint64_t macho_xref_arm64_block_avx2(const unsigned char* code) {
+	int i = 0;
+	uint64_t bits = 0;
+	__m256i adr_mask = _mm256_set1_epi32(0x1F000000);
+	__m256i adr = _mm256_set1_epi32(0x10000000);
+	__m256i literal_mask = _mm256_set1_epi32(0x3B000000);
+	__m256i literal = _mm256_set1_epi32(0x18000000);
+	for (i = 0; i < MACHO_XREF_BLOCK; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (code + i * sizeof(uint32_t)));
+		__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, adr_mask), adr),
+				_mm256_cmpeq_epi32(_mm256_and_si256(v, literal_mask), literal));
+		bits |= (uint64_t) (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(hit)) << i;
+	}
+	return bits;
+}
+#endif /* MACHO_XREF_X86 */
+
+/*
+ * Backend selection, done once per process
+ */
+static pthread_once_t macho_xref_once = PTHREAD_ONCE_INIT;
+static const char* macho_xref_backend = "generic";
+static macho_xref_block_t_64 macho_xref_arm64_block = macho_xref_arm64_block_generic;
+
+static void macho_xref_init_64() {
+	if (getenv("LIBMACHO_NO_XREF_SIMD")) {
+		return;
+	}
+#ifdef MACHO_XREF_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		macho_xref_backend = "avx2";
+		macho_xref_arm64_block = macho_xref_arm64_block_avx2;
+	}
+#endif
+}
+
+const char* macho_xref_backend_64() {
+	pthread_once(&macho_xref_once, macho_xref_init_64);
+	return macho_xref_backend;
+}
+
+/*
+ * ARM64 decoding
+ */
+
+// Whether an instruction overwrites a general purpose register, only the
+//   data processing and load classes are told apart
+static int macho_xref_arm64_clobbers(uint32_t insn, uint32_t reg) {
+	if ((insn & 0x1C000000) == 0x10000000 || (insn & 0x0E000000) == 0x0A000000) {
+		return (insn & 0x1F) == reg;
+	}
+	if ((insn & 0x0A000000) == 0x08000000 && !(insn & 0x04000000) && (insn & 0x00400000)) {
+		if ((insn & 0x1F) == reg) {
+			return 1;
+		}
+		return (insn & 0x3A000000) == 0x28000000 && ((insn >> 10) & 0x1F) == reg;
+	}
+	return 0;
+}
+
+// Follows the register an ADRP loaded a page into until an ADD or a load
+//   or store uses it as a base, it is overwritten or control leaves
+static int macho_xref_arm64_pair(macho_xref_chunk_t_64* chunk, uint64_t offset, uint32_t reg, uint64_t page) {
+	int i = 0;
+	uint32_t rt = 0;
+	uint32_t insn = 0;
+	uint32_t scale = 0;
+	uint32_t opc = 0;
+	uint64_t pc = 0;
+
+	for (i = 1; i <= MACHO_XREF_ARM64_WINDOW; i++) {
+		if (offset + (i + 1) * sizeof(uint32_t) > chunk->size) {
+			break;
+		}
+		insn = macho_read32_64(chunk->data + offset + i * sizeof(uint32_t));
+		pc = chunk->address + offset + i * sizeof(uint32_t);
+
+		// ADD (immediate), 64 bit, optionally shifted by 12
+		if ((insn & 0xFF800000) == 0x91000000 && ((insn >> 5) & 0x1F) == reg) {
+			if (macho_xref_add(chunk, page + (((insn >> 10) & 0xFFF) << ((insn & 0x00400000) ? 12 : 0)),
+					pc, MACHO_XREF_ADDRESS) < 0) {
+				return -1;
+			}
+			if ((insn & 0x1F) == reg) {
+				break;
+			}
+			continue;
+		}
+
+		// LDR and STR (unsigned immediate), scaled by the access size
+		if ((insn & 0x3B000000) == 0x39000000 && ((insn >> 5) & 0x1F) == reg) {
+			opc = (insn >> 22) & 0x3;
+			scale = insn >> 30;
+			if ((insn & 0x04000000) && (opc & 0x2)) {
+				scale = 4;
+			}
+			if (macho_xref_add(chunk, page + (((insn >> 10) & 0xFFF) << scale), pc, MACHO_XREF_LOAD) < 0) {
+				return -1;
+			}
+			rt = insn & 0x1F;
+			if (!(insn & 0x04000000) && opc && rt == reg) {
+				break;
+			}
+			continue;
+		}
+
+		// Unconditional branches, calls and returns end the search, hints
+		//   and conditional branches fall through to the same register state
+		if ((insn & 0x7C000000) == 0x14000000 || (insn & 0xFE000000) == 0xD6000000
+				|| macho_xref_arm64_clobbers(insn, reg)) {
+			break;
+		}
+	}
+	return 0;
+}
+
+static int macho_xref_arm64_scan(macho_xref_chunk_t_64* chunk) {
+	uint64_t i = 0;
+	uint64_t bits = 0;
+	uint64_t block = 0;
+	uint64_t offset = 0;
+	uint64_t count = 0;
+	uint64_t imm = 0;
+	uint64_t pc = 0;
+	uint32_t insn = 0;
+
+	for (block = chunk->start; block + sizeof(uint32_t) <= chunk->end; block += MACHO_XREF_BLOCK * sizeof(uint32_t)) {
+		count = (chunk->end - block) / sizeof(uint32_t);
+		if (count >= MACHO_XREF_BLOCK) {
+			bits = macho_xref_arm64_block(chunk->data + block);
+		} else {
+			bits = 0;
+			for (i = 0; i < count; i++) {
+				insn = macho_read32_64(chunk->data + block + i * sizeof(uint32_t));
+				if ((insn & 0x1F000000) == 0x10000000 || (insn & 0x3B000000) == 0x18000000) {
+					bits |= 1ULL << i;
+				}
+			}
+		}
+
+		while (bits) {
+			i = __builtin_ctzll(bits);
+			bits &= bits - 1;
+			offset = block + i * sizeof(uint32_t);
+			insn = macho_read32_64(chunk->data + offset);
+			pc = chunk->address + offset;
+
+			if ((insn & 0x1F000000) == 0x10000000) {
+				imm = (((insn >> 5) & 0x7FFFF) << 2) | ((insn >> 29) & 0x3);
+				if (insn & 0x80000000) {
+					// ADRP, the page is only half of the address
+					if ((insn & 0x1F) != 31 && macho_xref_arm64_pair(chunk, offset, insn & 0x1F,
+							(pc & ~0xFFFULL) + (uint64_t) (macho_xref_sign_extend(imm, 21) << 12)) < 0) {
+						return -1;
+					}
+				} else if (macho_xref_add(chunk, pc + (uint64_t) macho_xref_sign_extend(imm, 21),
+						pc, MACHO_XREF_ADDRESS) < 0) {
+					return -1;
+				}
+			} else {
+				imm = (insn >> 5) & 0x7FFFF;
+				if (macho_xref_add(chunk, pc + (uint64_t) (macho_xref_sign_extend(imm, 19) * 4),
+						pc, MACHO_XREF_LOAD) < 0) {
+					return -1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * x86_64 decoding
+ */
+
+// Instructions are only decoded far enough to find their length, so a
+//   chunk has to start on an instruction boundary, which function starts
+//   are. Undecodable bytes are stepped over one at a time.
+static int macho_xref_x86_64_scan(macho_xref_chunk_t_64* chunk) {
+	uint64_t offset = 0;
+	uint64_t pc = 0;
+	macho_x86_insn_t_64 insn;
+
+	for (offset = chunk->start; offset < chunk->end; offset += insn.length) {
+		if (macho_x86_decode_64(chunk->data + offset, chunk->size - offset, &insn) < 0) {
+			insn.length = 1;
+			continue;
+		}
+		if (insn.flags & MACHO_X86_RIP) {
+			pc = chunk->address + offset + insn.length;
+			if (macho_xref_add(chunk, pc + (uint64_t) insn.displacement, chunk->address + offset,
+					(insn.flags & MACHO_X86_LEA) ? MACHO_XREF_ADDRESS : MACHO_XREF_LOAD) < 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * Data pointers
+ */
+static int macho_xref_pointer_scan(macho_vm_t_64* vm, macho_xref_chunk_t_64* chunk) {
+	uint64_t raw = 0;
+	uint64_t offset = 0;
+	uint64_t target = 0;
+
+	offset = chunk->start + ((sizeof(uint64_t) - ((chunk->address + chunk->start) & 7)) & 7);
+	for (; offset + sizeof(uint64_t) <= chunk->end; offset += sizeof(uint64_t)) {
+		raw = macho_read64_64(chunk->data + offset);
+		if (raw == 0) {
+			continue;
+		}
+		target = macho_vm_decode_64(vm, raw, NULL);
+		if (target == 0 || macho_vm_view_64(vm, target, 1) == NULL) {
+			continue;
+		}
+		if (macho_xref_add(chunk, target, chunk->address + offset, MACHO_XREF_POINTER) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int macho_xref_chunk_job(uint64_t index, void* userdata) {
+	int ret = 0;
+	macho_xref_build_t_64* build = (macho_xref_build_t_64*) userdata;
+	macho_xref_chunk_t_64* chunk = &build->chunks[index];
+
+	if (chunk->cputype == MACHO_CPU_TYPE_ARM64) {
+		ret = macho_xref_arm64_scan(chunk);
+	} else if (chunk->cputype == MACHO_CPU_TYPE_X86_64) {
+		ret = macho_xref_x86_64_scan(chunk);
+	} else {
+		ret = macho_xref_pointer_scan(build->vm, chunk);
+	}
+	if (ret == 0 && chunk->count > 1) {
+		qsort(chunk->xrefs, chunk->count, sizeof(macho_xref_t_64), macho_xref_compare);
+	}
+	return ret;
+}
+
+// Where the chunk after one starting at start begins. Variable length code
+//   is only split at a function start, so without any the section stays whole.
+static uint64_t macho_xref_chunk_end(macho_xref_build_t_64* build, macho_section_info_t_64* info,
+		uint32_t cputype, uint64_t start) {
+	uint64_t end = 0;
+	uint64_t index = 0;
+
+	if (info->size - start <= MACHO_XREF_CHUNK) {
+		return info->size;
+	}
+	end = start + MACHO_XREF_CHUNK;
+	if (cputype != MACHO_CPU_TYPE_X86_64) {
+		return end;
+	}
+	index = macho_functions_find_64(build->functions, info->addr + end - 1);
+	index = index == MACHO_FUNCTION_NONE ? 0 : index + 1;
+	if (build->functions == NULL || index >= build->functions->count
+			|| build->functions->starts[index] >= info->addr + info->size) {
+		return info->size;
+	}
+	return build->functions->starts[index] - info->addr;
+}
+
+static int macho_xref_add_section(macho_xref_build_t_64* build, macho_section_t_64* section, uint32_t cputype) {
+	uint64_t start = 0;
+	uint64_t end = 0;
+	uint64_t capacity = 0;
+	const unsigned char* data = NULL;
+	macho_xref_chunk_t_64* chunks = NULL;
+	macho_xref_chunk_t_64* chunk = NULL;
+	macho_section_info_t_64* info = section->info;
+
+	data = section->data;
+	if (data == NULL || info->size == 0) {
+		return 0;
+	}
+	for (start = 0; start < info->size; start = end) {
+		end = macho_xref_chunk_end(build, info, cputype, start);
+		if (build->chunk_count == build->chunk_capacity) {
+			capacity = build->chunk_capacity ? build->chunk_capacity * 2 : 64;
+			chunks = (macho_xref_chunk_t_64*) realloc(build->chunks, capacity * sizeof(macho_xref_chunk_t_64));
+			if (chunks == NULL) {
+				return -1;
+			}
+			build->chunks = chunks;
+			build->chunk_capacity = capacity;
+		}
+		chunk = &build->chunks[build->chunk_count++];
+		memset(chunk, '\0', sizeof(macho_xref_chunk_t_64));
+		chunk->cputype = cputype;
+		chunk->address = info->addr;
+		chunk->data = data;
+		chunk->size = info->size;
+		chunk->start = start;
+		chunk->end = end;
+	}
+	return 0;
+}
+
+// Merges the sorted chunk runs pairwise until one is left
+static macho_xref_t_64* macho_xref_merge(macho_xref_build_t_64* build, uint64_t total) {
+	uint64_t i = 0;
+	uint64_t runs = 0;
+	uint64_t a = 0;
+	uint64_t b = 0;
+	uint64_t k = 0;
+	uint64_t* bounds = NULL;
+	macho_xref_t_64* swap = NULL;
+	macho_xref_t_64* source = NULL;
+	macho_xref_t_64* target = NULL;
+
+	source = (macho_xref_t_64*) malloc(total * sizeof(macho_xref_t_64));
+	target = (macho_xref_t_64*) malloc(total * sizeof(macho_xref_t_64));
+	bounds = (uint64_t*) malloc((build->chunk_count + 1) * sizeof(uint64_t));
+	if (source == NULL || target == NULL || bounds == NULL) {
+		free(source);
+		free(target);
+		free(bounds);
+		return NULL;
+	}
+
+	bounds[0] = 0;
+	for (i = 0; i < build->chunk_count; i++) {
+		if (build->chunks[i].count) {
+			memcpy(&source[bounds[runs]], build->chunks[i].xrefs, build->chunks[i].count * sizeof(macho_xref_t_64));
+			bounds[runs + 1] = bounds[runs] + build->chunks[i].count;
+			runs++;
+		}
+	}
+
+	while (runs > 1) {
+		for (i = 0; i + 1 < runs; i += 2) {
+			a = bounds[i];
+			b = bounds[i + 1];
+			k = bounds[i];
+			while (a < bounds[i + 1] && b < bounds[i + 2]) {
+				target[k++] = macho_xref_compare(&source[b], &source[a]) < 0 ? source[b++] : source[a++];
+			}
+			while (a < bounds[i + 1]) {
+				target[k++] = source[a++];
+			}
+			while (b < bounds[i + 2]) {
+				target[k++] = source[b++];
+			}
+			bounds[i / 2] = bounds[i];
+		}
+		if (runs & 1) {
+			memcpy(&target[bounds[runs - 1]], &source[bounds[runs - 1]],
+					(bounds[runs] - bounds[runs - 1]) * sizeof(macho_xref_t_64));
+			bounds[runs / 2] = bounds[runs - 1];
+		}
+		runs = (runs + 1) / 2;
+		bounds[runs] = total;
+		swap = source;
+		source = target;
+		target = swap;
+	}
+
+	free(target);
+	free(bounds);
+	return source;
+}
+
+/*
+ * Mach-O Cross Reference Functions
+ */
+macho_xref_index_t_64* macho_xref_index_create_64() {
+	macho_xref_index_t_64* index = (macho_xref_index_t_64*) malloc(sizeof(macho_xref_index_t_64));
+	if (index) {
+		memset(index, '\0', sizeof(macho_xref_index_t_64));
+	}
+	return index;
+}
+
+macho_xref_index_t_64* macho_xref_index_load_64(macho_t_64* macho) {
+	int ret = 0;
+	int code = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t total = 0;
+	uint64_t failed = 0;
+	macho_segment_t_64* segment = NULL;
+	macho_section_info_t_64* info = NULL;
+	macho_xref_index_t_64* index = NULL;
+	macho_xref_build_t_64 build;
+
+	if (macho == NULL || macho->header == NULL) {
+		return NULL;
+	}
+
+	index = macho_xref_index_create_64();
+	if (index == NULL) {
+		error("Unable to create cross reference index\n");
+		return NULL;
+	}
+	index->macho = macho;
+	index->vm = macho_vm_load_64(macho);
+	if (index->vm == NULL) {
+		macho_xref_index_free_64(index);
+		return NULL;
+	}
+
+	memset(&build, '\0', sizeof(build));
+	build.cputype = macho->header->cputype;
+	build.vm = index->vm;
+	macho_xref_backend_64();
+	if (build.cputype == MACHO_CPU_TYPE_X86_64) {
+		build.functions = macho_functions_load_64(macho);
+	}
+
+	// Code is only decoded for architectures there is a decoder for, data
+	//   pointers are found in any image
+	for (i = 0; ret == 0 && i < macho->segment_count; i++) {
+		segment = macho->segments[i];
+		if (segment == NULL || segment->command == NULL) {
+			continue;
+		}
+		for (j = 0; ret == 0 && j < segment->section_count; j++) {
+			info = segment->sections[j]->info;
+			if (info == NULL || segment->sections[j]->data == NULL) {
+				continue;
+			}
+			code = (info->flags & (MACHO_SECTION_ATTR_PURE_INSTRUCTIONS | MACHO_SECTION_ATTR_SOME_INSTRUCTIONS)) != 0;
+			if (code && (build.cputype == MACHO_CPU_TYPE_ARM64 || build.cputype == MACHO_CPU_TYPE_X86_64)) {
+				ret = macho_xref_add_section(&build, segment->sections[j], build.cputype);
+			} else if (!code && (segment->command->initprot & MACHO_XREF_PROT_WRITE)
+					&& (info->flags & MACHO_SECTION_TYPE) != MACHO_SECTION_CSTRING_LITERALS) {
+				ret = macho_xref_add_section(&build, segment->sections[j], 0);
+			}
+		}
+	}
+
+	if (ret == 0 && build.chunk_count
+			&& macho_pool_run_64(build.chunk_count, 1, macho_xref_chunk_job, &build, &failed) != 0) {
+		error("Unable to scan chunk %" PRIu64 " for cross references\n", failed);
+		ret = -1;
+	}
+	for (i = 0; ret == 0 && i < build.chunk_count; i++) {
+		total += build.chunks[i].count;
+	}
+	if (ret == 0 && total) {
+		index->xrefs = macho_xref_merge(&build, total);
+		if (index->xrefs == NULL) {
+			error("Unable to allocate cross references\n");
+			ret = -1;
+		} else {
+			index->count = total;
+		}
+	}
+
+	for (i = 0; i < build.chunk_count; i++) {
+		free(build.chunks[i].xrefs);
+	}
+	free(build.chunks);
+	macho_functions_free_64(build.functions);
+	if (ret < 0) {
+		macho_xref_index_free_64(index);
+		return NULL;
+	}
+	debug("Cross reference index loaded %" PRIu64 " references from %" PRIu64 " chunks with the %s backend\n",
+			index->count, build.chunk_count, macho_xref_backend);
+	return index;
+}
+
+// References to any address in [start, end), which come back as the count
+//   of consecutive entries starting at first
+uint64_t macho_xref_find_64(macho_xref_index_t_64* index, uint64_t start, uint64_t end, uint64_t* first) {
+	uint64_t low = 0;
+	uint64_t high = 0;
+	uint64_t middle = 0;
+	uint64_t last = 0;
+
+	if (index == NULL || first == NULL || end <= start) {
+		return 0;
+	}
+	high = index->count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (index->xrefs[middle].target < start) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	*first = low;
+	for (last = low; last < index->count && index->xrefs[last].target < end; last++);
+	return last - low;
+}
+
+void macho_xref_index_debug_64(macho_xref_index_t_64* index) {
+	uint64_t i = 0;
+	if (index) {
+		debug("\tCross References:\n");
+		debug("\t\tcount: 0x%" PRIx64 "\n", index->count);
+		for (i = 0; i < index->count; i++) {
+			debug("\t\t0x%016" PRIx64 " <- 0x%016" PRIx64 " (%u)\n", index->xrefs[i].target, index->xrefs[i].source,
+					index->xrefs[i].kind);
+		}
+	}
+}
+
+void macho_xref_index_free_64(macho_xref_index_t_64* index) {
+	if (index) {
+		if (index->xrefs) {
+			free(index->xrefs);
+			index->xrefs = NULL;
+		}
+		if (index->vm) {
+			macho_vm_free_64(index->vm);
+			index->vm = NULL;
+		}
+		free(index);
+	}
+}
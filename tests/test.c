@@ -0,0 +1,327 @@
+/**
+ * libmacho-1.0 - test.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "test.h"
+
+static int test_failures = 0;
+
+void test_put16(unsigned char* p, uint16_t value, int big_endian) {
+	p[big_endian ? 1 : 0] = (unsigned char) value;
+	p[big_endian ? 0 : 1] = (unsigned char) (value >> 8);
+}
+
+void test_put32(unsigned char* p, uint32_t value, int big_endian) {
+	int i = 0;
+	for (i = 0; i < 4; i++) {
+		p[big_endian ? 3 - i : i] = (unsigned char) (value >> (i * 8));
+	}
+}
+
+void test_put64(unsigned char* p, uint64_t value, int big_endian) {
+	int i = 0;
+	for (i = 0; i < 8; i++) {
+		p[big_endian ? 7 - i : i] = (unsigned char) (value >> (i * 8));
+	}
+}
+
+static uint64_t test_round(uint64_t value, uint64_t align) {
+	return (value + align - 1) & ~(align - 1);
+}
+
+static uint64_t test_segment_size(const test_segment_t* segment) {
+	uint32_t i = 0;
+	uint64_t size = 0;
+	for (i = 0; i < segment->count; i++) {
+		if (segment->sections[i].offset + segment->sections[i].size > size) {
+			size = segment->sections[i].offset + segment->sections[i].size;
+		}
+	}
+	return test_round(size, TEST_PAGE);
+}
+
+unsigned char* test_image_build(const test_image_t* image, uint64_t* size) {
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint32_t ncmds = 0;
+	uint64_t sizeofcmds = 0;
+	uint64_t offset = 0;
+	uint64_t strsize = 1;
+	uint64_t symoff = 0;
+	uint64_t stroff = 0;
+	uint64_t indirectoff = 0;
+	uint64_t total = 0;
+	uint64_t address = 0;
+	uint64_t* bloboffs = NULL;
+	unsigned char* data = NULL;
+	unsigned char* cmd = NULL;
+	int be = image->big_endian;
+
+	ncmds = image->segment_count + image->blob_count;
+	for (i = 0; i < image->segment_count; i++) {
+		sizeofcmds += 72 + 80 * image->segments[i].count;
+	}
+	if (image->symbol_count) {
+		ncmds++;
+		sizeofcmds += 24;
+		for (i = 0; i < image->symbol_count; i++) {
+			strsize += strlen(image->symbols[i].name) + 1;
+		}
+	}
+	if (image->indirect_count) {
+		ncmds++;
+		sizeofcmds += 80;
+	}
+	sizeofcmds += 16 * image->blob_count;
+	if (image->linkedit) {
+		ncmds++;
+		sizeofcmds += 72;
+	}
+
+	total = test_round(32 + sizeofcmds, TEST_PAGE);
+	for (i = 0; i < image->segment_count; i++) {
+		total += test_segment_size(&image->segments[i]);
+	}
+	symoff = total;
+	stroff = symoff + 16 * (uint64_t) image->symbol_count;
+	indirectoff = test_round(stroff + (image->symbol_count ? strsize : 0), 8);
+	total = indirectoff + 4 * (uint64_t) image->indirect_count;
+	bloboffs = calloc(image->blob_count + 1, sizeof(uint64_t));
+	for (i = 0; i < image->blob_count; i++) {
+		bloboffs[i] = test_round(total, 16);
+		total = bloboffs[i] + image->blobs[i].size;
+	}
+
+	data = calloc(1, total);
+	if (data == NULL || bloboffs == NULL) {
+		free(bloboffs);
+		free(data);
+		return NULL;
+	}
+	test_put32(data, 0xFEEDFACF, be);
+	test_put32(data + 4, image->cputype, be);
+	test_put32(data + 12, 2, be);
+	test_put32(data + 16, ncmds, be);
+	test_put32(data + 20, (uint32_t) sizeofcmds, be);
+
+	cmd = data + 32;
+	offset = test_round(32 + sizeofcmds, TEST_PAGE);
+	for (i = 0; i < image->segment_count; i++) {
+		const test_segment_t* segment = &image->segments[i];
+		uint64_t segsize = test_segment_size(segment);
+		test_put32(cmd, 0x19, be);
+		test_put32(cmd + 4, 72 + 80 * segment->count, be);
+		strncpy((char*) cmd + 8, segment->name, 16);
+		test_put64(cmd + 24, segment->address, be);
+		test_put64(cmd + 32, segsize ? segsize : TEST_PAGE, be);
+		test_put64(cmd + 40, offset, be);
+		test_put64(cmd + 48, segsize, be);
+		test_put32(cmd + 56, 7, be);
+		test_put32(cmd + 60, 7, be);
+		test_put32(cmd + 64, segment->count, be);
+		cmd += 72;
+		for (j = 0; j < segment->count; j++) {
+			const test_section_t* section = &segment->sections[j];
+			strncpy((char*) cmd, section->name, 16);
+			strncpy((char*) cmd + 16, segment->name, 16);
+			test_put64(cmd + 32, segment->address + section->offset, be);
+			test_put64(cmd + 40, section->size, be);
+			test_put32(cmd + 48, (uint32_t) (offset + section->offset), be);
+			test_put32(cmd + 64, section->flags, be);
+			test_put32(cmd + 68, section->reserved1, be);
+			test_put32(cmd + 72, section->reserved2, be);
+			if (section->data) {
+				memcpy(data + offset + section->offset, section->data, section->size);
+			}
+			cmd += 80;
+		}
+		offset += segsize;
+		if (segment->address + (segsize ? segsize : TEST_PAGE) > address) {
+			address = segment->address + (segsize ? segsize : TEST_PAGE);
+		}
+	}
+
+	if (image->linkedit) {
+		test_put32(cmd, 0x19, be);
+		test_put32(cmd + 4, 72, be);
+		strncpy((char*) cmd + 8, "__LINKEDIT", 16);
+		test_put64(cmd + 24, address, be);
+		test_put64(cmd + 32, test_round(total - symoff, TEST_PAGE), be);
+		test_put64(cmd + 40, symoff, be);
+		test_put64(cmd + 48, total - symoff, be);
+		test_put32(cmd + 56, 1, be);
+		test_put32(cmd + 60, 1, be);
+		cmd += 72;
+	}
+
+	if (image->symbol_count) {
+		uint64_t strx = 1;
+		test_put32(cmd, 0x2, be);
+		test_put32(cmd + 4, 24, be);
+		test_put32(cmd + 8, (uint32_t) symoff, be);
+		test_put32(cmd + 12, image->symbol_count, be);
+		test_put32(cmd + 16, (uint32_t) stroff, be);
+		test_put32(cmd + 20, (uint32_t) strsize, be);
+		cmd += 24;
+		for (i = 0; i < image->symbol_count; i++) {
+			unsigned char* nlist = data + symoff + 16 * (uint64_t) i;
+			test_put32(nlist, (uint32_t) strx, be);
+			nlist[4] = image->symbols[i].type;
+			nlist[5] = image->symbols[i].sect;
+			test_put64(nlist + 8, image->symbols[i].value, be);
+			memcpy(data + stroff + strx, image->symbols[i].name, strlen(image->symbols[i].name));
+			strx += strlen(image->symbols[i].name) + 1;
+		}
+	}
+
+	if (image->indirect_count) {
+		test_put32(cmd, 0xB, be);
+		test_put32(cmd + 4, 80, be);
+		test_put32(cmd + 8 + 12 * 4, (uint32_t) indirectoff, be);
+		test_put32(cmd + 8 + 13 * 4, image->indirect_count, be);
+		cmd += 80;
+		for (i = 0; i < image->indirect_count; i++) {
+			test_put32(data + indirectoff + 4 * (uint64_t) i, image->indirect[i], be);
+		}
+	}
+
+	for (i = 0; i < image->blob_count; i++) {
+		test_put32(cmd, image->blobs[i].cmd, be);
+		test_put32(cmd + 4, 16, be);
+		test_put32(cmd + 8, (uint32_t) bloboffs[i], be);
+		test_put32(cmd + 12, image->blobs[i].size, be);
+		cmd += 16;
+		if (image->blobs[i].data) {
+			memcpy(data + bloboffs[i], image->blobs[i].data, image->blobs[i].size);
+		}
+	}
+
+	free(bloboffs);
+	*size = total;
+	return data;
+}
+
+unsigned char* test_image_command(unsigned char* data, uint32_t cmd) {
+	uint32_t i = 0;
+	uint32_t ncmds = 0;
+	uint32_t value = 0;
+	uint32_t cmdsize = 0;
+	unsigned char* p = data + 32;
+
+	memcpy(&ncmds, data + 16, sizeof(ncmds));
+	for (i = 0; i < ncmds; i++) {
+		memcpy(&value, p, sizeof(value));
+		memcpy(&cmdsize, p + 4, sizeof(cmdsize));
+		if (value == cmd) {
+			return p;
+		}
+		p += cmdsize;
+	}
+	return NULL;
+}
+
+int test_write_file(const char* path, const unsigned char* data, uint64_t size) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		return -1;
+	}
+	if (size && fwrite(data, 1, size, file) != size) {
+		fclose(file);
+		return -1;
+	}
+	return fclose(file);
+}
+
+char* test_temp_dir() {
+	const char* base = getenv("TMPDIR");
+	char* path = NULL;
+	if (base == NULL || *base == '\0') {
+		base = "/tmp";
+	}
+	path = malloc(strlen(base) + sizeof("/libmacho-test-XXXXXX"));
+	if (path == NULL) {
+		return NULL;
+	}
+	sprintf(path, "%s/libmacho-test-XXXXXX", base);
+	if (mkdtemp(path) == NULL) {
+		free(path);
+		return NULL;
+	}
+	return path;
+}
+
+void test_remove_dir(const char* path) {
+	char child[4096];
+	struct stat info;
+	struct dirent* entry = NULL;
+	DIR* dir = opendir(path);
+	if (dir == NULL) {
+		return;
+	}
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+		snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+		if (lstat(child, &info) == 0 && S_ISDIR(info.st_mode)) {
+			test_remove_dir(child);
+		} else {
+			unlink(child);
+		}
+	}
+	closedir(dir);
+	rmdir(path);
+}
+
+uint32_t test_arm64_adrp(uint64_t pc, uint64_t target, uint32_t rd) {
+	uint64_t pages = ((target & ~0xFFFULL) - (pc & ~0xFFFULL)) >> 12;
+	return 0x90000000 | (uint32_t) ((pages & 3) << 29) | (uint32_t) (((pages >> 2) & 0x7FFFF) << 5) | rd;
+}
+
+uint32_t test_arm64_add(uint32_t rd, uint32_t rn, uint64_t target) {
+	return 0x91000000 | (uint32_t) ((target & 0xFFF) << 10) | (rn << 5) | rd;
+}
+
+uint32_t test_arm64_bl(uint64_t pc, uint64_t target) {
+	return 0x94000000 | (uint32_t) (((target - pc) >> 2) & 0x3FFFFFF);
+}
+
+void test_check_at(int ok, const char* expr, const char* file, int line) {
+	if (!ok) {
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+		test_failures++;
+	}
+}
+
+int test_finish(const char* name) {
+	if (test_failures) {
+		fprintf(stderr, "%s: %d checks failed\n", name, test_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
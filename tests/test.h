@@ -0,0 +1,107 @@
+/**
+ * libmacho-1.0 - test.h
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef MACHO_TEST_H_
+#define MACHO_TEST_H_
+
+#include <stdint.h>
+
+#define TEST_TEXT      0x100000000ULL
+#define TEST_PAGE      0x1000
+
+#define TEST_CPU_X86_64 0x01000007
+#define TEST_CPU_ARM64  0x0100000C
+
+#define TEST_S_CSTRING  0x00000002
+#define TEST_S_STUBS    0x80000408
+#define TEST_S_CODE     0x80000400
+
+#define TEST_N_UNDF     0x01 // undefined external
+#define TEST_N_SECT     0x0F // external, defined in n_sect
+
+#define test_check(expr) test_check_at((expr) ? 1 : 0, #expr, __FILE__, __LINE__)
+
+typedef struct test_section_t {
+	const char* name;
+	uint64_t offset;	/* from the start of the segment, in file and memory */
+	const unsigned char* data;
+	uint64_t size;
+	uint32_t flags;
+	uint32_t reserved1;	/* first indirect symbol for stubs */
+	uint32_t reserved2;	/* stub size */
+} test_section_t;
+
+typedef struct test_segment_t {
+	const char* name;
+	uint64_t address;
+	uint32_t count;
+	const test_section_t* sections;
+} test_segment_t;
+
+typedef struct test_symbol_t {
+	const char* name;
+	uint8_t type;
+	uint8_t sect;
+	uint64_t value;
+} test_symbol_t;
+
+typedef struct test_blob_t {
+	uint32_t cmd;		/* linkedit_data_command to point at the blob */
+	const unsigned char* data;	/* NULL reserves zeroes for the caller to fill */
+	uint32_t size;
+} test_blob_t;
+
+/*
+ * Segments are laid out from the first page after the load commands, each
+ *   rounded up to a page. The symbol table, indirect symbols and blobs
+ *   follow the last segment, unmapped unless linkedit asks for a segment.
+ */
+typedef struct test_image_t {
+	uint32_t cputype;
+	int big_endian;
+	uint32_t segment_count;
+	const test_segment_t* segments;
+	uint32_t symbol_count;
+	const test_symbol_t* symbols;
+	uint32_t indirect_count;
+	const uint32_t* indirect;
+	uint32_t blob_count;
+	const test_blob_t* blobs;
+	int linkedit;		/* map the tail with a __LINKEDIT segment */
+} test_image_t;
+
+void test_put16(unsigned char* p, uint16_t value, int big_endian);
+void test_put32(unsigned char* p, uint32_t value, int big_endian);
+void test_put64(unsigned char* p, uint64_t value, int big_endian);
+
+unsigned char* test_image_build(const test_image_t* image, uint64_t* size);
+unsigned char* test_image_command(unsigned char* data, uint32_t cmd);
+int test_write_file(const char* path, const unsigned char* data, uint64_t size);
+char* test_temp_dir();
+void test_remove_dir(const char* path);
+
+uint32_t test_arm64_adrp(uint64_t pc, uint64_t target, uint32_t rd);
+uint32_t test_arm64_add(uint32_t rd, uint32_t rn, uint64_t target);
+uint32_t test_arm64_bl(uint64_t pc, uint64_t target);
+
+void test_check_at(int ok, const char* expr, const char* file, int line);
+int test_finish(const char* name);
+
+#endif /* MACHO_TEST_H_ */
@@ -0,0 +1,216 @@
+/**
+ * libmacho-1.0 - test_cache.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/cache.h>
+#include <libmacho-1.0/cstring.h>
+#include <libmacho-1.0/section.h>
+
+#include "test.h"
+
+#define CACHE_SIZE   0x10000
+#define IMAGE        0x180004000ULL
+#define IMAGE_OFFSET 0x4000
+#define LINKEDIT     0x180100000ULL
+#define SYMOFF       0x8000
+#define STROFF       0x8100
+#define IMAGE_PATH   "/usr/lib/libt.dylib"
+
+static const char strings[] = "\0_alpha\0_beta";
+
+static void put_segment(unsigned char* p, const char* name, uint64_t vmaddr, uint64_t fileoff, uint32_t nsects) {
+	test_put32(p, 0x19, 0);
+	test_put32(p + 4, 72 + 80 * nsects, 0);
+	strncpy((char*) p + 8, name, 16);
+	test_put64(p + 24, vmaddr, 0);
+	test_put64(p + 32, 0x1000, 0);
+	test_put64(p + 40, fileoff, 0);
+	test_put64(p + 48, 0x1000, 0);
+	test_put32(p + 56, 5, 0);
+	test_put32(p + 60, 5, 0);
+	test_put32(p + 64, nsects, 0);
+}
+
+// A two-mapping cache holding one image: __TEXT in the first mapping,
+//   __LINKEDIT in the second, at file offsets that differ from the
+//   image-relative ones so untranslated reads land on the decoy
+static unsigned char* build(uint32_t nsyms, uint32_t strsize) {
+	unsigned char* cache = calloc(1, CACHE_SIZE);
+	unsigned char* image = NULL;
+	unsigned char* cmd = NULL;
+
+	if (cache == NULL) {
+		return NULL;
+	}
+	memcpy(cache, "dyld_v1   arm64", 16);
+	test_put32(cache + 16, 0x20, 0);
+	test_put32(cache + 20, 2, 0);
+	test_put32(cache + 24, 0x68, 0);
+	test_put32(cache + 28, 1, 0);
+	test_put64(cache + 0x20, 0x180000000ULL, 0);
+	test_put64(cache + 0x28, 0x8000, 0);
+	test_put64(cache + 0x30, 0, 0);
+	test_put32(cache + 0x38, 5, 0);
+	test_put32(cache + 0x3C, 5, 0);
+	test_put64(cache + 0x40, LINKEDIT, 0);
+	test_put64(cache + 0x48, 0x1000, 0);
+	test_put64(cache + 0x50, 0x8000, 0);
+	test_put32(cache + 0x58, 1, 0);
+	test_put32(cache + 0x5C, 1, 0);
+	test_put64(cache + 0x68, IMAGE, 0);
+	test_put32(cache + 0x80, 0x100, 0);
+	memcpy(cache + 0x100, IMAGE_PATH, sizeof(IMAGE_PATH));
+
+	image = cache + IMAGE_OFFSET;
+	test_put32(image, 0xFEEDFACF, 0);
+	test_put32(image + 4, TEST_CPU_ARM64, 0);
+	test_put32(image + 12, 6, 0);
+	test_put32(image + 16, 3, 0);
+	test_put32(image + 20, 72 + 80 + 72 + 24, 0);
+	cmd = image + 32;
+	put_segment(cmd, "__TEXT", IMAGE, IMAGE_OFFSET, 1);
+	strncpy((char*) cmd + 72, "__cstring", 16);
+	strncpy((char*) cmd + 72 + 16, "__TEXT", 16);
+	test_put64(cmd + 72 + 32, IMAGE + 0x800, 0);
+	test_put64(cmd + 72 + 40, 12, 0);
+	test_put32(cmd + 72 + 48, IMAGE_OFFSET + 0x800, 0);
+	test_put32(cmd + 72 + 64, TEST_S_CSTRING, 0);
+	cmd += 72 + 80;
+	put_segment(cmd, "__LINKEDIT", LINKEDIT, 0x8000, 0);
+	cmd += 72;
+	test_put32(cmd, 0x2, 0);
+	test_put32(cmd + 4, 24, 0);
+	test_put32(cmd + 8, SYMOFF, 0);
+	test_put32(cmd + 12, nsyms, 0);
+	test_put32(cmd + 16, STROFF, 0);
+	test_put32(cmd + 20, strsize, 0);
+
+	memcpy(cache + IMAGE_OFFSET + 0x800, "hello world", 12);
+	memcpy(cache + IMAGE_OFFSET + IMAGE_OFFSET + 0x800, "wrong bytes", 12);
+	memcpy(cache + STROFF, strings, sizeof(strings));
+	test_put32(cache + SYMOFF, 1, 0);
+	cache[SYMOFF + 4] = TEST_N_SECT;
+	cache[SYMOFF + 5] = 1;
+	test_put64(cache + SYMOFF + 8, IMAGE + 0x100, 0);
+	test_put32(cache + SYMOFF + 16, 8, 0);
+	cache[SYMOFF + 20] = TEST_N_SECT;
+	cache[SYMOFF + 21] = 1;
+	test_put64(cache + SYMOFF + 24, IMAGE + 0x200, 0);
+	return cache;
+}
+
+static macho_cache_t_64* open_cache(const char* path, uint32_t nsyms, uint32_t strsize, macho_t_64** macho) {
+	unsigned char* data = build(nsyms, strsize);
+	macho_cache_t_64* cache = NULL;
+
+	*macho = NULL;
+	if (data == NULL || test_write_file(path, data, CACHE_SIZE) < 0) {
+		free(data);
+		return NULL;
+	}
+	free(data);
+	cache = macho_cache_open_64(path);
+	if (cache) {
+		*macho = macho_cache_image_load_64(cache, macho_cache_find_image_64(cache, IMAGE_PATH));
+	}
+	return cache;
+}
+
+int main() {
+	char* dir = NULL;
+	char path[4096];
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_cache_t_64* cache = NULL;
+	macho_section_t_64* section = NULL;
+	macho_cstring_index_t_64* index = NULL;
+
+	dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir == NULL) {
+		return test_finish("cache");
+	}
+	snprintf(path, sizeof(path), "%s/cache", dir);
+
+	cache = open_cache(path, 2, sizeof(strings), &macho);
+	test_check(cache != NULL && macho != NULL);
+	if (macho) {
+		test_check(macho->symtab_count == 1);
+		test_check(macho_lookup_64(macho, "_alpha") == IMAGE + 0x100);
+		test_check(macho_lookup_64(macho, "_beta") == IMAGE + 0x200);
+
+		// Section contents come through the cache mappings by address
+		section = macho_get_section_64(macho, "__TEXT", "__cstring");
+		test_check(section && section->data && memcmp(section->data, "hello world", 12) == 0);
+		index = macho_cstring_index_load_64(macho);
+		test_check(index && index->count == 1);
+		test_check(index && index->count && strcmp(index->entries[0].string, "hello world") == 0);
+		test_check(index && index->count && index->entries[0].address == IMAGE + 0x800);
+		macho_cstring_index_free_64(index);
+	}
+	macho_cache_free_64(cache);
+
+	// A symbol table or string table running past the __LINKEDIT mapping
+	//   is dropped while the rest of the image stays usable
+	cache = open_cache(path, 0x1000, sizeof(strings), &macho);
+	test_check(cache != NULL && macho != NULL);
+	if (macho) {
+		test_check(macho->symtab_count == 0);
+		test_check(macho_get_section_64(macho, "__TEXT", "__cstring") != NULL);
+	}
+	macho_cache_free_64(cache);
+
+	cache = open_cache(path, 2, 0x10000, &macho);
+	test_check(cache != NULL && macho != NULL);
+	if (macho) {
+		test_check(macho->symtab_count == 0);
+	}
+	macho_cache_free_64(cache);
+
+	cache = open_cache(path, 0x10000001, sizeof(strings), &macho);
+	test_check(cache != NULL && macho != NULL);
+	if (macho) {
+		test_check(macho->symtab_count == 0);
+	}
+	macho_cache_free_64(cache);
+
+	// An image path running off the end of the mapping is dropped rather
+	//   than read past it
+	data = build(2, sizeof(strings));
+	test_check(data != NULL);
+	if (data) {
+		memset(data + CACHE_SIZE - 4, 'x', 4);
+		test_put32(data + 0x80, CACHE_SIZE - 4, 0);
+		test_check(test_write_file(path, data, CACHE_SIZE) == 0);
+		free(data);
+		cache = macho_cache_open_64(path);
+		test_check(cache && cache->image_count == 1 && cache->images[0].path == NULL);
+		test_check(cache && macho_cache_find_image_64(cache, IMAGE_PATH) == NULL);
+		macho_cache_free_64(cache);
+	}
+
+	test_remove_dir(dir);
+	free(dir);
+	return test_finish("cache");
+}
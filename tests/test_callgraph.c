@@ -0,0 +1,172 @@
+/**
+ * libmacho-1.0 - test_callgraph.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/callgraph.h>
+
+#include "test.h"
+
+#define STUBS (TEST_TEXT + 0x100)
+
+static int has_name(const macho_callgraph_node_t_64* node, const char* name) {
+	return node->name && strcmp(node->name, name) == 0;
+}
+
+// The calls node makes, as node indexes in order, must be exactly callees
+static int check_calls(macho_callgraph_t_64* graph, uint64_t node, const uint64_t* callees, const uint64_t* sites,
+		uint64_t count) {
+	uint64_t i = 0;
+	if (graph->offsets[node + 1] - graph->offsets[node] != count) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		if (graph->callees[graph->offsets[node] + i] != callees[i]
+				|| graph->sites[graph->offsets[node] + i] != sites[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static macho_callgraph_t_64* load(const test_image_t* image, unsigned char** data) {
+	uint64_t size = 0;
+	macho_t_64* macho = NULL;
+	macho_callgraph_t_64* graph = NULL;
+
+	*data = test_image_build(image, &size);
+	macho = *data ? macho_load_64(*data, size) : NULL;
+	graph = macho ? macho_callgraph_load_64(macho) : NULL;
+	if (graph == NULL) {
+		macho_free_64(macho);
+	}
+	return graph;
+}
+
+static void unload(macho_callgraph_t_64* graph, unsigned char* data) {
+	macho_t_64* macho = graph ? graph->macho : NULL;
+	macho_callgraph_free_64(graph);
+	macho_free_64(macho);
+	free(data);
+}
+
+static void test_arm64() {
+	uint32_t i = 0;
+	uint32_t code[12];
+	unsigned char bytes[sizeof(code)];
+	static unsigned char stubs[24];
+	unsigned char* data = NULL;
+	macho_callgraph_t_64* graph = NULL;
+	const test_section_t sections[] = {
+		{ "__text", 0, bytes, sizeof(bytes), TEST_S_CODE, 0, 0 },
+		{ "__stubs", STUBS - TEST_TEXT, stubs, sizeof(stubs), TEST_S_STUBS, 0, 12 },
+	};
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 2, sections } };
+	const test_symbol_t symbols[] = {
+		{ "_a", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_b", TEST_N_SECT, 1, TEST_TEXT + 0x10 },
+		{ "_c", TEST_N_SECT, 1, TEST_TEXT + 0x20 },
+		{ "_ext1", TEST_N_UNDF, 0, 0 },
+		{ "_ext2", TEST_N_UNDF, 0, 0 },
+	};
+	const uint32_t indirect[] = { 3, 4 };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 5, symbols, 2, indirect, 0, NULL, 0 };
+	const uint64_t a_callees[] = { 1, 3, 2 };
+	const uint64_t a_sites[] = { TEST_TEXT, TEST_TEXT + 4, TEST_TEXT + 8 };
+	const uint64_t b_callees[] = { 2 };
+	const uint64_t b_sites[] = { TEST_TEXT + 0x10 };
+	const uint64_t c_callees[] = { 4 };
+	const uint64_t c_sites[] = { TEST_TEXT + 0x20 };
+
+	for (i = 0; i < 12; i++) {
+		code[i] = 0xD65F03C0;	/* ret */
+	}
+	code[0] = test_arm64_bl(TEST_TEXT, TEST_TEXT + 0x10);
+	code[1] = test_arm64_bl(TEST_TEXT + 4, STUBS);
+	code[2] = test_arm64_bl(TEST_TEXT + 8, TEST_TEXT + 0x20);
+	code[4] = test_arm64_bl(TEST_TEXT + 0x10, TEST_TEXT + 0x20);
+	// Into the middle of _c, which is no node
+	code[5] = test_arm64_bl(TEST_TEXT + 0x14, TEST_TEXT + 0x24);
+	code[8] = test_arm64_bl(TEST_TEXT + 0x20, STUBS + 12);
+	for (i = 0; i < 12; i++) {
+		test_put32(bytes + 4 * i, code[i], 0);
+	}
+
+	graph = load(&image, &data);
+	test_check(graph != NULL);
+	if (graph) {
+		test_check(graph->function_count == 3 && graph->node_count == 5);
+		test_check(graph->edge_count == 5 && graph->unresolved == 1);
+		test_check(has_name(&graph->nodes[0], "_a") && graph->nodes[0].flags == 0);
+		test_check(has_name(&graph->nodes[2], "_c") && graph->nodes[2].address == TEST_TEXT + 0x20);
+		test_check(has_name(&graph->nodes[3], "_ext1") && graph->nodes[3].address == STUBS);
+		test_check(has_name(&graph->nodes[4], "_ext2") && graph->nodes[4].flags == MACHO_CALLGRAPH_IMPORT);
+		test_check(check_calls(graph, 0, a_callees, a_sites, 3));
+		test_check(check_calls(graph, 1, b_callees, b_sites, 1));
+		test_check(check_calls(graph, 2, c_callees, c_sites, 1));
+		test_check(check_calls(graph, 3, NULL, NULL, 0) && check_calls(graph, 4, NULL, NULL, 0));
+		test_check(macho_callgraph_find_64(graph, STUBS + 12) == 4);
+		test_check(macho_callgraph_find_64(graph, TEST_TEXT + 0x24) == MACHO_CALLGRAPH_NONE);
+	}
+	unload(graph, data);
+}
+
+static void test_x86_64() {
+	unsigned char* data = NULL;
+	macho_callgraph_t_64* graph = NULL;
+	unsigned char code[0x20];
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t symbols[] = {
+		{ "_main", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_f", TEST_N_SECT, 1, TEST_TEXT + 0x10 },
+	};
+	const test_image_t image = { TEST_CPU_X86_64, 0, 1, segments, 2, symbols, 0, NULL, 0, NULL, 0 };
+	const uint64_t main_callees[] = { 1 };
+	const uint64_t main_sites[] = { TEST_TEXT };
+
+	memset(code, 0xCC, sizeof(code));
+	// call _f; call _f + 3; ret
+	code[0] = 0xE8;
+	test_put32(code + 1, 0x10 - 5, 0);
+	code[5] = 0xE8;
+	test_put32(code + 6, 0x13 - 10, 0);
+	code[10] = 0xC3;
+	code[0x10] = 0xC3;
+
+	graph = load(&image, &data);
+	test_check(graph != NULL);
+	if (graph) {
+		test_check(graph->function_count == 2 && graph->node_count == 2);
+		test_check(graph->edge_count == 1 && graph->unresolved == 1);
+		test_check(check_calls(graph, 0, main_callees, main_sites, 1));
+		test_check(check_calls(graph, 1, NULL, NULL, 0));
+	}
+	unload(graph, data);
+}
+
+int main() {
+	test_arm64();
+	test_x86_64();
+	return test_finish("callgraph");
+}
@@ -0,0 +1,105 @@
+/**
+ * libmacho-1.0 - test_columns.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+
+#include "test.h"
+
+#define DATA (TEST_TEXT + 0x1000)
+
+static unsigned char code[0x40];
+static unsigned char pointers[0x40];
+
+static const test_symbol_t symbols[] = {
+	{ "_main", TEST_N_SECT, 1, TEST_TEXT },
+	{ "_table", TEST_N_SECT, 2, DATA + 0x18 },
+	{ "_ext", TEST_N_UNDF, 0, 0 },
+	{ "_helper", TEST_N_SECT, 1, TEST_TEXT + 0x20 },
+};
+
+// Every column agrees with the record it was split from, in host order
+//   whatever order the image was stored in
+static void check_columns(int be) {
+	uint64_t i = 0;
+	uint64_t size = 0;
+	uint64_t* values = NULL;
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	const test_section_t text_sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_section_t data_sections[] = { { "__const", 0, pointers, sizeof(pointers), 0, 0, 0 } };
+	const test_segment_t segments[] = {
+		{ "__TEXT", TEST_TEXT, 1, text_sections },
+		{ "__DATA", DATA, 1, data_sections },
+	};
+	const test_image_t image = { TEST_CPU_ARM64, be, 2, segments, 4, symbols, 0, NULL, 0, NULL, 0 };
+
+	data = test_image_build(&image, &size);
+	macho = data ? macho_load_64(data, size) : NULL;
+	test_check(macho && macho->symtab_count == 1);
+	if (macho && macho->symtab_count == 1) {
+		symtab = macho->symtabs[0];
+		test_check(symtab->nsyms == 4);
+		test_check(symtab->values && symtab->strx && symtab->descs && symtab->types && symtab->sects);
+		test_check(((uintptr_t) symtab->values % sizeof(uint64_t)) == 0);
+		test_check(((uintptr_t) symtab->strx % sizeof(uint32_t)) == 0);
+		test_check(((uintptr_t) symtab->descs % sizeof(uint16_t)) == 0);
+		for (i = 0; i < symtab->nsyms && i < 4; i++) {
+			test_check(symtab->values[i] == symbols[i].value);
+			test_check(symtab->types[i] == symbols[i].type);
+			test_check(symtab->sects[i] == symbols[i].sect);
+			test_check(symtab->descs[i] == 0);
+			test_check(symtab->strx[i] == symtab->symbols[i].n_un.n_strx);
+			test_check(strcmp(macho_symtab_name_64(symtab, i), symbols[i].name) == 0);
+		}
+		test_check(macho_lookup_64(macho, "_table") == DATA + 0x18);
+		test_check(macho_lookup_64(macho, "_helper") == TEST_TEXT + 0x20);
+
+		// Loading again keeps the columns already split
+		values = symtab->values;
+		test_check(macho_symtab_columns_load_64(symtab) == 0);
+		test_check(symtab->values == values);
+		macho_free_64(macho);
+	}
+	free(data);
+}
+
+int main() {
+	macho_symtab_t_64* symtab = NULL;
+
+	check_columns(0);
+	check_columns(1);
+
+	// An empty table has nothing to split
+	test_check(macho_symtab_columns_load_64(NULL) < 0);
+	symtab = macho_symtab_create_64();
+	test_check(symtab != NULL);
+	if (symtab) {
+		test_check(macho_symtab_columns_load_64(symtab) == 0);
+		test_check(symtab->values == NULL);
+		macho_symtab_free_64(symtab);
+	}
+	return test_finish("columns");
+}
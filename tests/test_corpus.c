@@ -0,0 +1,164 @@
+/**
+ * libmacho-1.0 - test_corpus.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/corpus.h>
+
+#include "test.h"
+
+static unsigned char code[0x2000];
+
+static int write_image(const char* path, const test_symbol_t* symbols, uint32_t count, uint64_t text_size) {
+	int ret = 0;
+	uint64_t size = 0;
+	unsigned char* data = NULL;
+	const test_section_t sections[] = { { "__text", 0, code, text_size, TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, count, symbols, 0, NULL, 0, NULL, 0 };
+
+	data = test_image_build(&image, &size);
+	if (data == NULL) {
+		return -1;
+	}
+	// Replace rather than rewrite, so the update sees a new file
+	unlink(path);
+	ret = test_write_file(path, data, size);
+	free(data);
+	return ret;
+}
+
+static void check_corpus(const char* dir) {
+	uint64_t a = 0;
+	uint64_t b = 0;
+	uint64_t count = 0;
+	char tree[1024];
+	char output[4096];
+	char path_a[4096];
+	char path_b[4096];
+	char path_c[4096];
+	char junk[4096];
+	macho_corpus_t_64* corpus = NULL;
+	const macho_corpus_posting_t_64* postings = NULL;
+	const test_symbol_t symbols_a[] = {
+		{ "_shared", TEST_N_SECT, 1, TEST_TEXT + 0x10 },
+		{ "_only_a", TEST_N_SECT, 1, TEST_TEXT + 0x20 },
+		{ "_printf", TEST_N_UNDF, 0, 0 },
+	};
+	const test_symbol_t symbols_b[] = {
+		{ "_shared", TEST_N_SECT, 1, TEST_TEXT + 0x40 },
+		{ "_only_b", TEST_N_SECT, 1, TEST_TEXT + 0x50 },
+	};
+	const test_symbol_t symbols_b2[] = {
+		{ "_shared", TEST_N_SECT, 1, TEST_TEXT + 0x40 },
+		{ "_added", TEST_N_SECT, 1, TEST_TEXT + 0x1060 },
+	};
+	const test_symbol_t symbols_c[] = { { "_printf", TEST_N_UNDF, 0, 0 } };
+
+	snprintf(tree, sizeof(tree), "%s/tree", dir);
+	snprintf(output, sizeof(output), "%s/corpus", dir);
+	snprintf(path_a, sizeof(path_a), "%s/a", tree);
+	snprintf(path_b, sizeof(path_b), "%s/b", tree);
+	snprintf(path_c, sizeof(path_c), "%s/c", tree);
+	snprintf(junk, sizeof(junk), "%s/notes.txt", tree);
+	test_check(mkdir(tree, 0755) == 0);
+	test_check(write_image(path_a, symbols_a, 3, 0x100) == 0);
+	test_check(write_image(path_b, symbols_b, 2, 0x100) == 0);
+	test_check(test_write_file(junk, (const unsigned char*) "not a Mach-O\n", 13) == 0);
+
+	test_check(macho_corpus_build_64(tree, output) == 0);
+	corpus = macho_corpus_open_64(output);
+	test_check(corpus != NULL);
+	if (corpus == NULL) {
+		return;
+	}
+	test_check(corpus->header->binary_count == 2);
+	a = macho_corpus_binary_find_64(corpus, path_a);
+	b = macho_corpus_binary_find_64(corpus, path_b);
+	test_check(a == 0 && b == 1);
+	test_check(macho_corpus_binary_find_64(corpus, junk) == UINT64_MAX);
+	test_check(strcmp(macho_corpus_binary_path_64(corpus, b), path_b) == 0);
+
+	postings = macho_corpus_lookup_64(corpus, "_shared", &count);
+	test_check(postings && count == 2);
+	if (postings && count == 2) {
+		test_check(postings[0].binary == a && postings[0].kind == MACHO_CORPUS_EXPORT);
+		test_check(postings[0].address == TEST_TEXT + 0x10);
+		test_check(postings[1].binary == b && postings[1].address == TEST_TEXT + 0x40);
+	}
+	postings = macho_corpus_lookup_64(corpus, "_printf", &count);
+	test_check(postings && count == 1 && postings[0].binary == a && postings[0].kind == MACHO_CORPUS_IMPORT);
+	test_check(macho_corpus_lookup_64(corpus, "_missing", &count) == NULL && count == 0);
+
+	// The Bloom filters never miss a symbol a binary has
+	test_check(macho_corpus_may_contain_64(corpus, a, "_only_a"));
+	test_check(macho_corpus_may_contain_64(corpus, b, "_only_b"));
+	postings = macho_corpus_lookup_binary_64(corpus, b, "_shared", &count);
+	test_check(postings && count == 1 && postings[0].binary == b);
+	test_check(macho_corpus_lookup_binary_64(corpus, b, "_only_a", &count) == NULL && count == 0);
+	test_check(macho_corpus_lookup_binary_64(corpus, 7, "_shared", &count) == NULL && count == 0);
+	macho_corpus_free_64(corpus);
+
+	// An update reindexes the binary that changed, picks up the new one
+	//   and keeps the untouched one's postings
+	test_check(write_image(path_b, symbols_b2, 2, 0x1100) == 0);
+	test_check(write_image(path_c, symbols_c, 1, 0x100) == 0);
+	test_check(macho_corpus_update_64(tree, output) == 0);
+	corpus = macho_corpus_open_64(output);
+	test_check(corpus != NULL);
+	if (corpus == NULL) {
+		return;
+	}
+	test_check(corpus->header->binary_count == 3);
+	test_check(macho_corpus_lookup_64(corpus, "_only_b", &count) == NULL && count == 0);
+	postings = macho_corpus_lookup_64(corpus, "_added", &count);
+	test_check(postings && count == 1 && postings[0].binary == b && postings[0].address == TEST_TEXT + 0x1060);
+	postings = macho_corpus_lookup_64(corpus, "_only_a", &count);
+	test_check(postings && count == 1 && postings[0].binary == a);
+	postings = macho_corpus_lookup_64(corpus, "_printf", &count);
+	test_check(postings && count == 2 && postings[1].binary == macho_corpus_binary_find_64(corpus, path_c));
+	macho_corpus_free_64(corpus);
+
+	// With nothing changed the update leaves the index as it was
+	test_check(macho_corpus_update_64(tree, output) == 0);
+	corpus = macho_corpus_open_64(output);
+	test_check(corpus && corpus->header->binary_count == 3);
+	if (corpus) {
+		postings = macho_corpus_lookup_64(corpus, "_added", &count);
+		test_check(postings && count == 1 && postings[0].binary == b);
+		macho_corpus_free_64(corpus);
+	}
+}
+
+int main() {
+	char* dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir) {
+		check_corpus(dir);
+		test_remove_dir(dir);
+		free(dir);
+	}
+	return test_finish("corpus");
+}
@@ -0,0 +1,178 @@
+/**
+ * libmacho-1.0 - test_demangle.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+#include <libmacho-1.0/demangle.h>
+
+#include "test.h"
+
+typedef struct golden_t {
+	const char* mangled;
+	const char* demangled;	/* NULL when the name must be left alone */
+} golden_t;
+
+static const golden_t goldens[] = {
+	{ "_Z3foov", "foo()" },
+	{ "__Z3foov", "foo()" },
+	{ "_Z3fooPKc", "foo(char const*)" },
+	{ "_ZNK3foo3barEv", "foo::bar() const" },
+	{ "_ZNSt6vectorIiSaIiEE9push_backERKi", "std::vector<int, std::allocator<int> >::push_back(int const&)" },
+	{ "_ZN1AD0Ev", "A::~A()" },
+	{ "_ZNSsC1Ev", "std::basic_string<char, std::char_traits<char>, std::allocator<char> >::basic_string()" },
+	{ "_Z1fPFviE", "f(void (*)(int))" },
+	{ "_Z1fRA10_i", "f(int (&) [10])" },
+	{ "_Z1fM1AKFvvE", "f(void (A::*)() const)" },
+	{ "_ZTV3Foo", "vtable for Foo" },
+	{ "_ZThn8_N3Foo3barEv", "non-virtual thunk to Foo::bar()" },
+	{ "_ZGVZ3foovE1x", "guard variable for foo()::x" },
+	{ "_ZN12_GLOBAL__N_13fooEv", "(anonymous namespace)::foo()" },
+	{ "_Z3maxIiET_S0_S0_", "int max<int>(int, int)" },
+	{ "_Z1fILb1EEvv", "void f<true>()" },
+	{ "_ZN1AcviEv", "A::operator int()" },
+	{ "_ZnwmPv", "operator new(unsigned long, void*)" },
+	{ "_ZNKSt3__112basic_stringIcNS_11char_traitsIcEENS_9allocatorIcEEE4sizeEv",
+		"std::__1::basic_string<char, std::__1::char_traits<char>, std::__1::allocator<char> >::size() const" },
+	{ "_Z1fIJidEEvDpT_", "void f<int, double>(int, double)" },
+	{ "_ZZ4mainENKUlvE_clEv", "main::{lambda()#1}::operator()() const" },
+	{ "_Z3fooB5cxx11v", "foo[abi:cxx11]()" },
+	{ "_ZN3foo3barEv.cold", "foo::bar() [clone .cold]" },
+	{ "_Z1fiz", "f(int, ...)" },
+	{ "_ZStlsISt11char_traitsIcEERSt13basic_ostreamIcT_ES5_PKc",
+		"std::basic_ostream<char, std::char_traits<char> >& std::operator<< <std::char_traits<char> >"
+		"(std::basic_ostream<char, std::char_traits<char> >&, char const*)" },
+	{ "_ZNKR1A1fEv", "A::f() const &" },
+	{ "_$s4main3FooV", "main.Foo" },
+	{ "$sSS", "Swift.String" },
+	{ "$sSi", "Swift.Int" },
+	{ "_$s4main3FooV3baryyF", "main.Foo.bar() -> ()" },
+	{ "_$s4main3FooVMa", "type metadata accessor for main.Foo" },
+	{ "_$s4main3FooC4nameSSvg", "main.Foo.name.getter : Swift.String" },
+	{ "$s4main3fooyS2iF", "main.foo(Swift.Int) -> Swift.Int" },
+	{ "_main", NULL },
+	{ "_Z", NULL },
+	{ "__ZN", NULL },
+	{ "_Z1fILi5E", NULL },
+	{ "$s", NULL },
+};
+
+#define GOLDEN_COUNT (sizeof(goldens) / sizeof(goldens[0]))
+#define MANY         600	/* enough names for the batch to be split across workers */
+
+static test_symbol_t many[MANY];
+static const char* many_results[MANY];
+
+int main() {
+	uint64_t i = 0;
+	uint64_t size = 0;
+	char* name = NULL;
+	const char* first = NULL;
+	const char* results[GOLDEN_COUNT];
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_demangler_t_64* single = NULL;
+	macho_demangler_t_64* range = NULL;
+	static unsigned char code[0x10];
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	test_symbol_t symbols[GOLDEN_COUNT];
+	test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, GOLDEN_COUNT, symbols, 0, NULL, 0, NULL, 0 };
+
+	for (i = 0; i < GOLDEN_COUNT; i++) {
+		name = macho_demangle_string_64(goldens[i].mangled);
+		if (goldens[i].demangled) {
+			test_check(name && strcmp(name, goldens[i].demangled) == 0);
+		} else {
+			test_check(name == NULL);
+		}
+		if (name && goldens[i].demangled && strcmp(name, goldens[i].demangled) != 0) {
+			fprintf(stderr, "%s: got %s\n", goldens[i].mangled, name);
+		}
+		free(name);
+	}
+
+	// The symbol table demanglers must agree with the string one, whether
+	//   names are looked up one at a time or a range at once
+	for (i = 0; i < GOLDEN_COUNT; i++) {
+		symbols[i].name = goldens[i].mangled;
+		symbols[i].type = TEST_N_SECT;
+		symbols[i].sect = 1;
+		symbols[i].value = TEST_TEXT;
+	}
+	data = test_image_build(&image, &size);
+	macho = data ? macho_load_64(data, size) : NULL;
+	test_check(macho && macho->symtab_count == 1);
+	if (macho == NULL || macho->symtab_count != 1) {
+		free(data);
+		return test_finish("demangle");
+	}
+
+	single = macho_demangler_create_64(macho->symtabs[0]);
+	range = macho_demangler_create_64(macho->symtabs[0]);
+	test_check(single && range);
+	test_check(macho_demangle_range_64(range, 0, GOLDEN_COUNT, results) == 0);
+	for (i = 0; i < GOLDEN_COUNT; i++) {
+		first = macho_demangle_64(single, i);
+		if (goldens[i].demangled) {
+			test_check(first && strcmp(first, goldens[i].demangled) == 0);
+			test_check(results[i] && strcmp(results[i], goldens[i].demangled) == 0);
+		} else {
+			test_check(first == NULL && results[i] == NULL);
+		}
+		// Memoized, a second lookup hands back the same string
+		test_check(macho_demangle_64(single, i) == first);
+	}
+	test_check(macho_demangle_64(single, GOLDEN_COUNT) == NULL);
+	test_check(macho_demangle_range_64(range, GOLDEN_COUNT - 1, 2, results) < 0);
+
+	macho_demangler_free_64(single);
+	macho_demangler_free_64(range);
+	macho_free_64(macho);
+	free(data);
+
+	// Larger ranges are demangled in chunks on the worker pool
+	for (i = 0; i < MANY; i++) {
+		many[i] = symbols[i % GOLDEN_COUNT];
+	}
+	image.symbol_count = MANY;
+	image.symbols = many;
+	data = test_image_build(&image, &size);
+	macho = data ? macho_load_64(data, size) : NULL;
+	test_check(macho && macho->symtab_count == 1);
+	if (macho && macho->symtab_count == 1) {
+		range = macho_demangler_create_64(macho->symtabs[0]);
+		test_check(range && macho_demangle_range_64(range, 0, MANY, many_results) == 0);
+		for (i = 0; range && i < MANY; i++) {
+			if (goldens[i % GOLDEN_COUNT].demangled) {
+				test_check(many_results[i] && strcmp(many_results[i], goldens[i % GOLDEN_COUNT].demangled) == 0);
+			} else {
+				test_check(many_results[i] == NULL);
+			}
+		}
+		macho_demangler_free_64(range);
+	}
+	macho_free_64(macho);
+	free(data);
+	return test_finish("demangle");
+}
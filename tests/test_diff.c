@@ -0,0 +1,156 @@
+/**
+ * libmacho-1.0 - test_diff.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/diff.h>
+
+#include "test.h"
+
+#define DATA (TEST_TEXT + 0x4000)
+
+static macho_diff_entry_t_64* find(macho_diff_t_64* diff, uint32_t kind, const char* name) {
+	uint64_t i = 0;
+	for (i = 0; i < diff->count; i++) {
+		if (diff->entries[i].kind == kind && strcmp(diff->entries[i].name, name) == 0) {
+			return &diff->entries[i];
+		}
+	}
+	return NULL;
+}
+
+int main() {
+	uint64_t count = 0;
+	uint64_t old_size = 0;
+	uint64_t new_size = 0;
+	int64_t delta = 0;
+	unsigned char* old_data = NULL;
+	unsigned char* new_data = NULL;
+	macho_t_64* old_macho = NULL;
+	macho_t_64* new_macho = NULL;
+	macho_diff_t_64* diff = NULL;
+	macho_diff_entry_t_64* entry = NULL;
+	static unsigned char old_text[0x2000];
+	static unsigned char new_text[0x2000];
+	static unsigned char konst[0x1100];
+	static unsigned char bytes[0x110];
+
+	// Between the two, __text changes in place, __const moves and grows,
+	//   __data stays and __extra appears after it
+	const test_section_t old_text_sections[] = {
+		{ "__text", 0, old_text, sizeof(old_text), TEST_S_CODE, 0, 0 },
+		{ "__const", 0x2000, konst, 0x100, 0, 0, 0 },
+	};
+	const test_section_t new_text_sections[] = {
+		{ "__text", 0, new_text, sizeof(new_text), TEST_S_CODE, 0, 0 },
+		{ "__const", 0x2800, konst, 0x1100, 0, 0, 0 },
+	};
+	const test_section_t old_data_sections[] = { { "__data", 0, bytes, 0x100, 0, 0, 0 } };
+	const test_section_t new_data_sections[] = {
+		{ "__data", 0, bytes, 0x100, 0, 0, 0 },
+		{ "__extra", 0x100, bytes + 0x100, 0x10, 0, 0, 0 },
+	};
+	const test_segment_t old_segments[] = {
+		{ "__TEXT", TEST_TEXT, 2, old_text_sections },
+		{ "__DATA", DATA, 1, old_data_sections },
+	};
+	const test_segment_t new_segments[] = {
+		{ "__TEXT", TEST_TEXT, 2, new_text_sections },
+		{ "__DATA", DATA, 2, new_data_sections },
+	};
+	// _c is last in __text and must stop at its end even when __const moves
+	//   away; the _dup pairs are listed in opposite orders
+	const test_symbol_t old_symbols[] = {
+		{ "_a", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_dup", TEST_N_SECT, 1, TEST_TEXT + 0x100 },
+		{ "_dup", TEST_N_SECT, 1, TEST_TEXT + 0x900 },
+		{ "_b", TEST_N_SECT, 1, TEST_TEXT + 0x800 },
+		{ "_c", TEST_N_SECT, 1, TEST_TEXT + 0x1800 },
+		{ "_k", TEST_N_SECT, 2, TEST_TEXT + 0x2000 },
+		{ "_gone", TEST_N_SECT, 3, DATA },
+		{ "_printf", TEST_N_UNDF, 0, 0 },
+	};
+	const test_symbol_t new_symbols[] = {
+		{ "_a", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_dup", TEST_N_SECT, 1, TEST_TEXT + 0x900 },
+		{ "_dup", TEST_N_SECT, 1, TEST_TEXT + 0x100 },
+		{ "_b", TEST_N_SECT, 1, TEST_TEXT + 0x800 },
+		{ "_c", TEST_N_SECT, 1, TEST_TEXT + 0x1800 },
+		{ "_k", TEST_N_SECT, 2, TEST_TEXT + 0x2800 },
+		{ "_new", TEST_N_SECT, 4, DATA + 0x100 },
+		{ "_printf", TEST_N_UNDF, 0, 0 },
+	};
+	const test_image_t old_image = { TEST_CPU_ARM64, 0, 2, old_segments, 8, old_symbols, 0, NULL, 0, NULL, 0 };
+	const test_image_t new_image = { TEST_CPU_ARM64, 0, 2, new_segments, 8, new_symbols, 0, NULL, 0, NULL, 0 };
+
+	memset(old_text, 0xAA, sizeof(old_text));
+	memset(new_text, 0xAA, sizeof(new_text));
+	new_text[0x1234] = 0x55;
+	old_data = test_image_build(&old_image, &old_size);
+	new_data = test_image_build(&new_image, &new_size);
+	old_macho = old_data ? macho_load_64(old_data, old_size) : NULL;
+	new_macho = new_data ? macho_load_64(new_data, new_size) : NULL;
+	test_check(old_macho != NULL && new_macho != NULL);
+
+	diff = macho_diff_load_64(old_macho, new_macho);
+	test_check(diff != NULL);
+	if (diff == NULL) {
+		return test_finish("diff");
+	}
+
+	test_check(diff->size_delta == (int64_t) new_size - (int64_t) old_size);
+	test_check(diff->identical == 1);
+	test_check(diff->count == 7);
+
+	entry = find(diff, MACHO_DIFF_SEGMENT, "__TEXT");
+	test_check(entry && entry->change == MACHO_DIFF_RESIZED && entry->old_size == 0x3000 && entry->new_size == 0x4000);
+	test_check(find(diff, MACHO_DIFF_SEGMENT, "__DATA") == NULL);
+
+	entry = find(diff, MACHO_DIFF_SECTION, "__TEXT,__text");
+	test_check(entry && entry->change == MACHO_DIFF_CHANGED);
+	entry = find(diff, MACHO_DIFF_SECTION, "__TEXT,__const");
+	test_check(entry && entry->change == MACHO_DIFF_RESIZED && entry->old_size == 0x100 && entry->new_size == 0x1100);
+	entry = find(diff, MACHO_DIFF_SECTION, "__DATA,__extra");
+	test_check(entry && entry->change == MACHO_DIFF_ADDED && entry->new_size == 0x10);
+
+	entry = find(diff, MACHO_DIFF_SYMBOL, "_k");
+	test_check(entry && entry->change == MACHO_DIFF_RESIZED && entry->old_size == 0x100 && entry->new_size == 0x1100);
+	entry = find(diff, MACHO_DIFF_SYMBOL, "_gone");
+	test_check(entry && entry->change == MACHO_DIFF_REMOVED && entry->old_size == 0x100);
+	entry = find(diff, MACHO_DIFF_SYMBOL, "_new");
+	test_check(entry && entry->change == MACHO_DIFF_ADDED && entry->new_size == 0x10);
+	test_check(find(diff, MACHO_DIFF_SYMBOL, "_c") == NULL);
+	test_check(find(diff, MACHO_DIFF_SYMBOL, "_dup") == NULL);
+
+	macho_diff_count_64(diff, MACHO_DIFF_SYMBOL, MACHO_DIFF_RESIZED, &count, &delta);
+	test_check(count == 1 && delta == 0x1000);
+	macho_diff_count_64(diff, MACHO_DIFF_SECTION, MACHO_DIFF_ADDED, &count, &delta);
+	test_check(count == 1 && delta == 0x10);
+
+	macho_diff_free_64(diff);
+	macho_free_64(old_macho);
+	macho_free_64(new_macho);
+	free(old_data);
+	free(new_data);
+	return test_finish("diff");
+}
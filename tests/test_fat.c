@@ -0,0 +1,161 @@
+/**
+ * libmacho-1.0 - test_fat.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/fat.h>
+
+#include "test.h"
+
+#define SLICE_ALIGN 0x4000
+
+static void put_arch64(unsigned char* data, uint32_t index, uint32_t cputype, uint64_t offset, uint64_t size) {
+	unsigned char* entry = data + 8 + 32 * index;
+	test_put32(entry, cputype, 1);
+	test_put32(entry + 4, 0, 1);
+	test_put64(entry + 8, offset, 1);
+	test_put64(entry + 16, size, 1);
+	test_put32(entry + 24, 14, 1);
+}
+
+static int loads(const char* path, const unsigned char* data, uint64_t size) {
+	macho_fat_t_64* fat = NULL;
+	if (test_write_file(path, data, size) < 0) {
+		return -1;
+	}
+	fat = macho_fat_open_64(path);
+	if (fat == NULL) {
+		return 0;
+	}
+	macho_fat_free_64(fat);
+	return 1;
+}
+
+int main() {
+	int index = 0;
+	uint64_t x86_size = 0;
+	uint64_t arm_size = 0;
+	uint64_t size = 0;
+	char* dir = NULL;
+	char path[4096];
+	char slice[4096];
+	unsigned char* x86 = NULL;
+	unsigned char* arm = NULL;
+	unsigned char* data = NULL;
+	unsigned char* bad = NULL;
+	macho_fat_t_64* fat = NULL;
+	macho_map_t_64* map = NULL;
+	macho_t_64* macho = NULL;
+	static unsigned char code[0x40];
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t x86_symbols[] = { { "_x86", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_symbol_t arm_symbols[] = { { "_arm", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_image_t x86_image = { TEST_CPU_X86_64, 0, 1, segments, 1, x86_symbols, 0, NULL, 0, NULL, 0 };
+	const test_image_t arm_image = { TEST_CPU_ARM64, 0, 1, segments, 1, arm_symbols, 0, NULL, 0, NULL, 0 };
+
+	dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir == NULL) {
+		return test_finish("fat");
+	}
+	snprintf(path, sizeof(path), "%s/fat", dir);
+	snprintf(slice, sizeof(slice), "%s/slice", dir);
+
+	x86 = test_image_build(&x86_image, &x86_size);
+	arm = test_image_build(&arm_image, &arm_size);
+	size = 2 * SLICE_ALIGN + ((arm_size + SLICE_ALIGN - 1) & ~((uint64_t) SLICE_ALIGN - 1));
+	data = calloc(1, size);
+	bad = malloc(size);
+	test_check(x86 && arm && data && bad && x86_size <= SLICE_ALIGN);
+
+	test_put32(data, MACHO_FAT_MAGIC_64, 1);
+	test_put32(data + 4, 2, 1);
+	put_arch64(data, 0, MACHO_CPU_TYPE_X86_64, SLICE_ALIGN, x86_size);
+	put_arch64(data, 1, MACHO_CPU_TYPE_ARM64, 2 * SLICE_ALIGN, arm_size);
+	memcpy(data + SLICE_ALIGN, x86, x86_size);
+	memcpy(data + 2 * SLICE_ALIGN, arm, arm_size);
+
+	test_check(test_write_file(path, data, size) == 0);
+	fat = macho_fat_open_64(path);
+	test_check(fat != NULL);
+	if (fat) {
+		test_check(fat->count == 2);
+		test_check(fat->archs[1].offset == 2 * SLICE_ALIGN && fat->archs[1].size == arm_size);
+		index = macho_fat_find_arch_64(fat, "arm64");
+		test_check(index == 1);
+		test_check(macho_fat_find_arch_64(fat, "ppc") < 0);
+		test_check(macho_fat_extract_64(fat, (uint32_t) index, slice) == 0);
+		test_check(macho_fat_extract_64(fat, 2, slice) < 0);
+		macho_fat_free_64(fat);
+
+		map = macho_map_open_64(slice);
+		test_check(map && map->size == arm_size && memcmp(map->data, arm, arm_size) == 0);
+		macho = map ? macho_load_64(map->data, map->size) : NULL;
+		test_check(macho && macho_lookup_64(macho, "_arm") == TEST_TEXT);
+		macho_free_64(macho);
+		macho_map_free_64(map);
+	}
+
+	// 64-bit offsets and sizes that wrap when added must not pass as in
+	//   bounds, and neither may a slice starting past the end
+	memcpy(bad, data, size);
+	put_arch64(bad, 1, MACHO_CPU_TYPE_ARM64, 2 * SLICE_ALIGN, UINT64_MAX - SLICE_ALIGN);
+	test_check(loads(path, bad, size) == 0);
+
+	memcpy(bad, data, size);
+	put_arch64(bad, 1, MACHO_CPU_TYPE_ARM64, UINT64_MAX - 0xF, 0x20);
+	test_check(loads(path, bad, size) == 0);
+
+	memcpy(bad, data, size);
+	put_arch64(bad, 1, MACHO_CPU_TYPE_ARM64, size + 1, 0);
+	test_check(loads(path, bad, size) == 0);
+
+	memcpy(bad, data, size);
+	put_arch64(bad, 1, MACHO_CPU_TYPE_ARM64, 2 * SLICE_ALIGN, size - 2 * SLICE_ALIGN + 1);
+	test_check(loads(path, bad, size) == 0);
+
+	memcpy(bad, data, size);
+	put_arch64(bad, 1, MACHO_CPU_TYPE_ARM64, 2 * SLICE_ALIGN, size - 2 * SLICE_ALIGN);
+	test_check(loads(path, bad, size) == 1);
+
+	memcpy(bad, data, size);
+	test_put32(bad + 4, 0x10000000, 1);
+	test_check(loads(path, bad, size) == 0);
+
+	// A thin image is one slice covering the whole file
+	test_check(test_write_file(path, arm, arm_size) == 0);
+	fat = macho_fat_open_64(path);
+	test_check(fat && fat->count == 1 && fat->archs[0].size == arm_size);
+	test_check(macho_fat_find_arch_64(fat, "arm64") == 0);
+	macho_fat_free_64(fat);
+
+	test_remove_dir(dir);
+	free(dir);
+	free(bad);
+	free(data);
+	free(arm);
+	free(x86);
+	return test_finish("fat");
+}
@@ -0,0 +1,129 @@
+/**
+ * libmacho-1.0 - test_iterator.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symtab.h>
+
+#include "test.h"
+
+#define LC_SYMTAB 0x2
+#define SYMBOLS   300
+
+static unsigned char code[SYMBOLS * 4];
+static char names[SYMBOLS][16];
+static test_symbol_t symbols[SYMBOLS];
+
+static void count_symbol(const char* name, uint64_t value, void* userdata) {
+	if (name && value) {
+		(*(uint64_t*) userdata)++;
+	}
+}
+
+int main() {
+	uint32_t i = 0;
+	uint32_t strx = 0;
+	uint64_t size = 0;
+	uint64_t count = 0;
+	uint64_t total = 0;
+	uint64_t listed = 0;
+	unsigned char* cmd = NULL;
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_symbol_record_t_64 records[7];
+	macho_symbol_cursor_t_64 cursor = { 0, 0 };
+	macho_symbol_filter_t_64 undefined = { 0x0E, 0x00, 0, 0, 0 };
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, SYMBOLS, symbols, 0, NULL, 0, NULL, 0 };
+
+	// Every third symbol is an import, the rest are defined in __text
+	for (i = 0; i < SYMBOLS; i++) {
+		snprintf(names[i], sizeof(names[i]), "_sym%u", i);
+		symbols[i].name = names[i];
+		symbols[i].type = (i % 3) ? TEST_N_SECT : TEST_N_UNDF;
+		symbols[i].sect = (i % 3) ? 1 : 0;
+		symbols[i].value = (i % 3) ? TEST_TEXT + i * 4 : 0;
+	}
+	data = test_image_build(&image, &size);
+	test_check(data != NULL);
+	if (data == NULL) {
+		return test_finish("iterator");
+	}
+
+	// Cut the string table short so the last symbol loses its name
+	cmd = test_image_command(data, LC_SYMTAB);
+	memcpy(&strx, data + macho_read32_64(cmd + 8) + (SYMBOLS - 1) * sizeof(struct nlist_64), sizeof(strx));
+	test_put32(cmd + 20, strx + strlen(names[SYMBOLS - 1]), 0);
+
+	macho = macho_load_64(data, size);
+	test_check(macho && macho->symtab_count == 1);
+	if (macho == NULL) {
+		free(data);
+		return test_finish("iterator");
+	}
+
+	// Small batches resume where the last one stopped and visit every
+	//   symbol once, in order
+	while ((count = macho_symbols_next_64(macho, &cursor, NULL, records, 7)) > 0) {
+		test_check(count <= 7);
+		for (i = 0; i < count; i++) {
+			test_check(records[i].index == total + i);
+			test_check(records[i].value == symbols[total + i].value);
+			test_check(records[i].type == symbols[total + i].type);
+			test_check(records[i].sect == symbols[total + i].sect);
+		}
+		total += count;
+	}
+	test_check(total == SYMBOLS);
+	test_check(cursor.symtab == macho->symtab_count && cursor.index == 0);
+	test_check(macho_symbols_next_64(macho, &cursor, NULL, records, 7) == 0);
+	test_check(macho_symtab_name_64(macho->symtabs[0], SYMBOLS - 2) != NULL);
+	test_check(macho_symtab_name_64(macho->symtabs[0], SYMBOLS - 1) == NULL);
+
+	// Filters on type skip the defined symbols
+	memset(&cursor, '\0', sizeof(cursor));
+	total = 0;
+	while ((count = macho_symbols_next_64(macho, &cursor, &undefined, records, 7)) > 0) {
+		for (i = 0; i < count; i++) {
+			test_check(records[i].type == TEST_N_UNDF && records[i].index % 3 == 0);
+			test_check(records[i].name && strcmp(records[i].name, names[records[i].index]) == 0);
+		}
+		total += count;
+	}
+	test_check(total == SYMBOLS / 3);
+
+	// The listing keeps named symbols with a value, so neither the imports
+	//   nor the unterminated last name are reported
+	macho_list_symbols_64(macho, count_symbol, &listed);
+	test_check(listed == SYMBOLS - SYMBOLS / 3 - 1);
+
+	memset(&cursor, '\0', sizeof(cursor));
+	test_check(macho_symbols_next_64(NULL, &cursor, NULL, records, 7) == 0);
+	test_check(macho_symbols_next_64(macho, NULL, NULL, records, 7) == 0);
+	test_check(macho_symbols_next_64(macho, &cursor, NULL, NULL, 7) == 0);
+
+	macho_free_64(macho);
+	free(data);
+	return test_finish("iterator");
+}
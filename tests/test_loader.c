@@ -0,0 +1,135 @@
+/**
+ * libmacho-1.0 - test_loader.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/loader.h>
+
+#include "test.h"
+
+#define PATHS 9
+
+typedef struct visits_t {
+	pthread_mutex_t lock;
+	int seen[PATHS];
+	int good[PATHS];
+	int fail_at;		/* index whose callback fails, or -1 */
+} visits_t;
+
+static unsigned char code[0x3000];
+
+static int visit(uint64_t index, macho_t_64* macho, void* userdata) {
+	visits_t* visits = (visits_t*) userdata;
+	int good = index < PATHS && macho_lookup_64(macho, "_main") == TEST_TEXT + index * 4;
+	pthread_mutex_lock(&visits->lock);
+	if (index < PATHS) {
+		visits->seen[index]++;
+		visits->good[index] += good;
+	}
+	pthread_mutex_unlock(&visits->lock);
+	return (int) index == visits->fail_at;
+}
+
+// Only the thin 64-bit Mach-Os are handed over, each exactly once
+static void check_run(const char* const* paths, const int* valid, const char* backend) {
+	uint64_t i = 0;
+	visits_t visits;
+
+	if (backend) {
+		setenv("LIBMACHO_LOADER", backend, 1);
+		test_check(macho_loader_backend_64() == MACHO_LOADER_THREADS);
+	} else {
+		unsetenv("LIBMACHO_LOADER");
+	}
+	memset(&visits, '\0', sizeof(visits));
+	pthread_mutex_init(&visits.lock, NULL);
+	visits.fail_at = -1;
+	test_check(macho_loader_run_64(paths, PATHS, 2, visit, &visits) == 0);
+	for (i = 0; i < PATHS; i++) {
+		test_check(visits.seen[i] == valid[i]);
+		test_check(visits.good[i] == valid[i]);
+	}
+
+	// A failing callback fails the run
+	memset(visits.seen, '\0', sizeof(visits.seen));
+	visits.fail_at = 0;
+	test_check(macho_loader_run_64(paths, PATHS, 0, visit, &visits) < 0);
+	test_check(visits.seen[0] == 1);
+	pthread_mutex_destroy(&visits.lock);
+}
+
+int main() {
+	int i = 0;
+	uint64_t size = 0;
+	char* dir = NULL;
+	char names[PATHS][4096];
+	const char* paths[PATHS];
+	unsigned char* data = NULL;
+	test_symbol_t symbol = { "_main", TEST_N_SECT, 1, TEST_TEXT };
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 1, &symbol, 0, NULL, 0, NULL, 0 };
+	// images at 0, 2, 5 and 8 (big endian), a missing file, junk, an empty
+	//   file, a bare header and a fat header
+	const int valid[PATHS] = { 1, 0, 1, 0, 0, 1, 0, 0, 1 };
+	const unsigned char fat[8] = { 0xCA, 0xFE, 0xBA, 0xBE, 0, 0, 0, 0 };
+	unsigned char header[32];
+
+	dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir == NULL) {
+		return test_finish("loader");
+	}
+	for (i = 0; i < PATHS; i++) {
+		snprintf(names[i], sizeof(names[i]), "%s/file%d", dir, i);
+		paths[i] = names[i];
+		if (valid[i]) {
+			symbol.value = TEST_TEXT + i * 4;
+			image.big_endian = (i == 8);
+			data = test_image_build(&image, &size);
+			test_check(data && test_write_file(names[i], data, size) == 0);
+			free(data);
+		}
+	}
+	test_check(test_write_file(names[3], (const unsigned char*) "not a Mach-O, just text\n", 24) == 0);
+	test_check(test_write_file(names[4], (const unsigned char*) "", 0) == 0);
+	memset(header, '\0', sizeof(header));
+	test_put32(header, 0xFEEDFACF, 0);
+	test_put32(header + 16, 4, 0);
+	test_put32(header + 20, 0x100, 0);
+	test_check(test_write_file(names[6], header, sizeof(header)) == 0);
+	test_check(test_write_file(names[7], fat, sizeof(fat)) == 0);
+	/* names[1] is never created */
+
+	check_run(paths, valid, "threads");
+	// io_uring unless it is missing or filtered, then the threads again
+	check_run(paths, valid, NULL);
+
+	test_check(macho_loader_run_64(NULL, 1, 0, visit, NULL) < 0);
+	test_check(macho_loader_run_64(paths, 0, 0, visit, NULL) == 0);
+
+	test_remove_dir(dir);
+	free(dir);
+	return test_finish("loader");
+}
@@ -0,0 +1,112 @@
+/**
+ * libmacho-1.0 - test_map.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/map.h>
+
+#include "test.h"
+
+static unsigned char code[0x5123];
+
+static void check_advice(macho_map_t_64* map) {
+	int advice = 0;
+	for (advice = MACHO_MAP_NORMAL; advice <= MACHO_MAP_WILLNEED; advice++) {
+		test_check(macho_map_advise_64(map, 0, 0, advice) == 0);
+		test_check(macho_map_advise_64(map, 0x123, 0x10, advice) == 0);
+		test_check(macho_map_advise_64(map, map->size - 1, UINT64_MAX, advice) == 0);
+	}
+	test_check(macho_map_advise_64(map, map->size, 0, MACHO_MAP_NORMAL) < 0);
+	test_check(macho_map_advise_64(map, 0, 0, 42) < 0);
+}
+
+int main() {
+	uint32_t i = 0;
+	uint64_t size = 0;
+	char* dir = NULL;
+	char path[4096];
+	char empty[4096];
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_map_t_64* map = NULL;
+	macho_map_t_64* huge = NULL;
+	macho_map_faults_t_64 before;
+	macho_map_faults_t_64 after;
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT + 0x40 } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 1, symbols, 0, NULL, 0, NULL, 1 };
+
+	for (i = 0; i < sizeof(code); i++) {
+		code[i] = (unsigned char) (i * 7);
+	}
+	dir = test_temp_dir();
+	data = test_image_build(&image, &size);
+	test_check(dir && data);
+	if (dir == NULL || data == NULL) {
+		return test_finish("map");
+	}
+	snprintf(path, sizeof(path), "%s/image", dir);
+	snprintf(empty, sizeof(empty), "%s/empty", dir);
+	test_check(test_write_file(path, data, size) == 0);
+	test_check(test_write_file(empty, (const unsigned char*) "", 0) == 0);
+
+	// Hints cover whole pages around any range and never change the bytes
+	macho_map_faults_64(&before);
+	map = macho_map_open_64(path);
+	test_check(map && map->size == size && !map->huge && map->fd >= 0);
+	if (map) {
+		check_advice(map);
+		test_check(memcmp(map->data, data, size) == 0);
+		macho = macho_load_64(map->data, map->size);
+		test_check(macho && macho_lookup_64(macho, "_main") == TEST_TEXT + 0x40);
+		macho_free_64(macho);
+		macho_map_free_64(map);
+	}
+	macho_map_faults_64(&after);
+	test_check(after.minor >= before.minor && after.major >= before.major);
+
+	// The huge page copy starts on a huge page boundary, needs no file
+	//   descriptor and takes the same hints
+	huge = macho_map_open_huge_64(path);
+	test_check(huge && huge->size == size && huge->huge && huge->fd < 0);
+	if (huge) {
+		test_check(((uintptr_t) huge->data & (MACHO_MAP_HUGE_PAGE - 1)) == 0);
+		check_advice(huge);
+		test_check(memcmp(huge->data, data, size) == 0);
+		macho = macho_load_64(huge->data, huge->size);
+		test_check(macho && macho_lookup_64(macho, "_main") == TEST_TEXT + 0x40);
+		macho_free_64(macho);
+		macho_map_free_64(huge);
+	}
+
+	test_check(macho_map_open_64(empty) == NULL);
+	test_check(macho_map_open_huge_64(empty) == NULL);
+	test_check(macho_map_open_64(dir) == NULL);
+	test_check(macho_map_advise_64(NULL, 0, 0, MACHO_MAP_NORMAL) < 0);
+
+	test_remove_dir(dir);
+	free(dir);
+	free(data);
+	return test_finish("map");
+}
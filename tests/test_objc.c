@@ -0,0 +1,209 @@
+/**
+ * libmacho-1.0 - test_objc.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/objc.h>
+
+#include "test.h"
+
+#define DATA     (TEST_TEXT + 0x4000)
+#define STRINGS  (TEST_TEXT + 0x100)
+#define S_FOO    (STRINGS + 0)
+#define S_BASE   (STRINGS + 4)
+#define S_RUN    (STRINGS + 9)
+#define S_TYPES  (STRINGS + 13)
+#define S_HELPER (STRINGS + 21)
+#define S_EXTRA  (STRINGS + 28)
+#define S_PROTO  (STRINGS + 34)
+
+// __DATA, one buffer carved into the ObjC sections
+#define CLASSLIST 0x000
+#define CATLIST   0x018
+#define SELREFS   0x020
+#define PROTOLIST 0x030
+#define CONST     0x040	/* class_ro_t, method lists, the category and protocol */
+#define RO_FOO    0x040
+#define RO_FOOM   0x088
+#define RO_BASE   0x0D0
+#define RO_BASEM  0x118
+#define LIST      0x160	/* pointer method list */
+#define CATEGORY  0x180
+#define PROTOCOL  0x1B0
+#define RELATIVE  0x1C0	/* relative method list */
+#define BAD       0x1D8	/* entries too small to be methods */
+#define OBJC_DATA 0x200	/* the classes and metaclasses */
+#define FOO       0x200
+#define FOOM      0x228
+#define BASE      0x250
+#define BASEM     0x278
+
+static const char cstrings[] = "Foo\0Base\0run\0v16@0:8\0helper\0Extra\0Proto";
+static unsigned char code[0x100];
+static unsigned char data[0x2A0];
+
+static void put_ro(uint64_t offset, uint32_t flags, uint64_t name, uint64_t methods) {
+	test_put32(data + offset, flags, 0);
+	test_put32(data + offset + 4, 8, 0);
+	test_put32(data + offset + 8, 16, 0);
+	test_put64(data + offset + 24, name, 0);
+	test_put64(data + offset + 32, methods, 0);
+}
+
+static void put_class(uint64_t offset, uint64_t isa, uint64_t superclass, uint64_t ro) {
+	test_put64(data + offset, isa, 0);
+	test_put64(data + offset + 8, superclass, 0);
+	test_put64(data + offset + 32, ro, 0);
+}
+
+static void build_data() {
+	uint64_t entry = DATA + RELATIVE + 8;
+
+	test_put64(data + CLASSLIST, DATA + FOO, 0);
+	test_put64(data + CLASSLIST + 8, DATA + BASE, 0);
+	test_put64(data + CLASSLIST + 16, 0x1234, 0);	/* unmapped, skipped */
+	test_put64(data + CATLIST, DATA + CATEGORY, 0);
+	test_put64(data + SELREFS, S_RUN, 0);
+	test_put64(data + SELREFS + 8, S_HELPER, 0);
+	test_put64(data + PROTOLIST, DATA + PROTOCOL, 0);
+
+	put_ro(RO_FOO, 0, S_FOO, DATA + LIST);
+	put_ro(RO_FOOM, MACHO_OBJC_RO_META, S_FOO, DATA + RELATIVE);
+	put_ro(RO_BASE, 0, S_BASE, DATA + BAD);
+	put_ro(RO_BASEM, MACHO_OBJC_RO_META, S_BASE, 0);
+	put_class(FOO, DATA + FOOM, DATA + BASE, DATA + RO_FOO);
+	put_class(FOOM, 0, 0, DATA + RO_FOOM);
+	put_class(BASE, DATA + BASEM, 0, DATA + RO_BASE);
+	put_class(BASEM, 0, 0, DATA + RO_BASEM);
+
+	test_put32(data + LIST, sizeof(macho_objc_method_info_t_64), 0);
+	test_put32(data + LIST + 4, 1, 0);
+	test_put64(data + LIST + 8, S_RUN, 0);
+	test_put64(data + LIST + 16, S_TYPES, 0);
+	test_put64(data + LIST + 24, TEST_TEXT + 0x10, 0);
+
+	// Relative entries are offsets from each field, the name one to a selref
+	test_put32(data + RELATIVE, MACHO_OBJC_METHOD_LIST_RELATIVE | sizeof(macho_objc_relative_method_t_64), 0);
+	test_put32(data + RELATIVE + 4, 1, 0);
+	test_put32(data + RELATIVE + 8, (uint32_t) (DATA + SELREFS + 8 - entry), 0);
+	test_put32(data + RELATIVE + 12, (uint32_t) (S_TYPES - (entry + 4)), 0);
+	test_put32(data + RELATIVE + 16, (uint32_t) (TEST_TEXT + 0x20 - (entry + 8)), 0);
+
+	test_put32(data + BAD, 4, 0);
+	test_put32(data + BAD + 4, 1, 0);
+
+	test_put64(data + CATEGORY, S_EXTRA, 0);
+	test_put64(data + CATEGORY + 8, DATA + FOO, 0);
+	test_put64(data + CATEGORY + 16, DATA + LIST, 0);
+	test_put64(data + PROTOCOL + 8, S_PROTO, 0);
+}
+
+int main() {
+	uint64_t size = 0;
+	unsigned char* image_data = NULL;
+	macho_t_64* macho = NULL;
+	macho_objc_t_64* objc = NULL;
+	macho_objc_class_t_64* foo = NULL;
+	macho_objc_class_t_64* base = NULL;
+	macho_objc_methods_t_64* methods = NULL;
+	const test_section_t text_sections[] = {
+		{ "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 },
+		{ "__cstring", 0x100, (const unsigned char*) cstrings, sizeof(cstrings), TEST_S_CSTRING, 0, 0 },
+	};
+	const test_section_t data_sections[] = {
+		{ "__objc_classlist", CLASSLIST, data + CLASSLIST, CATLIST - CLASSLIST, 0, 0, 0 },
+		{ "__objc_catlist", CATLIST, data + CATLIST, SELREFS - CATLIST, 0, 0, 0 },
+		{ "__objc_selrefs", SELREFS, data + SELREFS, PROTOLIST - SELREFS, 0, 0, 0 },
+		{ "__objc_protolist", PROTOLIST, data + PROTOLIST, CONST - PROTOLIST, 0, 0, 0 },
+		{ "__objc_const", CONST, data + CONST, OBJC_DATA - CONST, 0, 0, 0 },
+		{ "__objc_data", OBJC_DATA, data + OBJC_DATA, sizeof(data) - OBJC_DATA, 0, 0, 0 },
+	};
+	const test_segment_t segments[] = {
+		{ "__TEXT", TEST_TEXT, 2, text_sections },
+		{ "__DATA", DATA, 6, data_sections },
+	};
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 2, segments, 1, symbols, 0, NULL, 0, NULL, 0 };
+
+	build_data();
+	image_data = test_image_build(&image, &size);
+	macho = image_data ? macho_load_64(image_data, size) : NULL;
+	objc = macho ? macho_objc_load_64(macho) : NULL;
+	test_check(objc != NULL);
+	if (objc == NULL) {
+		macho_free_64(macho);
+		free(image_data);
+		return test_finish("objc");
+	}
+
+	// The unmapped class list entry is skipped, the rest resolve by name
+	test_check(objc->class_count == 2);
+	foo = macho_objc_find_class_64(objc, "Foo");
+	base = macho_objc_find_class_64(objc, "Base");
+	test_check(foo && foo->address == DATA + FOO && foo->instance_size == 16);
+	test_check(foo && foo->superclass && strcmp(foo->superclass, "Base") == 0);
+	test_check(base && base->superclass == NULL);
+	test_check(macho_objc_find_class_64(objc, "Missing") == NULL);
+
+	// Method lists are decoded on demand, pointer and relative alike
+	if (foo) {
+		methods = macho_objc_methods_64(objc, &foo->instance_methods);
+		test_check(methods && methods->count == 1);
+		if (methods && methods->count == 1) {
+			test_check(strcmp(methods->methods[0].name, "run") == 0);
+			test_check(strcmp(methods->methods[0].types, "v16@0:8") == 0);
+			test_check(methods->methods[0].imp == TEST_TEXT + 0x10);
+		}
+		test_check(macho_objc_methods_64(objc, &foo->instance_methods) == methods);
+		methods = macho_objc_methods_64(objc, &foo->class_methods);
+		test_check(methods && methods->count == 1);
+		if (methods && methods->count == 1) {
+			test_check(methods->methods[0].name && strcmp(methods->methods[0].name, "helper") == 0);
+			test_check(methods->methods[0].types && strcmp(methods->methods[0].types, "v16@0:8") == 0);
+			test_check(methods->methods[0].imp == TEST_TEXT + 0x20);
+		}
+	}
+	if (base) {
+		test_check(macho_objc_methods_64(objc, &base->instance_methods) == NULL);
+		methods = macho_objc_methods_64(objc, &base->class_methods);
+		test_check(methods && methods->count == 0);
+	}
+
+	test_check(objc->category_count == 1);
+	if (objc->category_count == 1) {
+		test_check(strcmp(objc->categories[0].name, "Extra") == 0);
+		test_check(objc->categories[0].cls && strcmp(objc->categories[0].cls, "Foo") == 0);
+		methods = macho_objc_methods_64(objc, &objc->categories[0].instance_methods);
+		test_check(methods && methods->count == 1 && strcmp(methods->methods[0].name, "run") == 0);
+	}
+	test_check(objc->protocol_count == 1 && strcmp(objc->protocols[0], "Proto") == 0);
+	test_check(objc->selref_count == 2);
+	test_check(macho_objc_selector_64(objc, 0) && strcmp(macho_objc_selector_64(objc, 0), "run") == 0);
+	test_check(macho_objc_selector_64(objc, 1) && strcmp(macho_objc_selector_64(objc, 1), "helper") == 0);
+	test_check(macho_objc_selector_64(objc, 2) == NULL);
+
+	macho_objc_free_64(objc);
+	macho_free_64(macho);
+	free(image_data);
+	return test_finish("objc");
+}
@@ -0,0 +1,180 @@
+/**
+ * libmacho-1.0 - test_query.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/query.h>
+#include <libmacho-1.0/symtab.h>
+
+#include "test.h"
+
+#define LC_SYMTAB 0x2
+#define SYMBOLS   200	/* three full blocks and a tail of 8 */
+#define HIGH      0x8000000000000000ULL
+
+static unsigned char code[0x100];
+static char names[SYMBOLS][16];
+static test_symbol_t symbols[SYMBOLS];
+
+static const macho_query_t_64 queries[] = {
+	{ 0, 0, 0, 0, 0, 0, 0, NULL },
+	{ MACHO_QUERY_TYPE, 0x0F, 0x01, 0, 0, 0, 0, NULL },
+	{ MACHO_QUERY_TYPE | MACHO_QUERY_ORDINAL, 0x0F, 0x01, 0, 3, 0, 0, NULL },
+	{ MACHO_QUERY_TYPE | MACHO_QUERY_SECT, 0x0E, 0x0E, 2, 0, 0, 0, NULL },
+	{ MACHO_QUERY_VALUE, 0, 0, 0, 0, TEST_TEXT + 0x40, TEST_TEXT + 0x2C0, NULL },
+	{ MACHO_QUERY_VALUE, 0, 0, 0, 0, HIGH - 0x100, HIGH + 0x100, NULL },
+	{ MACHO_QUERY_VALUE, 0, 0, 0, 0, TEST_TEXT + 0x100, TEST_TEXT + 0x100, NULL },
+	{ MACHO_QUERY_SECT | MACHO_QUERY_VALUE, 0, 0, 1, 0, TEST_TEXT, UINT64_MAX, NULL },
+	{ MACHO_QUERY_ORDINAL | MACHO_QUERY_PREFIX, 0, 0, 0, 1, 0, 0, "_sym1" },
+};
+
+// One symbol at a time, straight from the nlist records
+static int reference(macho_symtab_t_64* symtab, uint64_t i, const macho_query_t_64* query) {
+	const char* name = NULL;
+	struct nlist_64* nl = &symtab->symbols[i];
+	if ((query->fields & MACHO_QUERY_TYPE) && (nl->n_type & query->type_mask) != (query->type_value & query->type_mask)) {
+		return 0;
+	}
+	if ((query->fields & MACHO_QUERY_SECT) && nl->n_sect != query->sect) {
+		return 0;
+	}
+	if ((query->fields & MACHO_QUERY_ORDINAL) && MACHO_LIBRARY_ORDINAL(nl->n_desc) != query->ordinal) {
+		return 0;
+	}
+	if ((query->fields & MACHO_QUERY_VALUE) && (nl->n_value < query->value_min || nl->n_value >= query->value_max)) {
+		return 0;
+	}
+	if (query->fields & MACHO_QUERY_PREFIX) {
+		name = macho_symtab_name_64(symtab, i);
+		return name && strncmp(name, query->prefix, strlen(query->prefix)) == 0;
+	}
+	return 1;
+}
+
+// Every query must select the same symbols, in order, as the reference
+static void check_queries(macho_t_64* macho) {
+	uint64_t i = 0;
+	uint64_t j = 0;
+	uint64_t k = 0;
+	uint64_t bits[(SYMBOLS + 63) / 64];
+	uint64_t expect[(SYMBOLS + 63) / 64];
+	macho_query_result_t_64* result = NULL;
+
+	for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+		memset(bits, '\0', sizeof(bits));
+		memset(expect, '\0', sizeof(expect));
+		for (j = 0; j < SYMBOLS; j++) {
+			if (reference(macho->symtabs[0], j, &queries[i])) {
+				expect[j / 64] |= 1ULL << (j % 64);
+			}
+		}
+		result = macho_query_symbols_64(macho, &queries[i]);
+		test_check(result != NULL);
+		if (result == NULL) {
+			continue;
+		}
+		for (k = 0; k < result->count; k++) {
+			test_check(result->matches[k].symtab == 0 && result->matches[k].index < SYMBOLS);
+			test_check(k == 0 || result->matches[k].index > result->matches[k - 1].index);
+			if (result->matches[k].index < SYMBOLS) {
+				bits[result->matches[k].index / 64] |= 1ULL << (result->matches[k].index % 64);
+			}
+		}
+		test_check(memcmp(bits, expect, sizeof(bits)) == 0);
+		macho_query_result_free_64(result);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int status = 0;
+	uint32_t i = 0;
+	uint64_t size = 0;
+	uint64_t symoff = 0;
+	pid_t pid = 0;
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	const test_section_t sections[] = {
+		{ "__text", 0, code, sizeof(code) / 2, TEST_S_CODE, 0, 0 },
+		{ "__const", sizeof(code) / 2, code, sizeof(code) / 2, 0, 0, 0 },
+	};
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 2, sections } };
+	const test_image_t image = { TEST_CPU_X86_64, 0, 1, segments, SYMBOLS, symbols, 0, NULL, 0, NULL, 0 };
+
+	// A mix of imports from a few libraries and definitions in two sections,
+	//   a handful placed around the top bit to catch signed compares
+	for (i = 0; i < SYMBOLS; i++) {
+		snprintf(names[i], sizeof(names[i]), "_sym%u", i);
+		symbols[i].name = names[i];
+		if (i % 5 == 0) {
+			symbols[i].type = TEST_N_UNDF;
+		} else {
+			symbols[i].type = (i % 7) ? TEST_N_SECT : 0x0E;
+			symbols[i].sect = 1 + (i % 2);
+			symbols[i].value = (i % 11 == 0) ? HIGH - 0x80 + i : TEST_TEXT + i * 4;
+		}
+	}
+	data = test_image_build(&image, &size);
+	test_check(data != NULL);
+	if (data == NULL) {
+		return test_finish("query");
+	}
+	symoff = macho_read32_64(test_image_command(data, LC_SYMTAB) + 8);
+	for (i = 0; i < SYMBOLS; i++) {
+		if (i % 5 == 0) {
+			test_put16(data + symoff + i * sizeof(struct nlist_64) + 6, (i % 4) << 8, 0);
+		}
+	}
+
+	macho = macho_load_64(data, size);
+	test_check(macho && macho->symtab_count == 1);
+	if (macho && macho->symtab_count == 1) {
+		check_queries(macho);
+	}
+	macho_free_64(macho);
+	free(data);
+
+	// The backend is picked once per process, so the generic one is checked
+	//   in a copy of this test started without SIMD
+	if (getenv("LIBMACHO_NO_QUERY_SIMD")) {
+		test_check(strcmp(macho_query_backend_64(), "generic") == 0);
+		return test_finish("query (generic)");
+	}
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		test_check(strcmp(macho_query_backend_64(), "avx2") == 0);
+	}
+#endif
+	pid = fork();
+	if (pid == 0) {
+		setenv("LIBMACHO_NO_QUERY_SIMD", "1", 1);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+	test_check(pid > 0 && waitpid(pid, &status, 0) == pid);
+	test_check(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	(void) argc;
+	return test_finish("query");
+}
@@ -0,0 +1,184 @@
+/**
+ * libmacho-1.0 - test_server.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/server.h>
+
+#include "test.h"
+
+#define NAME_SIZE     4000
+#define ADDRESS_COUNT 20000
+
+typedef struct server_thread_t {
+	macho_server_t_64* server;
+	volatile int stop;
+	int ret;
+} server_thread_t;
+
+static void* serve(void* userdata) {
+	server_thread_t* thread = (server_thread_t*) userdata;
+	thread->ret = macho_server_run_64(thread->server, &thread->stop);
+	return NULL;
+}
+
+// Walks the frames of a symbolicate reply, counting the ones naming the
+//   long symbol at the expected offset
+static uint32_t check_frames(const macho_server_response_t_64* response, const unsigned char* records,
+		const char* name) {
+	uint32_t i = 0;
+	uint32_t good = 0;
+	uint64_t offset = 0;
+	macho_server_frame_t_64 frame;
+
+	for (i = 0; i < response->count && offset + sizeof(frame) <= response->payload_size; i++) {
+		memcpy(&frame, records + offset, sizeof(frame));
+		offset += sizeof(frame);
+		if (frame.name_size > response->payload_size - offset) {
+			break;
+		}
+		if (frame.address == TEST_TEXT && frame.offset == 8 && frame.name_size == NAME_SIZE
+				&& memcmp(records + offset, name, NAME_SIZE) == 0) {
+			good++;
+		}
+		offset += frame.name_size;
+	}
+	return good;
+}
+
+int main() {
+	int fd = -1;
+	int stalled = -1;
+	uint32_t i = 0;
+	time_t started = 0;
+	uint32_t done = 0;
+	uint64_t size = 0;
+	char* dir = NULL;
+	char* name = NULL;
+	char socket_path[256];
+	char image_path[4096];
+	char junk_path[4096];
+	unsigned char* data = NULL;
+	unsigned char* records = NULL;
+	uint64_t* addresses = NULL;
+	pthread_t thread;
+	server_thread_t state;
+	macho_server_response_t_64 response;
+	static unsigned char code[0x100];
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	test_symbol_t symbols[] = { { NULL, TEST_N_SECT, 1, TEST_TEXT } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 1, symbols, 0, NULL, 0, NULL, 0 };
+
+	dir = test_temp_dir();
+	name = malloc(NAME_SIZE + 1);
+	addresses = malloc(ADDRESS_COUNT * sizeof(uint64_t));
+	test_check(dir && name && addresses);
+	if (dir == NULL || name == NULL || addresses == NULL) {
+		return test_finish("server");
+	}
+	memset(name, 'x', NAME_SIZE);
+	name[0] = '_';
+	name[NAME_SIZE] = '\0';
+	symbols[0].name = name;
+	for (i = 0; i < ADDRESS_COUNT; i++) {
+		addresses[i] = TEST_TEXT + 8;
+	}
+
+	snprintf(socket_path, sizeof(socket_path), "%.200s/socket", dir);
+	snprintf(image_path, sizeof(image_path), "%s/image", dir);
+	snprintf(junk_path, sizeof(junk_path), "%s/junk", dir);
+	data = test_image_build(&image, &size);
+	test_check(data && test_write_file(image_path, data, size) == 0);
+	test_check(test_write_file(junk_path, (const unsigned char*) "junk", 4) == 0);
+
+	// A budget smaller than the image keeps it out of the cache entirely
+	memset(&state, '\0', sizeof(state));
+	state.server = macho_server_open_64(socket_path, 1);
+	test_check(state.server != NULL);
+	if (state.server == NULL || pthread_create(&thread, NULL, serve, &state) != 0) {
+		return test_finish("server");
+	}
+
+	fd = macho_server_connect_64(socket_path);
+	test_check(fd >= 0);
+	if (fd >= 0) {
+		test_check(macho_server_request_64(fd, MACHO_SERVER_LOOKUP, image_path, name, NAME_SIZE,
+				&response, &records) == 0);
+		test_check(response.status == MACHO_SERVER_OK && response.count == 1);
+		free(records);
+		test_check(macho_server_request_64(fd, MACHO_SERVER_LOOKUP, image_path, "_missing", 8,
+				&response, &records) == 0);
+		test_check(response.status == MACHO_SERVER_NOT_FOUND);
+		free(records);
+		test_check(macho_server_request_64(fd, MACHO_SERVER_LOOKUP, junk_path, "_main", 5,
+				&response, &records) == 0);
+		test_check(response.status == MACHO_SERVER_NO_IMAGE);
+		free(records);
+
+		// The full reply would be well past the payload cap, so it comes back
+		//   truncated to whole frames and the rest is asked for again
+		test_check(macho_server_request_64(fd, MACHO_SERVER_SYMBOLICATE, image_path, addresses,
+				ADDRESS_COUNT * sizeof(uint64_t), &response, &records) == 0);
+		test_check(response.status == MACHO_SERVER_TRUNCATED);
+		test_check(response.count > 0 && response.count < ADDRESS_COUNT);
+		test_check(response.payload_size <= MACHO_SERVER_PAYLOAD_MAX);
+		test_check(records && check_frames(&response, records, name) == response.count);
+		done = response.count;
+		free(records);
+
+		test_check(macho_server_request_64(fd, MACHO_SERVER_SYMBOLICATE, image_path, &addresses[done],
+				(ADDRESS_COUNT - done) * sizeof(uint64_t), &response, &records) == 0);
+		test_check(response.status == MACHO_SERVER_OK && response.count == ADDRESS_COUNT - done);
+		test_check(records && check_frames(&response, records, name) == response.count);
+		free(records);
+		close(fd);
+	}
+
+	// A client that stops partway through its header is dropped rather than
+	//   holding the server up when it is asked to stop
+	stalled = macho_server_connect_64(socket_path);
+	test_check(stalled >= 0 && write(stalled, "MSQ1", 4) == 4);
+	usleep(100000);
+	started = time(NULL);
+	state.stop = 1;
+	pthread_join(thread, NULL);
+	test_check(time(NULL) - started < 10);
+	if (stalled >= 0) {
+		close(stalled);
+	}
+	test_check(state.ret == 0);
+	test_check(state.server->used <= state.server->limit);
+	test_check(state.server->count == 0);
+	macho_server_free_64(state.server);
+
+	test_remove_dir(dir);
+	free(dir);
+	free(name);
+	free(addresses);
+	free(data);
+	return test_finish("server");
+}
@@ -0,0 +1,258 @@
+/**
+ * libmacho-1.0 - test_signature.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/signature.h>
+#include <libmacho-1.0/writer.h>
+
+#include "sha.h"
+#include "test.h"
+
+#define IDENTIFIER    "com.example.test"
+#define SPECIAL_SLOTS 5
+#define BLOB_COUNT    3
+#define CD_HEADER     88
+
+#define CORRUPT_PAGES        0x1 // wrong hashes in code slots 1 and 3
+#define CORRUPT_ENTITLEMENTS 0x2 // wrong hash in the entitlements slot
+#define CORRUPT_INFO         0x4 // wrong hash in the Info.plist slot
+
+static const char plist[] = "<?xml version=\"1.0\"?><plist><dict/></plist>";
+static const char entitlements[] = "<plist><dict><key>a</key><true/></dict></plist>";
+
+static uint32_t code_slots(uint32_t dataoff) {
+	return (dataoff + TEST_PAGE - 1) / TEST_PAGE;
+}
+
+static uint32_t signature_size(uint32_t dataoff) {
+	uint32_t cd = CD_HEADER + sizeof(IDENTIFIER) + (SPECIAL_SLOTS + code_slots(dataoff)) * MACHO_SHA256_DIGEST_SIZE;
+	return 12 + BLOB_COUNT * 8 + cd + 12 + 8 + sizeof(entitlements) - 1;
+}
+
+// Writes a SuperBlob with a CodeDirectory, an empty requirements blob and
+//   an entitlements blob at dataoff, hashing everything before it
+static void sign(unsigned char* data, uint32_t dataoff, int corrupt) {
+	uint32_t i = 0;
+	uint32_t ncode = code_slots(dataoff);
+	uint32_t hashoff = CD_HEADER + sizeof(IDENTIFIER) + SPECIAL_SLOTS * MACHO_SHA256_DIGEST_SIZE;
+	uint32_t cdlen = hashoff + ncode * MACHO_SHA256_DIGEST_SIZE;
+	uint32_t reqoff = 12 + BLOB_COUNT * 8 + cdlen;
+	uint32_t entoff = reqoff + 12;
+	uint32_t entlen = 8 + sizeof(entitlements) - 1;
+	unsigned char* sb = data + dataoff;
+	unsigned char* cd = sb + 12 + BLOB_COUNT * 8;
+	unsigned char* special = cd + hashoff - SPECIAL_SLOTS * MACHO_SHA256_DIGEST_SIZE;
+
+	test_put32(sb, MACHO_CSMAGIC_EMBEDDED_SIGNATURE, 1);
+	test_put32(sb + 4, signature_size(dataoff), 1);
+	test_put32(sb + 8, BLOB_COUNT, 1);
+	test_put32(sb + 12, MACHO_CSSLOT_CODEDIRECTORY, 1);
+	test_put32(sb + 16, 12 + BLOB_COUNT * 8, 1);
+	test_put32(sb + 20, MACHO_CSSLOT_REQUIREMENTS, 1);
+	test_put32(sb + 24, reqoff, 1);
+	test_put32(sb + 28, MACHO_CSSLOT_ENTITLEMENTS, 1);
+	test_put32(sb + 32, entoff, 1);
+
+	memset(cd, '\0', cdlen);
+	test_put32(cd, MACHO_CSMAGIC_CODEDIRECTORY, 1);
+	test_put32(cd + 4, cdlen, 1);
+	test_put32(cd + 8, 0x20400, 1);
+	test_put32(cd + 16, hashoff, 1);
+	test_put32(cd + 20, CD_HEADER, 1);
+	test_put32(cd + 24, SPECIAL_SLOTS, 1);
+	test_put32(cd + 28, ncode, 1);
+	test_put32(cd + 32, dataoff, 1);
+	cd[36] = MACHO_SHA256_DIGEST_SIZE;
+	cd[37] = MACHO_CS_HASHTYPE_SHA256;
+	cd[39] = 12;
+	memcpy(cd + CD_HEADER, IDENTIFIER, sizeof(IDENTIFIER));
+
+	test_put32(sb + reqoff, 0xFADE0C01, 1);
+	test_put32(sb + reqoff + 4, 12, 1);
+	test_put32(sb + reqoff + 8, 0, 1);
+	test_put32(sb + entoff, 0xFADE7171, 1);
+	test_put32(sb + entoff + 4, entlen, 1);
+	memcpy(sb + entoff + 8, entitlements, sizeof(entitlements) - 1);
+
+	// Special slots are stored in reverse, slot n at -n from the code slots
+	macho_sha256_64((const unsigned char*) plist, sizeof(plist), special + (SPECIAL_SLOTS - MACHO_CSSLOT_INFOSLOT) * MACHO_SHA256_DIGEST_SIZE);
+	macho_sha256_64(sb + reqoff, 12, special + (SPECIAL_SLOTS - MACHO_CSSLOT_REQUIREMENTS) * MACHO_SHA256_DIGEST_SIZE);
+	macho_sha256_64(sb + entoff, entlen, special + (SPECIAL_SLOTS - MACHO_CSSLOT_ENTITLEMENTS) * MACHO_SHA256_DIGEST_SIZE);
+	if (corrupt & CORRUPT_INFO) {
+		special[(SPECIAL_SLOTS - MACHO_CSSLOT_INFOSLOT) * MACHO_SHA256_DIGEST_SIZE] ^= 0xFF;
+	}
+	if (corrupt & CORRUPT_ENTITLEMENTS) {
+		special[(SPECIAL_SLOTS - MACHO_CSSLOT_ENTITLEMENTS) * MACHO_SHA256_DIGEST_SIZE] ^= 0xFF;
+	}
+	for (i = 0; i < ncode; i++) {
+		uint32_t end = (i + 1) * TEST_PAGE < dataoff ? (i + 1) * TEST_PAGE : dataoff;
+		macho_sha256_64(data + i * TEST_PAGE, end - i * TEST_PAGE, cd + hashoff + i * MACHO_SHA256_DIGEST_SIZE);
+		if ((corrupt & CORRUPT_PAGES) && (i == 1 || i == 3)) {
+			cd[hashoff + i * MACHO_SHA256_DIGEST_SIZE] ^= 0xFF;
+		}
+	}
+}
+
+static int verify(unsigned char* data, uint64_t size, macho_signature_verdict_t_64* verdict) {
+	int status = -1;
+	macho_t_64* macho = macho_load_64(data, size);
+	memset(verdict, '\0', sizeof(macho_signature_verdict_t_64));
+	if (macho) {
+		macho_verify_signature_64(macho, verdict);
+		status = verdict->status;
+		macho_free_64(macho);
+	}
+	return status;
+}
+
+int main() {
+	uint32_t i = 0;
+	uint32_t dataoff = 0;
+	uint64_t size = 0;
+	char* dir = NULL;
+	char path[4096];
+	unsigned char* data = NULL;
+	unsigned char* copy = NULL;
+	unsigned char* cmd = NULL;
+	unsigned char digest[MACHO_SHA256_DIGEST_SIZE];
+	macho_t_64* macho = NULL;
+	macho_t_64* stripped = NULL;
+	macho_map_t_64* map = NULL;
+	macho_writer_t_64* writer = NULL;
+	macho_section_t_64* text = NULL;
+	macho_signature_verdict_t_64 verdict;
+	static unsigned char code[0x5000];
+	static const unsigned char abc[] = {
+		0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+		0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD,
+	};
+	const test_section_t sections[] = {
+		{ "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 },
+		{ "__info_plist", sizeof(code), (const unsigned char*) plist, sizeof(plist), 0, 0, 0 },
+	};
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 2, sections } };
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT } };
+	test_blob_t blob = { 0x1D, NULL, 0 };
+	test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 1, symbols, 0, NULL, 1, &blob, 1 };
+
+	macho_sha256_64((const unsigned char*) "abc", 3, digest);
+	test_check(memcmp(digest, abc, sizeof(abc)) == 0);
+
+	for (i = 0; i < sizeof(code); i++) {
+		code[i] = (unsigned char) (i * 7);
+	}
+	// The signature's offset doesn't depend on its size, so lay the image
+	//   out once to find it and again with room for the blobs
+	data = test_image_build(&image, &size);
+	memcpy(&dataoff, test_image_command(data, 0x1D) + 8, sizeof(dataoff));
+	free(data);
+	blob.size = signature_size(dataoff);
+	data = test_image_build(&image, &size);
+	copy = malloc(size);
+	test_check(data != NULL && copy != NULL);
+	if (data == NULL || copy == NULL) {
+		return test_finish("signature");
+	}
+
+	sign(data, dataoff, 0);
+	test_check(verify(data, size, &verdict) == MACHO_SIGNATURE_VALID);
+	test_check(verdict.page_count == code_slots(dataoff));
+	test_check(verdict.code_limit == dataoff);
+	test_check(verdict.identifier && strcmp(verdict.identifier, IDENTIFIER) == 0);
+
+	// Every worker finds a mismatch, the verdict names the lowest page
+	memcpy(copy, data, size);
+	sign(copy, dataoff, CORRUPT_PAGES);
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_PAGE_MISMATCH);
+	test_check(verdict.failed_page == 1);
+
+	memcpy(copy, data, size);
+	copy[TEST_PAGE * 4 + 0x10] ^= 0xFF;
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_PAGE_MISMATCH);
+	test_check(verdict.failed_page == 4);
+
+	memcpy(copy, data, size);
+	sign(copy, dataoff, CORRUPT_ENTITLEMENTS);
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_SLOT_MISMATCH);
+	test_check(verdict.failed_slot == MACHO_CSSLOT_ENTITLEMENTS);
+
+	memcpy(copy, data, size);
+	sign(copy, dataoff, CORRUPT_INFO);
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_SLOT_MISMATCH);
+	test_check(verdict.failed_slot == MACHO_CSSLOT_INFOSLOT);
+
+	memcpy(copy, data, size);
+	test_put32(copy + dataoff + 16, 0x7FFFFFFF, 1);
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_MALFORMED);
+
+	// Page sizes are a shift, one out of range is refused before it is used
+	memcpy(copy, data, size);
+	copy[dataoff + 12 + BLOB_COUNT * 8 + 39] = 40;
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_MALFORMED);
+	memcpy(copy, data, size);
+	copy[dataoff + 12 + BLOB_COUNT * 8 + 39] = 11;
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_MALFORMED);
+
+	// A command too short to hold its offset and size is not read past
+	memcpy(copy, data, size);
+	test_put32(test_image_command(copy, 0x1D) + 4, 8, 0);
+	test_check(verify(copy, size, &verdict) == MACHO_SIGNATURE_MALFORMED);
+
+	// Unsigning drops the command and the blobs and leaves the code alone
+	dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir) {
+		snprintf(path, sizeof(path), "%s/unsigned", dir);
+		macho = macho_load_64(data, size);
+		writer = macho_writer_load_64(macho);
+		test_check(writer != NULL);
+		test_check(macho_writer_remove_signature_64(writer) == 0);
+		test_check(macho_writer_save_64(writer, path) == 0);
+		macho_writer_free_64(writer);
+		macho_free_64(macho);
+
+		map = macho_map_open_64(path);
+		stripped = map ? macho_load_64(map->data, map->size) : NULL;
+		test_check(stripped != NULL);
+		if (stripped) {
+			test_check(stripped->size == dataoff);
+			cmd = test_image_command(stripped->data, 0x1D);
+			test_check(cmd == NULL);
+			test_check(macho_verify_signature_64(stripped, &verdict) == 0);
+			test_check(verdict.status == MACHO_SIGNATURE_UNSIGNED);
+			text = macho_get_section_64(stripped, "__TEXT", "__text");
+			test_check(text && text->data && memcmp(text->data, code, sizeof(code)) == 0);
+			test_check(macho_lookup_64(stripped, "_main") == TEST_TEXT);
+			macho_free_64(stripped);
+		}
+		macho_map_free_64(map);
+		test_remove_dir(dir);
+		free(dir);
+	}
+
+	free(copy);
+	free(data);
+	return test_finish("signature");
+}
@@ -0,0 +1,181 @@
+/**
+ * libmacho-1.0 - test_swap.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/swap.h>
+#include <libmacho-1.0/vm.h>
+
+#include "test.h"
+
+#define DATA       (TEST_TEXT + 0x4000)
+#define HELLO      (TEST_TEXT + 0x11)
+#define FIXUPS     80
+#define LC_FIXUPS  0x80000034
+
+static const unsigned char cstrings[] = "\0hello\0world";
+
+// One PTR_64_OFFSET page in __DATA: a rebase to "hello", then a bind to
+//   import 0, _ext
+static void fixups(unsigned char* p, int be) {
+	memset(p, '\0', FIXUPS);
+	test_put32(p + 4, 32, be);		/* starts_offset */
+	test_put32(p + 8, 68, be);		/* imports_offset */
+	test_put32(p + 12, 72, be);		/* symbols_offset */
+	test_put32(p + 16, 1, be);		/* imports_count */
+	test_put32(p + 20, 1, be);		/* DYLD_CHAINED_IMPORT */
+	test_put32(p + 32, 2, be);		/* seg_count */
+	test_put32(p + 36, 0, be);
+	test_put32(p + 40, 12, be);
+	test_put32(p + 44, 24, be);		/* starts_in_segment size */
+	test_put16(p + 48, 0x1000, be);
+	test_put16(p + 50, 6, be);		/* DYLD_CHAINED_PTR_64_OFFSET */
+	test_put64(p + 52, DATA - TEST_TEXT, be);
+	test_put16(p + 64, 1, be);		/* page_count */
+	test_put16(p + 66, 0, be);		/* page_start */
+	test_put32(p + 68, 1 | (1 << 9), be);	/* ordinal 1, name at 1 */
+	memcpy(p + 73, "_ext", 4);
+}
+
+static unsigned char* build(int be, uint64_t* size) {
+	unsigned char pointers[16];
+	unsigned char payload[FIXUPS];
+	static const unsigned char code[] = {
+		0xC0, 0x03, 0x5F, 0xD6, 0xC0, 0x03, 0x5F, 0xD6, 0xC0, 0x03, 0x5F, 0xD6, 0xC0, 0x03, 0x5F, 0xD6,
+	};
+	const test_section_t text_sections[] = {
+		{ "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 },
+		{ "__cstring", 0x10, cstrings, sizeof(cstrings), TEST_S_CSTRING, 0, 0 },
+	};
+	const test_section_t data_sections[] = { { "__const", 0, pointers, sizeof(pointers), 0, 0, 0 } };
+	const test_segment_t segments[] = {
+		{ "__TEXT", TEST_TEXT, 2, text_sections },
+		{ "__DATA", DATA, 1, data_sections },
+	};
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_blob_t blob = { LC_FIXUPS, payload, FIXUPS };
+	const test_image_t image = { TEST_CPU_ARM64, be, 2, segments, 1, symbols, 0, NULL, 1, &blob, 0 };
+
+	test_put64(pointers, (HELLO - TEST_TEXT) | (2ULL << 51), be);
+	test_put64(pointers + 8, 1ULL << 63, be);
+	fixups(payload, be);
+	return test_image_build(&image, size);
+}
+
+// The caller's bytes are handed over read-only, so any attempt to swap
+//   them in place faults instead of passing
+static unsigned char* read_only(const unsigned char* data, uint64_t size) {
+	unsigned char* copy = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (copy == MAP_FAILED) {
+		return NULL;
+	}
+	memcpy(copy, data, size);
+	mprotect(copy, size, PROT_READ);
+	return copy;
+}
+
+static void check_image(macho_t_64* macho) {
+	const char* bind = NULL;
+	macho_vm_t_64* vm = NULL;
+	macho_section_t_64* section = NULL;
+
+	test_check(macho_lookup_64(macho, "_main") == TEST_TEXT);
+	test_check(macho->header->cputype == TEST_CPU_ARM64);
+	section = macho_get_section_64(macho, "__TEXT", "__cstring");
+	test_check(section && section->info->addr == TEST_TEXT + 0x10 && section->info->size == sizeof(cstrings));
+	test_check(section && memcmp(section->data, cstrings, sizeof(cstrings)) == 0);
+
+	vm = macho_vm_load_64(macho);
+	test_check(vm != NULL);
+	if (vm) {
+		test_check(vm->pointer_format == 6);
+		test_check(vm->import_count == 1);
+		test_check(macho_vm_pointer_64(vm, DATA, NULL) == HELLO);
+		test_check(macho_vm_pointer_64(vm, DATA + 8, &bind) == 0);
+		test_check(bind && strcmp(bind, "_ext") == 0);
+		test_check(macho_vm_string_64(vm, HELLO) && strcmp(macho_vm_string_64(vm, HELLO), "hello") == 0);
+		macho_vm_free_64(vm);
+	}
+}
+
+int main() {
+	uint64_t le_size = 0;
+	uint64_t be_size = 0;
+	unsigned char* le = NULL;
+	unsigned char* be = NULL;
+	unsigned char* view = NULL;
+	unsigned char* bad = NULL;
+	unsigned char* pristine = NULL;
+	macho_t_64* macho = NULL;
+
+	le = build(0, &le_size);
+	be = build(1, &be_size);
+	test_check(le && be && le_size == be_size);
+	if (le == NULL || be == NULL) {
+		return test_finish("swap");
+	}
+	test_check(!macho_is_swapped_64(le, le_size));
+	test_check(macho_is_swapped_64(be, be_size));
+
+	macho = macho_load_64(le, le_size);
+	test_check(macho && !macho->swapped);
+	if (macho) {
+		check_image(macho);
+		macho_free_64(macho);
+	}
+
+	view = read_only(be, be_size);
+	test_check(view != NULL);
+	if (view) {
+		macho = macho_load_64(view, be_size);
+		test_check(macho && macho->swapped && macho->data != view);
+		if (macho) {
+			check_image(macho);
+			macho_free_64(macho);
+		}
+		test_check(memcmp(view, be, be_size) == 0);
+		munmap(view, be_size);
+	}
+
+	// A load command running past sizeofcmds fails the load partway through
+	//   the swap and must leave the input as it was
+	bad = malloc(be_size);
+	pristine = malloc(be_size);
+	if (bad && pristine) {
+		memcpy(bad, be, be_size);
+		test_put32(test_image_command(le, LC_FIXUPS) - le + bad + 4, 0x10000, 1);
+		memcpy(pristine, bad, be_size);
+		view = read_only(bad, be_size);
+		test_check(view && macho_load_64(view, be_size) == NULL);
+		test_check(view && memcmp(view, pristine, be_size) == 0);
+		if (view) munmap(view, be_size);
+	}
+
+	free(pristine);
+	free(bad);
+	free(be);
+	free(le);
+	return test_finish("swap");
+}
@@ -0,0 +1,237 @@
+/**
+ * libmacho-1.0 - test_swift.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/swift.h>
+
+#include "test.h"
+
+#define META (TEST_TEXT + 0x100)
+
+// One buffer carved into the Swift sections, descriptors first
+#define MODULE    0x000
+#define POINT     0x010
+#define PROTO     0x030
+#define BASE      0x040
+#define PTR_BASE  0x058	/* pointer to the Base descriptor */
+#define PTR_PROTO 0x060	/* pointer to the Shape descriptor */
+#define CONF      0x070	/* three conformance descriptors */
+#define STRINGS   0x0A0
+#define S_APP     (STRINGS + 0)
+#define S_POINT   (STRINGS + 4)
+#define S_SHAPE   (STRINGS + 10)
+#define S_BASE    (STRINGS + 16)
+#define S_NSOBJ   (STRINGS + 21)
+#define TYPES     0x0C0
+#define CONFS     0x0D0
+#define FIELDMD   0x0E0
+#define REFLSTR   0x118
+#define TYPEREF   0x120
+#define T_INT     (TYPEREF + 0)
+#define T_DOUBLE  (TYPEREF + 3)
+#define T_POINT   (TYPEREF + 6)	/* symbolic reference, its offset bytes hold zeros */
+#define T_BASE    (TYPEREF + 12)
+#define T_NSOBJ   (TYPEREF + 19)
+
+static const char strings[] = "App\0Point\0Shape\0Base\0NSObject";
+static const char typeref[] = "Si\0Sd\0\x01\x00\x01\x00\x00\0" "4BaseC\0So8NSObjectC";
+static unsigned char code[0x100];
+static unsigned char meta[0x140];
+static int seen[3];
+
+// Relative references are signed offsets from the field that holds them
+static void put_relative(uint64_t field, uint64_t target, uint32_t low) {
+	test_put32(meta + field, (uint32_t) (int32_t) (target - field) | low, 0);
+}
+
+static void put_context(uint64_t offset, uint32_t kind, uint64_t name) {
+	test_put32(meta + offset, kind, 0);
+	if (offset != MODULE) {
+		put_relative(offset + 4, MODULE, 0);
+	}
+	put_relative(offset + 8, name, 0);
+}
+
+static void put_conformance(uint64_t offset, uint64_t protocol, uint32_t indirect, uint64_t type, uint32_t kind) {
+	put_relative(offset, protocol, indirect);
+	put_relative(offset + 4, type, 0);
+	test_put32(meta + offset + 8, 0x1000, 0);
+	test_put32(meta + offset + 12, kind << 3, 0);
+}
+
+static void put_record(uint64_t offset, uint32_t flags, uint64_t type, uint64_t name) {
+	test_put32(meta + offset, flags, 0);
+	put_relative(offset + 4, type, 0);
+	put_relative(offset + 8, name, 0);
+}
+
+static void build_meta() {
+	memcpy(meta + STRINGS, strings, sizeof(strings));
+	memcpy(meta + TYPEREF, typeref, sizeof(typeref));
+
+	put_context(MODULE, MACHO_SWIFT_KIND_MODULE, S_APP);
+	put_context(POINT, MACHO_SWIFT_KIND_STRUCT, S_POINT);
+	put_relative(POINT + 16, FIELDMD, 0);
+	put_context(PROTO, MACHO_SWIFT_KIND_PROTOCOL, S_SHAPE);
+	put_context(BASE, MACHO_SWIFT_KIND_CLASS, S_BASE);
+	test_put64(meta + PTR_BASE, META + BASE, 0);
+	test_put64(meta + PTR_PROTO, META + PROTO, 0);
+
+	// Point directly, Base through its pointer, and one entry off the image
+	put_relative(TYPES, POINT, 0);
+	put_relative(TYPES + 4, PTR_BASE, 1);
+	test_put32(meta + TYPES + 8, 0x40000000, 0);
+
+	put_conformance(CONF, PROTO, 0, POINT, MACHO_SWIFT_TYPE_DIRECT);
+	put_conformance(CONF + 0x10, PTR_PROTO, 1, PTR_BASE, MACHO_SWIFT_TYPE_INDIRECT);
+	put_conformance(CONF + 0x20, PROTO, 0, S_NSOBJ, MACHO_SWIFT_TYPE_OBJC_NAME);
+	put_relative(CONFS, CONF, 0);
+	put_relative(CONFS + 4, CONF + 0x10, 0);
+	put_relative(CONFS + 8, CONF + 0x20, 0);
+
+	// Point with two records, then Base with a superclass and none
+	put_relative(FIELDMD, T_POINT, 0);
+	test_put16(meta + FIELDMD + 10, sizeof(macho_swift_record_info_t_64), 0);
+	test_put32(meta + FIELDMD + 12, 2, 0);
+	put_record(FIELDMD + 16, 0, T_INT, REFLSTR);
+	put_record(FIELDMD + 28, 2, T_DOUBLE, REFLSTR + 2);
+	put_relative(FIELDMD + 40, T_BASE, 0);
+	put_relative(FIELDMD + 44, T_NSOBJ, 0);
+	test_put16(meta + FIELDMD + 48, 1, 0);
+	memcpy(meta + REFLSTR, "x\0y", 4);
+}
+
+static int collect(uint64_t index, macho_swift_conformance_t_64* conformance, void* userdata) {
+	const char* expected = (const char*) userdata;
+	if (index < 3 && conformance->protocol && strcmp(conformance->protocol, expected) == 0) {
+		seen[index] = 1;
+	}
+	return 0;
+}
+
+static int stop(uint64_t index, macho_swift_conformance_t_64* conformance, void* userdata) {
+	(void) conformance;
+	(void) userdata;
+	return index == 1 ? -1 : 0;
+}
+
+int main() {
+	uint64_t size = 0;
+	uint64_t cursor = 0;
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_swift_t_64* swift = NULL;
+	macho_section_t_64* fieldmd = NULL;
+	macho_swift_type_t_64 type;
+	macho_swift_field_t_64 field;
+	macho_swift_record_t_64 record;
+	macho_swift_conformance_t_64 conformance;
+	const test_section_t sections[] = {
+		{ "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 },
+		{ "__const", 0x100, meta, TYPES, 0, 0, 0 },
+		{ "__swift5_types", 0x100 + TYPES, meta + TYPES, 12, 0, 0, 0 },
+		{ "__swift5_proto", 0x100 + CONFS, meta + CONFS, 12, 0, 0, 0 },
+		{ "__swift5_fieldmd", 0x100 + FIELDMD, meta + FIELDMD, REFLSTR - FIELDMD, 0, 0, 0 },
+		{ "__swift5_reflstr", 0x100 + REFLSTR, meta + REFLSTR, 4, 0, 0, 0 },
+		{ "__swift5_typeref", 0x100 + TYPEREF, meta + TYPEREF, sizeof(typeref), 0, 0, 0 },
+	};
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 7, sections } };
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 1, symbols, 0, NULL, 0, NULL, 0 };
+
+	build_meta();
+	data = test_image_build(&image, &size);
+	macho = data ? macho_load_64(data, size) : NULL;
+	swift = macho ? macho_swift_load_64(macho) : NULL;
+	test_check(swift != NULL);
+	if (swift == NULL) {
+		macho_free_64(macho);
+		free(data);
+		return test_finish("swift");
+	}
+	test_check(swift->type_count == 3 && swift->types == META + TYPES);
+	test_check(swift->conformance_count == 3 && swift->conformances == META + CONFS);
+	test_check(swift->fields_size == REFLSTR - FIELDMD && swift->strings == META + REFLSTR);
+
+	// Types resolve direct and through a pointer, with their module
+	test_check(macho_swift_type_64(swift, 0, &type) == 0);
+	test_check(type.address == META + POINT && type.kind == MACHO_SWIFT_KIND_STRUCT);
+	test_check(type.name && strcmp(type.name, "Point") == 0);
+	test_check(type.parent && strcmp(type.parent, "App") == 0);
+	test_check(type.fields == META + FIELDMD);
+	test_check(macho_swift_type_64(swift, 1, &type) == 0);
+	test_check(type.address == META + BASE && type.kind == MACHO_SWIFT_KIND_CLASS);
+	test_check(type.name && strcmp(type.name, "Base") == 0 && type.fields == 0);
+	test_check(macho_swift_type_64(swift, 2, &type) < 0);
+	test_check(macho_swift_type_64(swift, 3, &type) < 0);
+
+	// Conformances name their type by descriptor, pointer or ObjC class
+	test_check(macho_swift_conformance_64(swift, 0, &conformance) == 0);
+	test_check(conformance.address == META + CONF && conformance.witness_table == META + CONF + 8 + 0x1000);
+	test_check(conformance.protocol && strcmp(conformance.protocol, "Shape") == 0);
+	test_check(conformance.type && strcmp(conformance.type, "Point") == 0);
+	test_check(macho_swift_conformance_64(swift, 1, &conformance) == 0);
+	test_check(conformance.protocol && strcmp(conformance.protocol, "Shape") == 0);
+	test_check(conformance.type && strcmp(conformance.type, "Base") == 0);
+	test_check(macho_swift_conformance_64(swift, 2, &conformance) == 0);
+	test_check(conformance.type && strcmp(conformance.type, "NSObject") == 0);
+	test_check(macho_swift_conformance_64(swift, 3, &conformance) < 0);
+
+	test_check(macho_swift_conformances_each_64(swift, collect, "Shape") == 0);
+	test_check(seen[0] && seen[1] && seen[2]);
+	test_check(macho_swift_conformances_each_64(swift, stop, NULL) < 0);
+	test_check(macho_swift_conformances_each_64(swift, NULL, NULL) < 0);
+
+	// Mangled names are sized past the zero bytes of symbolic references
+	test_check(macho_swift_fields_next_64(swift, &cursor, &field) == 1);
+	test_check(field.address == META + FIELDMD && field.count == 2 && field.superclass == NULL);
+	test_check(field.type && field.type_size == 5 && memcmp(field.type, "\x01\x00\x01\x00\x00", 6) == 0);
+	test_check(macho_swift_record_64(swift, &field, 0, &record) == 0);
+	test_check(record.flags == 0 && record.name && strcmp(record.name, "x") == 0);
+	test_check(record.type && record.type_size == 2 && strcmp(record.type, "Si") == 0);
+	test_check(macho_swift_record_64(swift, &field, 1, &record) == 0);
+	test_check(record.flags == 2 && record.name && strcmp(record.name, "y") == 0);
+	test_check(record.type && strcmp(record.type, "Sd") == 0);
+	test_check(macho_swift_record_64(swift, &field, 2, &record) < 0);
+	test_check(macho_swift_fields_next_64(swift, &cursor, &field) == 1);
+	test_check(field.kind == 1 && field.count == 0);
+	test_check(field.type && strcmp(field.type, "4BaseC") == 0);
+	test_check(field.superclass && field.superclass_size == 12 && strcmp(field.superclass, "So8NSObjectC") == 0);
+	test_check(macho_swift_fields_next_64(swift, &cursor, &field) == 0);
+
+	// A descriptor whose records run past the section ends the walk
+	fieldmd = macho_get_section_64(macho, "__TEXT", "__swift5_fieldmd");
+	test_check(fieldmd && fieldmd->data);
+	if (fieldmd && fieldmd->data) {
+		test_put32(fieldmd->data + 12, 4, 0);
+		cursor = 0;
+		test_check(macho_swift_fields_next_64(swift, &cursor, &field) == 0);
+	}
+
+	macho_swift_free_64(swift);
+	macho_free_64(macho);
+	free(data);
+	return test_finish("swift");
+}
@@ -0,0 +1,104 @@
+/**
+ * libmacho-1.0 - test_symbolicate.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/symbolicate.h>
+
+#include "test.h"
+
+#define DATA (TEST_TEXT + 0x4000)
+
+int main() {
+	uint64_t i = 0;
+	uint64_t size = 0;
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_symbolicator_t_64* symbolicator = NULL;
+	macho_symbolication_t_64 results[8];
+	static unsigned char text[0x600];
+	static unsigned char bytes[0x10];
+	const test_section_t text_sections[] = { { "__text", 0, text, sizeof(text), TEST_S_CODE, 0, 0 } };
+	const test_section_t data_sections[] = { { "__data", 0, bytes, sizeof(bytes), 0, 0, 0 } };
+	const test_segment_t segments[] = {
+		{ "__TEXT", TEST_TEXT, 1, text_sections },
+		{ "__DATA", DATA, 1, data_sections },
+	};
+	const test_symbol_t symbols[] = {
+		{ "_second", TEST_N_SECT, 1, TEST_TEXT + 0x80 },
+		{ "_first", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_data", TEST_N_SECT, 2, DATA },
+		{ "_import", TEST_N_UNDF, 0, 0 },
+	};
+	const test_image_t image = { TEST_CPU_ARM64, 0, 2, segments, 4, symbols, 0, NULL, 0, NULL, 0 };
+	// Deliberately unsorted, the results must come back in this order
+	const uint64_t addresses[] = {
+		TEST_TEXT + 0x5FF,	/* last byte of __text */
+		TEST_TEXT + 0x10,
+		TEST_TEXT + 0x600,	/* first byte past __text */
+		0xFFFFFFFFFFFFULL,	/* far past the last symbol */
+		0x999999,		/* below every symbol */
+		DATA + 0x8,
+		DATA + 0x10,		/* past __data */
+		TEST_TEXT,
+	};
+
+	data = test_image_build(&image, &size);
+	test_check(data != NULL);
+	macho = macho_load_64(data, size);
+	test_check(macho != NULL);
+	symbolicator = macho_symbolicator_load_64(macho);
+	test_check(symbolicator != NULL);
+	if (symbolicator == NULL) {
+		return test_finish("symbolicate");
+	}
+
+	test_check(symbolicator->count == 3);
+	memset(results, '\0', sizeof(results));
+	test_check(macho_symbolicator_resolve_64(symbolicator, addresses, 8, results) == 0);
+
+	test_check(results[0].name && strcmp(results[0].name, "_second") == 0 && results[0].offset == 0x57F);
+	test_check(results[1].name && strcmp(results[1].name, "_first") == 0 && results[1].offset == 0x10);
+	test_check(results[2].name == NULL);
+	test_check(results[3].name == NULL);
+	test_check(results[4].name == NULL);
+	test_check(results[5].name && strcmp(results[5].name, "_data") == 0 && results[5].offset == 0x8);
+	test_check(results[6].name == NULL);
+	test_check(results[7].name && strcmp(results[7].name, "_first") == 0 && results[7].offset == 0);
+	for (i = 0; i < 8; i++) {
+		if (results[i].name == NULL) {
+			test_check(results[i].offset == addresses[i]);
+		}
+	}
+	test_check(macho_symbolicator_resolve_64(symbolicator, addresses, 0, results) == 0);
+
+	// File offsets map through the segment's fileoff, not the first
+	//   section's, so offset 0x520 into __TEXT is 0x520 past its vmaddr
+	test_check(macho_offset_to_address_64(macho, TEST_PAGE + 0x520) == TEST_TEXT + 0x520);
+	test_check(macho_offset_to_address_64(macho, 2 * TEST_PAGE + 0x8) == DATA + 0x8);
+
+	macho_symbolicator_free_64(symbolicator);
+	macho_free_64(macho);
+	free(data);
+	return test_finish("symbolicate");
+}
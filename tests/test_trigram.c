@@ -0,0 +1,102 @@
+/**
+ * libmacho-1.0 - test_trigram.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/query.h>
+#include <libmacho-1.0/trigram.h>
+
+#include "test.h"
+
+static unsigned char code[0x100];
+
+// Indexes of the matches, in symbol order, as one bit each
+static uint64_t search(macho_trigram_index_t_64* index, const char* substring) {
+	uint64_t i = 0;
+	uint64_t found = 0;
+	macho_query_result_t_64* result = macho_trigram_search_64(index, substring);
+	if (result == NULL) {
+		return UINT64_MAX;
+	}
+	for (i = 0; i < result->count; i++) {
+		found |= 1ULL << result->matches[i].index;
+	}
+	macho_query_result_free_64(result);
+	return found;
+}
+
+static void check_trigram(const char* dir) {
+	uint64_t size = 0;
+	char path[4096];
+	unsigned char* data = NULL;
+	macho_t_64* macho = NULL;
+	macho_trigram_index_t_64* index = NULL;
+	macho_trigram_index_t_64* saved = NULL;
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t symbols[] = {
+		{ "_shared", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_sharedmemory", TEST_N_SECT, 1, TEST_TEXT + 0x10 },
+		{ "_only_a", TEST_N_SECT, 1, TEST_TEXT + 0x20 },
+		{ "_hared_x", TEST_N_SECT, 1, TEST_TEXT + 0x30 },
+		{ "_printf", TEST_N_UNDF, 0, 0 },
+	};
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 5, symbols, 0, NULL, 0, NULL, 0 };
+
+	data = test_image_build(&image, &size);
+	macho = data ? macho_load_64(data, size) : NULL;
+	index = macho ? macho_trigram_index_load_64(macho) : NULL;
+	test_check(index != NULL);
+	if (index) {
+		test_check(search(index, "hare") == 0xB);
+		test_check(search(index, "sharedm") == 0x2);
+		test_check(search(index, "_printf") == 0x10);
+		test_check(search(index, "ly") == 0x4);
+		test_check(search(index, "zzz") == 0);
+		test_check(search(index, "memoryx") == 0);
+
+		snprintf(path, sizeof(path), "%s/trigrams", dir);
+		test_check(macho_trigram_index_save_64(index, path) == 0);
+		saved = macho_trigram_index_open_64(macho, path);
+		test_check(saved != NULL);
+		if (saved) {
+			test_check(search(saved, "hare") == 0xB);
+			test_check(search(saved, "ed_") == 0x8);
+			macho_trigram_index_free_64(saved);
+		}
+		macho_trigram_index_free_64(index);
+	}
+	macho_free_64(macho);
+	free(data);
+}
+
+int main() {
+	char* dir = test_temp_dir();
+	test_check(dir != NULL);
+	if (dir) {
+		check_trigram(dir);
+		test_remove_dir(dir);
+		free(dir);
+	}
+	return test_finish("trigram");
+}
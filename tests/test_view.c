@@ -0,0 +1,123 @@
+/**
+ * libmacho-1.0 - test_view.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/view.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/segment.h>
+#include <libmacho-1.0/symtab.h>
+
+#include "test.h"
+
+#define LC_SYMTAB 0x2
+
+static unsigned char code[0x100];
+
+int main() {
+	uint64_t size = 0;
+	uint32_t strx = 0;
+	unsigned char* cmd = NULL;
+	unsigned char* data = NULL;
+	unsigned char bytes[16];
+	macho_t_64* macho = NULL;
+	macho_symtab_t_64* symtab = NULL;
+	macho_section_t_64* section = NULL;
+	macho_segment_t_64* segment = NULL;
+	const test_section_t sections[] = { { "__sixteen_chars_", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t symbols[] = {
+		{ "_first", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_last", TEST_N_SECT, 1, TEST_TEXT + 0x10 },
+	};
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 2, symbols, 0, NULL, 0, NULL, 0 };
+
+	// The views overlay the on-disk layout exactly
+	test_check(sizeof(macho_header_t_64) == 32);
+	test_check(sizeof(macho_command_info_t_64) == 8);
+	test_check(sizeof(macho_segment_cmd_t_64) == 72);
+	test_check(sizeof(macho_section_info_t_64) == 80);
+	test_check(sizeof(macho_symtab_cmd_t_64) == 24);
+	test_check(sizeof(struct nlist_64) == 16);
+
+	// Bounds are checked without overflowing
+	test_check(macho_view_64(bytes, sizeof(bytes), 0, sizeof(bytes)) == bytes);
+	test_check(macho_view_64(bytes, sizeof(bytes), sizeof(bytes), 0) == bytes + sizeof(bytes));
+	test_check(macho_view_64(bytes, sizeof(bytes), sizeof(bytes) + 1, 0) == NULL);
+	test_check(macho_view_64(bytes, sizeof(bytes), 8, 9) == NULL);
+	test_check(macho_view_64(bytes, sizeof(bytes), 8, UINT64_MAX) == NULL);
+
+	// Fields are read at any alignment
+	test_put16(bytes + 1, 0x1234, 0);
+	test_check(macho_read16_64(bytes + 1) == 0x1234);
+	test_put32(bytes + 3, 0x89ABCDEF, 0);
+	test_check(macho_read32_64(bytes + 3) == 0x89ABCDEF);
+	test_put64(bytes + 7, 0x0123456789ABCDEFULL, 0);
+	test_check(macho_read64_64(bytes + 7) == 0x0123456789ABCDEFULL);
+
+	data = test_image_build(&image, &size);
+	test_check(data != NULL);
+	if (data == NULL) {
+		return test_finish("view");
+	}
+
+	// Loading points into the image instead of copying it
+	macho = macho_load_64(data, size);
+	test_check(macho != NULL);
+	if (macho) {
+		test_check((unsigned char*) macho->header == data);
+		segment = macho_get_segment_64(macho, "__TEXT");
+		test_check(segment && (unsigned char*) segment->command > data
+				&& (unsigned char*) segment->command < data + size);
+		section = macho_get_section_64(macho, "__TEXT", "__sixteen_chars_");
+		test_check(section && (unsigned char*) section->info > data
+				&& (unsigned char*) section->info < data + size);
+		test_check(section && strlen(section->name) == 16);
+		test_check(macho->symtab_count == 1);
+		symtab = macho->symtab_count ? macho->symtabs[0] : NULL;
+		test_check(symtab && (unsigned char*) symtab->symbols > data
+				&& (unsigned char*) symtab->symbols < data + size);
+		test_check(symtab && symtab->nsyms == 2);
+		test_check(symtab && strcmp(macho_symtab_name_64(symtab, 1), "_last") == 0);
+		macho_free_64(macho);
+	}
+
+	// A name that runs off the end of the string table has no name
+	cmd = test_image_command(data, LC_SYMTAB);
+	test_check(cmd != NULL);
+	if (cmd) {
+		memcpy(&strx, data + macho_read32_64(cmd + 8) + sizeof(struct nlist_64), sizeof(strx));
+		test_put32(cmd + 20, strx + strlen("_last"), 0);
+		macho = macho_load_64(data, size);
+		test_check(macho && macho->symtab_count == 1);
+		if (macho && macho->symtab_count) {
+			test_check(strcmp(macho_symtab_name_64(macho->symtabs[0], 0), "_first") == 0);
+			test_check(macho_symtab_name_64(macho->symtabs[0], 1) == NULL);
+			test_check(macho_lookup_64(macho, "_last") == 0);
+		}
+		macho_free_64(macho);
+	}
+
+	free(data);
+	return test_finish("view");
+}
@@ -0,0 +1,173 @@
+/**
+ * libmacho-1.0 - test_writer.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/section.h>
+#include <libmacho-1.0/writer.h>
+
+#include "test.h"
+
+#define LC_UUID 0x1B
+
+static unsigned char code[0x3000];
+
+// Reads back what the writer produced, the caller frees the map
+static macho_t_64* reload(const char* path, macho_map_t_64** map) {
+	*map = macho_map_open_64(path);
+	return *map ? macho_load_64((*map)->data, (*map)->size) : NULL;
+}
+
+int main() {
+	int fd = -1;
+	uint32_t i = 0;
+	uint64_t size = 0;
+	uint64_t linkedit = 0;
+	uint64_t table_size = 0;
+	char* dir = NULL;
+	char source[4096];
+	char output[4096];
+	unsigned char uuid[24];
+	unsigned char big[0x1000];
+	unsigned char* data = NULL;
+	unsigned char* longer = NULL;
+	unsigned char* table = NULL;
+	macho_t_64* macho = NULL;
+	macho_t_64* written = NULL;
+	macho_map_t_64* map = NULL;
+	macho_writer_t_64* writer = NULL;
+	macho_section_t_64* text = NULL;
+	macho_segment_t_64* segment = NULL;
+	const test_section_t sections[] = { { "__text", 0, code, sizeof(code), TEST_S_CODE, 0, 0 } };
+	const test_segment_t segments[] = { { "__TEXT", TEST_TEXT, 1, sections } };
+	const test_symbol_t symbols[] = {
+		{ "_main", TEST_N_SECT, 1, TEST_TEXT },
+		{ "_helper", TEST_N_SECT, 1, TEST_TEXT + 0x100 },
+	};
+	const test_image_t image = { TEST_CPU_ARM64, 0, 1, segments, 2, symbols, 0, NULL, 0, NULL, 1 };
+
+	for (i = 0; i < sizeof(code); i++) {
+		code[i] = (unsigned char) (i * 13);
+	}
+	dir = test_temp_dir();
+	data = test_image_build(&image, &size);
+	test_check(dir && data);
+	if (dir == NULL || data == NULL) {
+		return test_finish("writer");
+	}
+	snprintf(source, sizeof(source), "%s/source", dir);
+	snprintf(output, sizeof(output), "%s/output", dir);
+	test_check(test_write_file(source, data, size) == 0);
+
+	// Unedited, the output is the input byte for byte, through the source
+	//   descriptor as well as from memory
+	macho = macho_load_64(data, size);
+	writer = macho_writer_load_64(macho);
+	test_check(writer != NULL && writer->linkedit_offset != 0);
+	if (writer) {
+		linkedit = writer->linkedit_offset;
+		test_check(writer->linkedit_offset + writer->linkedit_size == size);
+		test_check(macho_writer_save_64(writer, output) == 0);
+		written = reload(output, &map);
+		test_check(written && written->size == size && memcmp(written->data, data, size) == 0);
+		macho_free_64(written);
+		macho_map_free_64(map);
+
+		fd = open(source, O_RDONLY);
+		test_check(fd >= 0);
+		macho_writer_set_source_fd_64(writer, fd);
+		test_check(macho_writer_save_64(writer, output) == 0);
+		written = reload(output, &map);
+		test_check(written && written->size == size && memcmp(written->data, data, size) == 0);
+		macho_free_64(written);
+		macho_map_free_64(map);
+		close(fd);
+		macho_writer_free_64(writer);
+	}
+
+	// Commands are edited in private copies and a replacement __LINKEDIT
+	//   resizes the segment
+	memset(uuid, 0xAB, sizeof(uuid));
+	test_put32(uuid, LC_UUID, 0);
+	test_put32(uuid + 4, sizeof(uuid), 0);
+	table_size = size - linkedit + 0x20;
+	table = calloc(1, table_size);
+	writer = macho_writer_load_64(macho);
+	test_check(writer != NULL && table != NULL);
+	if (writer && table) {
+		memcpy(table, data + linkedit, size - linkedit);
+		test_check(macho_writer_add_command_64(writer, uuid, sizeof(uuid)) == 0);
+		test_check(macho_writer_find_command_64(writer, LC_UUID) != NULL);
+		test_check(macho_writer_set_linkedit_64(writer, table, table_size) == 0);
+		test_check(macho_writer_save_64(writer, output) == 0);
+		written = reload(output, &map);
+		test_check(written && written->size == linkedit + table_size);
+		if (written) {
+			test_check(written->command_count == macho->command_count + 1);
+			test_check(test_image_command(written->data, LC_UUID) != NULL);
+			segment = macho_get_segment_64(written, "__LINKEDIT");
+			test_check(segment && segment->command->filesize == table_size);
+			text = macho_get_section_64(written, "__TEXT", "__text");
+			test_check(text && text->data && memcmp(text->data, code, sizeof(code)) == 0);
+			test_check(macho_lookup_64(written, "_helper") == TEST_TEXT + 0x100);
+			macho_free_64(written);
+		}
+		macho_map_free_64(map);
+
+		// Load commands may not grow into the segment data
+		memset(big, '\0', sizeof(big));
+		test_put32(big, LC_UUID, 0);
+		test_put32(big + 4, sizeof(big), 0);
+		test_check(macho_writer_add_command_64(writer, big, sizeof(big)) == 0);
+		test_check(macho_writer_save_64(writer, output) < 0);
+		test_check(macho_writer_remove_command_64(writer, writer->command_count - 1) == 0);
+		test_check(macho_writer_save_64(writer, output) == 0);
+	}
+	macho_writer_free_64(writer);
+	macho_free_64(macho);
+	free(table);
+
+	// Bytes past __LINKEDIT can't be carried over, so the write fails
+	//   instead of producing a truncated image
+	longer = calloc(1, size + 0x20);
+	test_check(longer != NULL);
+	if (longer) {
+		memcpy(longer, data, size);
+		memset(longer + size, 0x5A, 0x20);
+		macho = macho_load_64(longer, size + 0x20);
+		writer = macho_writer_load_64(macho);
+		test_check(writer != NULL);
+		test_check(writer && macho_writer_save_64(writer, output) < 0);
+		macho_writer_free_64(writer);
+		macho_free_64(macho);
+		free(longer);
+	}
+
+	test_remove_dir(dir);
+	free(dir);
+	free(data);
+	return test_finish("writer");
+}
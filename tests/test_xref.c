@@ -0,0 +1,157 @@
+/**
+ * libmacho-1.0 - test_xref.c
+ * Copyright (C) 2013 Crippy-Dev Team
+ * Copyright (C) 2010-2013 Joshua Hill
+ * Copyright (C) 2010-2023 Joshua Minguez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/xref.h>
+
+#include "test.h"
+
+#define CSTRING (TEST_TEXT + 0x1000)
+#define WORLD   (CSTRING + 6)
+#define DATA    (TEST_TEXT + 0x4000)
+
+static const unsigned char cstrings[] = "hello\0world";
+
+// The single cross reference to target, or NULL if there is not exactly one
+static macho_xref_t_64* find_one(macho_xref_index_t_64* index, uint64_t target) {
+	uint64_t first = 0;
+	if (macho_xref_find_64(index, target, target + 1, &first) != 1) {
+		return NULL;
+	}
+	return &index->xrefs[first];
+}
+
+static macho_xref_index_t_64* load(uint32_t cputype, const unsigned char* code, uint64_t code_size,
+		unsigned char** data) {
+	uint64_t size = 0;
+	macho_t_64* macho = NULL;
+	macho_xref_index_t_64* index = NULL;
+	unsigned char pointers[16];
+	const test_section_t text_sections[] = {
+		{ "__text", 0, code, code_size, TEST_S_CODE, 0, 0 },
+		{ "__cstring", CSTRING - TEST_TEXT, cstrings, sizeof(cstrings), TEST_S_CSTRING, 0, 0 },
+	};
+	const test_section_t data_sections[] = { { "__data", 0, pointers, sizeof(pointers), 0, 0, 0 } };
+	const test_segment_t segments[] = {
+		{ "__TEXT", TEST_TEXT, 2, text_sections },
+		{ "__DATA", DATA, 1, data_sections },
+	};
+	const test_symbol_t symbols[] = { { "_main", TEST_N_SECT, 1, TEST_TEXT } };
+	const test_image_t image = { cputype, 0, 2, segments, 1, symbols, 0, NULL, 0, NULL, 0 };
+
+	test_put64(pointers, WORLD, 0);
+	test_put64(pointers + 8, 0x4141, 0);
+	*data = test_image_build(&image, &size);
+	macho = *data ? macho_load_64(*data, size) : NULL;
+	index = macho ? macho_xref_index_load_64(macho) : NULL;
+	if (index == NULL) {
+		macho_free_64(macho);
+	}
+	return index;
+}
+
+static void unload(macho_xref_index_t_64* index, unsigned char* data) {
+	macho_t_64* macho = index ? index->macho : NULL;
+	macho_xref_index_free_64(index);
+	macho_free_64(macho);
+	free(data);
+}
+
+// The pointer in __data is found whatever the architecture
+static void check_pointer(macho_xref_index_t_64* index) {
+	macho_xref_t_64* xref = find_one(index, WORLD);
+	test_check(xref && xref->source == DATA && xref->kind == MACHO_XREF_POINTER);
+}
+
+static void test_arm64() {
+	uint32_t i = 0;
+	uint32_t code[0x10];
+	unsigned char bytes[sizeof(code)];
+	unsigned char* data = NULL;
+	macho_xref_t_64* xref = NULL;
+	macho_xref_index_t_64* index = NULL;
+
+	for (i = 0; i < 0x10; i++) {
+		code[i] = 0xD503201F;	/* nop */
+	}
+	// adrp x0, hello; add x1, x0, :lo12:hello
+	code[0] = test_arm64_adrp(TEST_TEXT, CSTRING, 0);
+	code[2] = test_arm64_add(1, 0, CSTRING);
+	// adrp x8, __data; ldr x9, [x8, #8]
+	code[4] = test_arm64_adrp(TEST_TEXT + 0x10, DATA, 8);
+	code[5] = 0xF9400000 | (1 << 10) | (8 << 5) | 9;
+	// adrp x4, hello; orr x4, xzr, x5; add x6, x4, :lo12:hello
+	code[8] = test_arm64_adrp(TEST_TEXT + 0x20, CSTRING, 4);
+	code[9] = 0xAA0503E4;
+	code[10] = test_arm64_add(6, 4, CSTRING);
+	for (i = 0; i < 0x10; i++) {
+		test_put32(bytes + 4 * i, code[i], 0);
+	}
+
+	index = load(TEST_CPU_ARM64, bytes, sizeof(bytes), &data);
+	test_check(index != NULL);
+	if (index) {
+		// Only the pair whose register survives is a reference
+		xref = find_one(index, CSTRING);
+		test_check(xref && xref->source == TEST_TEXT + 8 && xref->kind == MACHO_XREF_ADDRESS);
+		xref = find_one(index, DATA + 8);
+		test_check(xref && xref->source == TEST_TEXT + 0x14 && xref->kind == MACHO_XREF_LOAD);
+		check_pointer(index);
+		test_check(index->count == 3);
+	}
+	unload(index, data);
+}
+
+static void test_x86_64() {
+	unsigned char* data = NULL;
+	macho_xref_t_64* xref = NULL;
+	macho_xref_index_t_64* index = NULL;
+	unsigned char code[0x10] = {
+		0x48, 0x8D, 0x05, 0, 0, 0, 0,	/* lea rax, [rip + hello] */
+		0x48, 0x8B, 0x05, 0, 0, 0, 0,	/* mov rax, [rip + __data + 8] */
+		0xC3, 0xCC,
+	};
+
+	test_put32(code + 3, (uint32_t) (CSTRING - (TEST_TEXT + 7)), 0);
+	test_put32(code + 10, (uint32_t) (DATA + 8 - (TEST_TEXT + 14)), 0);
+	index = load(TEST_CPU_X86_64, code, sizeof(code), &data);
+	test_check(index != NULL);
+	if (index) {
+		xref = find_one(index, CSTRING);
+		test_check(xref && xref->source == TEST_TEXT && xref->kind == MACHO_XREF_ADDRESS);
+		xref = find_one(index, DATA + 8);
+		test_check(xref && xref->source == TEST_TEXT + 7 && xref->kind == MACHO_XREF_LOAD);
+		check_pointer(index);
+		test_check(index->count == 3);
+	}
+	unload(index, data);
+}
+
+int main() {
+	uint64_t first = 0;
+	test_arm64();
+	test_x86_64();
+	test_check(macho_xref_find_64(NULL, 0, 1, &first) == 0);
+	return test_finish("xref");
+}
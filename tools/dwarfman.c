@@ -34,8 +34,7 @@ int main(int argc, char* argv[]) {
 		printf("Getting __DWARF segment\n");
 		macho_section_t_64* dwarf_abbrev = macho_get_section_64(macho, "__DWARF", "__debug_abbrev");
 		if(dwarf_abbrev) {
-			printf("Found DWARF debug_abbrev section at 0x%08x and is 0x%08x bytes long\n", dwarf_abbrev->info->offset, dwarf_abbrev->info->size);
-			macho_section_free_64(dwarf_abbrev);
+			printf("Found DWARF debug_abbrev section at 0x%08x and is 0x%08llx bytes long\n", dwarf_abbrev->info->offset, dwarf_abbrev->info->size);
 		}
 		macho_free_64(macho);
 	}
@@ -19,54 +19,801 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include <libmacho-1.0/macho.h>
+#include <libmacho-1.0/cache.h>
+#include <libmacho-1.0/callgraph.h>
+#include <libmacho-1.0/corpus.h>
+#include <libmacho-1.0/cstring.h>
+#include <libmacho-1.0/diff.h>
+#include <libmacho-1.0/fat.h>
+#include <libmacho-1.0/map.h>
+#include <libmacho-1.0/objc.h>
+#include <libmacho-1.0/query.h>
+#include <libmacho-1.0/signature.h>
+#include <libmacho-1.0/swift.h>
+#include <libmacho-1.0/writer.h>
+#include <libmacho-1.0/xref.h>
+#include <libmacho-1.0/server.h>
+#include <libmacho-1.0/symbolicate.h>
 #include <libcrippy-1.0/libcrippy.h>
 
+#define SYMBOLICATE_CHUNK_SIZE   0x100000
+#define SYMBOLICATE_BATCH_COUNT  0x40000
+#define SERVE_CACHE_SIZE         0x400 // megabytes of parsed images kept warm
+
 enum {
 	OP_NONE,
 	OP_INFO,
 	OP_VIRT,
-	OP_SEARCH
+	OP_SEARCH,
+	OP_SYMBOLICATE,
+	OP_CACHE,
+	OP_VERIFY,
+	OP_IMPORTS,
+	OP_OBJC,
+	OP_SWIFT,
+	OP_CALLGRAPH,
+	OP_DIFF,
+	OP_UNSIGN,
+	OP_THIN,
+	OP_EXTRACT,
+	OP_CORPUS_BUILD,
+	OP_CORPUS_UPDATE,
+	OP_CORPUS_QUERY,
+	OP_SERVE
 } op_mode_t;
 
+static volatile int stopping = 0;
+
 static void print_usage(int argc, char **argv)
 {
 	char *name = NULL;
 	
 	name = strrchr(argv[0], '/');
 	printf("Usage: %s <mach-o file> [OPTIONS] [PARAMS ...]\n", (name ? name + 1: argv[0]));
+	printf("       %s --diff <old mach-o> <new mach-o>\n", (name ? name + 1: argv[0]));
+	printf("       %s --corpus-build <directory> <index>\n", (name ? name + 1: argv[0]));
+	printf("       %s --corpus-update <directory> <index> [--watch]\n", (name ? name + 1: argv[0]));
+	printf("       %s --corpus-query <index> <symbol> [--in <binary>]\n", (name ? name + 1: argv[0]));
+	printf("       %s --serve <socket> [--cache-size MB] [--huge-pages]\n", (name ? name + 1: argv[0]));
 	printf("  -a|--address OFFSET\tget virtual address for given file offset.\n");
-	printf("  -s|--search STRING\tsearch for STRING and print function addresses\n\t\tcontaining references to this string.\n");
+	printf("  -s|--search STRING\tsearch for STRING and print the addresses of instructions\n\t\tand pointers referencing this string.\n");
+	printf("  --exact\t\tonly search strings equal to STRING.\n");
+	printf("  --prefix\t\tonly search strings starting with STRING.\n");
+	printf("  -S|--symbolicate FILE\tresolve addresses read from FILE (or - for stdin),\n\t\tone per line, to symbol+offset.\n");
+	printf("  --offsets\t\ttreat symbolicate records as file offsets instead\n\t\tof virtual addresses.\n");
+	printf("  --connect SOCKET\tsymbolicate through the query server on SOCKET.\n");
+	printf("  -c|--cache [IMAGE]\ttreat the file as a dyld shared cache and list its\n\t\timages, or print the load commands of IMAGE.\n");
+	printf("  -V|--verify\t\tverify every code signature page hash.\n");
+	printf("  -i|--imports [ORDINAL]\tlist undefined external symbols, only those bound to\n\t\tlibrary ORDINAL if given.\n");
+	printf("  --objc\t\tlist Objective-C classes, categories and their methods.\n");
+	printf("  --swift\t\tlist Swift types, protocol conformances and fields.\n");
+	printf("  --callgraph\t\tlist the direct calls made by every function, with\n\t\tstubs resolved to the symbols they import.\n");
+	printf("  -R|--remove-signature OUTPUT\n\t\twrite a copy without LC_CODE_SIGNATURE to OUTPUT.\n");
+	printf("  -t|--thin ARCH OUTPUT\twrite the ARCH slice of a universal binary to OUTPUT.\n");
+	printf("  -x|--extract-all DIR\twrite every slice to DIR/<name>.<arch> in parallel.\n");
+	printf("  -d|--diff OLD NEW\tsummarize added, removed and resized segments,\n\t\tsections and symbols between two builds.\n");
+	printf("  --corpus-build DIR INDEX\n\t\tindex the exports and imports of every Mach-O below DIR.\n");
+	printf("  --corpus-update DIR INDEX\n\t\treindex only the binaries below DIR that changed since\n\t\tINDEX was written.\n");
+	printf("  --watch\t\tkeep updating the corpus index as files below DIR change.\n");
+	printf("  --corpus-query INDEX SYMBOL\n\t\tlist the indexed binaries exporting or importing SYMBOL.\n");
+	printf("  --in BINARY\t\tonly look in the indexed BINARY, answering misses from\n\t\tits Bloom filter.\n");
+	printf("  --serve SOCKET\tanswer lookup, symbolicate, section and search requests\n\t\ton a UNIX socket, keeping parsed images cached.\n");
+	printf("  --cache-size MB\tmemory budget of the query server cache (default %d).\n", SERVE_CACHE_SIZE);
+	printf("  --huge-pages\tcopy cached images into transparent huge pages to\n\t\tcut page faults in a long running server.\n");
 	printf("\n");
 }
 
-static uint64_t get_virtual_address(macho_t_64* macho, uint64_t offset)
+// A TRUNCATED reply answers a prefix of the batch in order, the rest is
+//   asked for again. Returns the number of addresses left unanswered.
+static uint64_t symbolicate_remote(int fd, const char* image, const uint64_t* records,
+		uint64_t* addresses, uint64_t count)
+{
+	uint64_t i = 0;
+	uint64_t done = 0;
+	uint64_t offset = 0;
+	unsigned char* data = NULL;
+	macho_server_frame_t_64 frame;
+	macho_server_response_t_64 response;
+
+	while (done < count) {
+		data = NULL;
+		if (macho_server_request_64(fd, MACHO_SERVER_SYMBOLICATE, image, &addresses[done],
+				(count - done) * sizeof(uint64_t), &response, &data) < 0
+				|| (response.status != MACHO_SERVER_OK && response.status != MACHO_SERVER_TRUNCATED)
+				|| response.count > count - done || response.count == 0
+				|| (response.status == MACHO_SERVER_OK && response.count != count - done)) {
+			free(data);
+			break;
+		}
+		offset = 0;
+		for (i = 0; i < response.count && offset + sizeof(frame) <= response.payload_size; i++) {
+			memcpy(&frame, &data[offset], sizeof(frame));
+			offset += sizeof(frame);
+			if (frame.name_size > response.payload_size - offset) {
+				break;
+			}
+			if (frame.name_size == 0) {
+				printf("0x%08" PRIx64 "\t???\n", records[done + i]);
+				continue;
+			}
+			printf("0x%08" PRIx64 "\t%.*s+0x%" PRIx64 "\n", records[done + i], (int) frame.name_size,
+					(const char*) &data[offset], frame.offset);
+			offset += frame.name_size;
+		}
+		free(data);
+		done += i;
+		if (i < response.count) {
+			break;
+		}
+	}
+	if (done < count) {
+		error("Unable to symbolicate %" PRIu64 " addresses through the query server\n", count - done);
+	}
+	return count - done;
+}
+
+static int symbolicate_flush(macho_symbolicator_t_64* symbolicator, const uint64_t* records,
+		uint64_t* addresses, macho_symbolication_t_64* results, uint64_t count)
+{
+	uint64_t i = 0;
+	if (macho_symbolicator_resolve_64(symbolicator, addresses, count, results) < 0) {
+		error("Unable to symbolicate batch\n");
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		if (results[i].name == NULL) {
+			printf("0x%08" PRIx64 "\t???\n", records[i]);
+		} else {
+			printf("0x%08" PRIx64 "\t%s+0x%" PRIx64 "\n", records[i], results[i].name, results[i].offset);
+		}
+	}
+	return 0;
+}
+
+// With a query server connection the image is resolved by the server and
+//   macho is not needed
+static int symbolicate(macho_t_64* macho, const char* path, int offsets, int fd, const char* image)
+{
+	int ret = 0;
+	FILE* input = NULL;
+	char* buffer = NULL;
+	char* cursor = NULL;
+	char* end = NULL;
+	int skipping = 0;
+	size_t used = 0;
+	size_t nread = 0;
+	uint64_t count = 0;
+	uint64_t* records = NULL;
+	uint64_t* addresses = NULL;
+	macho_symbolication_t_64* results = NULL;
+	macho_symbolicator_t_64* symbolicator = NULL;
+
+	if (!strcmp(path, "-")) {
+		input = stdin;
+	} else {
+		input = fopen(path, "r");
+		if (input == NULL) {
+			error("Unable to open %s\n", path);
+			return -1;
+		}
+	}
+
+	symbolicator = fd < 0 ? macho_symbolicator_load_64(macho) : NULL;
+	buffer = (char*) malloc(SYMBOLICATE_CHUNK_SIZE + 1);
+	records = (uint64_t*) malloc(SYMBOLICATE_BATCH_COUNT * sizeof(uint64_t));
+	addresses = (uint64_t*) malloc(SYMBOLICATE_BATCH_COUNT * sizeof(uint64_t));
+	results = (macho_symbolication_t_64*) malloc(SYMBOLICATE_BATCH_COUNT * sizeof(macho_symbolication_t_64));
+	if ((fd < 0 && !symbolicator) || !buffer || !records || !addresses || !results) {
+		error("Unable to allocate symbolication buffers\n");
+		ret = -1;
+		goto done;
+	}
+	setvbuf(stdout, NULL, _IOFBF, SYMBOLICATE_CHUNK_SIZE);
+
+	// Records are read a chunk at a time; a number split across the chunk
+	//   boundary is carried over to the front of the buffer for the next read.
+	//   A record filling a whole chunk is reported and skipped up to the next
+	//   whitespace.
+	while ((nread = fread(buffer + used, 1, SYMBOLICATE_CHUNK_SIZE - used, input)) > 0 || used > 0) {
+		int eof = (nread == 0);
+		used += nread;
+		buffer[used] = '\0';
+		cursor = buffer;
+		while (skipping && cursor < buffer + used && !isspace((unsigned char) *cursor)) {
+			cursor++;
+		}
+		if (cursor < buffer + used) {
+			skipping = 0;
+		}
+		while (1) {
+			while (cursor < buffer + used && isspace((unsigned char) *cursor)) {
+				cursor++;
+			}
+			if (cursor >= buffer + used) {
+				used = 0;
+				break;
+			}
+			end = cursor;
+			while (end < buffer + used && !isspace((unsigned char) *end)) {
+				end++;
+			}
+			if (end == buffer + used && !eof) {
+				if (cursor == buffer && used == SYMBOLICATE_CHUNK_SIZE) {
+					error("Skipping a record longer than %d bytes\n", SYMBOLICATE_CHUNK_SIZE);
+					skipping = 1;
+					used = 0;
+					break;
+				}
+				used = end - cursor;
+				memmove(buffer, cursor, used);
+				break;
+			}
+			*end = '\0';
+			records[count] = strtoull(cursor, NULL, 0);
+			addresses[count] = offsets ? macho_offset_to_address_64(macho, records[count]) : records[count];
+			if (++count == SYMBOLICATE_BATCH_COUNT) {
+				if (fd < 0) {
+					if (symbolicate_flush(symbolicator, records, addresses, results, count) < 0) {
+						ret = -1;
+					}
+				} else if (symbolicate_remote(fd, image, records, addresses, count) > 0) {
+					ret = -1;
+				}
+				count = 0;
+			}
+			cursor = end + 1;
+		}
+		if (eof) {
+			break;
+		}
+	}
+	if (count > 0 && fd < 0) {
+		if (symbolicate_flush(symbolicator, records, addresses, results, count) < 0) {
+			ret = -1;
+		}
+	} else if (count > 0 && symbolicate_remote(fd, image, records, addresses, count) > 0) {
+		ret = -1;
+	}
+	fflush(stdout);
+
+done:
+	if (results) free(results);
+	if (addresses) free(addresses);
+	if (records) free(records);
+	if (buffer) free(buffer);
+	if (symbolicator) macho_symbolicator_free_64(symbolicator);
+	if (input != stdin) fclose(input);
+	return ret;
+}
+
+static int cache_info(const char* path, const char* image_path)
 {
-	if (macho->segment_count == 0) {
-		error("no segments?\n");
+	uint64_t i = 0;
+	macho_t_64* macho = NULL;
+	macho_cache_t_64* cache = NULL;
+	macho_cache_image_t_64* image = NULL;
+
+	cache = macho_cache_open_64(path);
+	if (cache == NULL) {
+		error("Unable to open dyld shared cache\n");
+		return -1;
+	}
+
+	if (image_path == NULL) {
+		for (i = 0; i < cache->image_count; i++) {
+			printf("0x%016" PRIx64 " %s\n", cache->images[i].address,
+					cache->images[i].path ? cache->images[i].path : "(no path)");
+		}
+		macho_cache_free_64(cache);
 		return 0;
 	}
 
+	image = macho_cache_find_image_64(cache, image_path);
+	if (image == NULL) {
+		printf("image '%s' not found!\n", image_path);
+		macho_cache_free_64(cache);
+		return -1;
+	}
+	macho = macho_cache_image_load_64(cache, image);
+	if (macho) {
+		macho_debug_64(macho);
+	}
+	macho_cache_free_64(cache);
+	return 0;
+}
+
+static int thin(const char* path, const char* arch, const char* output, const char* directory)
+{
+	int ret = 0;
+	int index = 0;
+	macho_fat_t_64* fat = NULL;
+
+	fat = macho_fat_open_64(path);
+	if (fat == NULL) {
+		error("Unable to open universal binary\n");
+		return -1;
+	}
+
+	if (directory) {
+		ret = macho_fat_extract_all_64(fat, directory);
+	} else {
+		index = macho_fat_find_arch_64(fat, arch);
+		if (index < 0) {
+			printf("architecture '%s' not found!\n", arch);
+			ret = -1;
+		} else {
+			ret = macho_fat_extract_64(fat, index, output);
+		}
+	}
+
+	macho_fat_free_64(fat);
+	return ret;
+}
+
+static const char* diff_change_string(uint32_t change)
+{
+	switch (change) {
+	case MACHO_DIFF_ADDED:
+		return "+";
+	case MACHO_DIFF_REMOVED:
+		return "-";
+	case MACHO_DIFF_RESIZED:
+		return "~";
+	default:
+		return "*";
+	}
+}
+
+// Images are mapped rather than read so whole-file scans get read ahead;
+//   macho_free_64 leaves the mapping to the caller
+static macho_t_64* open_mapped(const char* path, int advice, macho_map_t_64** map)
+{
+	macho_t_64* macho = NULL;
+
+	*map = macho_map_open_64(path);
+	if (*map == NULL) {
+		return NULL;
+	}
+	macho_map_advise_64(*map, 0, 0, advice);
+	macho = macho_load_64((*map)->data, (*map)->size);
+	if (macho == NULL) {
+		macho_map_free_64(*map);
+		*map = NULL;
+	}
+	return macho;
+}
+
+static int diff(const char* old_path, const char* new_path)
+{
+	uint64_t i = 0;
+	uint64_t count = 0;
+	int64_t delta = 0;
+	uint32_t kind = 0;
+	uint32_t change = 0;
+	macho_t_64* old_macho = NULL;
+	macho_t_64* new_macho = NULL;
+	macho_map_t_64* old_map = NULL;
+	macho_map_t_64* new_map = NULL;
+	macho_diff_t_64* result = NULL;
+	macho_diff_entry_t_64* entry = NULL;
+	const char* kinds[] = { "", "segment", "section", "symbol" };
+
+	// Every section is hashed front to back
+	old_macho = open_mapped(old_path, MACHO_MAP_SEQUENTIAL, &old_map);
+	new_macho = open_mapped(new_path, MACHO_MAP_SEQUENTIAL, &new_map);
+	if (old_macho == NULL || new_macho == NULL) {
+		error("Unable to open macho files\n");
+		if (old_macho) macho_free_64(old_macho);
+		if (new_macho) macho_free_64(new_macho);
+		macho_map_free_64(old_map);
+		macho_map_free_64(new_map);
+		return -1;
+	}
+
+	result = macho_diff_load_64(old_macho, new_macho);
+	if (result == NULL) {
+		error("Unable to diff macho files\n");
+		macho_free_64(old_macho);
+		macho_free_64(new_macho);
+		macho_map_free_64(old_map);
+		macho_map_free_64(new_map);
+		return -1;
+	}
+
+	for (i = 0; i < result->count; i++) {
+		entry = &result->entries[i];
+		printf("%s %-7s %s 0x%" PRIx64 " -> 0x%" PRIx64 "\n", diff_change_string(entry->change),
+				kinds[entry->kind], entry->name, entry->old_size, entry->new_size);
+	}
+
+	printf("\nfile size: %+" PRId64 " bytes, %" PRIu64 " identical sections skipped\n",
+			result->size_delta, result->identical);
+	for (kind = MACHO_DIFF_SEGMENT; kind <= MACHO_DIFF_SYMBOL; kind++) {
+		printf("%ss:", kinds[kind]);
+		for (change = MACHO_DIFF_ADDED; change <= MACHO_DIFF_CHANGED; change++) {
+			macho_diff_count_64(result, kind, change, &count, &delta);
+			printf(" %s%" PRIu64 " (%+" PRId64 ")", diff_change_string(change), count, delta);
+		}
+		printf("\n");
+	}
+
+	macho_diff_free_64(result);
+	macho_free_64(old_macho);
+	macho_free_64(new_macho);
+	macho_map_free_64(old_map);
+	macho_map_free_64(new_map);
+	return 0;
+}
+
+static void interrupt(int signo)
+{
+	stopping = 1;
+}
+
+// Stored pointers to saddr anywhere in the file, printed as they are found
+static uint64_t search_pointers(macho_t_64* macho, uint64_t saddr)
+{
+	uint64_t j = 0;
+	uint64_t value = 0;
 	uint64_t vaddr = 0;
-	int i;
+	uint64_t references = 0;
+	for (j = 0; j + sizeof(uint64_t) <= macho->size; j += 4) {
+		memcpy(&value, &macho->data[j], sizeof(value));
+		if (value == saddr) {
+			// Bytes outside every segment are never loaded, so can't refer to it
+			vaddr = macho_offset_to_address_64(macho, j);
+			if (vaddr == 0) {
+				continue;
+			}
+			debug("found reference at offset 0x%08" PRIx64 ", vaddr=0x%08" PRIx64 "\n", j, vaddr);
+			printf("pointer 0x%08" PRIx64 "\n", vaddr);
+			references++;
+		}
+	}
+	return references;
+}
 
-	for (i = 0; i < macho->segment_count; i++) {
-		macho_segment_t_64* seg = macho->segments[i];
-		if ((offset >= seg->offset) && (offset < seg->offset + seg->size)) {
-			vaddr = (offset + seg->address) - seg->offset;
-			break;
+// Images without C string sections are searched byte by byte, each match
+//   reported once from the start of the string holding it
+static int search_raw(macho_t_64* macho, const char* search, int mode)
+{
+	int found = 0;
+	uint64_t i = 0;
+	uint64_t start = 0;
+	uint64_t saddr = 0;
+	uint64_t length = strlen(search);
+
+	for (i = 0; length && i + length <= macho->size; i++) {
+		if (macho->data[i] != (unsigned char) search[0] || memcmp(&macho->data[i], search, length) != 0) {
+			continue;
+		}
+		for (start = i; start > 0 && macho->data[start - 1] != '\0'; start--);
+		if ((mode != MACHO_CSTRING_SUBSTRING && start != i)
+				|| (mode == MACHO_CSTRING_EXACT && i + length < macho->size && macho->data[i + length] != '\0')) {
+			continue;
+		}
+		// Later matches in the same string are covered by this one
+		for (; i < macho->size && macho->data[i] != '\0'; i++);
+
+		saddr = macho_offset_to_address_64(macho, start);
+		if (saddr == 0) {
+			debug("No virtual address for offset 0x%08" PRIx64 "\n", start);
+			continue;
+		}
+		found++;
+		debug("Found match in string at offset 0x%08" PRIx64 "\n", start);
+		if (search_pointers(macho, saddr) == 0) {
+			printf("string 0x%08" PRIx64 " no references\n", saddr);
+		}
+	}
+	if (!found) {
+		printf("string '%s' not found!\n", search);
+	}
+	return 0;
+}
+
+static int corpus_update(const char* directory, const char* path, int watch)
+{
+	if (!watch) {
+		return macho_corpus_update_64(directory, path);
+	}
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+	return macho_corpus_watch_64(directory, path, &stopping);
+}
+
+// Undefined externals, optionally narrowed to one library ordinal
+static int imports_dump(macho_t_64* macho, int ordinal)
+{
+	uint64_t i = 0;
+	macho_symtab_t_64* symtab = NULL;
+	macho_query_result_t_64* result = NULL;
+	macho_query_t_64 query = { MACHO_QUERY_TYPE, 0x0F, 0x01, 0, 0, 0, 0, NULL };
+
+	if (ordinal >= 0) {
+		query.fields |= MACHO_QUERY_ORDINAL;
+		query.ordinal = (uint8_t) ordinal;
+	}
+	result = macho_query_symbols_64(macho, &query);
+	if (result == NULL) {
+		error("Unable to query symbols\n");
+		return -1;
+	}
+	for (i = 0; i < result->count; i++) {
+		symtab = macho->symtabs[result->matches[i].symtab];
+		printf("%u\t%s\n", MACHO_LIBRARY_ORDINAL(symtab->descs[result->matches[i].index]),
+				macho_symtab_name_64(symtab, result->matches[i].index)
+				? macho_symtab_name_64(symtab, result->matches[i].index) : "(no name)");
+	}
+	macho_query_result_free_64(result);
+	return 0;
+}
+
+static void objc_methods(macho_objc_t_64* objc, macho_objc_methods_t_64* methods, char kind,
+		const char* cls, const char* category)
+{
+	uint64_t i = 0;
+	if (macho_objc_methods_64(objc, methods) == NULL) {
+		return;
+	}
+	for (i = 0; i < methods->count; i++) {
+		printf("\t0x%016" PRIx64 "\t%c[%s%s%s%s %s]\n", methods->methods[i].imp, kind, cls,
+				category ? "(" : "", category ? category : "", category ? ")" : "",
+				methods->methods[i].name ? methods->methods[i].name : "?");
+	}
+}
+
+static int objc_dump(macho_t_64* macho)
+{
+	uint64_t i = 0;
+	macho_objc_t_64* objc = NULL;
+	macho_objc_class_t_64* cls = NULL;
+	macho_objc_category_t_64* category = NULL;
+
+	objc = macho_objc_load_64(macho);
+	if (objc == NULL) {
+		error("Unable to load Objective-C metadata\n");
+		return -1;
+	}
+	for (i = 0; i < objc->class_count; i++) {
+		cls = &objc->classes[i];
+		printf("0x%016" PRIx64 "\t%s : %s\n", cls->address, cls->name, cls->superclass ? cls->superclass : "(root)");
+		objc_methods(objc, &cls->class_methods, '+', cls->name, NULL);
+		objc_methods(objc, &cls->instance_methods, '-', cls->name, NULL);
+	}
+	for (i = 0; i < objc->category_count; i++) {
+		category = &objc->categories[i];
+		printf("0x%016" PRIx64 "\t%s (%s)\n", category->address, category->cls ? category->cls : "?", category->name);
+		objc_methods(objc, &category->class_methods, '+', category->cls ? category->cls : "?", category->name);
+		objc_methods(objc, &category->instance_methods, '-', category->cls ? category->cls : "?", category->name);
+	}
+	for (i = 0; i < objc->protocol_count; i++) {
+		printf("@protocol %s\n", objc->protocols[i]);
+	}
+	printf("%" PRIu64 " selector references\n", objc->selref_count);
+	macho_objc_free_64(objc);
+	return 0;
+}
+
+// Mangled names may embed symbolic references, which are printed as a
+//   marker instead of their raw offset bytes
+static void swift_mangled(const char* name, uint32_t size)
+{
+	uint32_t i = 0;
+	uint32_t step = 0;
+	if (name == NULL) {
+		printf("?");
+		return;
+	}
+	while (i < size && name[i]) {
+		if (name[i] >= 0x01 && name[i] <= 0x17) {
+			printf("<ref>");
+			step = 5;
+		} else if (name[i] >= 0x18 && name[i] <= 0x1F) {
+			printf("<ref>");
+			step = 9;
+		} else {
+			putchar(name[i]);
+			step = 1;
+		}
+		i += (step < size - i) ? step : size - i;
+	}
+}
+
+static int swift_dump(macho_t_64* macho)
+{
+	uint32_t j = 0;
+	uint64_t i = 0;
+	uint64_t cursor = 0;
+	macho_swift_t_64* swift = NULL;
+	macho_swift_type_t_64 type;
+	macho_swift_field_t_64 field;
+	macho_swift_record_t_64 record;
+	macho_swift_conformance_t_64 conformance;
+	static const char* kinds[] = { "class", "struct", "enum" };
+
+	swift = macho_swift_load_64(macho);
+	if (swift == NULL) {
+		error("Unable to load Swift reflection metadata\n");
+		return -1;
+	}
+	for (i = 0; i < swift->type_count; i++) {
+		if (macho_swift_type_64(swift, i, &type) < 0) {
+			continue;
+		}
+		printf("0x%016" PRIx64 "\t%s %s%s%s\n", type.address,
+				type.kind >= MACHO_SWIFT_KIND_CLASS && type.kind <= MACHO_SWIFT_KIND_ENUM
+						? kinds[type.kind - MACHO_SWIFT_KIND_CLASS] : "type",
+				type.parent ? type.parent : "", type.parent ? "." : "", type.name ? type.name : "?");
+	}
+	for (i = 0; i < swift->conformance_count; i++) {
+		if (macho_swift_conformance_64(swift, i, &conformance) < 0) {
+			continue;
+		}
+		printf("0x%016" PRIx64 "\t%s : %s\n", conformance.address, conformance.type ? conformance.type : "?",
+				conformance.protocol ? conformance.protocol : "?");
+	}
+	while (macho_swift_fields_next_64(swift, &cursor, &field)) {
+		printf("0x%016" PRIx64 "\tfields of ", field.address);
+		swift_mangled(field.type, field.type_size);
+		printf("\n");
+		for (j = 0; j < field.count; j++) {
+			if (macho_swift_record_64(swift, &field, j, &record) < 0) {
+				break;
+			}
+			printf("\t%s: ", record.name ? record.name : "?");
+			swift_mangled(record.type, record.type_size);
+			printf("\n");
+		}
+	}
+	macho_swift_free_64(swift);
+	return 0;
+}
+
+static int callgraph_dump(macho_t_64* macho)
+{
+	uint64_t i = 0;
+	uint64_t j = 0;
+	macho_callgraph_t_64* graph = NULL;
+	macho_callgraph_node_t_64* node = NULL;
+	macho_callgraph_node_t_64* callee = NULL;
+
+	graph = macho_callgraph_load_64(macho);
+	if (graph == NULL) {
+		error("Unable to extract call graph\n");
+		return -1;
+	}
+	for (i = 0; i < graph->function_count; i++) {
+		node = &graph->nodes[i];
+		if (graph->offsets[i] == graph->offsets[i + 1]) {
+			continue;
+		}
+		printf("0x%016" PRIx64 "\t%s\n", node->address, node->name ? node->name : "?");
+		for (j = graph->offsets[i]; j < graph->offsets[i + 1]; j++) {
+			callee = &graph->nodes[graph->callees[j]];
+			printf("\t0x%016" PRIx64 "\t-> 0x%016" PRIx64 " %s%s\n", graph->sites[j], callee->address,
+					callee->name ? callee->name : "?", (callee->flags & MACHO_CALLGRAPH_IMPORT) ? " (import)" : "");
 		}
 	}
-	return vaddr;
+	printf("%" PRIu64 " functions, %" PRIu64 " stubs, %" PRIu64 " calls, %" PRIu64 " unresolved\n", graph->function_count,
+			graph->node_count - graph->function_count, graph->edge_count, graph->unresolved);
+	macho_callgraph_free_64(graph);
+	return 0;
+}
+
+static int corpus_query(const char* path, const char* symbol, const char* binary)
+{
+	uint64_t i = 0;
+	uint64_t id = 0;
+	uint64_t count = 0;
+	macho_corpus_t_64* corpus = NULL;
+	const macho_corpus_posting_t_64* postings = NULL;
+
+	corpus = macho_corpus_open_64(path);
+	if (corpus == NULL) {
+		error("Unable to open corpus index\n");
+		return -1;
+	}
+
+	if (binary) {
+		id = macho_corpus_binary_find_64(corpus, binary);
+		if (id == UINT64_MAX) {
+			error("Binary %s is not in the corpus index\n", binary);
+			macho_corpus_free_64(corpus);
+			return -1;
+		}
+		postings = macho_corpus_lookup_binary_64(corpus, id, symbol, &count);
+	} else {
+		postings = macho_corpus_lookup_64(corpus, symbol, &count);
+	}
+	for (i = 0; i < count; i++) {
+		if (postings[i].kind == MACHO_CORPUS_EXPORT) {
+			printf("export 0x%016" PRIx64 " %s\n", postings[i].address,
+					macho_corpus_binary_path_64(corpus, postings[i].binary));
+		} else {
+			printf("import %18s %s\n", "", macho_corpus_binary_path_64(corpus, postings[i].binary));
+		}
+	}
+	if (count == 0) {
+		printf("symbol '%s' not found!\n", symbol);
+	}
+
+	macho_corpus_free_64(corpus);
+	return 0;
+}
+
+static int serve(const char* path, uint64_t cache_size, int huge)
+{
+	int ret = 0;
+	macho_server_t_64* server = NULL;
+
+	server = macho_server_open_64(path, cache_size << 20);
+	if (server == NULL) {
+		error("Unable to start query server\n");
+		return -1;
+	}
+	server->huge = huge;
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+	signal(SIGPIPE, SIG_IGN);
+	ret = macho_server_run_64(server, &stopping);
+	macho_server_free_64(server);
+	return ret;
+}
+
+static int symbolicate_connect(const char* path, const char* server, const char* records)
+{
+	int fd = -1;
+	int ret = 0;
+	char* image = NULL;
+
+	// The server resolves paths from its own working directory
+	image = realpath(path, NULL);
+	if (image == NULL) {
+		error("Unable to resolve %s\n", path);
+		return -1;
+	}
+	fd = macho_server_connect_64(server);
+	if (fd < 0) {
+		error("Unable to connect to query server %s\n", server);
+		free(image);
+		return -1;
+	}
+	ret = symbolicate(NULL, records, 0, fd, image);
+	close(fd);
+	free(image);
+	return ret;
 }
 
 int main(int argc, char* argv[])
 {
 	uint64_t offset = 0;
 	char* search = NULL;
-	int search_len = 0;
+	int search_mode = MACHO_CSTRING_SUBSTRING;
+	char* records = NULL;
+	char* image = NULL;
+	char* output = NULL;
+	char* arch = NULL;
+	char* old_path = NULL;
+	char* new_path = NULL;
+	char* corpus = NULL;
+	char* corpus_arg = NULL;
+	char* corpus_binary = NULL;
+	char* server = NULL;
+	uint64_t cache_size = SERVE_CACHE_SIZE;
+	int offsets = 0;
+	int watch = 0;
+	int huge = 0;
+	int ordinal = -1;
 	int mode = (argc < 2) ? OP_NONE : OP_INFO;
+	int ret = 0;
 	int i;
 
 	/* parse cmdline args */
@@ -77,7 +824,7 @@ int main(int argc, char* argv[])
 				print_usage(argc, argv);
 				return 0;
 			}
-			sscanf(argv[i], "%lli", &offset);
+			offset = strtoull(argv[i], NULL, 0);
 			mode = OP_VIRT;
 			continue;
 		}
@@ -88,10 +835,155 @@ int main(int argc, char* argv[])
 				return 0;
 			}
 			search = strdup(argv[i]);
-			search_len = strlen(search);
 			mode = OP_SEARCH;
 			continue;
 		}
+		else if (!strcmp(argv[i], "--exact")) {
+			search_mode = MACHO_CSTRING_EXACT;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--prefix")) {
+			search_mode = MACHO_CSTRING_PREFIX;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-S") || !strcmp(argv[i], "--symbolicate")) {
+			i++;
+			if (!argv[i]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			records = argv[i];
+			mode = OP_SYMBOLICATE;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--offsets")) {
+			offsets = 1;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--diff")) {
+			if (!argv[i+1] || !argv[i+2]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			old_path = argv[++i];
+			new_path = argv[++i];
+			mode = OP_DIFF;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--corpus-build") || !strcmp(argv[i], "--corpus-update")
+				|| !strcmp(argv[i], "--corpus-query")) {
+			if (!argv[i+1] || !argv[i+2]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			if (!strcmp(argv[i], "--corpus-build")) {
+				mode = OP_CORPUS_BUILD;
+			} else if (!strcmp(argv[i], "--corpus-update")) {
+				mode = OP_CORPUS_UPDATE;
+			} else {
+				mode = OP_CORPUS_QUERY;
+			}
+			corpus = argv[++i];
+			corpus_arg = argv[++i];
+			continue;
+		}
+		else if (!strcmp(argv[i], "--watch")) {
+			watch = 1;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--in")) {
+			i++;
+			if (!argv[i]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			corpus_binary = argv[i];
+			continue;
+		}
+		else if (!strcmp(argv[i], "--serve") || !strcmp(argv[i], "--connect")) {
+			if (!argv[i+1]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			if (!strcmp(argv[i], "--serve")) {
+				mode = OP_SERVE;
+			}
+			server = argv[++i];
+			continue;
+		}
+		else if (!strcmp(argv[i], "--cache-size")) {
+			i++;
+			if (!argv[i]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			cache_size = strtoull(argv[i], NULL, 0);
+			continue;
+		}
+		else if (!strcmp(argv[i], "--huge-pages")) {
+			huge = 1;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--thin")) {
+			if (!argv[i+1] || !argv[i+2]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			arch = argv[++i];
+			output = argv[++i];
+			mode = OP_THIN;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-x") || !strcmp(argv[i], "--extract-all")) {
+			i++;
+			if (!argv[i]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			output = argv[i];
+			mode = OP_EXTRACT;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-R") || !strcmp(argv[i], "--remove-signature")) {
+			i++;
+			if (!argv[i]) {
+				print_usage(argc, argv);
+				return 0;
+			}
+			output = argv[i];
+			mode = OP_UNSIGN;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-V") || !strcmp(argv[i], "--verify")) {
+			mode = OP_VERIFY;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-i") || !strcmp(argv[i], "--imports")) {
+			if (argv[i+1] && argv[i+1][0] != '-') {
+				ordinal = (int) strtol(argv[++i], NULL, 0);
+			}
+			mode = OP_IMPORTS;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--objc")) {
+			mode = OP_OBJC;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--swift")) {
+			mode = OP_SWIFT;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--callgraph")) {
+			mode = OP_CALLGRAPH;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--cache")) {
+			if (argv[i+1] && argv[i+1][0] != '-') {
+				image = argv[++i];
+			}
+			mode = OP_CACHE;
+			continue;
+		}
 	}
 
 	if (mode == OP_NONE) {
@@ -99,17 +991,53 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	macho_t_64* macho = macho_open_64(argv[1]);
+	if (mode == OP_CACHE) {
+		return cache_info(argv[1], image);
+	}
+	if (mode == OP_DIFF) {
+		return diff(old_path, new_path);
+	}
+	if (mode == OP_CORPUS_BUILD) {
+		return macho_corpus_build_64(corpus, corpus_arg);
+	}
+	if (mode == OP_CORPUS_UPDATE) {
+		return corpus_update(corpus, corpus_arg, watch);
+	}
+	if (mode == OP_CORPUS_QUERY) {
+		return corpus_query(corpus, corpus_arg, corpus_binary);
+	}
+	if (mode == OP_SERVE) {
+		return serve(server, cache_size, huge);
+	}
+	if (mode == OP_SYMBOLICATE && server) {
+		if (offsets) {
+			error("--offsets needs the image parsed locally\n");
+			return -1;
+		}
+		return symbolicate_connect(argv[1], server, records);
+	}
+	if (mode == OP_THIN) {
+		return thin(argv[1], arch, output, NULL);
+	}
+	if (mode == OP_EXTRACT) {
+		return thin(argv[1], NULL, NULL, output);
+	}
+
+	// Searching, verifying and the call graph read the image front to back
+	macho_map_t_64* map = NULL;
+	macho_t_64* macho = open_mapped(argv[1], (mode == OP_SEARCH || mode == OP_VERIFY || mode == OP_CALLGRAPH
+			|| mode == OP_UNSIGN) ? MACHO_MAP_SEQUENTIAL : MACHO_MAP_NORMAL, &map);
 	if(macho == NULL) {
 		error("Unable to open macho file\n");
+		return -1;
 	}
 
 	switch (mode) {
 	case OP_VIRT:
 		{
-			uint64_t vaddr = get_virtual_address(macho, offset);
+			uint64_t vaddr = macho_offset_to_address_64(macho, offset);
 			if (vaddr > 0) {
-				printf("0x%08llx\n", vaddr);
+				printf("0x%08" PRIx64 "\n", vaddr);
 			} else {
 				printf("Not found...\n");
 			}
@@ -118,46 +1046,122 @@ int main(int argc, char* argv[])
 	case OP_SEARCH:
 		{
 		int found = 0;
-		for (i = 0; i < macho->size; i++) {
-			if (macho->data[i] != search[0]) {
-				continue;
-			}
-			if (memcmp(macho->data + i, search, search_len) != 0) {
-				continue;
-			}
-
-			// found match. go back to the beginning of the string
-			offset = i;
-			uint64_t saddr;
+		uint64_t k = 0;
+		macho_cstring_entry_t_64* entry = NULL;
+		macho_cstring_result_t_64* matches = NULL;
+		macho_xref_index_t_64* xrefs = NULL;
+		macho_cstring_index_t_64* strings = macho_cstring_index_load_64(macho);
+		if (strings && strings->count == 0) {
+			// No sections typed as C strings, so fall back to the whole file
+			ret = search_raw(macho, search, search_mode);
+			macho_cstring_index_free_64(strings);
+			break;
+		}
+		if (strings) {
+			matches = macho_find_cstrings_64(strings, search, search_mode);
+		}
+		if (matches == NULL) {
+			error("Unable to search strings\n");
+			macho_cstring_index_free_64(strings);
+			ret = -1;
+			break;
+		}
+		xrefs = macho_xref_index_load_64(macho);
+		for (k = 0; k < matches->count; k++) {
+			// the index already knows where the string starts and where it is mapped
+			entry = &strings->entries[matches->matches[k]];
+			uint64_t saddr = entry->address;
+			uint64_t references = 0;
 			found++;
 
-			while (offset > 0 && (macho->data[offset-1] != '\0')) {
-				offset--;
-			}
-			debug("Found match in string '%s', offset 0x%08x\n", macho->data + offset, offset);
-			saddr = get_virtual_address(macho, offset);
-			if (saddr == 0) {
-				error("Error: could not get virtual address for offset 0x%08llx\n", offset);
-				continue;
-			}
-			debug("Virtual address: 0x%08x\n", saddr);
-			int j;
-			for (j = 0; j < macho->size; j+=4) {
-				if (*(uint64_t*)(macho->data+j) == saddr) {
-					uint64_t vaddr = get_virtual_address(macho, j);
-					debug("found reference at offset 0x%08x, vaddr=0x%08x\n", j, vaddr);
-					offset = j;
-					while (offset > 0 && ((*(uint16_t*)(macho->data+offset) & 0xFF0F) != 0xB500)) {
-						offset -= 2;
-					}
-					debug("found push instruction at offset 0x%08x\n", offset);
-					printf("function 0x%08llx\n", get_virtual_address(macho, offset));
+			debug("Found match in string '%s', offset 0x%08" PRIx64 "\n", entry->string, entry->offset);
+			debug("Virtual address: 0x%08" PRIx64 "\n", saddr);
+			if (xrefs) {
+				// instruction pairs and stored pointers into any byte of the string
+				uint64_t first = 0;
+				uint64_t count = macho_xref_find_64(xrefs, saddr, saddr + entry->size + 1, &first);
+				for (; count > 0; count--, first++, references++) {
+					macho_xref_t_64* xref = &xrefs->xrefs[first];
+					printf("%s 0x%08" PRIx64 "\n", xref->kind == MACHO_XREF_POINTER ? "pointer" : "reference", xref->source);
 				}
+			} else {
+				references = search_pointers(macho, saddr);
+			}
+			if (references == 0) {
+				printf("string 0x%08" PRIx64 " no references\n", saddr);
 			}
 		}
 		if (!found) {
 			printf("string '%s' not found!\n", search);
 		}
+		macho_xref_index_free_64(xrefs);
+		macho_cstring_result_free_64(matches);
+		macho_cstring_index_free_64(strings);
+		}
+		break;
+	case OP_SYMBOLICATE:
+		ret = symbolicate(macho, records, offsets, -1, NULL);
+		break;
+	case OP_IMPORTS:
+		ret = imports_dump(macho, ordinal);
+		break;
+	case OP_OBJC:
+		ret = objc_dump(macho);
+		break;
+	case OP_SWIFT:
+		ret = swift_dump(macho);
+		break;
+	case OP_CALLGRAPH:
+		ret = callgraph_dump(macho);
+		break;
+	case OP_VERIFY:
+		{
+			macho_signature_verdict_t_64 verdict;
+			if (macho_verify_signature_64(macho, &verdict) < 0) {
+				error("Unable to verify code signature\n");
+				ret = -1;
+				break;
+			}
+			printf("signature: %s\n", macho_signature_status_string_64(verdict.status));
+			// Anything short of a valid signature fails the run
+			if (verdict.status != MACHO_SIGNATURE_VALID) {
+				ret = -1;
+			}
+			if (verdict.status == MACHO_SIGNATURE_UNSIGNED) {
+				break;
+			}
+			printf("identifier: %s\n", verdict.identifier ? verdict.identifier : "(none)");
+			printf("hash type: %u (%u bytes, %s)\n", verdict.hash_type, verdict.hash_size, verdict.backend);
+			printf("pages: %" PRIu64 " x 0x%x, code limit 0x%" PRIx64 "\n", verdict.page_count, verdict.page_size, verdict.code_limit);
+			if (verdict.status == MACHO_SIGNATURE_PAGE_MISMATCH) {
+				printf("first mismatch: page %" PRIu64 " (offset 0x%" PRIx64 ")\n", verdict.failed_page,
+						verdict.failed_page * verdict.page_size);
+			}
+			if (verdict.status == MACHO_SIGNATURE_SLOT_MISMATCH) {
+				printf("mismatch: special slot %u\n", verdict.failed_slot);
+			}
+		}
+		break;
+	case OP_UNSIGN:
+		{
+			int fd = -1;
+			macho_writer_t_64* writer = macho_writer_load_64(macho);
+			if (writer == NULL) {
+				error("Unable to create writer\n");
+				ret = -1;
+				break;
+			}
+			fd = open(argv[1], O_RDONLY);
+			macho_writer_set_source_fd_64(writer, fd);
+			if (macho_writer_remove_signature_64(writer) < 0
+					|| macho_writer_save_64(writer, output) < 0) {
+				error("Unable to write %s\n", output);
+				ret = -1;
+			}
+			if (fd >= 0) {
+				close(fd);
+			}
+			macho_writer_free_64(writer);
 		}
 		break;
 	case OP_INFO:
@@ -165,10 +1169,12 @@ int main(int argc, char* argv[])
 		break;
 	default:
 		printf("invalid mode?!\n");
+		ret = -1;
 		break;
 	}
 
-leave:
 	macho_free_64(macho);
-	return 0;
+	macho_map_free_64(map);
+	free(search);
+	return ret;
 }